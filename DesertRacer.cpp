@@ -17,6 +17,14 @@
 #include "racetrack.h" // Racetrack class
 #include "startup.h" // Startup screen
 #include "track_selection.h"
+#include "simulator.h" // Headless balancing runs
+#include "replay.h" // Headless replays of recorded races
+#include "netrace.h" // Multiplayer server / clients
+#include "telemetry.h" // Live telemetry stream
+#include "archive.h" // Race trace archives
+#include "jobbench.h" // Job system scaling benchmark
+#include "vecbench.h" // Vector layout benchmark
+#include "raceenv.h" // Headless race environment
 
 // Standard library
 using namespace std;
@@ -35,7 +43,7 @@ enum GameState
 	Paused
 };
 
-void main()
+int main(int argc, char* argv[])
 {
 	// Determines the speed of all elements in the game
 	const float kGameSpeed = 1;
@@ -47,6 +55,43 @@ void main()
 	// Control keybinding selection
 	const SControlKeybinding controlKeybind = kDefaultDvorakBind.kControlKeybind;
 
+	// Balancing runs race headless, no window
+	if (argc > 1 && argv[1] == SimulatorCommand::kFlag)
+	{
+		return SimulatorCommand::run(vector<string>(argv + 2, argv + argc), trackFolder + tracks.front());
+	}
+	if (argc > 1 && argv[1] == ReplayCommand::kFlag)
+	{
+		return ReplayCommand::run(vector<string>(argv + 2, argv + argc));
+	}
+	if (argc > 1 && argv[1] == NetCommand::kFlag)
+	{
+		return NetCommand::run(vector<string>(argv + 2, argv + argc), trackFolder + tracks.front());
+	}
+	if (argc > 1 && argv[1] == ArchiveCommand::kFlag)
+	{
+		return ArchiveCommand::run(vector<string>(argv + 2, argv + argc), trackFolder + tracks.front());
+	}
+	if (argc > 1 && argv[1] == JobBenchmarkCommand::kFlag)
+	{
+		return JobBenchmarkCommand::run(vector<string>(argv + 2, argv + argc), trackFolder + tracks.front());
+	}
+	if (argc > 1 && argv[1] == VectorBenchmarkCommand::kFlag)
+	{
+		return VectorBenchmarkCommand::run(vector<string>(argv + 2, argv + argc));
+	}
+	if (argc > 1 && argv[1] == EnvironmentCommand::kFlag)
+	{
+		return EnvironmentCommand::run(vector<string>(argv + 2, argv + argc), trackFolder + tracks.front());
+	}
+
+	// Races are played as usual, every tick's telemetry is streamed
+	string telemetryTarget;
+	if (argc > 2 && argv[1] == TelemetryStream::kFlag)
+	{
+		telemetryTarget = argv[2];
+	}
+
 	GameState state = Startup;
 
 	// Create a 3D engine
@@ -104,6 +149,10 @@ void main()
 				state = Playing;
 				// Create racetrack scene
 				defaultTrack = new DesertRacetrack(myEngine, trackFolder + tracks.at(trackIndex), controlKeybind);
+				if (!telemetryTarget.empty())
+				{
+					defaultTrack->streamTelemetry(telemetryTarget);
+				}
 				selectionScreen->remove(myEngine);
 				myEngine->StartMouseCapture();
 			}
@@ -169,4 +218,5 @@ void main()
 
 	// Delete the 3D engine
 	myEngine->Delete();
+	return 0;
 }
@@ -8,6 +8,8 @@
 
 #include <TL-Engine.h>
 #include <string>
+#include <cmath>
+#include <algorithm>
 #include "node.h"
 #include "ai.h"
 #include "collision.h"
@@ -15,14 +17,24 @@
 using namespace tle;
 using namespace desert;
 
-RNG HoverAI::speedRNG = {HoverAI::kMinSpeedRng, HoverAI::kMaxSpeedRng};
+const SHoverAITuning HoverAI::kDefaultTuning = {};
+const float HoverAI::kDegreesToRadians = 3.14159265358979f / 180.0f;
 
-HoverAI::HoverAI(IModel* m, string tag) : DesertVehicle(m, DesertVehicle::VehicleType::AI), kUniqueSpeed(speedRNG.getDecimalPoint())
+HoverAI::HoverAI(IModel* m, RNG random, string tag, const SHoverAITuning* tuning) : DesertVehicle(m, DesertVehicle::VehicleType::AI),
+	mTuning(tuning), kUniqueSpeed(random.getDecimalPoint(tuning->kMinSpeedRng, tuning->kMaxSpeedRng))
 {
 	mTag = tag;
-	mRadius = kCollisionRadius;
+	mState.thrust = mTuning->kInitialThrust;
+	mState.health = mTuning->kInitialHealth;
+	mRadius = mTuning->kCollisionRadius;
 	// Pushback after collisions
 	mFixed = false;
+
+	// Only orientation read the car needs, from here on it keeps its own heading
+	const SVector2D facing = getFacingVector2D();
+	mFacingScale = facing.length();
+	mInitialHeading = headingOf(facing);
+	mState.heading = mInitialHeading;
 	cout << "Hover AI created" << endl;
 }
 
@@ -31,18 +43,31 @@ HoverAI::~HoverAI()
 	cout << "Hover AI destroyed" << endl;
 }
 
-void HoverAI::follow(ISceneNode* destination)
+void HoverAI::setRacingLine(const RacingLine* line)
+{
+	mRacingLine = (line && !line->isEmpty()) ? line : nullptr;
+	mState.lineDistance = mRacingLine ? mRacingLine->project(position2D()) : 0.0f;
+}
+
+void HoverAI::setFlowField(const FlowField* field)
+{
+	mFlowField = (field && !field->isEmpty()) ? field : nullptr;
+}
+
+void HoverAI::follow(SVector2D destination)
 {
-	currentTargetNode = destination;
-	targetVector = { currentTargetNode->GetX(), currentTargetNode->GetZ() };
+	mState.targetVector = destination;
+	mState.following = true;
 
-	++waypointIndex;
+	++mState.waypointIndex;
 }
 
-bool HoverAI::updateScene(const float kGameSpeed, const float kDeltaTime, const float distanceToPlayer, bool ahead)
+HoverAI::SSteering HoverAI::steer(const SVehicleSnapshot& self, const SVehicleSnapshot& player, const float kGameSpeed, const float kDeltaTime) const
 {
+	// Rubberbanding
+	//const bool ahead = DesertVehicle::compareSnapshots(self, player);
 	//int rubberMultiplier = (ahead) ? 1 : -1;
-	//float cappedDistance = distanceToPlayer * rubberMultiplier;
+	//float cappedDistance = (player.position - self.position).length() * rubberMultiplier;
 
 	//if (cappedDistance > kMaxRubberDistance)
 	//{
@@ -56,31 +81,162 @@ bool HoverAI::updateScene(const float kGameSpeed, const float kDeltaTime, const
 
 	//SVector2D thrustVector = kThrustVector * (cappedDistance / kRubberDivider);
 
-	if (mInvTimer > 0)
+	const SHoverAIDriver driver = { mTuning, kUniqueSpeed, mFacingScale, mRacingLine, mFlowField };
+	return steer(driver, mState, self, kGameSpeed, kDeltaTime);
+}
+
+HoverAI::SSteering HoverAI::steer(const SHoverAIDriver& driver, const SHoverAIState& state, const SVehicleSnapshot& self, const float kGameSpeed, const float kDeltaTime)
+{
+	const SHoverAITuning* tuning = driver.tuning;
+	SSteering steering = { state.heading, state.lineDistance, { 0, 0 }, state.invTimer, false };
+
+	if (steering.invTimer > 0)
 	{
-		mInvTimer -= kDeltaTime;
+		steering.invTimer -= kDeltaTime;
 	}
-	else if (mInvTimer < 0)
+	else if (steering.invTimer < 0)
 	{
-		mInvTimer = 0;
+		steering.invTimer = 0;
 	}
 
+	const SVector2D fullThrust = tuning->kThrustVector * kGameSpeed * driver.uniqueSpeed;
+	// Knocked away from where the car should be, steering straight to the target may hit a wall
+	bool offCourse = false;
+
+	// Racing line: one lookup ahead of the car's progress, speed from the line's profile
+	if (driver.racingLine)
+	{
+		const RacingLine* line = driver.racingLine;
+		steering.lineDistance = line->project(self.position, state.lineDistance, tuning->kLineSearchWindow);
+		const RacingLine::SSample ahead = line->sample(steering.lineDistance + tuning->kLineLookahead);
+		steering.heading = turnTowards(state.heading, ahead.position - self.position, tuning->kTurnRate, kDeltaTime);
+
+		// Full thrust well under the target speed, none over it (drag slows the car down)
+		const float speedMissing = ahead.targetSpeed * driver.uniqueSpeed - self.movement.length();
+		const float throttle = std::max(0.0f, std::min(speedMissing / tuning->kThrottleBand, 1.0f));
+		steering.thrust = headingVector(steering.heading) * driver.facingScale * fullThrust * throttle;
+
+		const SVector2D fromLine = self.position - line->sample(steering.lineDistance).position;
+		offCourse = fromLine.lengthSquared() > tuning->kRecoveryDistance * tuning->kRecoveryDistance;
+	}
 	// If car is after some target
-	if (currentTargetNode != nullptr)
+	else if (state.following)
 	{
-		node->LookAt(currentTargetNode);
+		const SVector2D toTarget = state.targetVector - self.position;
+		steering.heading = turnTowards(state.heading, toTarget, tuning->kTurnRate, kDeltaTime);
 
 		// Update movement vector
-		movementThisFrame += getFacingVector2D() * (kThrustVector * kGameSpeed * kUniqueSpeed);
-		// Returns true if car has almost reached target
-		return ((position2D() - targetVector).length()) <= kWaypointArrivalDistance;
+		const SVector2D direction = headingVector(steering.heading);
+		steering.thrust = direction * driver.facingScale * fullThrust;
+
+		// Car has almost reached target, or it has gone past it
+		const float distanceSquared = toTarget.lengthSquared();
+		steering.reachedWaypoint = distanceSquared <= tuning->kWaypointArrivalDistance * tuning->kWaypointArrivalDistance ||
+			(distanceSquared <= tuning->kWaypointPassDistance * tuning->kWaypointPassDistance && direction.dot(toTarget) < 0);
+
+		// Just bounced off something
+		offCourse = state.invTimer > 0;
 	}
-	return false;
+
+	// Recovery: the flow field leads to the next checkpoint around the obstacles
+	if (offCourse && driver.flowField)
+	{
+		const SVector2D way = driver.flowField->direction(self.stage % driver.flowField->getGatesNumber(), self.position);
+
+		if (!way.isZero())
+		{
+			steering.heading = turnTowards(state.heading, way, tuning->kTurnRate, kDeltaTime);
+			steering.thrust = headingVector(steering.heading) * driver.facingScale * fullThrust * tuning->kRecoveryThrottle;
+		}
+	}
+	return steering;
+}
+
+float HoverAI::turnTowards(float heading, SVector2D direction, const float turnRate, const float kDeltaTime)
+{
+	if (direction.isZero())
+	{
+		return heading;
+	}
+
+	// No faster than the turn rate
+	const float maxTurn = turnRate * kDeltaTime;
+	const float turn = std::max(-maxTurn, std::min(wrapDegrees(headingOf(direction) - heading), maxTurn));
+	return wrapDegrees(heading + turn);
+}
+
+bool HoverAI::applySteering(const SSteering& steering)
+{
+	mState.invTimer = steering.invTimer;
+	mState.lineDistance = steering.lineDistance;
+
+	// Orientation is written once, and only if the car turned
+	if (steering.heading != mState.heading)
+	{
+		mState.heading = steering.heading;
+		setRotationY(mState.heading);
+	}
+
+	movementThisFrame += steering.thrust;
+	return steering.reachedWaypoint;
+}
+
+void HoverAI::applyThrust(SVector2D thrust)
+{
+	movementThisFrame += thrust;
+}
+
+bool HoverAI::advanceOnLine(const float kDeltaTime)
+{
+	if (!mRacingLine)
+	{
+		return false;
+	}
+
+	const float speed = mRacingLine->sample(mState.lineDistance).targetSpeed * kUniqueSpeed;
+	mState.lineDistance = fmod(mState.lineDistance + speed * kDeltaTime, mRacingLine->getLength());
+	const RacingLine::SSample next = mRacingLine->sample(mState.lineDistance);
+
+	// Position and orientation reach the engine together, in one write
+	setPositionByVector({ next.position.x, getY(), next.position.y });
+	mState.heading = headingOf(next.direction);
+	setRotationY(mState.heading);
+	movementThisFrame = next.direction * speed;
+
+	if (mState.invTimer > 0)
+	{
+		mState.invTimer = std::max(0.0f, mState.invTimer - kDeltaTime);
+	}
+	return true;
+}
+
+float HoverAI::headingOf(SVector2D direction)
+{
+	return atan2(direction.x, direction.y) / kDegreesToRadians;
+}
+
+SVector2D HoverAI::headingVector(float heading)
+{
+	return { sin(heading * kDegreesToRadians), cos(heading * kDegreesToRadians) };
+}
+
+float HoverAI::wrapDegrees(float degrees)
+{
+	degrees = fmod(degrees, 360.0f);
+	if (degrees > 180.0f)
+	{
+		degrees -= 360.0f;
+	}
+	else if (degrees <= -180.0f)
+	{
+		degrees += 360.0f;
+	}
+	return degrees;
 }
 
 void HoverAI::modifyMovementVector(SVector2D change)
 {
-	movementThisFrame = change * kBounce;
+	movementThisFrame = change * mTuning->kBounce;
 	mVectorModified = true;
 }
 
@@ -88,13 +244,13 @@ void HoverAI::applyMovementVector(const float kDeltaTime)
 {
 	// Apply movement vector, drag
 	moveByVector(movementThisFrame * kDeltaTime);
-	movementThisFrame *= kDrag;
+	movementThisFrame *= mTuning->kDrag;
 }
 
 void HoverAI::bounce(Collision::CollisionAxis reverse)
 {
 	// Reverse movement vector
-	movementThisFrame = -movementThisFrame * kBounce;
+	movementThisFrame = -movementThisFrame * mTuning->kBounce;
 }
 
 //void HoverAI::stop()
@@ -106,57 +262,82 @@ void HoverAI::bounce(Collision::CollisionAxis reverse)
 void HoverAI::reset()
 {
 	resetPosition();
+	mState.heading = mInitialHeading;
+	setRotationY(mInitialHeading);
+	mState.lineDistance = mRacingLine ? mRacingLine->project(position2D()) : 0.0f;
 	resetStage();
 	movementThisFrame = { 0, 0 };
-	targetVector = { 0, 0 };
-	currentTargetNode = nullptr;
-	waypointIndex = 0;
-	mCollided = false;
-	mHealth = kInitialHealth;
-	mThrust = kInitialThrust;
-	mInvTimer = 0.0f;
+	mState.targetVector = { 0, 0 };
+	mState.following = false;
+	mState.waypointIndex = 0;
+	mState.collided = false;
+	mState.health = mTuning->kInitialHealth;
+	mState.thrust = mTuning->kInitialThrust;
+	mState.invTimer = 0.0f;
 }
 
 void HoverAI::reduceHealth(const int reduction)
 {
-	mHealth -= reduction;
+	mState.health -= reduction;
 
-	if (mHealth < kSpeedHealthNerf)
+	if (mState.health < mTuning->kSpeedHealthNerf)
 	{
-		mThrust = kNerfedThrust;
+		mState.thrust = mTuning->kNerfedThrust;
 	}
 }
 
 void HoverAI::setCollided()
 {
-	if (!mInvTimer)
+	if (!mState.invTimer)
 	{
-		mCollided = true;
-		mInvTimer = kInvTime;
+		mState.collided = true;
+		mState.invTimer = mTuning->kInvTime;
 	}
 }
 
 void HoverAI::resetCollided()
 {
-	mCollided = false;
+	mState.collided = false;
+}
+
+void HoverAI::saveState(SnapshotWriter& writer) const
+{
+	DesertVehicle::saveState(writer);
+	writer.write(mState);
+}
+
+void HoverAI::loadState(SnapshotReader& reader)
+{
+	DesertVehicle::loadState(reader);
+	reader.read(mState);
+}
+
+float HoverAI::getUniqueSpeed() const
+{
+	return kUniqueSpeed;
 }
 
 const float HoverAI::getCollisionRadius() const
 {
-	return kCollisionRadius;
+	return mTuning->kCollisionRadius;
 }
 
 unsigned int HoverAI::getWaypointIndex() const
 {
-	return waypointIndex;
+	return mState.waypointIndex;
+}
+
+int HoverAI::getHealth() const
+{
+	return mState.health;
 }
 
 bool HoverAI::hasCollided() const
 {
-	return mCollided;
+	return mState.collided;
 }
 
 void HoverAI::resetWaypoint()
 {
-	waypointIndex = 0;
+	mState.waypointIndex = 0;
 }
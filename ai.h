@@ -19,31 +19,162 @@
 #include "node.h"
 #include "vehicle.h"
 #include "rng.h"
+#include "racingline.h"
+#include "flowfield.h"
 
 
 namespace desert {
 	/**
-	* Non-player hover cars capable of following ISceneNodes, also offer collision detection
+	* Hover AI tuning constants
+	* One read-only table is shared by every AI car instead of each car holding its own copy
+	*/
+	struct SHoverAITuning
+	{
+		// Unique speed range (in hundredths)
+		int kMinSpeedRng = 80;
+		int kMaxSpeedRng = 100;
+		float kWaypointArrivalDistance = 4.0f;
+		// A waypoint left behind within this distance counts as reached (the car cannot turn on the spot)
+		float kWaypointPassDistance = 15.0f;
+		// Maximum turning speed (degrees per second), gives the car a turning radius
+		float kTurnRate = 360.0f;
+		float kCollisionRadius = 3.0f;
+		// Bounce multiplier
+		float kBounce = 4.5f;
+		float kDrag = 0.92;
+		// Much less health than players have
+		int kInitialHealth = 20;
+		int kSpeedHealthNerf = 10;
+
+		SVector2D kThrustVector = { 8.0f, 8.0f };
+
+		float kInitialThrust = 1.0f;
+		float kNerfedThrust = 0.5f;
+		float kMaxRubberDistance = 100;
+		float kRubberDivider = -30;
+
+		float kInvTime = 5;
+
+		// Racing line following
+		// Distance ahead of the car's progress it steers towards
+		float kLineLookahead = 12.0f;
+		// Distance around the last progress searched for the new one
+		float kLineSearchWindow = 20.0f;
+		// Speed below the target at which the car stops using full thrust
+		float kThrottleBand = 10.0f;
+
+		// Recovery (flow field following)
+		// Distance from the racing line at which the car counts as knocked off it
+		float kRecoveryDistance = 10.0f;
+		// Thrust used while finding the way back
+		float kRecoveryThrottle = 0.6f;
+	};
+
+	/**
+	* Non-player hover cars capable of following waypoints, also offer collision detection
 	*/
 	class HoverAI : public DesertVehicle
 	{
 	public:
+		// Tuning used by every AI car unless told otherwise
+		static const SHoverAITuning kDefaultTuning;
+
+		// Result of steering, kept apart from the car until every AI has been steered
+		struct SSteering
+		{
+			// Heading angle to face (degrees, 0 is +Z)
+			float heading;
+			// Progress along the racing line
+			float lineDistance;
+			// Added to the movement vector
+			SVector2D thrust;
+			float invTimer;
+			bool reachedWaypoint;
+		};
+
+		// Everything that changes while racing, packed together
+		struct SHoverAIState
+		{
+			SVector2D targetVector;
+			// Degrees around Y, 0 is facing +Z, positive turns right
+			float heading = 0.0f;
+			float lineDistance = 0.0f;
+			float thrust = 0.0f;
+			float invTimer = 0.0f;
+			unsigned int waypointIndex = 0;
+			int health = 0;
+			bool collided = false;
+			bool following = false;
+		};
+
+		// What steering reads besides the state, fixed for a car's lifetime
+		struct SHoverAIDriver
+		{
+			const SHoverAITuning* tuning;
+			float uniqueSpeed;
+			// The model's scale along its facing axis
+			float facingScale;
+			const RacingLine* racingLine;
+			const FlowField* flowField;
+		};
+
+		/**
+		* The steering rules on their own, no car needed (headless races use them too)
+		* @param state State of the car being steered
+		* @param self The car's snapshot
+		*/
+		static SSteering steer(const SHoverAIDriver& driver, const SHoverAIState& state, const SVehicleSnapshot& self, const float kGameSpeed, const float kDeltaTime);
+		// Heading angle of a direction on the ground
+		static float headingOf(SVector2D direction);
+		// Unit direction on the ground of a heading angle
+		static SVector2D headingVector(float heading);
+		// Bring an angle to (-180, 180]
+		static float wrapDegrees(float degrees);
+
 		/**
 		* @param model The hover car IModel
+		* @param random Random stream for this car (picks its unique speed)
+		* @param tuning Shared tuning table
 		*/
-		HoverAI(tle::IModel* model, std::string tag = "");
+		HoverAI(tle::IModel* model, RNG random, std::string tag = "", const SHoverAITuning* tuning = &kDefaultTuning);
 		~HoverAI();
 		/**
-		* Face the Scene Node and start moving towards it
-		* @param destination ISceneNode to move to
+		* Face the point and start moving towards it
+		* @param destination Waypoint position to move to
+		*/
+		void follow(SVector2D destination);
+		/**
+		* Follow a racing line instead of the waypoints
+		* @param line Solved racing line, must outlive the car (nullptr goes back to waypoints)
 		*/
-		void follow(tle::ISceneNode* destination);
+		void setRacingLine(const RacingLine* line);
 		/**
-		* Update model position based on movement vector / collisions
+		* Find the way to the next checkpoint through a flow field when knocked off course
+		* @param field Flow field with one gate per checkpoint, must outlive the car
+		*/
+		void setFlowField(const FlowField* field);
+		/**
+		* Decide where to go this frame
+		* Only reads the snapshots and this car's own state, so every AI can be steered at the same time
+		* @param self This car's snapshot from the previous tick
+		* @param player The player's snapshot from the previous tick
 		* @param kGameSpeed Global game speed
 		* @param kDeltaTime Time elapsed since last frame
 		*/
-		bool updateScene(const float kGameSpeed, const float kDeltaTime, const float distanceToPlayer, bool ahead);
+		SSteering steer(const SVehicleSnapshot& self, const SVehicleSnapshot& player, const float kGameSpeed, const float kDeltaTime) const;
+		/**
+		* Turn the car (one orientation write) and add the thrust decided by steer()
+		* @return True if car has almost reached its target
+		*/
+		bool applySteering(const SSteering& steering);
+		// Add thrust again without steering (reduced rate updates keep the last decision between steers)
+		void applyThrust(SVector2D thrust);
+		/**
+		* Cheap update for cars nobody is looking at: glide along the racing line at the pace
+		* its speed profile expects, leaving the car on the line with a matching movement vector
+		* @return False if the car has no racing line to glide on
+		*/
+		bool advanceOnLine(const float kDeltaTime);
 
 		void modifyMovementVector(SVector2D change);
 		// Move model by movement vector
@@ -62,39 +193,33 @@ namespace desert {
 
 		const float getCollisionRadius() const;
 		unsigned int getWaypointIndex() const;
+		int getHealth() const;
 		bool hasCollided() const;
 		void reset();
 		void resetWaypoint();
+		void saveState(SnapshotWriter& writer) const;
+		void loadState(SnapshotReader& reader);
+		// Unique speed (picked from the random stream given to the constructor)
+		float getUniqueSpeed() const;
 	protected:
-		static constexpr int kMinSpeedRng = 80;
-		static constexpr int kMaxSpeedRng = 100;
-		static RNG speedRNG;
-		const float kWaypointArrivalDistance = 4.0f;
-		const float kCollisionRadius = 3.0f;
-		// Bounce multiplier
-		const float kBounce = 4.5f;
-		const float kDrag = 0.92;
-		// Much less health than players have
-		const int kInitialHealth = 20;
-		const int kSpeedHealthNerf = 10;
-
-		SVector2D targetVector, facingVector;
-		const SVector2D kThrustVector = { 8.0f, 8.0f };
-
-		const float kInitialThrust = 1.0f;
-		const float kNerfedThrust = 0.5f;
-		float mThrust = kInitialThrust;
-		unsigned int waypointIndex = 0;
-		int mHealth = kInitialHealth;
-		bool mCollided = false;
-		const float kMaxRubberDistance = 100;
-		const float kRubberDivider = -30;
-
-		const float kInvTime = 5;
-		float mInvTimer = 0;
-		const float kUniqueSpeed;
+		// Shared tuning table
+		const SHoverAITuning* mTuning;
+
+		// Heading after turning towards a direction for a frame, no faster than the turn rate
+		static float turnTowards(float heading, SVector2D direction, const float turnRate, const float kDeltaTime);
 
-		tle::ISceneNode* currentTargetNode = nullptr;
+		static const float kDegreesToRadians;
+
+		// Hot per-frame state
+		SHoverAIState mState;
+		const float kUniqueSpeed;
+		// Orientation when loaded, restored on reset
+		float mInitialHeading;
+		// The model's scale along its facing axis, thrust is scaled by it
+		float mFacingScale;
+		// Optional racing line / flow field, shared by every AI
+		const RacingLine* mRacingLine = nullptr;
+		const FlowField* mFlowField = nullptr;
 	};
 };
 
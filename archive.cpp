@@ -0,0 +1,766 @@
+/**
+ * @file archive.cpp
+ * Columnar, compressed archive of simulated race traces, for analysing millions of laps offline
+ *
+ * @author Jacob Sanchez Perez (G20812080) <jsanchez-perez@uclan.ac.uk>
+ * Games Concepts (CO1301), University of Central Lancashire
+ */
+
+#include <iostream>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <algorithm>
+#include "jobs.h"
+#include "simulator.h"
+#include "archive.h"
+
+using namespace std;
+using namespace desert;
+
+static const uint32_t kFileMagic = 0x41525244;
+static const uint32_t kFileVersion = 1;
+// Positions and speeds are stored in 1 / kFixedPoint units
+static const float kFixedPoint = 64.0f;
+static const char* const kColumnNames[kTraceColumnsNumber] = { "race", "tick", "vehicle", "x", "z", "speed", "stage" };
+
+// Value of a column as stored, before the delta
+static int64_t storedValue(const STraceRow& row, int column)
+{
+	switch (column)
+	{
+	case RaceColumn:
+		return row.race;
+	case TickColumn:
+		return row.tick;
+	case VehicleColumn:
+		return row.vehicle;
+	case XColumn:
+		return llround(row.x * kFixedPoint);
+	case ZColumn:
+		return llround(row.z * kFixedPoint);
+	case SpeedColumn:
+		return llround(row.speed * kFixedPoint);
+	default:
+		return row.stage;
+	}
+}
+
+// Small magnitudes of either sign in few bytes: zigzag, then 7 bits a byte
+static void writeVarint(int64_t value, vector<uint8_t>& out)
+{
+	uint64_t zigzag = (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+	while (zigzag >= 0x80)
+	{
+		out.push_back(static_cast<uint8_t>(zigzag | 0x80));
+		zigzag >>= 7;
+	}
+	out.push_back(static_cast<uint8_t>(zigzag));
+}
+
+static bool readVarint(const uint8_t*& data, const uint8_t* end, int64_t& value)
+{
+	uint64_t zigzag = 0;
+	for (int shift = 0; shift < 64 && data < end; shift += 7)
+	{
+		const uint8_t byte = *data++;
+		zigzag |= static_cast<uint64_t>(byte & 0x7f) << shift;
+		if (!(byte & 0x80))
+		{
+			value = static_cast<int64_t>(zigzag >> 1) ^ -static_cast<int64_t>(zigzag & 1);
+			return true;
+		}
+	}
+	return false;
+}
+
+// Lengths past a token's nibble: bytes of 255 and the rest
+static void writeLength(size_t length, vector<uint8_t>& out)
+{
+	for (; length >= 255; length -= 255)
+	{
+		out.push_back(255);
+	}
+	out.push_back(static_cast<uint8_t>(length));
+}
+
+static bool readLength(const uint8_t* data, size_t size, size_t& position, size_t& length)
+{
+	uint8_t byte = 255;
+	while (byte == 255)
+	{
+		if (position >= size)
+		{
+			return false;
+		}
+		byte = data[position++];
+		length += byte;
+	}
+	return true;
+}
+
+
+void BlockCompressor::compress(const uint8_t* data, size_t size, vector<uint8_t>& compressed)
+{
+	const size_t kNone = numeric_limits<size_t>::max();
+	// Last position of every hashed 4 bytes
+	vector<size_t> table(size_t(1) << kHashBits, kNone);
+
+	size_t anchor = 0, i = 0;
+	// A sequence: token (literals / match length nibbles), literals, 16 bit offset, lengths past 15
+	auto writeSequence = [&](size_t literals, size_t offset, size_t match)
+	{
+		const size_t matchCode = match ? match - kMinMatch : 0;
+		compressed.push_back(static_cast<uint8_t>((min<size_t>(literals, 15) << 4) | min<size_t>(matchCode, 15)));
+		if (literals >= 15)
+		{
+			writeLength(literals - 15, compressed);
+		}
+		compressed.insert(compressed.end(), data + anchor, data + anchor + literals);
+		if (match)
+		{
+			compressed.push_back(static_cast<uint8_t>(offset));
+			compressed.push_back(static_cast<uint8_t>(offset >> 8));
+			if (matchCode >= 15)
+			{
+				writeLength(matchCode - 15, compressed);
+			}
+		}
+	};
+
+	while (i + kMinMatch <= size)
+	{
+		uint32_t word;
+		memcpy(&word, data + i, sizeof(word));
+		const size_t hash = (word * 2654435761u) >> (32 - kHashBits);
+		const size_t candidate = table[hash];
+		table[hash] = i;
+
+		if (candidate != kNone && i - candidate <= kMaxOffset && !memcmp(data + candidate, data + i, kMinMatch))
+		{
+			size_t length = kMinMatch;
+			while (i + length < size && data[candidate + length] == data[i + length])
+			{
+				++length;
+			}
+			writeSequence(i - anchor, i - candidate, length);
+			i += length;
+			anchor = i;
+		}
+		else
+		{
+			++i;
+		}
+	}
+
+	// Whatever is left ends the block as literals
+	writeSequence(size - anchor, 0, 0);
+}
+
+bool BlockCompressor::decompress(const uint8_t* compressed, size_t compressedSize, size_t size, vector<uint8_t>& decompressed)
+{
+	decompressed.resize(size);
+	uint8_t* out = decompressed.data();
+	size_t in = 0, written = 0;
+
+	while (in < compressedSize)
+	{
+		const uint8_t token = compressed[in++];
+		size_t literals = token >> 4;
+		if ((literals == 15 && !readLength(compressed, compressedSize, in, literals)) ||
+			in + literals > compressedSize || written + literals > size)
+		{
+			return false;
+		}
+		memcpy(out + written, compressed + in, literals);
+		in += literals;
+		written += literals;
+
+		// The last sequence has no match
+		if (in == compressedSize)
+		{
+			break;
+		}
+
+		if (in + 2 > compressedSize)
+		{
+			return false;
+		}
+		const size_t offset = compressed[in] | (compressed[in + 1] << 8);
+		in += 2;
+		size_t match = token & 15;
+		if ((match == 15 && !readLength(compressed, compressedSize, in, match)) || !offset || offset > written)
+		{
+			return false;
+		}
+		match += kMinMatch;
+		if (written + match > size)
+		{
+			return false;
+		}
+
+		// Matches may overlap what they write (runs), byte by byte then
+		const uint8_t* from = out + written - offset;
+		if (offset >= match)
+		{
+			memcpy(out + written, from, match);
+		}
+		else
+		{
+			for (size_t j = 0; j < match; j++)
+			{
+				out[written + j] = from[j];
+			}
+		}
+		written += match;
+	}
+	return written == size;
+}
+
+
+TraceArchiveWriter::~TraceArchiveWriter()
+{
+	close();
+}
+
+bool TraceArchiveWriter::open(const string& filename)
+{
+	mFile.open(filename, ios::binary | ios::trunc);
+
+	if (!mFile.is_open())
+	{
+		cout << "File IO error when opening " << filename << endl;
+		return false;
+	}
+
+	mFile.write(reinterpret_cast<const char*>(&kFileMagic), sizeof(kFileMagic));
+	mFile.write(reinterpret_cast<const char*>(&kFileVersion), sizeof(kFileVersion));
+	mOffset = sizeof(kFileMagic) + sizeof(kFileVersion);
+	mRows.clear();
+	mRows.reserve(kBlockRows);
+	mBlocks.clear();
+	mRowsNumber = 0;
+	return true;
+}
+
+void TraceArchiveWriter::add(const STraceRow& row)
+{
+	mRows.push_back(row);
+	++mRowsNumber;
+	if (mRows.size() == kBlockRows)
+	{
+		writeBlock();
+	}
+}
+
+bool TraceArchiveWriter::close()
+{
+	if (!mFile.is_open())
+	{
+		return false;
+	}
+
+	writeBlock();
+
+	// Index: every block, then where it starts (read from the end of the file)
+	const uint64_t indexOffset = mOffset;
+	const uint32_t blocks = static_cast<uint32_t>(mBlocks.size());
+	mFile.write(reinterpret_cast<const char*>(&blocks), sizeof(blocks));
+	for (const SArchiveBlock& block : mBlocks)
+	{
+		mFile.write(reinterpret_cast<const char*>(&block.offset), sizeof(block.offset));
+		mFile.write(reinterpret_cast<const char*>(&block.rows), sizeof(block.rows));
+		mFile.write(reinterpret_cast<const char*>(&block.firstRace), sizeof(block.firstRace));
+		mFile.write(reinterpret_cast<const char*>(&block.lastRace), sizeof(block.lastRace));
+		mFile.write(reinterpret_cast<const char*>(&block.minTick), sizeof(block.minTick));
+		mFile.write(reinterpret_cast<const char*>(&block.maxTick), sizeof(block.maxTick));
+		mFile.write(reinterpret_cast<const char*>(block.compressedBytes), sizeof(block.compressedBytes));
+		mFile.write(reinterpret_cast<const char*>(block.encodedBytes), sizeof(block.encodedBytes));
+	}
+	mFile.write(reinterpret_cast<const char*>(&indexOffset), sizeof(indexOffset));
+	mFile.write(reinterpret_cast<const char*>(&kFileMagic), sizeof(kFileMagic));
+	mOffset = static_cast<uint64_t>(mFile.tellp());
+
+	const bool good = mFile.good();
+	mFile.close();
+	return good;
+}
+
+long long TraceArchiveWriter::getRowsNumber() const
+{
+	return mRowsNumber;
+}
+
+uint64_t TraceArchiveWriter::getBytesWritten() const
+{
+	return mOffset;
+}
+
+void TraceArchiveWriter::writeBlock()
+{
+	if (mRows.empty())
+	{
+		return;
+	}
+
+	SArchiveBlock block;
+	block.offset = mOffset;
+	block.rows = static_cast<uint32_t>(mRows.size());
+	block.firstRace = mRows.front().race;
+	block.lastRace = mRows.back().race;
+	block.minTick = numeric_limits<uint32_t>::max();
+	for (const STraceRow& row : mRows)
+	{
+		block.firstRace = min(block.firstRace, row.race);
+		block.lastRace = max(block.lastRace, row.race);
+		block.minTick = min(block.minTick, row.tick);
+		block.maxTick = max(block.maxTick, row.tick);
+	}
+
+	for (int column = 0; column < kTraceColumnsNumber; column++)
+	{
+		mEncoded.clear();
+		int64_t previous = 0;
+		for (const STraceRow& row : mRows)
+		{
+			const int64_t value = storedValue(row, column);
+			writeVarint(value - previous, mEncoded);
+			previous = value;
+		}
+
+		mCompressed.clear();
+		BlockCompressor::compress(mEncoded.data(), mEncoded.size(), mCompressed);
+		mFile.write(reinterpret_cast<const char*>(mCompressed.data()), mCompressed.size());
+		block.compressedBytes[column] = static_cast<uint32_t>(mCompressed.size());
+		block.encodedBytes[column] = static_cast<uint32_t>(mEncoded.size());
+		mOffset += mCompressed.size();
+	}
+
+	mBlocks.push_back(block);
+	mRows.clear();
+}
+
+
+bool TraceArchiveReader::open(const string& filename)
+{
+	mFile.close();
+	mFile.clear();
+	mFile.open(filename, ios::binary);
+	mBlocks.clear();
+	mChunkOffsets.clear();
+	mRowsNumber = 0;
+	mBytesRead = 0;
+
+	if (!mFile.is_open())
+	{
+		cout << "File IO error when opening " << filename << endl;
+		return false;
+	}
+
+	uint32_t magic = 0, version = 0, endMagic = 0, blocks = 0;
+	uint64_t indexOffset = 0;
+	mFile.read(reinterpret_cast<char*>(&magic), sizeof(magic));
+	mFile.read(reinterpret_cast<char*>(&version), sizeof(version));
+	mFile.seekg(-static_cast<int>(sizeof(indexOffset) + sizeof(endMagic)), ios::end);
+	mFile.read(reinterpret_cast<char*>(&indexOffset), sizeof(indexOffset));
+	mFile.read(reinterpret_cast<char*>(&endMagic), sizeof(endMagic));
+
+	if (!mFile.good() || magic != kFileMagic || version != kFileVersion || endMagic != kFileMagic)
+	{
+		cout << filename << " is not a trace archive (or is from another version, or was not closed)" << endl;
+		return false;
+	}
+
+	mFile.seekg(indexOffset);
+	mFile.read(reinterpret_cast<char*>(&blocks), sizeof(blocks));
+	mBlocks.resize(mFile.good() ? blocks : 0);
+	for (SArchiveBlock& block : mBlocks)
+	{
+		mFile.read(reinterpret_cast<char*>(&block.offset), sizeof(block.offset));
+		mFile.read(reinterpret_cast<char*>(&block.rows), sizeof(block.rows));
+		mFile.read(reinterpret_cast<char*>(&block.firstRace), sizeof(block.firstRace));
+		mFile.read(reinterpret_cast<char*>(&block.lastRace), sizeof(block.lastRace));
+		mFile.read(reinterpret_cast<char*>(&block.minTick), sizeof(block.minTick));
+		mFile.read(reinterpret_cast<char*>(&block.maxTick), sizeof(block.maxTick));
+		mFile.read(reinterpret_cast<char*>(block.compressedBytes), sizeof(block.compressedBytes));
+		mFile.read(reinterpret_cast<char*>(block.encodedBytes), sizeof(block.encodedBytes));
+
+		uint64_t offset = block.offset;
+		for (int column = 0; column < kTraceColumnsNumber; column++)
+		{
+			mChunkOffsets.push_back(offset);
+			offset += block.compressedBytes[column];
+		}
+		mRowsNumber += block.rows;
+	}
+
+	if (!mFile.good())
+	{
+		cout << filename << " has a truncated or corrupt index" << endl;
+		mBlocks.clear();
+		mChunkOffsets.clear();
+		mRowsNumber = 0;
+		return false;
+	}
+	return true;
+}
+
+const vector<SArchiveBlock>& TraceArchiveReader::getBlocks() const
+{
+	return mBlocks;
+}
+
+long long TraceArchiveReader::getRowsNumber() const
+{
+	return mRowsNumber;
+}
+
+void TraceArchiveReader::findBlocks(uint32_t race, uint32_t tick, vector<int>& blocks) const
+{
+	blocks.clear();
+	// Races are in order, so the first block that can hold the race is found by halves
+	const auto first = lower_bound(mBlocks.begin(), mBlocks.end(), race,
+		[](const SArchiveBlock& block, uint32_t value) { return block.lastRace < value; });
+	for (auto it = first; it != mBlocks.end() && it->firstRace <= race; ++it)
+	{
+		if (tick >= it->minTick && tick <= it->maxTick)
+		{
+			blocks.push_back(static_cast<int>(it - mBlocks.begin()));
+		}
+	}
+}
+
+bool TraceArchiveReader::readColumn(int block, TraceColumn column, vector<int64_t>& values)
+{
+	const SArchiveBlock& info = mBlocks[block];
+	const uint32_t bytes = info.compressedBytes[column];
+
+	// Only this column's chunk is read
+	mCompressed.resize(bytes);
+	mFile.clear();
+	mFile.seekg(mChunkOffsets[block * kTraceColumnsNumber + column]);
+	mFile.read(reinterpret_cast<char*>(mCompressed.data()), bytes);
+	if (!mFile.good() || !BlockCompressor::decompress(mCompressed.data(), bytes, info.encodedBytes[column], mEncoded))
+	{
+		return false;
+	}
+	mBytesRead += bytes;
+
+	values.resize(info.rows);
+	const uint8_t* data = mEncoded.data();
+	const uint8_t* end = data + mEncoded.size();
+	int64_t value = 0;
+	for (int64_t& stored : values)
+	{
+		int64_t delta = 0;
+		if (!readVarint(data, end, delta))
+		{
+			return false;
+		}
+		value += delta;
+		stored = value;
+	}
+	return data == end;
+}
+
+bool TraceArchiveReader::readRows(int block, vector<STraceRow>& rows)
+{
+	for (int column = 0; column < kTraceColumnsNumber; column++)
+	{
+		if (!readColumn(block, static_cast<TraceColumn>(column), mValues[column]))
+		{
+			return false;
+		}
+	}
+
+	rows.resize(mBlocks[block].rows);
+	for (size_t i = 0; i < rows.size(); i++)
+	{
+		STraceRow& row = rows[i];
+		row.race = static_cast<uint32_t>(mValues[RaceColumn][i]);
+		row.tick = static_cast<uint32_t>(mValues[TickColumn][i]);
+		row.vehicle = static_cast<uint32_t>(mValues[VehicleColumn][i]);
+		row.x = mValues[XColumn][i] * getScale(XColumn);
+		row.z = mValues[ZColumn][i] * getScale(ZColumn);
+		row.speed = mValues[SpeedColumn][i] * getScale(SpeedColumn);
+		row.stage = static_cast<int32_t>(mValues[StageColumn][i]);
+	}
+	return true;
+}
+
+float TraceArchiveReader::getScale(TraceColumn column)
+{
+	return (column == XColumn || column == ZColumn || column == SpeedColumn) ? 1.0f / kFixedPoint : 1.0f;
+}
+
+const char* TraceArchiveReader::getName(TraceColumn column)
+{
+	return kColumnNames[column];
+}
+
+TraceColumn TraceArchiveReader::findColumn(const string& name)
+{
+	for (int column = 0; column < kTraceColumnsNumber; column++)
+	{
+		if (name == kColumnNames[column])
+		{
+			return static_cast<TraceColumn>(column);
+		}
+	}
+	return kTraceColumnsNumber;
+}
+
+uint64_t TraceArchiveReader::getBytesRead() const
+{
+	return mBytesRead;
+}
+
+
+const string ArchiveCommand::kFlag = "--archive";
+
+int ArchiveCommand::run(const vector<string>& args, const string& defaultTrack)
+{
+	if (args.size() < 2)
+	{
+		printUsage();
+		return 1;
+	}
+
+	const vector<string> options(args.begin() + 2, args.end());
+	if (args[0] == "write")
+	{
+		return write(args[1], options, defaultTrack);
+	}
+	if (args[0] == "scan")
+	{
+		return scan(args[1], options.empty() ? "all" : options.front());
+	}
+
+	printUsage();
+	return 1;
+}
+
+void ArchiveCommand::printUsage()
+{
+	cout << "Usage: DesertRacer " << kFlag << " write file [--races N] [--cars N] [--seed S] [--threads N] [--track file]" << endl
+		<< "       DesertRacer " << kFlag << " scan file [column|all]" << endl
+		<< "Columns: ";
+	for (int column = 0; column < kTraceColumnsNumber; column++)
+	{
+		cout << kColumnNames[column] << " ";
+	}
+	cout << endl;
+}
+
+int ArchiveCommand::write(const string& filename, const vector<string>& options, const string& defaultTrack)
+{
+	string track = defaultTrack;
+	int races = 100;
+	int cars = 8;
+	uint64_t seed = 1;
+	int workers = JobSystem::defaultWorkerCount();
+
+	for (unsigned int i = 0; i + 1 < options.size(); i += 2)
+	{
+		const string& option = options[i];
+		const string& value = options[i + 1];
+		try
+		{
+			if (option == "--races")
+			{
+				races = max(1, stoi(value));
+			}
+			else if (option == "--cars")
+			{
+				cars = min(max(1, stoi(value)), 255);
+			}
+			else if (option == "--seed")
+			{
+				seed = stoull(value);
+			}
+			else if (option == "--threads")
+			{
+				workers = max(0, stoi(value) - 1);
+			}
+			else if (option == "--track")
+			{
+				track = value;
+			}
+			else
+			{
+				cout << "Unknown option " << option << " " << value << endl;
+				printUsage();
+				return 1;
+			}
+		}
+		catch (const exception&)
+		{
+			cout << "Bad value for " << option << ": " << value << endl;
+			return 1;
+		}
+	}
+
+	RaceTrackData data;
+	TraceArchiveWriter writer;
+	if (!data.load(track) || !writer.open(filename))
+	{
+		return 1;
+	}
+
+	// Every car on the AI rules, race i uses seed + i
+	const SSimulationSettings settings;
+	const RaceSimulator simulator(&data, &settings);
+	SSimulationConfig config;
+	config.aiPlayer = true;
+
+	// Races are simulated in batches across the workers and archived in order
+	JobSystem jobs(workers);
+	const int batchSize = 4 * (jobs.getWorkerCount() + 1);
+	vector<vector<STraceRow>> batch(batchSize);
+	int batchFirst = 0, batchRaces = 0;
+	JobGraph graph;
+	graph.addParallelFor("archive.races", [&batchRaces] { return batchRaces; }, 1, [&](int first, int last)
+	{
+		for (int i = first; i < last; i++)
+		{
+			const uint32_t race = static_cast<uint32_t>(batchFirst + i);
+			RaceSimulator::SSession session;
+			simulator.start(session, config, seed + race, cars, 0);
+			vector<SRaceAction> actions(cars);
+			// One trace per car, each in tick order
+			vector<vector<STraceRow>> traces(cars);
+			bool racing = true;
+			while (racing && session.time < settings.kTimeLimit)
+			{
+				vector<char> wasRacing(cars);
+				for (int car = 0; car < cars; car++)
+				{
+					wasRacing[car] = session.cars[car].racing;
+				}
+				racing = simulator.step(session, actions.data(), settings.kDeltaTime);
+				for (int car = 0; car < cars; car++)
+				{
+					if (wasRacing[car])
+					{
+						const RaceSimulator::SSimCar& simCar = session.cars[car];
+						STraceRow row;
+						row.race = race;
+						row.tick = session.tick;
+						row.vehicle = car;
+						row.x = simCar.car.position.x;
+						row.z = simCar.car.position.y;
+						row.speed = simCar.car.movement.length();
+						row.stage = simCar.car.stage;
+						traces[car].push_back(row);
+					}
+				}
+			}
+
+			vector<STraceRow>& rows = batch[i];
+			rows.clear();
+			for (const vector<STraceRow>& trace : traces)
+			{
+				rows.insert(rows.end(), trace.begin(), trace.end());
+			}
+		}
+	});
+
+	cout << "Archiving " << races << " races of " << cars << " cars on " << jobs.getWorkerCount() + 1 << " threads" << endl;
+	const auto start = chrono::steady_clock::now();
+	for (batchFirst = 0; batchFirst < races; batchFirst += batchSize)
+	{
+		batchRaces = min(batchSize, races - batchFirst);
+		jobs.run(graph);
+		for (int i = 0; i < batchRaces; i++)
+		{
+			for (const STraceRow& row : batch[i])
+			{
+				writer.add(row);
+			}
+		}
+	}
+	if (!writer.close())
+	{
+		cout << "Could not write " << filename << endl;
+		return 1;
+	}
+	const double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+	const double raw = static_cast<double>(writer.getRowsNumber()) * sizeof(STraceRow);
+	cout << writer.getRowsNumber() << " rows in " << seconds << "s, " << raw / 1e6 << " MB as rows, " << writer.getBytesWritten() / 1e6
+		<< " MB archived (" << raw / max<double>(static_cast<double>(writer.getBytesWritten()), 1.0) << "x)" << endl;
+	return 0;
+}
+
+int ArchiveCommand::scan(const string& filename, const string& columnName)
+{
+	TraceArchiveReader reader;
+	if (!reader.open(filename))
+	{
+		return 1;
+	}
+
+	const bool all = columnName == "all";
+	const TraceColumn only = TraceArchiveReader::findColumn(columnName);
+	if (!all && only == kTraceColumnsNumber)
+	{
+		cout << "Unknown column " << columnName << endl;
+		printUsage();
+		return 1;
+	}
+
+	// Sum / range of every column scanned, so that nothing decoded goes unused
+	double sums[kTraceColumnsNumber] = {};
+	int64_t lowest[kTraceColumnsNumber], highest[kTraceColumnsNumber];
+	fill(begin(lowest), end(lowest), numeric_limits<int64_t>::max());
+	fill(begin(highest), end(highest), numeric_limits<int64_t>::min());
+	vector<int64_t> values;
+
+	const auto start = chrono::steady_clock::now();
+	for (int block = 0; block < static_cast<int>(reader.getBlocks().size()); block++)
+	{
+		for (int column = 0; column < kTraceColumnsNumber; column++)
+		{
+			if (!all && column != only)
+			{
+				continue;
+			}
+			if (!reader.readColumn(block, static_cast<TraceColumn>(column), values))
+			{
+				cout << "Block " << block << " column " << kColumnNames[column] << " is corrupt" << endl;
+				return 1;
+			}
+
+			int64_t sum = 0, low = lowest[column], high = highest[column];
+			for (const int64_t value : values)
+			{
+				sum += value;
+				low = min(low, value);
+				high = max(high, value);
+			}
+			sums[column] += static_cast<double>(sum);
+			lowest[column] = low;
+			highest[column] = high;
+		}
+	}
+	const double seconds = max(chrono::duration<double>(chrono::steady_clock::now() - start).count(), 1e-9);
+
+	const int columns = all ? kTraceColumnsNumber : 1;
+	const double rows = static_cast<double>(reader.getRowsNumber());
+	// What the values take in memory once decoded, 4 bytes each
+	const double decoded = rows * columns * 4.0;
+	cout << "Scanned " << (all ? string("every column") : columnName) << " of " << rows << " rows in " << reader.getBlocks().size() << " blocks in "
+		<< seconds << "s: " << rows / seconds / 1e6 << " M rows/s, " << reader.getBytesRead() / seconds / 1e6 << " MB/s read, "
+		<< decoded / seconds / 1e9 << " GB/s decoded" << endl;
+	for (int column = 0; column < kTraceColumnsNumber; column++)
+	{
+		if (all || column == only)
+		{
+			const float scale = TraceArchiveReader::getScale(static_cast<TraceColumn>(column));
+			cout << "  " << kColumnNames[column] << ": mean " << sums[column] / max(rows, 1.0) * scale << ", range " << lowest[column] * scale
+				<< " to " << highest[column] * scale << endl;
+		}
+	}
+	return 0;
+}
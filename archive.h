@@ -0,0 +1,176 @@
+/**
+ * @file archive.h
+ * Columnar, compressed archive of simulated race traces, for analysing millions of laps offline
+ *
+ * @author Jacob Sanchez Perez (G20812080) <jsanchez-perez@uclan.ac.uk>
+ * Games Concepts (CO1301), University of Central Lancashire
+ */
+
+#ifndef DESERT_RACER_ARCHIVE_H
+#define DESERT_RACER_ARCHIVE_H
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <cstdint>
+#include <cstddef>
+
+
+namespace desert
+{
+	// One car at the end of one tick of one race
+	struct STraceRow
+	{
+		uint32_t race = 0;
+		uint32_t tick = 0;
+		uint32_t vehicle = 0;
+		float x = 0.0f, z = 0.0f;
+		// Units per second
+		float speed = 0.0f;
+		int32_t stage = 0;
+	};
+
+	// Columns of the archive, one per field of a row
+	enum TraceColumn
+	{
+		RaceColumn,
+		TickColumn,
+		VehicleColumn,
+		XColumn,
+		ZColumn,
+		SpeedColumn,
+		StageColumn,
+		kTraceColumnsNumber
+	};
+
+	/**
+	* Byte oriented LZ77 (the LZ4 block layout): runs of literals and matches up to 64 KB back
+	* Fast to decode, and enough for varint columns that repeat the same few bytes
+	*/
+	class BlockCompressor
+	{
+	public:
+		// Appends the compressed bytes
+		static void compress(const uint8_t* data, size_t size, std::vector<uint8_t>& compressed);
+		/**
+		* @param size Size of the data before compression (decompressed is resized to it)
+		* @return False if the compressed bytes are corrupt
+		*/
+		static bool decompress(const uint8_t* compressed, size_t compressedSize, size_t size, std::vector<uint8_t>& decompressed);
+	protected:
+		static const int kMinMatch = 4;
+		static const int kHashBits = 14;
+		static const size_t kMaxOffset = 65535;
+	};
+
+	// Where a block is in the file and what it holds, the index every seek and scan starts from
+	struct SArchiveBlock
+	{
+		uint64_t offset = 0;
+		uint32_t rows = 0;
+		// Range of races and ticks in the block (ticks of every car in it)
+		uint32_t firstRace = 0, lastRace = 0;
+		uint32_t minTick = 0, maxTick = 0;
+		// Per column: bytes in the file (compressed) and varint bytes once decompressed
+		uint32_t compressedBytes[kTraceColumnsNumber] = {};
+		uint32_t encodedBytes[kTraceColumnsNumber] = {};
+	};
+
+	/**
+	* Rows are stored in blocks, each block one chunk per column: the values as deltas from the row before,
+	* zigzag varints, then compressed. The block index is written at the end of the file
+	* Rows should be added by race, then car, then tick (a car's trace), so consecutive values are close
+	*/
+	class TraceArchiveWriter
+	{
+	public:
+		static const uint32_t kBlockRows = 65536;
+
+		~TraceArchiveWriter();
+
+		bool open(const std::string& filename);
+		void add(const STraceRow& row);
+		// Write the last block and the index, returns false if anything could not be written
+		bool close();
+
+		long long getRowsNumber() const;
+		uint64_t getBytesWritten() const;
+	protected:
+		void writeBlock();
+
+		std::ofstream mFile;
+		std::vector<STraceRow> mRows;
+		std::vector<SArchiveBlock> mBlocks;
+		long long mRowsNumber = 0;
+		uint64_t mOffset = 0;
+		// Reused for every column of every block
+		std::vector<uint8_t> mEncoded, mCompressed;
+	};
+
+	/**
+	* Reads the index once, then any column of any block on its own:
+	* a scan of one column reads and decodes nothing of the others
+	*/
+	class TraceArchiveReader
+	{
+	public:
+		bool open(const std::string& filename);
+
+		const std::vector<SArchiveBlock>& getBlocks() const;
+		long long getRowsNumber() const;
+		// Blocks that may hold a tick of a race (race and tick inside their ranges)
+		void findBlocks(uint32_t race, uint32_t tick, std::vector<int>& blocks) const;
+
+		/**
+		* Values of one column of a block, as stored (positions and speeds in 1 / getScale units)
+		* @return False if the chunk could not be read or is corrupt
+		*/
+		bool readColumn(int block, TraceColumn column, std::vector<int64_t>& values);
+		// Every column of a block, back as rows
+		bool readRows(int block, std::vector<STraceRow>& rows);
+
+		// What a stored value is multiplied by (1 for integer columns)
+		static float getScale(TraceColumn column);
+		static const char* getName(TraceColumn column);
+		// Returns kTraceColumnsNumber for an unknown name
+		static TraceColumn findColumn(const std::string& name);
+
+		// Bytes read from the file and decoded since the archive was opened
+		uint64_t getBytesRead() const;
+	protected:
+		std::ifstream mFile;
+		std::vector<SArchiveBlock> mBlocks;
+		// Offset of every column chunk of every block
+		std::vector<uint64_t> mChunkOffsets;
+		long long mRowsNumber = 0;
+		uint64_t mBytesRead = 0;
+		std::vector<uint8_t> mCompressed, mEncoded;
+		std::vector<int64_t> mValues[kTraceColumnsNumber];
+	};
+
+	/**
+	* Command line front end:
+	* DesertRacer --archive write file [--races N] [--cars N] [--seed S] [--threads N] [--track file]
+	* DesertRacer --archive scan file [column|all]
+	* write simulates races with every car on the AI rules and archives their traces,
+	* scan decodes a column (or every column) of the whole archive and reports the throughput
+	*/
+	class ArchiveCommand
+	{
+	public:
+		static const std::string kFlag;
+
+		/**
+		* @param args Arguments after the flag
+		* @param defaultTrack Track raced if none is given
+		* @return Process exit code
+		*/
+		static int run(const std::vector<std::string>& args, const std::string& defaultTrack);
+	protected:
+		static void printUsage();
+		static int write(const std::string& filename, const std::vector<std::string>& options, const std::string& defaultTrack);
+		static int scan(const std::string& filename, const std::string& columnName);
+	};
+}
+
+#endif
@@ -0,0 +1,97 @@
+/**
+ * @file bitstream.cpp
+ * Values packed into as few bits as they need, for network packets
+ *
+ * @author Jacob Sanchez Perez (G20812080) <jsanchez-perez@uclan.ac.uk>
+ * Games Concepts (CO1301), University of Central Lancashire
+ */
+
+#include "bitstream.h"
+
+using namespace std;
+using namespace desert;
+
+// Sizes of a variable length value, picked by its 2 bit prefix
+static const int kVarSizes[] = { 4, 8, 16, 32 };
+
+
+BitWriter::BitWriter(vector<uint8_t>& buffer) : mBuffer(buffer)
+{
+	mBuffer.clear();
+}
+
+void BitWriter::write(uint32_t value, int bits)
+{
+	for (int i = 0; i < bits; i++, mBits++)
+	{
+		if (!(mBits & 7))
+		{
+			mBuffer.push_back(0);
+		}
+		if ((value >> i) & 1)
+		{
+			mBuffer.back() |= static_cast<uint8_t>(1 << (mBits & 7));
+		}
+	}
+}
+
+void BitWriter::writeBool(bool value)
+{
+	write(value ? 1 : 0, 1);
+}
+
+void BitWriter::writeVarSigned(int32_t value)
+{
+	// Zigzag: 0, -1, 1, -2... become 0, 1, 2, 3...
+	const uint32_t zigzag = (static_cast<uint32_t>(value) << 1) ^ static_cast<uint32_t>(value >> 31);
+
+	int size = 0;
+	while (size < 3 && (zigzag >> kVarSizes[size]))
+	{
+		++size;
+	}
+	write(size, 2);
+	write(zigzag, kVarSizes[size]);
+}
+
+size_t BitWriter::getBitsNumber() const
+{
+	return mBits;
+}
+
+
+BitReader::BitReader(const uint8_t* data, size_t size) : mData(data), mSize(size)
+{
+}
+
+bool BitReader::isGood() const
+{
+	return mGood;
+}
+
+uint32_t BitReader::read(int bits)
+{
+	if (!mGood || mBit + bits > mSize * 8)
+	{
+		mGood = false;
+		return 0;
+	}
+
+	uint32_t value = 0;
+	for (int i = 0; i < bits; i++, mBit++)
+	{
+		value |= static_cast<uint32_t>((mData[mBit >> 3] >> (mBit & 7)) & 1) << i;
+	}
+	return value;
+}
+
+bool BitReader::readBool()
+{
+	return read(1) != 0;
+}
+
+int32_t BitReader::readVarSigned()
+{
+	const uint32_t zigzag = read(kVarSizes[read(2)]);
+	return static_cast<int32_t>((zigzag >> 1) ^ (0u - (zigzag & 1)));
+}
@@ -0,0 +1,60 @@
+/**
+ * @file bitstream.h
+ * Values packed into as few bits as they need, for network packets
+ *
+ * @author Jacob Sanchez Perez (G20812080) <jsanchez-perez@uclan.ac.uk>
+ * Games Concepts (CO1301), University of Central Lancashire
+ */
+
+#ifndef DESERT_RACER_BITSTREAM_H
+#define DESERT_RACER_BITSTREAM_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+
+namespace desert
+{
+	// Appends values bit by bit, least significant bit first
+	class BitWriter
+	{
+	public:
+		// The buffer is emptied
+		explicit BitWriter(std::vector<uint8_t>& buffer);
+
+		// The low bits of a value (up to 32)
+		void write(uint32_t value, int bits);
+		void writeBool(bool value);
+		/**
+		* A signed value, small magnitudes in fewer bits
+		* Zigzag encoded, then sent in the smallest of 4, 8, 16 or 32 bits (plus 2 bits for the size)
+		*/
+		void writeVarSigned(int32_t value);
+
+		size_t getBitsNumber() const;
+	protected:
+		std::vector<uint8_t>& mBuffer;
+		size_t mBits = 0;
+	};
+
+	// Reads values back in the order they were written, reading past the end fails the reader
+	class BitReader
+	{
+	public:
+		BitReader(const uint8_t* data, size_t size);
+
+		// False once a read went past the end (what was read is then zero)
+		bool isGood() const;
+		uint32_t read(int bits);
+		bool readBool();
+		int32_t readVarSigned();
+	protected:
+		const uint8_t* mData;
+		size_t mSize;
+		size_t mBit = 0;
+		bool mGood = true;
+	};
+}
+
+#endif
@@ -16,7 +16,7 @@ using namespace std;
 using namespace tle;
 using namespace desert;
 
-DesertCheckpoint::DesertCheckpoint(IModel* checkpointModel, NodeAlignment alignment, IMesh* cross) : BoxCollisionModel(checkpointModel, alignment), crossMesh(cross)
+DesertCheckpoint::DesertCheckpoint(IModel* checkpointModel, NodeAlignment alignment, IMesh* cross, TimerWheel* timerWheel) : BoxCollisionModel(checkpointModel, alignment), timers(timerWheel), crossMesh(cross)
 {
 	mHalfLength = kHalfLength;
 	mHalfWidth = kHalfWidth;
@@ -29,10 +29,13 @@ const string DesertCheckpoint::kDefaultModelName = "Checkpoint";
 
 Collision::CollisionAxis DesertCheckpoint::collision(SVector2D position, const float collisionRadius, bool saveAxis)
 {
-	SVector2D strutDistance = { kHalfLength, 0 };
-	if (mAlignment == zAligned)
-		strutDistance = { 0, kHalfLength };
-	SVector2D strutA = position2D() - strutDistance, strutB = position2D() + strutDistance;
+	return test(position, collisionRadius);
+}
+
+Collision::CollisionAxis DesertCheckpoint::test(SVector2D position, const float collisionRadius) const
+{
+	SVector2D strutA, strutB;
+	getStruts(strutA, strutB);
 
 	Collision::CollisionAxis collisionA = Collision::circleToCircle(position, strutA, kStrutRadius, collisionRadius);
 	Collision::CollisionAxis collisionB = Collision::circleToCircle(position, strutB, kStrutRadius, collisionRadius);
@@ -43,6 +46,23 @@ Collision::CollisionAxis DesertCheckpoint::collision(SVector2D position, const f
 	return Collision::CollisionAxis::None;
 }
 
+void DesertCheckpoint::getShapes(vector<SCollisionShape>& shapes) const
+{
+	SVector2D strutA, strutB;
+	getStruts(strutA, strutB);
+	shapes.push_back({ SCollisionShape::Circle, SCollisionShape::Strut, strutA, { kStrutRadius, 0 } });
+	shapes.push_back({ SCollisionShape::Circle, SCollisionShape::Strut, strutB, { kStrutRadius, 0 } });
+}
+
+void DesertCheckpoint::getStruts(SVector2D& strutA, SVector2D& strutB) const
+{
+	SVector2D strutDistance = { kHalfLength, 0 };
+	if (mAlignment == zAligned)
+		strutDistance = { 0, kHalfLength };
+	strutA = position2D() - strutDistance;
+	strutB = position2D() + strutDistance;
+}
+
 bool DesertCheckpoint::checkpointCollision(SVector2D position)
 {
 	if (mAlignment == zAligned)
@@ -51,29 +71,52 @@ bool DesertCheckpoint::checkpointCollision(SVector2D position)
 }
 
 void DesertCheckpoint::setCrossed()
+{
+	showCross(kCrossLifetime);
+}
+
+void DesertCheckpoint::showCross(float lifetime)
 {
 	state = RecentlyCrossed;
 	crossModel->SetY(kCrossActiveY);
-	crossElapsed = 0.0f;
+	// Crossed again while shown, the lifetime starts over
+	timers->cancel(crossTimer);
+	crossTimer = timers->schedule(lifetime, [this]
+	{
+		crossTimer = TimerWheel::kNoTimer;
+		reset();
+	});
 }
 
 void DesertCheckpoint::reset()
 {
+	timers->cancel(crossTimer);
 	state = Uncrossed;
 	crossModel->SetY(kCrossInactiveY);
 }
 
-void DesertCheckpoint::updateScene(const float kDeltaTime)
+void DesertCheckpoint::saveState(SnapshotWriter& writer) const
+{
+	CollisionModel::saveState(writer);
+	writer.write(state);
+	// Time the cross was shown for, the snapshot does not depend on the wheel
+	const float crossElapsed = state == RecentlyCrossed ? kCrossLifetime - timers->getRemaining(crossTimer) : 0.0f;
+	writer.write(crossElapsed);
+}
+
+void DesertCheckpoint::loadState(SnapshotReader& reader)
 {
-	if (state == RecentlyCrossed)
+	CollisionModel::loadState(reader);
+	CheckpointState savedState;
+	float crossElapsed;
+	reader.read(savedState);
+	reader.read(crossElapsed);
+	if (savedState == RecentlyCrossed)
+	{
+		showCross(kCrossLifetime - crossElapsed);
+	}
+	else
 	{
-		crossElapsed += kDeltaTime;
-
-		if (crossElapsed > kCrossLifetime)
-		{
-			// Hide cross
-			state = Uncrossed;
-			crossModel->SetY(kCrossInactiveY);
-		}
+		reset();
 	}
 }
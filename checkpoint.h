@@ -12,6 +12,7 @@
 #include <TL-Engine.h>
 #include "vector.h"
 #include "node.h"
+#include "timerwheel.h"
 
 
 namespace desert
@@ -32,36 +33,47 @@ namespace desert
 
         static const std::string kDefaultModelName;
 
+        // Box collision params
+        static constexpr float kHalfLength = 10.0f;
+        static constexpr float kHalfWidth = 3.0f;
+        // Strut collision params
+        static constexpr float kStrutRadius = 1.0f;
+
         /**
         * @param checkpointModel IModel pointer of checkpoint
         * @param alignment Model axis alignment type
         * @param crossMesh Pointer to mesh of cross indicator
+        * @param timers Wheel of the scene, hides the cross once its lifetime is up
         */
-        DesertCheckpoint(tle::IModel* checkpointModel, NodeAlignment alignment, tle::IMesh* crossMesh);
+        DesertCheckpoint(tle::IModel* checkpointModel, NodeAlignment alignment, tle::IMesh* crossMesh, TimerWheel* timers);
         /**
         * Test collision with another object
         * @param position 2D vector of the other object
         * @param collisionRadius the collision radius of the other object
         */
         Collision::CollisionAxis collision(SVector2D position, const float collisionRadius = 0.0f, bool saveAxis = false);
+        // Strut collision without side effects
+        Collision::CollisionAxis test(SVector2D position, const float collisionRadius = 0.0f) const;
+        // The two struts (the gate between them is not an obstacle)
+        void getShapes(std::vector<SCollisionShape>& shapes) const;
         /**
         * Test collision with checkpoint box to see if it has been crossed
         * @param position of hover car
         */
         bool checkpointCollision(SVector2D position);
-        // Update scene (hide/show cross indicator)
-        void updateScene(const float kDeltaTime);
-        // Show cross model
+        // Show cross model (for its lifetime)
         void setCrossed();
         // Hide cross model
         void reset();
+        void saveState(SnapshotWriter& writer) const;
+        // The cross is shown / hidden again as it was
+        void loadState(SnapshotReader& reader);
 
     protected:
-        // Box collision params
-        const float kHalfLength = 10.0f;
-        const float kHalfWidth = 3.0f;
-        // Strut collision params
-        const float kStrutRadius = 1.0f;
+        // Centres of the struts on both ends
+        void getStruts(SVector2D& strutA, SVector2D& strutB) const;
+        // Show the cross and hide it after a time
+        void showCross(float lifetime);
 
         // For how long to show cross
         const float kCrossLifetime = 1.0f;
@@ -72,8 +84,9 @@ namespace desert
         // Cross Y parking positions
         const float kCrossActiveY = 4.0f, kCrossInactiveY = -8.0f;
 
-        // Cross timer
-        float crossElapsed = 0.0f;
+        // Hides the cross, pending while it is shown
+        TimerWheel* timers;
+        TimerWheel::TimerId crossTimer = TimerWheel::kNoTimer;
 
         tle::IMesh* crossMesh;
         tle::IModel* crossModel;
@@ -7,6 +7,8 @@
  */
 
 #include <iostream>
+#include <cmath>
+#include <algorithm>
 #include "vector.h"
 #include "collision.h"
 
@@ -16,14 +18,16 @@ using namespace desert;
 Collision::CollisionAxis Collision::circleToCircle(SVector2D a, SVector2D b, const float radiusA, const float radiusB)
 {
 	SVector2D c = a - b;
-	if (c.length() <= (radiusA + radiusB)) { return Both; }
+	const float radii = radiusA + radiusB;
+	if (c.lengthSquared() <= radii * radii) { return Both; }
 	return None;
 }
 
 bool Collision::sphereToSphere(SVector3D a, SVector3D b, const float radiusA, const float radiusB)
 {
 	SVector3D c = a - b;
-	return c.length() <= (radiusA + radiusB);
+	const float radii = radiusA + radiusB;
+	return c.lengthSquared() <= radii * radii;
 }
 
 Collision::CollisionAxis Collision::pointToBox(SVector2D point, const float x1, const float x2, const float y1, const float y2)
@@ -61,3 +65,65 @@ Collision::CollisionAxis Collision::circleToBox(SVector2D circle, const float ra
 {
 	return pointToBox(circle, boxCentre, halfWidth + radius, halfLength + radius);
 }
+
+Collision::CollisionAxis Collision::circleToShape(SVector2D circle, const float radius, const SCollisionShape& shape)
+{
+	if (shape.form == SCollisionShape::Circle)
+	{
+		return circleToCircle(circle, shape.centre, radius, shape.halfSize.x);
+	}
+	return circleToBox(circle, radius, shape.centre, shape.halfSize.x, shape.halfSize.y);
+}
+
+bool Collision::rayToCircle(SVector2D origin, SVector2D direction, SVector2D centre, const float radius, float& distance)
+{
+	const SVector2D offset = origin - centre;
+	const float c = offset.lengthSquared() - radius * radius;
+
+	// Origin inside
+	if (c <= 0)
+	{
+		distance = 0.0f;
+		return true;
+	}
+
+	const float b = offset.dot(direction);
+	const float discriminant = b * b - c;
+	distance = -b - sqrt(discriminant);
+	return discriminant >= 0 && distance >= 0;
+}
+
+bool Collision::rayToBox(SVector2D origin, SVector2D direction, SVector2D boxCentre, const float halfWidth, const float halfLength, float& distance)
+{
+	// Slabs, a zero component never leaves its slab
+	const SVector2D offset = origin - boxCentre;
+	float nearest = 0.0f, farthest = INFINITY;
+	const float offsets[2] = { offset.x, offset.y }, directions[2] = { direction.x, direction.y }, halves[2] = { halfWidth, halfLength };
+
+	for (int axis = 0; axis < 2; axis++)
+	{
+		if (directions[axis] == 0)
+		{
+			if (offsets[axis] < -halves[axis] || offsets[axis] > halves[axis]) { return false; }
+			continue;
+		}
+
+		float a = (-halves[axis] - offsets[axis]) / directions[axis];
+		float b = (halves[axis] - offsets[axis]) / directions[axis];
+		if (a > b) { swap(a, b); }
+		nearest = max(nearest, a);
+		farthest = min(farthest, b);
+	}
+
+	distance = nearest;
+	return nearest <= farthest;
+}
+
+bool Collision::rayToShape(SVector2D origin, SVector2D direction, const SCollisionShape& shape, float& distance)
+{
+	if (shape.form == SCollisionShape::Circle)
+	{
+		return rayToCircle(origin, direction, shape.centre, shape.halfSize.x, distance);
+	}
+	return rayToBox(origin, direction, shape.centre, shape.halfSize.x, shape.halfSize.y, distance);
+}
@@ -14,6 +14,32 @@
 
 namespace desert
 {
+    // Outline of an obstacle on the ground, enough for queries that do not go through a scene node
+    struct SCollisionShape
+    {
+        enum Form
+        {
+            Circle,
+            Box
+        };
+
+        // What the shape belongs to
+        enum Owner
+        {
+            Prop,
+            Wall,
+            Tower,
+            Strut,
+            Vehicle
+        };
+
+        Form form;
+        Owner owner;
+        SVector2D centre;
+        // Box half extents along X / Z, circle radius in x
+        SVector2D halfSize;
+    };
+
     class Collision
     {
     public:
@@ -32,6 +58,15 @@ namespace desert
         static bool pointToBox(SVector3D point, const float x1, const float x2, const float y1, const float y2, const float z1, const float z2);
         static CollisionAxis circleToBox(SVector2D circle, const float radius, SVector2D boxCentre, const float halfSide);
         static CollisionAxis circleToBox(SVector2D circle, const float radius, SVector2D boxCentre, const float halfWidth, const float halfLength);
+        static CollisionAxis circleToShape(SVector2D circle, const float radius, const SCollisionShape& shape);
+        /**
+        * Ray casts, the direction must be a unit vector
+        * @param distance Distance along the ray to the first hit (zero if the origin is inside)
+        * @return False if the ray misses or the shape is behind it
+        */
+        static bool rayToCircle(SVector2D origin, SVector2D direction, SVector2D centre, const float radius, float& distance);
+        static bool rayToBox(SVector2D origin, SVector2D direction, SVector2D boxCentre, const float halfWidth, const float halfLength, float& distance);
+        static bool rayToShape(SVector2D origin, SVector2D direction, const SCollisionShape& shape, float& distance);
     };
 }
 
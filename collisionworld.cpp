@@ -0,0 +1,303 @@
+/**
+ * @file collisionworld.cpp
+ * Static collision shapes in a grid, answers batches of ray casts (sensors)
+ *
+ * @author Jacob Sanchez Perez (G20812080) <jsanchez-perez@uclan.ac.uk>
+ * Games Concepts (CO1301), University of Central Lancashire
+ */
+
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include <xmmintrin.h>
+#include "vector.h"
+#include "collisionworld.h"
+
+using namespace std;
+using namespace desert;
+
+const int CollisionWorld::kLanes;
+const float CollisionWorld::kDegreesToRadians = 3.14159265358979f / 180.0f;
+
+
+void CollisionWorld::build(const vector<SCollisionShape>& shapes, const float cellSize)
+{
+	mShapes = shapes;
+	mCellStart.clear();
+	mCellShapes.clear();
+	mWidth = mHeight = 0;
+
+	if (shapes.empty())
+	{
+		return;
+	}
+
+	// Bounds of every shape
+	SVector2D low = shapes.front().centre, high = low;
+	for (const SCollisionShape& shape : shapes)
+	{
+		const SVector2D half = (shape.form == SCollisionShape::Circle) ? SVector2D{ shape.halfSize.x, shape.halfSize.x } : shape.halfSize;
+		low = { min(low.x, shape.centre.x - half.x), min(low.y, shape.centre.y - half.y) };
+		high = { max(high.x, shape.centre.x + half.x), max(high.y, shape.centre.y + half.y) };
+	}
+
+	mOrigin = low;
+	mCellSize = cellSize;
+	mWidth = static_cast<int>(floor((high.x - low.x) / cellSize)) + 1;
+	mHeight = static_cast<int>(floor((high.y - low.y) / cellSize)) + 1;
+
+	// Bucket the shapes, then flatten the buckets into one array
+	vector<vector<int>> cells(mWidth * mHeight);
+	for (int i = 0; i < static_cast<int>(shapes.size()); i++)
+	{
+		const SCollisionShape& shape = shapes[i];
+		const SVector2D half = (shape.form == SCollisionShape::Circle) ? SVector2D{ shape.halfSize.x, shape.halfSize.x } : shape.halfSize;
+		const int x0 = static_cast<int>((shape.centre.x - half.x - mOrigin.x) / mCellSize);
+		const int x1 = static_cast<int>((shape.centre.x + half.x - mOrigin.x) / mCellSize);
+		const int y0 = static_cast<int>((shape.centre.y - half.y - mOrigin.y) / mCellSize);
+		const int y1 = static_cast<int>((shape.centre.y + half.y - mOrigin.y) / mCellSize);
+
+		for (int y = max(y0, 0); y <= min(y1, mHeight - 1); y++)
+		{
+			for (int x = max(x0, 0); x <= min(x1, mWidth - 1); x++)
+			{
+				cells[y * mWidth + x].push_back(i);
+			}
+		}
+	}
+
+	mCellStart.reserve(cells.size() + 1);
+	for (const vector<int>& cell : cells)
+	{
+		mCellStart.push_back(static_cast<int>(mCellShapes.size()));
+		mCellShapes.insert(mCellShapes.end(), cell.begin(), cell.end());
+	}
+	mCellStart.push_back(static_cast<int>(mCellShapes.size()));
+}
+
+bool CollisionWorld::isEmpty() const
+{
+	return mShapes.empty();
+}
+
+const vector<SCollisionShape>& CollisionWorld::getShapes() const
+{
+	return mShapes;
+}
+
+void CollisionWorld::gather(SVector2D centre, const float halfSize, vector<int>& candidates, vector<int>& stamps, int stamp) const
+{
+	candidates.clear();
+	if (isEmpty())
+	{
+		return;
+	}
+
+	const int x0 = max(static_cast<int>(floor((centre.x - halfSize - mOrigin.x) / mCellSize)), 0);
+	const int x1 = min(static_cast<int>(floor((centre.x + halfSize - mOrigin.x) / mCellSize)), mWidth - 1);
+	const int y0 = max(static_cast<int>(floor((centre.y - halfSize - mOrigin.y) / mCellSize)), 0);
+	const int y1 = min(static_cast<int>(floor((centre.y + halfSize - mOrigin.y) / mCellSize)), mHeight - 1);
+
+	for (int y = y0; y <= y1; y++)
+	{
+		for (int x = x0; x <= x1; x++)
+		{
+			const int cell = y * mWidth + x;
+			for (int i = mCellStart[cell]; i < mCellStart[cell + 1]; i++)
+			{
+				// Big shapes are in several cells
+				const int shape = mCellShapes[i];
+				if (stamps[shape] != stamp)
+				{
+					stamps[shape] = stamp;
+					candidates.push_back(shape);
+				}
+			}
+		}
+	}
+}
+
+int CollisionWorld::overlap(SVector2D centre, const float radius) const
+{
+	if (isEmpty())
+	{
+		return -1;
+	}
+
+	const int x0 = max(static_cast<int>(floor((centre.x - radius - mOrigin.x) / mCellSize)), 0);
+	const int x1 = min(static_cast<int>(floor((centre.x + radius - mOrigin.x) / mCellSize)), mWidth - 1);
+	const int y0 = max(static_cast<int>(floor((centre.y - radius - mOrigin.y) / mCellSize)), 0);
+	const int y1 = min(static_cast<int>(floor((centre.y + radius - mOrigin.y) / mCellSize)), mHeight - 1);
+
+	// Shapes in several cells are tested more than once, harmless for a minimum
+	int first = -1;
+	for (int y = y0; y <= y1; y++)
+	{
+		for (int x = x0; x <= x1; x++)
+		{
+			const int cell = y * mWidth + x;
+			for (int i = mCellStart[cell]; i < mCellStart[cell + 1]; i++)
+			{
+				const int shape = mCellShapes[i];
+				if ((first < 0 || shape < first) && Collision::circleToShape(centre, radius, mShapes[shape]) == Collision::Both)
+				{
+					first = shape;
+				}
+			}
+		}
+	}
+	return first;
+}
+
+SRayHit CollisionWorld::rayCast(SVector2D origin, SVector2D direction, const float length) const
+{
+	vector<int> candidates, stamps(mShapes.size(), -1);
+	gather(origin, length, candidates, stamps, 0);
+
+	SRayHit hit;
+	castLanes(origin, &direction.x, &direction.y, 1, length, candidates, &hit);
+	return hit;
+}
+
+void CollisionWorld::rayFans(const SVector2D* origins, const float* headings, int cars, const SRayFan& fan, SRayHit* hits) const
+{
+	// Candidates are reused from car to car, the car's index is its stamp
+	vector<int> candidates, stamps(mShapes.size(), -1);
+	float directionX[kLanes], directionY[kLanes];
+
+	// A full circle would cast its first and last rays the same way
+	const bool fullCircle = fan.spread >= 360.0f;
+	const float step = (fan.rays < 2) ? 0.0f : fan.spread / (fullCircle ? fan.rays : fan.rays - 1);
+	const float firstOffset = (fan.rays < 2 || fullCircle) ? 0.0f : -fan.spread / 2;
+
+	for (int car = 0; car < cars; car++)
+	{
+		gather(origins[car], fan.length, candidates, stamps, car);
+		SRayHit* carHits = hits + car * fan.rays;
+
+		for (int first = 0; first < fan.rays; first += kLanes)
+		{
+			const int count = min(kLanes, fan.rays - first);
+			for (int lane = 0; lane < count; lane++)
+			{
+				const float radians = (headings[car] + firstOffset + (first + lane) * step) * kDegreesToRadians;
+				directionX[lane] = sin(radians);
+				directionY[lane] = cos(radians);
+			}
+
+			castLanes(origins[car], directionX, directionY, count, fan.length, candidates, carHits + first);
+		}
+	}
+}
+
+void CollisionWorld::castLanes(SVector2D origin, const float* directionX, const float* directionY, int count, const float length,
+	const vector<int>& candidates, SRayHit* hits) const
+{
+	// Unused lanes get a harmless direction, their results are dropped
+	alignas(16) float dirX[kLanes] = { 1, 1, 1, 1 }, dirY[kLanes] = { 0, 0, 0, 0 };
+	alignas(16) float invX[kLanes], invY[kLanes];
+	for (int lane = 0; lane < count; lane++)
+	{
+		dirX[lane] = directionX[lane];
+		dirY[lane] = directionY[lane];
+	}
+	// Slabs divide by the direction, zero components become tiny instead
+	for (int lane = 0; lane < kLanes; lane++)
+	{
+		const float kTiny = 1e-12f;
+		invX[lane] = 1.0f / (fabs(dirX[lane]) < kTiny ? kTiny : dirX[lane]);
+		invY[lane] = 1.0f / (fabs(dirY[lane]) < kTiny ? kTiny : dirY[lane]);
+	}
+
+	const __m128 dx = _mm_load_ps(dirX), dy = _mm_load_ps(dirY);
+	const __m128 idx = _mm_load_ps(invX), idy = _mm_load_ps(invY);
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 miss = _mm_set1_ps(numeric_limits<float>::infinity());
+
+	float best[kLanes] = { length, length, length, length };
+	int bestShape[kLanes] = { -1, -1, -1, -1 };
+	alignas(16) float distances[kLanes];
+
+	for (const int index : candidates)
+	{
+		const SCollisionShape& shape = mShapes[index];
+		const SVector2D offset = origin - shape.centre;
+		__m128 distance;
+
+		if (shape.form == SCollisionShape::Circle)
+		{
+			const float c = offset.lengthSquared() - shape.halfSize.x * shape.halfSize.x;
+			if (c <= 0)
+			{
+				// Origin inside, every ray hits straight away
+				distance = zero;
+			}
+			else
+			{
+				const __m128 b = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(offset.x), dx), _mm_mul_ps(_mm_set1_ps(offset.y), dy));
+				const __m128 discriminant = _mm_sub_ps(_mm_mul_ps(b, b), _mm_set1_ps(c));
+				const __m128 t = _mm_sub_ps(_mm_sub_ps(zero, b), _mm_sqrt_ps(_mm_max_ps(discriminant, zero)));
+				const __m128 hit = _mm_and_ps(_mm_cmpge_ps(discriminant, zero), _mm_cmpge_ps(t, zero));
+				distance = _mm_or_ps(_mm_and_ps(hit, t), _mm_andnot_ps(hit, miss));
+			}
+		}
+		else
+		{
+			// Slabs: enter both before leaving either
+			const __m128 lowX = _mm_mul_ps(_mm_set1_ps(-shape.halfSize.x - offset.x), idx);
+			const __m128 highX = _mm_mul_ps(_mm_set1_ps(shape.halfSize.x - offset.x), idx);
+			const __m128 lowY = _mm_mul_ps(_mm_set1_ps(-shape.halfSize.y - offset.y), idy);
+			const __m128 highY = _mm_mul_ps(_mm_set1_ps(shape.halfSize.y - offset.y), idy);
+			const __m128 enter = _mm_max_ps(_mm_min_ps(lowX, highX), _mm_min_ps(lowY, highY));
+			const __m128 leave = _mm_min_ps(_mm_max_ps(lowX, highX), _mm_max_ps(lowY, highY));
+			const __m128 hit = _mm_and_ps(_mm_cmple_ps(enter, leave), _mm_cmpge_ps(leave, zero));
+			distance = _mm_or_ps(_mm_and_ps(hit, _mm_max_ps(enter, zero)), _mm_andnot_ps(hit, miss));
+		}
+
+		_mm_store_ps(distances, distance);
+		for (int lane = 0; lane < count; lane++)
+		{
+			if (distances[lane] < best[lane])
+			{
+				best[lane] = distances[lane];
+				bestShape[lane] = index;
+			}
+		}
+	}
+
+	for (int lane = 0; lane < count; lane++)
+	{
+		SRayHit& hit = hits[lane];
+		hit.distance = best[lane];
+		hit.shape = bestShape[lane];
+		hit.owner = SCollisionShape::Prop;
+		hit.normal = { 0, 0 };
+
+		if (hit.shape >= 0)
+		{
+			const SCollisionShape& shape = mShapes[hit.shape];
+			hit.owner = shape.owner;
+			if (hit.distance > 0)
+			{
+				hit.normal = surfaceNormal(shape, origin + SVector2D{ dirX[lane], dirY[lane] } * hit.distance);
+			}
+		}
+	}
+}
+
+SVector2D CollisionWorld::surfaceNormal(const SCollisionShape& shape, SVector2D point)
+{
+	const SVector2D local = point - shape.centre;
+
+	if (shape.form == SCollisionShape::Circle)
+	{
+		return local.isZero() ? SVector2D{ 0, 0 } : local.unit();
+	}
+
+	// The face the point is closest to
+	if (fabs(local.x) - shape.halfSize.x > fabs(local.y) - shape.halfSize.y)
+	{
+		return { local.x < 0 ? -1.0f : 1.0f, 0 };
+	}
+	return { 0, local.y < 0 ? -1.0f : 1.0f };
+}
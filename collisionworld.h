@@ -0,0 +1,101 @@
+/**
+ * @file collisionworld.h
+ * Static collision shapes in a grid, answers batches of ray casts (sensors)
+ *
+ * @author Jacob Sanchez Perez (G20812080) <jsanchez-perez@uclan.ac.uk>
+ * Games Concepts (CO1301), University of Central Lancashire
+ */
+
+#ifndef DESERT_RACER_COLLISION_WORLD_H
+#define DESERT_RACER_COLLISION_WORLD_H
+
+#include <vector>
+#include "vector.h"
+#include "collision.h"
+
+
+namespace desert
+{
+	// Nearest shape along a ray
+	struct SRayHit
+	{
+		// The ray's length if nothing was hit, zero if the ray starts inside a shape
+		float distance;
+		// Surface normal at the hit point, zero if nothing was hit or the ray starts inside
+		SVector2D normal;
+		// Index of the shape hit, -1 if nothing
+		int shape;
+		SCollisionShape::Owner owner;
+	};
+
+	// Rays spread evenly around a heading
+	struct SRayFan
+	{
+		int rays = 8;
+		// Degrees between the first and the last ray (360 goes all the way around)
+		float spread = 180.0f;
+		float length = 100.0f;
+	};
+
+	/**
+	* Static shapes bucketed in a uniform grid
+	* Rays leaving the same point only look at the shapes near it, and are tested against them four at a time (SSE)
+	*/
+	class CollisionWorld
+	{
+	public:
+		static constexpr float kDefaultCellSize = 32.0f;
+
+		void build(const std::vector<SCollisionShape>& shapes, const float cellSize = kDefaultCellSize);
+		bool isEmpty() const;
+		const std::vector<SCollisionShape>& getShapes() const;
+
+		/**
+		* First shape a circle overlaps, in the order they were built with (same answer as testing them all)
+		* @return Index of the shape, -1 if none
+		*/
+		int overlap(SVector2D centre, const float radius) const;
+
+		/**
+		* @param direction Unit direction
+		*/
+		SRayHit rayCast(SVector2D origin, SVector2D direction, const float length) const;
+		/**
+		* A fan of rays from each of N cars, in one call
+		* @param origins Car positions
+		* @param headings Car headings (degrees, 0 faces +Z, positive turns right)
+		* @param hits Room for cars * fan.rays hits, written car after car, each fan from left to right
+		*/
+		void rayFans(const SVector2D* origins, const float* headings, int cars, const SRayFan& fan, SRayHit* hits) const;
+	protected:
+		// Rays tested together
+		static const int kLanes = 4;
+		static const float kDegreesToRadians;
+
+		/**
+		* Every shape whose bounds touch a square around a point, once each
+		* @param stamps One per shape, shapes already stamped with this query's stamp are skipped
+		*/
+		void gather(SVector2D centre, const float halfSize, std::vector<int>& candidates, std::vector<int>& stamps, int stamp) const;
+		/**
+		* Up to kLanes rays from one origin against some shapes
+		* @param directionX, directionY Unit directions, count of them
+		* @param hits Nearest hit of every ray
+		*/
+		void castLanes(SVector2D origin, const float* directionX, const float* directionY, int count, const float length,
+			const std::vector<int>& candidates, SRayHit* hits) const;
+		// Normal of a shape at a point on its surface
+		static SVector2D surfaceNormal(const SCollisionShape& shape, SVector2D point);
+
+		std::vector<SCollisionShape> mShapes;
+
+		// Grid over the shapes, the shapes of cell i are mCellShapes[mCellStart[i], mCellStart[i + 1])
+		SVector2D mOrigin;
+		float mCellSize = 0.0f;
+		int mWidth = 0, mHeight = 0;
+		std::vector<int> mCellStart;
+		std::vector<int> mCellShapes;
+	};
+}
+
+#endif
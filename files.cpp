@@ -61,3 +61,45 @@ vector<string> Files::splitLine(string line) {
 
     return pieces;
 }
+
+// Read every model of a scene setup file
+vector<SSceneModel> Files::getSceneModels(string filename)
+{
+    vector<SSceneModel> models;
+
+    for (const string& line : getLinesFromFile(filename))
+    {
+        vector<string> elements = splitLine(line);
+        SSceneModel model;
+
+        model.mesh = elements.at(MeshIndex);
+        model.x = stof(elements.at(XIndex));
+        model.z = stof(elements.at(ZIndex));
+        model.yRotation = stof(elements.at(YRotIndex));
+
+        // Optional columns
+        if (elements.size() > YIndex)
+        {
+            model.y = stof(elements.at(YIndex));
+        }
+
+        if (elements.size() > XRotIndex)
+        {
+            model.xRotation = stof(elements.at(XRotIndex));
+        }
+
+        if (elements.size() > ZRotIndex)
+        {
+            model.zRotation = stof(elements.at(ZRotIndex));
+        }
+
+        if (elements.size() > ScaleIndex)
+        {
+            model.scale = stof(elements.at(ScaleIndex));
+        }
+
+        models.push_back(model);
+    }
+
+    return models;
+}
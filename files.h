@@ -11,9 +11,20 @@
 #define DESERT_RACER_FILES_H
 
 #include <string>
+#include <vector>
 
 namespace desert
 {
+    // One model of a scene setup file
+    struct SSceneModel
+    {
+        std::string mesh;
+        float x = 0.0f, y = 0.0f, z = 0.0f;
+        // Degrees
+        float xRotation = 0.0f, yRotation = 0.0f, zRotation = 0.0f;
+        float scale = 1.0f;
+    };
+
     class Files
     {
     public:
@@ -24,6 +35,24 @@ namespace desert
         static std::vector<std::string> Files::getLinesFromFile(std::string filename);
         // Split string into contiguous chunks
         static std::vector<std::string> Files::splitLine(std::string line);
+        /**
+        * Read every model of a scene setup file
+        * Line format: mesh x z yRotation [y xRotation zRotation scale]
+        */
+        static std::vector<SSceneModel> Files::getSceneModels(std::string filename);
+    private:
+        // Columns of a scene setup line
+        enum SetupColumn
+        {
+            MeshIndex = 0,
+            XIndex = 1,
+            ZIndex = 2,
+            YRotIndex = 3,
+            YIndex = 4,
+            XRotIndex = 5,
+            ZRotIndex = 6,
+            ScaleIndex = 7
+        };
     };
 }
 
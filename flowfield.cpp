@@ -0,0 +1,296 @@
+/**
+ * @file flowfield.cpp
+ * Grid of directions leading to each gate of the track around the obstacles
+ *
+ * @author Jacob Sanchez Perez (G20812080) <jsanchez-perez@uclan.ac.uk>
+ * Games Concepts (CO1301), University of Central Lancashire
+ */
+
+#include <iostream>
+#include <fstream>
+#include <cmath>
+#include <queue>
+#include <functional>
+#include <algorithm>
+#include "vector.h"
+#include "flowfield.h"
+
+using namespace std;
+using namespace desert;
+
+const SFlowFieldTuning FlowField::kDefaultTuning = {};
+// E, NE, N, NW, W, SW, S, SE
+const int FlowField::kOffsetX[kDirections] = { 1, 1, 0, -1, -1, -1, 0, 1 };
+const int FlowField::kOffsetY[kDirections] = { 0, 1, 1, 1, 0, -1, -1, -1 };
+const uint8_t FlowField::kNoDirection;
+
+
+void FlowField::build(const vector<SCollisionShape>& obstacles, const vector<SVector2D>& gates, const SFlowFieldTuning* tuning)
+{
+	mDirections.clear();
+	mDistances.clear();
+	mBlocked.clear();
+	mGates = gates;
+	mWidth = mHeight = 0;
+
+	if (gates.empty())
+	{
+		return;
+	}
+
+	// Bounds of everything on the track
+	SVector2D low = gates.front(), high = gates.front();
+	auto extend = [&low, &high](SVector2D p)
+	{
+		low = { min(low.x, p.x), min(low.y, p.y) };
+		high = { max(high.x, p.x), max(high.y, p.y) };
+	};
+	for (const SVector2D& gate : gates)
+	{
+		extend(gate);
+	}
+	for (const SCollisionShape& obstacle : obstacles)
+	{
+		extend(obstacle.centre);
+	}
+
+	const SVector2D margin = { tuning->kMargin, tuning->kMargin };
+	mOrigin = low - margin;
+	const SVector2D size = (high + margin) - mOrigin;
+
+	// Big tracks get bigger cells so the grid stays bounded
+	mCellSize = max(tuning->kCellSize, max(size.x, size.y) / tuning->kMaxCellsPerSide);
+	mWidth = static_cast<int>(ceil(size.x / mCellSize));
+	mHeight = static_cast<int>(ceil(size.y / mCellSize));
+
+	// A cell is blocked if a car standing on it would collide with something
+	mBlocked.assign(mWidth * mHeight, false);
+	for (int y = 0; y < mHeight; y++)
+	{
+		for (int x = 0; x < mWidth; x++)
+		{
+			const SVector2D centre = cellCentre(x, y);
+			for (const SCollisionShape& obstacle : obstacles)
+			{
+				if (Collision::circleToShape(centre, tuning->kClearance, obstacle) == Collision::CollisionAxis::Both)
+				{
+					mBlocked[y * mWidth + x] = true;
+					break;
+				}
+			}
+		}
+	}
+
+	for (int gate = 0; gate < static_cast<int>(gates.size()); gate++)
+	{
+		buildGate(gates[gate], tuning->kGateRadius);
+	}
+
+	cout << "Flow field: " << mWidth << "x" << mHeight << " cells of " << mCellSize << " for " << gates.size() << " gates" << endl;
+}
+
+void FlowField::buildGate(SVector2D centre, const float gateRadius)
+{
+	const int cells = mWidth * mHeight;
+	mDirections.push_back(vector<uint8_t>(cells, kNoDirection));
+	mDistances.push_back(vector<float>(cells, -1.0f));
+	vector<uint8_t>& directions = mDirections.back();
+	vector<float>& distances = mDistances.back();
+
+	// Dijkstra from every free cell of the gate outwards
+	typedef pair<float, int> Entry;
+	priority_queue<Entry, vector<Entry>, greater<Entry>> open;
+
+	for (int y = 0; y < mHeight; y++)
+	{
+		for (int x = 0; x < mWidth; x++)
+		{
+			const int cell = y * mWidth + x;
+			if (!mBlocked[cell] && (cellCentre(x, y) - centre).lengthSquared() <= gateRadius * gateRadius)
+			{
+				distances[cell] = 0.0f;
+				open.push({ 0.0f, cell });
+			}
+		}
+	}
+
+	while (!open.empty())
+	{
+		const Entry current = open.top();
+		open.pop();
+
+		const int cell = current.second;
+		if (current.first > distances[cell])
+		{
+			continue;
+		}
+
+		const int x = cell % mWidth, y = cell / mWidth;
+		for (int d = 0; d < kDirections; d++)
+		{
+			const int nx = x + kOffsetX[d], ny = y + kOffsetY[d];
+			if (nx < 0 || ny < 0 || nx >= mWidth || ny >= mHeight)
+			{
+				continue;
+			}
+
+			const int next = ny * mWidth + nx;
+			const bool diagonal = kOffsetX[d] && kOffsetY[d];
+			// Diagonal steps cannot squeeze between two blocked cells
+			if (mBlocked[next] || (diagonal && (mBlocked[y * mWidth + nx] || mBlocked[ny * mWidth + x])))
+			{
+				continue;
+			}
+
+			const float distance = current.first + (diagonal ? 1.41421356f : 1.0f) * mCellSize;
+			if (distances[next] < 0 || distance < distances[next])
+			{
+				distances[next] = distance;
+				// The way back to the current cell is the opposite direction
+				directions[next] = static_cast<uint8_t>((d + kDirections / 2) % kDirections);
+				open.push({ distance, next });
+			}
+		}
+	}
+
+	// Cars pushed against an obstacle stand on blocked cells, which point out to their nearest free neighbour
+	for (int cell = 0; cell < cells; cell++)
+	{
+		if (!mBlocked[cell])
+		{
+			continue;
+		}
+
+		const int x = cell % mWidth, y = cell / mWidth;
+		for (int d = 0; d < kDirections; d++)
+		{
+			const int nx = x + kOffsetX[d], ny = y + kOffsetY[d];
+			if (nx < 0 || ny < 0 || nx >= mWidth || ny >= mHeight)
+			{
+				continue;
+			}
+
+			const int next = ny * mWidth + nx;
+			if (mBlocked[next] || distances[next] < 0)
+			{
+				continue;
+			}
+
+			const float distance = distances[next] + (kOffsetX[d] && kOffsetY[d] ? 1.41421356f : 1.0f) * mCellSize;
+			if (distances[cell] < 0 || distance < distances[cell])
+			{
+				distances[cell] = distance;
+				directions[cell] = static_cast<uint8_t>(d);
+			}
+		}
+	}
+}
+
+bool FlowField::isEmpty() const
+{
+	return mDirections.empty();
+}
+
+int FlowField::getGatesNumber() const
+{
+	return static_cast<int>(mDirections.size());
+}
+
+int FlowField::cellOf(SVector2D position) const
+{
+	const int x = static_cast<int>(floor((position.x - mOrigin.x) / mCellSize));
+	const int y = static_cast<int>(floor((position.y - mOrigin.y) / mCellSize));
+
+	if (x < 0 || y < 0 || x >= mWidth || y >= mHeight)
+	{
+		return -1;
+	}
+	return y * mWidth + x;
+}
+
+SVector2D FlowField::cellCentre(int x, int y) const
+{
+	return { mOrigin.x + (x + 0.5f) * mCellSize, mOrigin.y + (y + 0.5f) * mCellSize };
+}
+
+SVector2D FlowField::direction(int gate, SVector2D position) const
+{
+	const int cell = cellOf(position);
+	if (cell < 0 || gate < 0 || gate >= getGatesNumber())
+	{
+		return { 0, 0 };
+	}
+
+	const uint8_t d = mDirections[gate][cell];
+	// Already at the gate: straight through its centre
+	if (!mDistances[gate][cell])
+	{
+		const SVector2D toGate = mGates[gate] - position;
+		return toGate.isZero() ? SVector2D{ 0, 0 } : toGate.unit();
+	}
+	if (d == kNoDirection)
+	{
+		return { 0, 0 };
+	}
+
+	return SVector2D{ static_cast<float>(kOffsetX[d]), static_cast<float>(kOffsetY[d]) }.unit();
+}
+
+float FlowField::distance(int gate, SVector2D position) const
+{
+	const int cell = cellOf(position);
+	if (cell < 0 || gate < 0 || gate >= getGatesNumber())
+	{
+		return -1.0f;
+	}
+	return mDistances[gate][cell];
+}
+
+bool FlowField::writeImage(const string& filename, int gate) const
+{
+	if (gate < 0 || gate >= getGatesNumber())
+	{
+		return false;
+	}
+
+	ofstream file(filename, ios::binary);
+	if (!file.is_open())
+	{
+		cout << "File IO error when opening " << filename << endl;
+		return false;
+	}
+
+	// One colour per direction, around the colour wheel
+	static const unsigned char kPalette[kDirections][3] =
+	{
+		{ 230, 60, 60 }, { 230, 160, 40 }, { 220, 220, 50 }, { 90, 200, 70 },
+		{ 50, 200, 200 }, { 60, 110, 230 }, { 150, 80, 220 }, { 220, 80, 180 }
+	};
+
+	file << "P6\n" << mWidth << " " << mHeight << "\n255\n";
+	// Image rows go top-down, +Z is up in the plot
+	for (int y = mHeight - 1; y >= 0; y--)
+	{
+		for (int x = 0; x < mWidth; x++)
+		{
+			const int cell = y * mWidth + x;
+			unsigned char colour[3] = { 40, 40, 40 };
+
+			if (mBlocked[cell])
+			{
+				colour[0] = colour[1] = colour[2] = 0;
+			}
+			else if (!mDistances[gate][cell])
+			{
+				colour[0] = colour[1] = colour[2] = 255;
+			}
+			else if (mDirections[gate][cell] != kNoDirection)
+			{
+				copy(kPalette[mDirections[gate][cell]], kPalette[mDirections[gate][cell]] + 3, colour);
+			}
+			file.write(reinterpret_cast<const char*>(colour), 3);
+		}
+	}
+
+	return file.good();
+}
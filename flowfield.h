@@ -0,0 +1,91 @@
+/**
+ * @file flowfield.h
+ * Grid of directions leading to each gate of the track around the obstacles
+ *
+ * @author Jacob Sanchez Perez (G20812080) <jsanchez-perez@uclan.ac.uk>
+ * Games Concepts (CO1301), University of Central Lancashire
+ */
+
+#ifndef DESERT_RACER_FLOW_FIELD_H
+#define DESERT_RACER_FLOW_FIELD_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "vector.h"
+#include "collision.h"
+
+
+namespace desert
+{
+	struct SFlowFieldTuning
+	{
+		// Side of a grid cell
+		float kCellSize = 4.0f;
+		// Cells closer than this to an obstacle are blocked (about a car's radius)
+		float kClearance = 3.0f;
+		// Cells this close to a gate centre are the goal of its field
+		float kGateRadius = 6.0f;
+		// Space added around the obstacles / gates
+		float kMargin = 40.0f;
+		// Grids bigger than this use bigger cells
+		int kMaxCellsPerSide = 512;
+	};
+
+	/**
+	* For every cell of a grid over the track and every gate (checkpoint), the direction
+	* of the next cell on the shortest obstacle-free path to that gate
+	* Built at load, looking a direction up is O(1)
+	*/
+	class FlowField
+	{
+	public:
+		static const SFlowFieldTuning kDefaultTuning;
+
+		/**
+		* Rasterise the obstacles and run a search outwards from every gate
+		* @param obstacles Shapes of the static collision nodes (walls, towers, struts...)
+		* @param gates Gate centres, in race order
+		*/
+		void build(const std::vector<SCollisionShape>& obstacles, const std::vector<SVector2D>& gates, const SFlowFieldTuning* tuning = &kDefaultTuning);
+
+		bool isEmpty() const;
+		int getGatesNumber() const;
+		/**
+		* @param gate Gate to head to
+		* @return Unit direction to follow, zero if outside the grid or unreachable
+		* (blocked cells next to free ones point out of the obstacle)
+		*/
+		SVector2D direction(int gate, SVector2D position) const;
+		// Path length to a gate, negative if unreachable
+		float distance(int gate, SVector2D position) const;
+
+		/**
+		* Plot a gate's field as a PPM image, one pixel per cell
+		* Obstacles are black, goal cells white, the rest coloured by direction
+		*/
+		bool writeImage(const std::string& filename, int gate) const;
+	protected:
+		// Directions a cell can point to (8 neighbours) plus "nowhere"
+		static const int kDirections = 8;
+		static const uint8_t kNoDirection = 255;
+		static const int kOffsetX[kDirections], kOffsetY[kDirections];
+
+		// Cell of a position, -1 if outside the grid
+		int cellOf(SVector2D position) const;
+		SVector2D cellCentre(int x, int y) const;
+		// Search outwards from the next gate, appends its directions / distances
+		void buildGate(SVector2D centre, const float gateRadius);
+
+		SVector2D mOrigin;
+		float mCellSize = 0.0f;
+		int mWidth = 0, mHeight = 0;
+		std::vector<char> mBlocked;
+		std::vector<SVector2D> mGates;
+		// Per gate, one entry per cell
+		std::vector<std::vector<uint8_t>> mDirections;
+		std::vector<std::vector<float>> mDistances;
+	};
+}
+
+#endif
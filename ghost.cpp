@@ -0,0 +1,331 @@
+/**
+ * @file ghost.cpp
+ * Best lap of a track kept as a few keyframes, replayed by a ghost car without any physics
+ *
+ * @author Jacob Sanchez Perez (G20812080) <jsanchez-perez@uclan.ac.uk>
+ * Games Concepts (CO1301), University of Central Lancashire
+ */
+
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <cmath>
+#include "bitstream.h"
+#include "ghost.h"
+
+using namespace std;
+using namespace desert;
+
+const string GhostPath::kFileExtension = ".ghost";
+const float GhostPath::kPositionTolerance = 0.5f;
+const float GhostPath::kHeadingTolerance = 3.0f;
+const float GhostPath::kMaxKeyframeGap = 4.0f;
+const uint32_t GhostPath::kFileMagic = 0x47525244;
+const uint32_t GhostPath::kFileVersion = 1;
+
+
+void GhostPath::build(const vector<SGhostPose>& poses, float positionTolerance, float headingTolerance)
+{
+	// Keyframes are taken from the grid they are stored on, and checked against the poses as recorded (what playback is measured against)
+	vector<SGhostPose> grid, recorded;
+	grid.reserve(poses.size());
+	recorded.reserve(poses.size());
+	int32_t lastTime = 0;
+	for (const SGhostPose& pose : poses)
+	{
+		const SQuantizedPose quantized = quantize(pose);
+		// Steps shorter than the time resolution add nothing
+		if (grid.empty() || quantized.time > lastTime)
+		{
+			grid.push_back(dequantize(quantized));
+			recorded.push_back(pose);
+			lastTime = quantized.time;
+		}
+	}
+
+	mKeyframes.clear();
+	mCursor = 0;
+	if (!grid.empty())
+	{
+		// Stretch each keyframe's span as far as interpolation still predicts every pose in it
+		const int last = static_cast<int>(grid.size()) - 1;
+		int anchor = 0;
+		mKeyframes.push_back(grid.front());
+		while (anchor < last)
+		{
+			int next = anchor + 1;
+			while (next < last && grid[next + 1].time - grid[anchor].time <= kMaxKeyframeGap &&
+				predicts(grid, recorded, anchor, next + 1, positionTolerance, headingTolerance))
+			{
+				++next;
+			}
+			mKeyframes.push_back(grid[next]);
+			anchor = next;
+		}
+	}
+	encode();
+}
+
+bool GhostPath::save(const string& filename) const
+{
+	ofstream file(filename, ios::binary);
+
+	if (!file.is_open())
+	{
+		cout << "File IO error when opening " << filename << endl;
+		return false;
+	}
+
+	const uint32_t keyframes = static_cast<uint32_t>(mKeyframes.size());
+	const uint32_t bytes = static_cast<uint32_t>(mEncoded.size());
+	file.write(reinterpret_cast<const char*>(&kFileMagic), sizeof(kFileMagic));
+	file.write(reinterpret_cast<const char*>(&kFileVersion), sizeof(kFileVersion));
+	file.write(reinterpret_cast<const char*>(&keyframes), sizeof(keyframes));
+	file.write(reinterpret_cast<const char*>(&bytes), sizeof(bytes));
+	file.write(reinterpret_cast<const char*>(mEncoded.data()), bytes);
+
+	return file.good();
+}
+
+bool GhostPath::load(const string& filename)
+{
+	ifstream file(filename, ios::binary);
+
+	if (!file.is_open())
+	{
+		return false;
+	}
+
+	uint32_t magic = 0, version = 0, keyframes = 0, bytes = 0;
+	file.read(reinterpret_cast<char*>(&magic), sizeof(magic));
+	file.read(reinterpret_cast<char*>(&version), sizeof(version));
+	file.read(reinterpret_cast<char*>(&keyframes), sizeof(keyframes));
+	file.read(reinterpret_cast<char*>(&bytes), sizeof(bytes));
+
+	if (!file.good() || magic != kFileMagic || version != kFileVersion)
+	{
+		cout << filename << " is not a ghost (or is from another version)" << endl;
+		return false;
+	}
+
+	mEncoded.resize(bytes);
+	file.read(reinterpret_cast<char*>(mEncoded.data()), bytes);
+	mKeyframes.resize(keyframes);
+	mCursor = 0;
+
+	if (!file.good() || !decode())
+	{
+		cout << filename << " is truncated or corrupt" << endl;
+		mKeyframes.clear();
+		mEncoded.clear();
+		return false;
+	}
+	return true;
+}
+
+bool GhostPath::isEmpty() const
+{
+	return mKeyframes.empty();
+}
+
+float GhostPath::getDuration() const
+{
+	return mKeyframes.empty() ? 0.0f : mKeyframes.back().time - mKeyframes.front().time;
+}
+
+int GhostPath::getKeyframesNumber() const
+{
+	return static_cast<int>(mKeyframes.size());
+}
+
+size_t GhostPath::getEncodedBytes() const
+{
+	return mEncoded.size();
+}
+
+SGhostPose GhostPath::getPose(float time) const
+{
+	if (mKeyframes.empty())
+	{
+		return SGhostPose();
+	}
+
+	if (time <= mKeyframes.front().time)
+	{
+		return mKeyframes.front();
+	}
+	if (time >= mKeyframes.back().time)
+	{
+		return mKeyframes.back();
+	}
+
+	// Time went back (a new lap): search, otherwise walk on from the last keyframe
+	if (mCursor >= static_cast<int>(mKeyframes.size()) - 1 || time < mKeyframes[mCursor].time)
+	{
+		const auto after = upper_bound(mKeyframes.begin(), mKeyframes.end(), time,
+			[](float value, const SGhostPose& keyframe) { return value < keyframe.time; });
+		mCursor = static_cast<int>(after - mKeyframes.begin()) - 1;
+	}
+	while (mKeyframes[mCursor + 1].time <= time)
+	{
+		++mCursor;
+	}
+	return interpolate(mKeyframes[mCursor], mKeyframes[mCursor + 1], time);
+}
+
+GhostPath::SQuantizedPose GhostPath::quantize(const SGhostPose& pose)
+{
+	SQuantizedPose quantized;
+	quantized.time = static_cast<int32_t>(lround(pose.time * kTimeScale));
+	quantized.x = static_cast<int32_t>(lround(pose.position.x * kPositionScale));
+	quantized.z = static_cast<int32_t>(lround(pose.position.y * kPositionScale));
+	quantized.heading = static_cast<int32_t>(lround(pose.heading * kHeadingSteps / 360.0f));
+	return quantized;
+}
+
+SGhostPose GhostPath::dequantize(const SQuantizedPose& pose)
+{
+	SGhostPose ghostPose;
+	ghostPose.time = static_cast<float>(pose.time) / kTimeScale;
+	ghostPose.position = { static_cast<float>(pose.x) / kPositionScale, static_cast<float>(pose.z) / kPositionScale };
+	ghostPose.heading = static_cast<float>(pose.heading) * 360.0f / kHeadingSteps;
+	return ghostPose;
+}
+
+SGhostPose GhostPath::interpolate(const SGhostPose& a, const SGhostPose& b, float time)
+{
+	const float t = (time - a.time) / (b.time - a.time);
+	SGhostPose pose;
+	pose.time = time;
+	pose.position = a.position + (b.position - a.position) * t;
+	pose.heading = a.heading + (b.heading - a.heading) * t;
+	return pose;
+}
+
+bool GhostPath::predicts(const vector<SGhostPose>& grid, const vector<SGhostPose>& recorded, int first, int last, float positionTolerance,
+	float headingTolerance)
+{
+	for (int i = first + 1; i < last; i++)
+	{
+		const SGhostPose predicted = interpolate(grid[first], grid[last], recorded[i].time);
+		if ((predicted.position - recorded[i].position).length() > positionTolerance || fabs(predicted.heading - recorded[i].heading) > headingTolerance)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+GhostPath::SQuantizedPose GhostPath::extrapolate(const SQuantizedPose& before, const SQuantizedPose& previous, int32_t time)
+{
+	// Keeps going the way it went between the two keyframes before
+	SQuantizedPose predicted = previous;
+	predicted.time = time;
+	const int64_t span = previous.time - before.time;
+	if (span > 0)
+	{
+		const int64_t elapsed = time - previous.time;
+		predicted.x += static_cast<int32_t>((previous.x - before.x) * elapsed / span);
+		predicted.z += static_cast<int32_t>((previous.z - before.z) * elapsed / span);
+		predicted.heading += static_cast<int32_t>((previous.heading - before.heading) * elapsed / span);
+	}
+	return predicted;
+}
+
+void GhostPath::encode()
+{
+	// Time against the keyframe before, the rest against where the two keyframes before lead
+	BitWriter writer(mEncoded);
+	SQuantizedPose before = {}, previous = {};
+	for (const SGhostPose& keyframe : mKeyframes)
+	{
+		const SQuantizedPose quantized = quantize(keyframe);
+		const SQuantizedPose predicted = extrapolate(before, previous, quantized.time);
+		writer.writeVarSigned(quantized.time - previous.time);
+		writer.writeVarSigned(quantized.x - predicted.x);
+		writer.writeVarSigned(quantized.z - predicted.z);
+		writer.writeVarSigned(quantized.heading - predicted.heading);
+		before = previous;
+		previous = quantized;
+	}
+}
+
+bool GhostPath::decode()
+{
+	BitReader reader(mEncoded.data(), mEncoded.size());
+	SQuantizedPose before = {}, previous = {};
+	for (SGhostPose& keyframe : mKeyframes)
+	{
+		const int32_t time = previous.time + reader.readVarSigned();
+		SQuantizedPose quantized = extrapolate(before, previous, time);
+		quantized.x += reader.readVarSigned();
+		quantized.z += reader.readVarSigned();
+		quantized.heading += reader.readVarSigned();
+		keyframe = dequantize(quantized);
+		before = previous;
+		previous = quantized;
+	}
+
+	// Keyframes must go forwards in time for the search
+	for (size_t i = 1; i < mKeyframes.size(); i++)
+	{
+		if (mKeyframes[i].time <= mKeyframes[i - 1].time)
+		{
+			return false;
+		}
+	}
+	return reader.isGood();
+}
+
+
+void GhostRecorder::begin(float time)
+{
+	mRecording = true;
+	mStart = time;
+	mPoses.clear();
+}
+
+void GhostRecorder::record(float time, SVector2D position, float heading)
+{
+	if (!mRecording)
+	{
+		return;
+	}
+
+	// Headings are kept continuous, a turn across 0 must not interpolate the long way round
+	if (!mPoses.empty())
+	{
+		const float previous = mPoses.back().heading;
+		heading = previous + remainder(heading - previous, 360.0f);
+	}
+
+	SGhostPose pose;
+	pose.time = time - mStart;
+	pose.position = position;
+	pose.heading = heading;
+	mPoses.push_back(pose);
+}
+
+void GhostRecorder::discard()
+{
+	mRecording = false;
+	mPoses.clear();
+}
+
+bool GhostRecorder::isRecording() const
+{
+	return mRecording;
+}
+
+bool GhostRecorder::finish(GhostPath& path)
+{
+	if (!mRecording || mPoses.empty())
+	{
+		discard();
+		return false;
+	}
+
+	path.build(mPoses);
+	discard();
+	return true;
+}
@@ -0,0 +1,122 @@
+/**
+ * @file ghost.h
+ * Best lap of a track kept as a few keyframes, replayed by a ghost car without any physics
+ *
+ * @author Jacob Sanchez Perez (G20812080) <jsanchez-perez@uclan.ac.uk>
+ * Games Concepts (CO1301), University of Central Lancashire
+ */
+
+#ifndef DESERT_RACER_GHOST_H
+#define DESERT_RACER_GHOST_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include "vector.h"
+
+
+namespace desert
+{
+	// Where a car was at a time
+	struct SGhostPose
+	{
+		// Seconds since the start of the path
+		float time = 0.0f;
+		SVector2D position;
+		// Degrees, 0 faces +Z, not wrapped (a path turns continuously)
+		float heading = 0.0f;
+	};
+
+	/**
+	* A car's path as keyframes: only the poses the ones around them do not predict by linear interpolation,
+	* quantized and stored as bit packed deltas from where the keyframes before were heading
+	*/
+	class GhostPath
+	{
+	public:
+		static const std::string kFileExtension;
+		// Most a kept pose may be from the interpolated one (units / degrees)
+		static const float kPositionTolerance;
+		static const float kHeadingTolerance;
+
+		/**
+		* Keep the keyframes of a path
+		* @param poses Every pose recorded, in time order
+		*/
+		void build(const std::vector<SGhostPose>& poses, float positionTolerance = kPositionTolerance, float headingTolerance = kHeadingTolerance);
+
+		bool save(const std::string& filename) const;
+		// Returns false (quietly) if there is no file
+		bool load(const std::string& filename);
+
+		bool isEmpty() const;
+		// Seconds from the first keyframe to the last
+		float getDuration() const;
+		int getKeyframesNumber() const;
+		// Size of the packed keyframes
+		size_t getEncodedBytes() const;
+
+		/**
+		* Pose at a time of the path (clamped to its ends), one interpolation between the keyframes around it
+		* Walks on from the last keyframe found, so times that keep increasing cost no search
+		*/
+		SGhostPose getPose(float time) const;
+	protected:
+		static const uint32_t kFileMagic;
+		static const uint32_t kFileVersion;
+		// Quantization: milliseconds, 1 / kPositionScale units, 1 / kHeadingSteps of a turn
+		static const int kTimeScale = 1000;
+		static const int kPositionScale = 32;
+		static const int kHeadingSteps = 4096;
+		// Longest time between two keyframes (seconds), keeps the deltas small and the search short
+		static const float kMaxKeyframeGap;
+
+		// A pose on the quantization grid
+		struct SQuantizedPose
+		{
+			int32_t time, x, z, heading;
+		};
+
+		static SQuantizedPose quantize(const SGhostPose& pose);
+		static SGhostPose dequantize(const SQuantizedPose& pose);
+		// Where a keyframe is expected at a time, from the two before it (both zero at the start)
+		static SQuantizedPose extrapolate(const SQuantizedPose& before, const SQuantizedPose& previous, int32_t time);
+		static SGhostPose interpolate(const SGhostPose& a, const SGhostPose& b, float time);
+		// Whether every recorded pose between two keyframes of the grid is close enough to their interpolation
+		static bool predicts(const std::vector<SGhostPose>& grid, const std::vector<SGhostPose>& recorded, int first, int last,
+			float positionTolerance, float headingTolerance);
+
+		void encode();
+		bool decode();
+
+		std::vector<SGhostPose> mKeyframes;
+		std::vector<uint8_t> mEncoded;
+		// Keyframe the last pose was found after
+		mutable int mCursor = 0;
+	};
+
+	// Poses of the lap being driven, a GhostPath once it is complete
+	class GhostRecorder
+	{
+	public:
+		// Start recording a lap at a race time, dropping what was being recorded
+		void begin(float time);
+		// Pose at the end of a tick, ignored while not recording
+		void record(float time, SVector2D position, float heading);
+		// Stop until the next begin (the lap can no longer be trusted, it was rewound)
+		void discard();
+		bool isRecording() const;
+		/**
+		* Lap complete, stops recording
+		* @return False if no lap was being recorded
+		*/
+		bool finish(GhostPath& path);
+	protected:
+		bool mRecording = false;
+		float mStart = 0.0f;
+		std::vector<SGhostPose> mPoses;
+	};
+}
+
+#endif
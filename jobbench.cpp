@@ -0,0 +1,263 @@
+/**
+ * @file jobbench.cpp
+ * Scaling benchmark of the job system on the stages of a race tick
+ *
+ * @author Jacob Sanchez Perez (G20812080) <jsanchez-perez@uclan.ac.uk>
+ * Games Concepts (CO1301), University of Central Lancashire
+ */
+
+#include <iostream>
+#include <chrono>
+#include <algorithm>
+#include "jobbench.h"
+
+using namespace std;
+using namespace desert;
+
+const string JobBenchmarkCommand::kFlag = "--bench-jobs";
+
+
+int JobBenchmarkCommand::run(const vector<string>& args, const string& defaultTrack)
+{
+	string track = defaultTrack;
+	int cars = 512;
+	int emitters = 256;
+	int ticks = 600;
+	int maxThreads = JobSystem::defaultWorkerCount() + 1;
+
+	// Options are "--name value"
+	for (unsigned int i = 0; i < args.size(); i++)
+	{
+		const string& option = args[i];
+		if (i + 1 >= args.size())
+		{
+			cout << "Missing value for " << option << endl;
+			printUsage();
+			return 1;
+		}
+		const string& value = args[++i];
+
+		try
+		{
+			if (option == "--track")
+			{
+				track = value;
+			}
+			else if (option == "--cars")
+			{
+				cars = max(1, stoi(value));
+			}
+			else if (option == "--emitters")
+			{
+				emitters = max(0, stoi(value));
+			}
+			else if (option == "--ticks")
+			{
+				ticks = max(1, stoi(value));
+			}
+			else if (option == "--threads")
+			{
+				maxThreads = max(1, min(stoi(value), JobSystem::kMaxThreads));
+			}
+			else
+			{
+				cout << "Unknown option " << option << " " << value << endl;
+				printUsage();
+				return 1;
+			}
+		}
+		catch (const exception&)
+		{
+			cout << "Bad value for " << option << ": " << value << endl;
+			return 1;
+		}
+	}
+
+	RaceTrackData data;
+	if (!data.load(track))
+	{
+		return 1;
+	}
+
+	// 1, 2, 4... threads, and the most last
+	vector<int> threadCounts;
+	for (int threads = 1; threads < maxThreads; threads *= 2)
+	{
+		threadCounts.push_back(threads);
+	}
+	threadCounts.push_back(maxThreads);
+
+	cout << "Benchmarking " << ticks << " ticks of " << cars << " AI cars and " << emitters << " emitters (" << emitters * kParticlesPerEmitter
+		<< " particles)" << endl;
+	// What each car costs: the engine side objects, and the state the tick touches
+	cout << "Per car: HoverAI " << sizeof(HoverAI) << " bytes (state " << sizeof(HoverAI::SHoverAIState) << "), HoverCar " << sizeof(HoverCar)
+		<< " bytes (state " << sizeof(HoverCar::SHoverCarState) << "), simulated car " << sizeof(RaceSimulator::SSimCar) << " bytes" << endl;
+	double singleThread = 0.0;
+	uint64_t firstHash = 0;
+	bool deterministic = true;
+	for (int threads : threadCounts)
+	{
+		uint64_t hash;
+		const double tick = benchmark(data, threads, cars, emitters, ticks, hash);
+		if (threads == 1)
+		{
+			singleThread = tick;
+			firstHash = hash;
+		}
+		deterministic = deterministic && hash == firstHash;
+
+		cout << threads << " threads: " << tick * 1e3 << "ms per tick, " << singleThread / tick << "x, state " << hex << hash << dec << endl;
+	}
+
+	if (!deterministic)
+	{
+		cout << "The final state depends on the number of threads" << endl;
+		return 1;
+	}
+	return 0;
+}
+
+void JobBenchmarkCommand::printUsage()
+{
+	cout << "Usage: DesertRacer " << kFlag << " [--cars N] [--emitters N] [--ticks N] [--threads N] [--track file]" << endl;
+}
+
+double JobBenchmarkCommand::benchmark(const RaceTrackData& track, int threads, int cars, int emitters, int ticks, uint64_t& hash)
+{
+	const SSimulationSettings& settings = RaceSimulator::kDefaultSettings;
+	const float kDeltaTime = settings.kDeltaTime;
+	const SSimulationConfig config;
+	const SHoverAITuning& tuning = config.ai;
+	const RaceSimulator simulator(&track);
+
+	// Every car on the AI rules, rows added behind the grid
+	SBenchState state;
+	simulator.start(state.session, config, 1, cars, 0);
+	vector<RaceSimulator::SSimCar>& simCars = state.session.cars;
+	state.snapshots.resize(cars);
+	state.steering.resize(cars);
+	state.hits.resize(cars);
+	state.particles.resize(emitters * kParticlesPerEmitter);
+	for (unsigned int i = 0; i < state.particles.size(); i++)
+	{
+		// Emitters over the checkpoints, particles at different points of their life
+		state.particles[i].position = { track.getCheckpoint(i / kParticlesPerEmitter % track.getStagesNumber()).x, 0.0f,
+			track.getCheckpoint(i / kParticlesPerEmitter % track.getStagesNumber()).y };
+		state.particles[i].lifespan = (i % kParticlesPerEmitter) / static_cast<float>(kParticlesPerEmitter);
+	}
+
+	JobGraph graph;
+	graph.addParallelFor("particles.simulate", [emitters] { return emitters; }, kBatchSize,
+		[&state, kDeltaTime](int first, int last) { updateParticles(state.particles, first, last, kDeltaTime); });
+
+	// Same stages as the race tick: what steering and queries read is captured first
+	const int snapshots = graph.addParallelFor("snapshots", [cars] { return cars; }, kBatchSize, [&](int first, int last)
+	{
+		for (int i = first; i < last; i++)
+		{
+			const RaceSimulator::SSimCar& car = simCars[i];
+			SVehicleSnapshot& snapshot = state.snapshots[i];
+			snapshot.position = car.car.position;
+			snapshot.facing = HeadlessCar::headingVector(car.ai.heading);
+			snapshot.movement = car.car.movement;
+			snapshot.distanceToCheckpoint = (track.getCheckpoint(car.car.stage % track.getStagesNumber()) - car.car.position).length();
+			snapshot.stage = car.car.stage;
+			snapshot.lap = car.car.lap;
+		}
+	});
+	const int steering = graph.addParallelFor("ai.steering", [cars] { return cars; }, kBatchSize, [&](int first, int last)
+	{
+		for (int i = first; i < last; i++)
+		{
+			state.steering[i] = HoverAI::steer(simCars[i].driver, simCars[i].ai, state.snapshots[i], settings.kGameSpeed, kDeltaTime);
+		}
+	}, { snapshots });
+	const int apply = graph.addParallelFor("ai.apply", [cars] { return cars; }, kBatchSize, [&](int first, int last)
+	{
+		for (int i = first; i < last; i++)
+		{
+			RaceSimulator::SSimCar& car = simCars[i];
+			car.ai.invTimer = state.steering[i].invTimer;
+			car.ai.lineDistance = state.steering[i].lineDistance;
+			car.ai.heading = state.steering[i].heading;
+			car.car.movement += state.steering[i].thrust;
+			// Laps go on for as long as the benchmark
+			HeadlessCar::passCheckpoints(car.car, track, INT32_MAX);
+		}
+	}, { steering });
+	// Obstacles, then every other car (the snapshots do not move during the tick)
+	const int queries = graph.addParallelFor("ai.collision", [cars] { return cars; }, kBatchSize, [&](int first, int last)
+	{
+		for (int i = first; i < last; i++)
+		{
+			const SVector2D position = simCars[i].car.position;
+			bool hit = track.getCollisionWorld().overlap(position, tuning.kCollisionRadius) >= 0;
+			for (int j = 0; j < cars && !hit; j++)
+			{
+				hit = j != i && Collision::circleToCircle(position, state.snapshots[j].position, tuning.kCollisionRadius,
+					tuning.kCollisionRadius) == Collision::Both;
+			}
+			state.hits[i] = hit;
+		}
+	}, { apply });
+	// Serial, always in the same order
+	graph.addTask("ai.resolution", [&]
+	{
+		for (int i = 0; i < cars; i++)
+		{
+			RaceSimulator::SSimCar& car = simCars[i];
+			if (state.hits[i] && !car.ai.invTimer)
+			{
+				car.ai.invTimer = tuning.kInvTime;
+				car.car.movement = -car.car.movement * tuning.kBounce;
+				--car.ai.health;
+			}
+			car.car.previousPosition = car.car.position;
+			car.car.position += car.car.movement * kDeltaTime;
+			car.car.movement *= tuning.kDrag;
+		}
+	}, { queries });
+
+	JobSystem jobs(threads - 1);
+	const auto start = chrono::steady_clock::now();
+	for (int tick = 0; tick < ticks; tick++)
+	{
+		jobs.run(graph);
+	}
+	const double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+	vector<SHashedCar> hashed;
+	for (const RaceSimulator::SSimCar& car : simCars)
+	{
+		hashed.push_back(RaceSimulator::hashedCar(car));
+	}
+	StateHashStream stream;
+	stream.begin(cars);
+	hash = stream.record(ticks * kDeltaTime, hashed.data());
+
+	return seconds / ticks;
+}
+
+void JobBenchmarkCommand::updateParticles(vector<SBenchParticle>& particles, int first, int last, const float kDeltaTime)
+{
+	// Fire particles (see FireParticleSystem)
+	const SVector3D kInitialVelocity = { 0.0f, 3.0f, 0.0f };
+	const SVector3D kGravity = { 0.0f, -20.0f, 0.0f };
+	const float kLifespan = 1.0f;
+
+	for (int i = first * kParticlesPerEmitter; i < last * kParticlesPerEmitter; i++)
+	{
+		SBenchParticle& p = particles[i];
+		p.position += p.velocity * kDeltaTime;
+		p.lifespan += kDeltaTime;
+		p.velocity += kGravity * kDeltaTime;
+
+		if (p.lifespan > kLifespan)
+		{
+			const float spread = static_cast<float>(i % 7) - 3.0f;
+			p.lifespan = 0.0f;
+			p.velocity = kInitialVelocity + SVector3D{ spread * 0.1f, 0.0f, -spread * 0.1f };
+			p.position.y = 0.0f;
+		}
+	}
+}
@@ -0,0 +1,73 @@
+/**
+ * @file jobbench.h
+ * Scaling benchmark of the job system on the stages of a race tick
+ *
+ * @author Jacob Sanchez Perez (G20812080) <jsanchez-perez@uclan.ac.uk>
+ * Games Concepts (CO1301), University of Central Lancashire
+ */
+
+#ifndef DESERT_RACER_JOB_BENCH_H
+#define DESERT_RACER_JOB_BENCH_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "vector.h"
+#include "jobs.h"
+#include "simulator.h"
+
+
+namespace desert
+{
+	/**
+	* Command line front end: DesertRacer --bench-jobs [--cars N] [--emitters N] [--ticks N] [--threads N] [--track file]
+	* Runs the same ticks on 1, 2, 4... threads up to every core (or --threads) and reports the time per tick and the speedup
+	* A tick has the stages of DesertRacetrack's race tick: particles and AI steering in parallel batches,
+	* collision queries in parallel on the positions of the tick, serial resolution
+	* Every thread count must end in the same state, the hash of it is printed next to each run
+	* The bytes each car takes (engine objects and simulated state) are printed first
+	*/
+	class JobBenchmarkCommand
+	{
+	public:
+		static const std::string kFlag;
+
+		/**
+		* @param args Arguments after the flag
+		* @param defaultTrack Track raced if none is given
+		* @return Process exit code
+		*/
+		static int run(const std::vector<std::string>& args, const std::string& defaultTrack);
+	protected:
+		// One particle of an emitter, updated as ParticleSystem::updateSystem does (no models to move)
+		struct SBenchParticle
+		{
+			SVector3D position;
+			SVector3D velocity;
+			float lifespan = 0.0f;
+		};
+
+		// Items per job, as in the race tick
+		static const int kBatchSize = 16;
+		// As many as a fire system
+		static const int kParticlesPerEmitter = 120;
+
+		struct SBenchState
+		{
+			RaceSimulator::SSession session;
+			// Read by steering and queries, captured at the start of the tick
+			std::vector<SVehicleSnapshot> snapshots;
+			std::vector<HoverAI::SSteering> steering;
+			std::vector<char> hits;
+			std::vector<SBenchParticle> particles;
+		};
+
+		static void printUsage();
+		// Time per tick (seconds) of a run on a number of threads, hash of the final state
+		static double benchmark(const RaceTrackData& track, int threads, int cars, int emitters, int ticks, uint64_t& hash);
+		// Particles of emitters [first, last)
+		static void updateParticles(std::vector<SBenchParticle>& particles, int first, int last, const float kDeltaTime);
+	};
+}
+
+#endif
@@ -0,0 +1,290 @@
+/**
+ * @file jobs.cpp
+ * Work-stealing job system running the stages of a tick
+ *
+ * @author Jacob Sanchez Perez (G20812080) <jsanchez-perez@uclan.ac.uk>
+ * Games Concepts (CO1301), University of Central Lancashire
+ */
+
+#include <algorithm>
+#include "jobs.h"
+
+using namespace std;
+using namespace desert;
+
+namespace
+{
+	thread_local int tThreadIndex = 0;
+}
+
+
+////////////////////
+// Graph
+////////////////////
+
+int JobGraph::addTask(string name, function<void()> task, initializer_list<int> dependencies, Affinity affinity)
+{
+	return addStage({ name, [] { return 1; }, [task](int, int) { task(); }, 1, affinity, 0, {} }, dependencies);
+}
+
+int JobGraph::addParallelFor(string name, function<int()> count, int batchSize, function<void(int, int)> body, initializer_list<int> dependencies)
+{
+	return addStage({ name, count, body, max(batchSize, 1), AnyThread, 0, {} }, dependencies);
+}
+
+int JobGraph::addStage(SStage stage, initializer_list<int> dependencies)
+{
+	const int index = static_cast<int>(mStages.size());
+
+	// Stages can only depend on earlier ones, so the graph never has cycles
+	for (int dependency : dependencies)
+	{
+		if (dependency >= 0 && dependency < index)
+		{
+			mStages[dependency].dependents.push_back(index);
+			++stage.dependencies;
+		}
+	}
+
+	mStages.push_back(stage);
+	return index;
+}
+
+int JobGraph::getStagesNumber() const
+{
+	return static_cast<int>(mStages.size());
+}
+
+
+////////////////////
+// Job system
+////////////////////
+
+const int JobSystem::kMaxThreads;
+const int JobSystem::kCacheLine;
+
+int JobSystem::defaultWorkerCount()
+{
+	const int cores = static_cast<int>(thread::hardware_concurrency());
+	return max(0, min(cores - 1, kMaxThreads - 1));
+}
+
+int JobSystem::getThreadIndex()
+{
+	return tThreadIndex;
+}
+
+JobSystem::JobSystem(int workers) : mStagesLeft(0), mQueuedJobs(0)
+{
+	workers = max(0, min(workers, kMaxThreads - 1));
+
+	for (int i = 0; i <= workers; i++)
+	{
+		mQueues.push_back(unique_ptr<SWorkQueue>(new SWorkQueue()));
+	}
+
+	for (int i = 1; i <= workers; i++)
+	{
+		mThreads.push_back(thread(&JobSystem::workerLoop, this, i));
+	}
+}
+
+JobSystem::~JobSystem()
+{
+	{
+		lock_guard<mutex> lock(mSleepLock);
+		mQuit = true;
+	}
+	mWake.notify_all();
+
+	for (thread& worker : mThreads)
+	{
+		worker.join();
+	}
+}
+
+void JobSystem::run(const JobGraph& graph)
+{
+	const int stages = graph.getStagesNumber();
+
+	if (stages > mCapacity)
+	{
+		mDependenciesLeft.reset(new atomic<int>[stages]);
+		mJobsLeft.reset(new atomic<int>[stages]);
+		mCapacity = stages;
+	}
+
+	for (int i = 0; i < stages; i++)
+	{
+		mDependenciesLeft[i] = graph.mStages[i].dependencies;
+		mJobsLeft[i] = 0;
+	}
+
+	mGraph = &graph;
+	mStagesLeft = stages;
+
+	for (int i = 0; i < stages; i++)
+	{
+		if (!graph.mStages[i].dependencies)
+		{
+			startStage(0, i);
+		}
+	}
+
+	// Work alongside the workers until the whole graph is done
+	while (mStagesLeft > 0)
+	{
+		SJob job;
+		bool found = false;
+		{
+			lock_guard<mutex> lock(mMainQueue.lock);
+			if (!mMainQueue.jobs.empty())
+			{
+				job = mMainQueue.jobs.front();
+				mMainQueue.jobs.pop_front();
+				found = true;
+			}
+		}
+
+		if (found || findJob(0, job))
+		{
+			execute(0, job);
+		}
+		else
+		{
+			this_thread::yield();
+		}
+	}
+
+	mGraph = nullptr;
+}
+
+void JobSystem::workerLoop(int index)
+{
+	tThreadIndex = index;
+
+	while (true)
+	{
+		SJob job;
+		if (findJob(index, job))
+		{
+			execute(index, job);
+			continue;
+		}
+
+		unique_lock<mutex> lock(mSleepLock);
+		mWake.wait(lock, [this] { return mQuit || mQueuedJobs > 0; });
+		if (mQuit)
+		{
+			return;
+		}
+	}
+}
+
+bool JobSystem::findJob(int index, SJob& job)
+{
+	{
+		SWorkQueue& own = *mQueues[index];
+		lock_guard<mutex> lock(own.lock);
+		if (!own.jobs.empty())
+		{
+			job = own.jobs.back();
+			own.jobs.pop_back();
+			--mQueuedJobs;
+			return true;
+		}
+	}
+
+	const int queues = static_cast<int>(mQueues.size());
+	for (int i = 1; i < queues; i++)
+	{
+		SWorkQueue& victim = *mQueues[(index + i) % queues];
+		lock_guard<mutex> lock(victim.lock);
+		if (!victim.jobs.empty())
+		{
+			job = victim.jobs.front();
+			victim.jobs.pop_front();
+			--mQueuedJobs;
+			++mQueues[index]->stats.stolen;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void JobSystem::execute(int index, const SJob& job)
+{
+	mGraph->mStages[job.stage].body(job.first, job.last);
+	++mQueues[index]->stats.executed;
+
+	if (--mJobsLeft[job.stage] == 0)
+	{
+		finishStage(index, job.stage);
+	}
+}
+
+void JobSystem::startStage(int index, int stage)
+{
+	const JobGraph::SStage& s = mGraph->mStages[stage];
+	const int count = s.count();
+
+	// Nothing to do this time
+	if (count <= 0)
+	{
+		finishStage(index, stage);
+		return;
+	}
+
+	const int jobs = (count + s.batchSize - 1) / s.batchSize;
+	mJobsLeft[stage] = jobs;
+
+	const bool mainThread = s.affinity == JobGraph::MainThread;
+	SWorkQueue& queue = mainThread ? mMainQueue : *mQueues[index];
+	{
+		lock_guard<mutex> lock(queue.lock);
+		for (int first = 0; first < count; first += s.batchSize)
+		{
+			queue.jobs.push_back({ stage, first, min(first + s.batchSize, count) });
+		}
+	}
+
+	if (!mainThread)
+	{
+		mQueuedJobs += jobs;
+		{
+			lock_guard<mutex> lock(mSleepLock);
+		}
+		mWake.notify_all();
+	}
+}
+
+void JobSystem::finishStage(int index, int stage)
+{
+	for (int dependent : mGraph->mStages[stage].dependents)
+	{
+		if (--mDependenciesLeft[dependent] == 0)
+		{
+			startStage(index, dependent);
+		}
+	}
+
+	// Last, so run() cannot return while dependents are being started
+	--mStagesLeft;
+}
+
+int JobSystem::getWorkerCount() const
+{
+	return static_cast<int>(mThreads.size());
+}
+
+JobSystem::SJobStats JobSystem::getStats() const
+{
+	SJobStats total;
+	for (const unique_ptr<SWorkQueue>& queue : mQueues)
+	{
+		total.executed += queue->stats.executed;
+		total.stolen += queue->stats.stolen;
+	}
+	return total;
+}
@@ -0,0 +1,163 @@
+/**
+ * @file jobs.h
+ * Work-stealing job system running the stages of a tick
+ *
+ * @author Jacob Sanchez Perez (G20812080) <jsanchez-perez@uclan.ac.uk>
+ * Games Concepts (CO1301), University of Central Lancashire
+ */
+
+#ifndef DESERT_RACER_JOBS_H
+#define DESERT_RACER_JOBS_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+namespace desert
+{
+	/**
+	* Stages of a tick and the order they depend on each other
+	* Built once, run as many times as needed by a JobSystem
+	*/
+	class JobGraph
+	{
+	public:
+		// Where a stage is allowed to run
+		enum Affinity
+		{
+			AnyThread,
+			// Stages that touch the engine / UI / input
+			MainThread
+		};
+
+		/**
+		* Add a stage that runs once
+		* @param name Name used in reports
+		* @param task Work to do
+		* @param dependencies Stages that must finish before this one starts
+		* @return Handle of the stage, used as a dependency by later ones
+		*/
+		int addTask(std::string name, std::function<void()> task, std::initializer_list<int> dependencies = {}, Affinity affinity = AnyThread);
+		/**
+		* Add a stage split in batches that run in parallel
+		* @param count Number of items, asked every time the stage starts
+		* @param batchSize Items per job
+		* @param body Processes items [first, last)
+		*/
+		int addParallelFor(std::string name, std::function<int()> count, int batchSize, std::function<void(int first, int last)> body, std::initializer_list<int> dependencies = {});
+
+		int getStagesNumber() const;
+	private:
+		friend class JobSystem;
+
+		struct SStage
+		{
+			std::string name;
+			std::function<int()> count;
+			std::function<void(int, int)> body;
+			int batchSize;
+			Affinity affinity;
+			int dependencies;
+			std::vector<int> dependents;
+		};
+
+		int addStage(SStage stage, std::initializer_list<int> dependencies);
+
+		std::vector<SStage> mStages;
+	};
+
+	/**
+	* Fixed pool of worker threads, each with its own job queue
+	* Idle workers steal from the others; the thread calling run() works too
+	*/
+	class JobSystem
+	{
+	public:
+		// Upper limit of threads (main included), sizes per-thread counters elsewhere
+		static const int kMaxThreads = 64;
+		/**
+		* Bytes kept between data written by different threads, so they never share a cache line
+		* Padding rather than alignas: over-aligned types are not aligned by new before C++17
+		*/
+		static const int kCacheLine = 64;
+
+		struct SJobStats
+		{
+			long long executed = 0;
+			long long stolen = 0;
+		};
+
+		// One worker per core, the main thread takes the remaining one
+		static int defaultWorkerCount();
+		// 0 on the main thread, 1..workers on the workers
+		static int getThreadIndex();
+
+		/**
+		* @param workers Worker threads to start (0 runs everything on the calling thread)
+		*/
+		JobSystem(int workers = defaultWorkerCount());
+		~JobSystem();
+		JobSystem(const JobSystem&) = delete;
+		JobSystem& operator=(const JobSystem&) = delete;
+
+		/**
+		* Run every stage of a graph, returns once all of them are done
+		* Must be called from the thread that created the job system
+		*/
+		void run(const JobGraph& graph);
+
+		int getWorkerCount() const;
+		SJobStats getStats() const;
+	private:
+		struct SJob
+		{
+			int stage;
+			int first, last;
+		};
+
+		// Allocated one by one, padded so that the next allocation starts on another cache line
+		struct SWorkQueue
+		{
+			std::mutex lock;
+			std::deque<SJob> jobs;
+			SJobStats stats;
+			char padding[kCacheLine];
+		};
+
+		void workerLoop(int index);
+		// Own queue first (newest job), then steal from the others (oldest job)
+		bool findJob(int index, SJob& job);
+		void execute(int index, const SJob& job);
+		// Split a stage whose dependencies are done into jobs
+		void startStage(int index, int stage);
+		void finishStage(int index, int stage);
+
+		// Queue 0 belongs to the main thread, the rest to the workers
+		std::vector<std::unique_ptr<SWorkQueue>> mQueues;
+		// MainThread stages, only the main thread takes from here
+		SWorkQueue mMainQueue;
+		std::vector<std::thread> mThreads;
+
+		// State of the graph being run
+		const JobGraph* mGraph = nullptr;
+		std::unique_ptr<std::atomic<int>[]> mDependenciesLeft, mJobsLeft;
+		int mCapacity = 0;
+		std::atomic<int> mStagesLeft;
+
+		// Sleeping workers
+		std::mutex mSleepLock;
+		std::condition_variable mWake;
+		std::atomic<int> mQueuedJobs;
+		bool mQuit = false;
+	};
+}
+
+#endif
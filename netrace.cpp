@@ -0,0 +1,836 @@
+/**
+ * @file netrace.cpp
+ * Authoritative server races with remote players over UDP, clients get delta compressed snapshots
+ *
+ * @author Jacob Sanchez Perez (G20812080) <jsanchez-perez@uclan.ac.uk>
+ * Games Concepts (CO1301), University of Central Lancashire
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <thread>
+#include <cmath>
+#include <algorithm>
+#include "racecar.h"
+#include "netrace.h"
+#include "prediction.h"
+
+using namespace std;
+using namespace desert;
+
+const int SNetSnapshot::kMaxCars;
+const int NetSnapshotHistory::kSize;
+
+// Every packet starts with these 16 bits, anything else on the port is ignored
+static const uint32_t kPacketMagic = 0x4452;
+static const int kPacketTypeBits = 2;
+static const size_t kMaxPacketSize = 1200;
+
+enum PacketType
+{
+	HelloPacket,
+	WelcomePacket,
+	InputPacket,
+	SnapshotPacket
+};
+
+static void writeHeader(BitWriter& writer, PacketType type)
+{
+	writer.write(kPacketMagic, 16);
+	writer.write(type, kPacketTypeBits);
+}
+
+// Returns false if the packet is not one of ours
+static bool readHeader(BitReader& reader, PacketType& type)
+{
+	const uint32_t magic = reader.read(16);
+	type = static_cast<PacketType>(reader.read(kPacketTypeBits));
+	return reader.isGood() && magic == kPacketMagic;
+}
+
+
+SNetCar NetCodec::quantize(const SHashedCar& car)
+{
+	SNetCar net;
+	net.x = static_cast<int32_t>(lround(car.positionX * kPositionScale));
+	net.z = static_cast<int32_t>(lround(car.positionY * kPositionScale));
+	net.movementX = static_cast<int32_t>(lround(car.movementX * kPositionScale));
+	net.movementZ = static_cast<int32_t>(lround(car.movementY * kPositionScale));
+
+	const float turns = car.heading / 360.0f;
+	const long step = lround((turns - floor(turns)) * kHeadingSteps);
+	net.heading = static_cast<uint16_t>(step % kHeadingSteps);
+
+	net.health = static_cast<uint8_t>(min(max(car.health, 0), (1 << kHealthBits) - 1));
+	net.stage = static_cast<uint8_t>(min(max(car.stage, 0), (1 << kStageBits) - 1));
+	net.lap = static_cast<uint8_t>(min(max(car.lap, 0), (1 << kLapBits) - 1));
+	net.racing = car.racing ? 1 : 0;
+	return net;
+}
+
+SVector2D NetCodec::getPosition(const SNetCar& car)
+{
+	return { static_cast<float>(car.x) / kPositionScale, static_cast<float>(car.z) / kPositionScale };
+}
+
+SVector2D NetCodec::getMovement(const SNetCar& car)
+{
+	return { static_cast<float>(car.movementX) / kPositionScale, static_cast<float>(car.movementZ) / kPositionScale };
+}
+
+float NetCodec::getHeading(const SNetCar& car)
+{
+	return car.heading * 360.0f / kHeadingSteps;
+}
+
+bool NetCodec::equals(const SNetCar& a, const SNetCar& b)
+{
+	return a.x == b.x && a.z == b.z && a.movementX == b.movementX && a.movementZ == b.movementZ && a.heading == b.heading &&
+		a.health == b.health && a.stage == b.stage && a.lap == b.lap && a.racing == b.racing;
+}
+
+void NetCodec::writeSnapshot(BitWriter& writer, const SNetSnapshot& snapshot, const SNetSnapshot* baseline)
+{
+	static const SNetCar kEmpty;
+	writer.write(snapshot.cars, kCarsBits);
+
+	for (int i = 0; i < snapshot.cars; i++)
+	{
+		const SNetCar& car = snapshot.car[i];
+		const SNetCar& base = (baseline && i < baseline->cars) ? baseline->car[i] : kEmpty;
+
+		const bool changed = !equals(car, base);
+		writer.writeBool(changed);
+		if (!changed)
+		{
+			continue;
+		}
+
+		const int32_t deltas[] = { car.x - base.x, car.z - base.z, car.movementX - base.movementX, car.movementZ - base.movementZ };
+		for (const int32_t delta : deltas)
+		{
+			writer.writeBool(delta != 0);
+			if (delta)
+			{
+				writer.writeVarSigned(delta);
+			}
+		}
+
+		// The short way around
+		int32_t turn = car.heading - base.heading;
+		turn -= (turn >= kHeadingSteps / 2) ? kHeadingSteps : (turn < -kHeadingSteps / 2) ? -kHeadingSteps : 0;
+		writer.writeBool(turn != 0);
+		if (turn)
+		{
+			writer.writeVarSigned(turn);
+		}
+
+		const bool packedChanged = car.health != base.health || car.stage != base.stage || car.lap != base.lap || car.racing != base.racing;
+		writer.writeBool(packedChanged);
+		if (packedChanged)
+		{
+			writer.write(car.health, kHealthBits);
+			writer.write(car.stage, kStageBits);
+			writer.write(car.lap, kLapBits);
+			writer.write(car.racing, 1);
+		}
+	}
+}
+
+bool NetCodec::readSnapshot(BitReader& reader, SNetSnapshot& snapshot, const SNetSnapshot* baseline)
+{
+	static const SNetCar kEmpty;
+	snapshot.cars = reader.read(kCarsBits);
+	if (snapshot.cars > SNetSnapshot::kMaxCars)
+	{
+		return false;
+	}
+
+	for (int i = 0; i < snapshot.cars; i++)
+	{
+		SNetCar& car = snapshot.car[i];
+		car = (baseline && i < baseline->cars) ? baseline->car[i] : kEmpty;
+		if (!reader.readBool())
+		{
+			continue;
+		}
+
+		int32_t* fields[] = { &car.x, &car.z, &car.movementX, &car.movementZ };
+		for (int32_t* field : fields)
+		{
+			if (reader.readBool())
+			{
+				*field += reader.readVarSigned();
+			}
+		}
+
+		if (reader.readBool())
+		{
+			const int32_t heading = car.heading + reader.readVarSigned();
+			car.heading = static_cast<uint16_t>(((heading % kHeadingSteps) + kHeadingSteps) % kHeadingSteps);
+		}
+
+		if (reader.readBool())
+		{
+			car.health = static_cast<uint8_t>(reader.read(kHealthBits));
+			car.stage = static_cast<uint8_t>(reader.read(kStageBits));
+			car.lap = static_cast<uint8_t>(reader.read(kLapBits));
+			car.racing = static_cast<uint8_t>(reader.read(1));
+		}
+	}
+	return reader.isGood();
+}
+
+
+void NetSnapshotHistory::add(const SNetSnapshot& snapshot)
+{
+	mSnapshots[mNext] = snapshot;
+	mNext = (mNext + 1) % kSize;
+	mCount = min(mCount + 1, kSize);
+}
+
+const SNetSnapshot* NetSnapshotHistory::find(uint32_t tick) const
+{
+	// Newest first, the baseline asked for is nearly always recent
+	for (int i = 1; i <= mCount; i++)
+	{
+		const SNetSnapshot& snapshot = mSnapshots[(mNext - i + kSize) % kSize];
+		if (snapshot.tick == tick)
+		{
+			return &snapshot;
+		}
+	}
+	return nullptr;
+}
+
+void NetSnapshotHistory::clear()
+{
+	mCount = 0;
+	mNext = 0;
+}
+
+
+RaceServer::RaceServer(const RaceTrackData* track, const SNetSettings& settings) :
+	mSettings(settings), mSimulator(track, &mRaceSettings)
+{
+	mRaceSettings.kDeltaTime = 1.0f / mSettings.kTickRate;
+	mRaceSettings.kLaps = mSettings.kLaps;
+}
+
+bool RaceServer::open()
+{
+	if (!mSocket.open(mSettings.kPort))
+	{
+		return false;
+	}
+	mSocket.setLoss(mSettings.kLoss, mSettings.kSeed);
+	return true;
+}
+
+uint16_t RaceServer::getPort() const
+{
+	return mSocket.getPort();
+}
+
+bool RaceServer::tick()
+{
+	receive();
+	if (mOver)
+	{
+		return false;
+	}
+
+	if (!mStarted)
+	{
+		if (static_cast<int>(mClients.size()) < mSettings.kPlayers)
+		{
+			return true;
+		}
+
+		const int cars = min(max(mSettings.kCars, mSettings.kPlayers), SNetSnapshot::kMaxCars);
+		mSimulator.start(mSession, mConfig, mSettings.kSeed, cars, mSettings.kPlayers);
+		mActions.assign(cars, SRaceAction());
+		mStarted = true;
+		cout << "Race started with " << mClients.size() << " players and " << cars - mClients.size() << " AI" << endl;
+	}
+
+	for (const SClient& client : mClients)
+	{
+		mActions[client.car] = RaceSimulator::decodeInput(client.input);
+	}
+	mOver = !mSimulator.step(mSession, mActions.data(), mRaceSettings.kDeltaTime) || mSession.time >= mRaceSettings.kTimeLimit;
+
+	// Snapshots on their own rate, and always the last one
+	const unsigned int interval = max(1, mSettings.kTickRate / mSettings.kSnapshotRate);
+	if (mSession.tick % interval == 0 || mOver)
+	{
+		SNetSnapshot snapshot;
+		snapshot.tick = mSession.tick;
+		snapshot.cars = static_cast<int>(mSession.cars.size());
+		for (int i = 0; i < snapshot.cars; i++)
+		{
+			snapshot.car[i] = NetCodec::quantize(RaceSimulator::hashedCar(mSession.cars[i]));
+		}
+		mHistory.add(snapshot);
+
+		for (SClient& client : mClients)
+		{
+			sendSnapshot(client, snapshot);
+		}
+	}
+	return !mOver;
+}
+
+bool RaceServer::isStarted() const
+{
+	return mStarted;
+}
+
+const NetSnapshotHistory& RaceServer::getHistory() const
+{
+	return mHistory;
+}
+
+void RaceServer::getClientStats(vector<SClientStats>& stats) const
+{
+	stats.clear();
+	for (const SClient& client : mClients)
+	{
+		stats.push_back({ client.address, client.car, client.bytes, client.snapshots, client.fullSnapshots });
+	}
+}
+
+void RaceServer::getResults(vector<SCarResult>& results)
+{
+	mSimulator.finish(mSession, results);
+}
+
+void RaceServer::receive()
+{
+	uint8_t data[kMaxPacketSize];
+	SNetAddress from;
+	int size;
+	while ((size = mSocket.receive(from, data, sizeof(data))) >= 0)
+	{
+		BitReader reader(data, size);
+		PacketType type;
+		if (!readHeader(reader, type))
+		{
+			continue;
+		}
+
+		SClient* client = findClient(from);
+		if (type == HelloPacket)
+		{
+			// Players join until the race starts, a repeated hello means the welcome was lost
+			if (!client && !mStarted && static_cast<int>(mClients.size()) < mSettings.kPlayers)
+			{
+				mClients.push_back(SClient());
+				client = &mClients.back();
+				client->address = from;
+				client->car = static_cast<int>(mClients.size()) - 1;
+				cout << from.toString() << " joined, car " << client->car << endl;
+			}
+			if (client)
+			{
+				sendWelcome(*client);
+			}
+		}
+		else if (type == InputPacket && client)
+		{
+			const bool acknowledged = reader.readBool();
+			const uint32_t acknowledgedTick = acknowledged ? reader.read(32) : 0;
+			const uint32_t sequence = reader.read(32);
+			const uint8_t input = static_cast<uint8_t>(reader.read(5));
+
+			// Packets arrive out of order, only newer ones count
+			if (!reader.isGood() || sequence <= client->inputSequence)
+			{
+				continue;
+			}
+			client->inputSequence = sequence;
+			client->input = input;
+			if (acknowledged && (!client->acknowledged || acknowledgedTick > client->acknowledgedTick))
+			{
+				client->acknowledged = true;
+				client->acknowledgedTick = acknowledgedTick;
+			}
+		}
+	}
+}
+
+void RaceServer::sendWelcome(SClient& client)
+{
+	BitWriter writer(mPacket);
+	writeHeader(writer, WelcomePacket);
+	writer.write(client.car, 8);
+	writer.write(mSettings.kPlayers, 8);
+	writer.write(mSettings.kLaps, 8);
+	mSocket.send(client.address, mPacket.data(), mPacket.size());
+	client.bytes += mPacket.size() + UdpSocket::kHeaderBytes;
+}
+
+void RaceServer::sendSnapshot(SClient& client, const SNetSnapshot& snapshot)
+{
+	// Against the newest snapshot the client is known to have, if it is still held
+	const SNetSnapshot* baseline = client.acknowledged ? mHistory.find(client.acknowledgedTick) : nullptr;
+
+	BitWriter writer(mPacket);
+	writeHeader(writer, SnapshotPacket);
+	writer.write(snapshot.tick, 32);
+	writer.writeBool(baseline != nullptr);
+	if (baseline)
+	{
+		writer.write(baseline->tick, 32);
+	}
+	NetCodec::writeSnapshot(writer, snapshot, baseline);
+
+	mSocket.send(client.address, mPacket.data(), mPacket.size());
+	client.bytes += mPacket.size() + UdpSocket::kHeaderBytes;
+	++client.snapshots;
+	if (!baseline)
+	{
+		++client.fullSnapshots;
+	}
+}
+
+RaceServer::SClient* RaceServer::findClient(const SNetAddress& address)
+{
+	for (SClient& client : mClients)
+	{
+		if (client.address == address)
+		{
+			return &client;
+		}
+	}
+	return nullptr;
+}
+
+
+bool RaceClient::connect(const SNetAddress& server, float loss, uint64_t lossSeed)
+{
+	mServer = server;
+	mJoined = false;
+	mHasLatest = false;
+	mSequence = 0;
+	mHistory.clear();
+
+	if (!mSocket.open())
+	{
+		return false;
+	}
+	mSocket.setLoss(loss, lossSeed);
+	return true;
+}
+
+void RaceClient::update(uint8_t input)
+{
+	receive();
+
+	BitWriter writer(mPacket);
+	if (!mJoined)
+	{
+		writeHeader(writer, HelloPacket);
+		mSocket.send(mServer, mPacket.data(), mPacket.size());
+		return;
+	}
+
+	writeHeader(writer, InputPacket);
+	writer.writeBool(mHasLatest);
+	if (mHasLatest)
+	{
+		writer.write(mLatest.tick, 32);
+	}
+	writer.write(++mSequence, 32);
+	writer.write(input, 5);
+	mSocket.send(mServer, mPacket.data(), mPacket.size());
+}
+
+bool RaceClient::isJoined() const
+{
+	return mJoined;
+}
+
+int RaceClient::getCar() const
+{
+	return mCar;
+}
+
+const SNetSnapshot* RaceClient::getLatest() const
+{
+	return mHasLatest ? &mLatest : nullptr;
+}
+
+int RaceClient::getSnapshotsReceived() const
+{
+	return mReceived;
+}
+
+int RaceClient::getSnapshotsRejected() const
+{
+	return mRejected;
+}
+
+void RaceClient::receive()
+{
+	uint8_t data[kMaxPacketSize];
+	SNetAddress from;
+	int size;
+	while ((size = mSocket.receive(from, data, sizeof(data))) >= 0)
+	{
+		BitReader reader(data, size);
+		PacketType type;
+		if (!(from == mServer) || !readHeader(reader, type))
+		{
+			continue;
+		}
+
+		if (type == WelcomePacket)
+		{
+			const int car = reader.read(8);
+			if (reader.isGood() && !mJoined)
+			{
+				mCar = car;
+				mJoined = true;
+			}
+		}
+		else if (type == SnapshotPacket)
+		{
+			SNetSnapshot snapshot;
+			snapshot.tick = reader.read(32);
+			const bool hasBaseline = reader.readBool();
+			const uint32_t baselineTick = hasBaseline ? reader.read(32) : 0;
+			const SNetSnapshot* baseline = hasBaseline ? mHistory.find(baselineTick) : nullptr;
+
+			// Late packets are of no use, the newer snapshot already replaced them
+			if (!reader.isGood() || (mHasLatest && snapshot.tick <= mLatest.tick))
+			{
+				continue;
+			}
+			if ((hasBaseline && !baseline) || !NetCodec::readSnapshot(reader, snapshot, baseline))
+			{
+				++mRejected;
+				continue;
+			}
+
+			mHistory.add(snapshot);
+			mLatest = snapshot;
+			mHasLatest = true;
+			++mReceived;
+		}
+	}
+}
+
+
+const string NetCommand::kFlag = "--net";
+
+int NetCommand::run(const vector<string>& args, const string& defaultTrack)
+{
+	if (args.empty() || (args[0] != "server" && args[0] != "client" && args[0] != "test" && args[0] != "predict"))
+	{
+		printUsage();
+		return 1;
+	}
+
+	const string mode = args[0];
+	SNetSettings settings;
+	string track = defaultTrack;
+	string address = "localhost";
+	int clients = 8;
+	float seconds = 60.0f;
+	SPredictionTestSettings prediction;
+
+	// Options are "--name value", a client takes the server's address first
+	unsigned int first = 1;
+	if (mode == "client" && args.size() > 1)
+	{
+		address = args[1];
+		first = 2;
+	}
+
+	for (unsigned int i = first; i < args.size(); i++)
+	{
+		const string& option = args[i];
+		if (i + 1 >= args.size())
+		{
+			cout << "Missing value for " << option << endl;
+			printUsage();
+			return 1;
+		}
+		const string& value = args[++i];
+
+		try
+		{
+			if (option == "--track")
+			{
+				track = value;
+			}
+			else if (option == "--port")
+			{
+				settings.kPort = static_cast<uint16_t>(stoi(value));
+			}
+			else if (option == "--players")
+			{
+				settings.kPlayers = min(max(1, stoi(value)), SNetSnapshot::kMaxCars);
+			}
+			else if (option == "--clients")
+			{
+				clients = min(max(1, stoi(value)), SNetSnapshot::kMaxCars);
+			}
+			else if (option == "--cars")
+			{
+				settings.kCars = min(max(1, stoi(value)), SNetSnapshot::kMaxCars);
+			}
+			else if (option == "--laps")
+			{
+				settings.kLaps = max(1, stoi(value));
+			}
+			else if (option == "--seed")
+			{
+				settings.kSeed = stoull(value);
+			}
+			else if (option == "--rate")
+			{
+				settings.kSnapshotRate = max(1, stoi(value));
+			}
+			else if (option == "--loss")
+			{
+				settings.kLoss = min(max(0.0f, stof(value)), 1.0f);
+			}
+			else if (option == "--seconds")
+			{
+				seconds = max(1.0f, stof(value));
+			}
+			else if (option == "--latency")
+			{
+				prediction.kLatency = max(0.0f, stof(value)) / 1000.0f;
+			}
+			else if (option == "--jitter")
+			{
+				prediction.kJitter = max(0.0f, stof(value)) / 1000.0f;
+			}
+			else if (option == "--bumps")
+			{
+				prediction.kBumpRate = max(0.0f, stof(value));
+			}
+			else
+			{
+				cout << "Unknown option " << option << " " << value << endl;
+				printUsage();
+				return 1;
+			}
+		}
+		catch (const exception&)
+		{
+			cout << "Bad value for " << option << ": " << value << endl;
+			return 1;
+		}
+	}
+
+	if (mode == "client")
+	{
+		SNetAddress server;
+		if (!SNetAddress::parse(address, settings.kPort, server))
+		{
+			cout << "Bad server address " << address << endl;
+			return 1;
+		}
+		return runClient(server, settings);
+	}
+
+	RaceTrackData data;
+	if (!data.load(track))
+	{
+		return 1;
+	}
+	if (mode == "predict")
+	{
+		prediction.kLoss = settings.kLoss;
+		prediction.kSeconds = seconds;
+		prediction.kSeed = settings.kSeed;
+		return PredictionTest::run(data, prediction);
+	}
+	return mode == "server" ? runServer(data, settings) : runTest(data, settings, clients, seconds);
+}
+
+void NetCommand::printUsage()
+{
+	cout << "Usage: DesertRacer " << kFlag << " server [--port N] [--players N] [--cars N] [--laps N] [--seed N] [--rate Hz] [--loss p] [--track file]" << endl;
+	cout << "       DesertRacer " << kFlag << " client host[:port] [--loss p]" << endl;
+	cout << "       DesertRacer " << kFlag << " test [--clients N] [--cars N] [--seconds S] [--rate Hz] [--loss p] [--seed N] [--track file]" << endl;
+	cout << "       DesertRacer " << kFlag << " predict [--latency ms] [--jitter ms] [--loss p] [--bumps per s] [--seconds S] [--seed N] [--track file]" << endl;
+}
+
+int NetCommand::runServer(const RaceTrackData& track, const SNetSettings& settings)
+{
+	RaceServer server(&track, settings);
+	if (!server.open())
+	{
+		return 1;
+	}
+	cout << "Waiting for " << settings.kPlayers << " players on port " << server.getPort() << endl;
+
+	// Fixed rate, in real time
+	const chrono::duration<double> step(1.0 / settings.kTickRate);
+	auto next = chrono::steady_clock::now();
+	while (server.tick())
+	{
+		next += chrono::duration_cast<chrono::steady_clock::duration>(step);
+		this_thread::sleep_until(next);
+	}
+
+	vector<SCarResult> results;
+	server.getResults(results);
+	for (unsigned int i = 0; i < results.size(); i++)
+	{
+		cout << "Car " << i << ": position " << results[i].position << (results[i].finished ? ", finished in " : ", out after ")
+			<< results[i].time << "s" << endl;
+	}
+	return 0;
+}
+
+int NetCommand::runClient(const SNetAddress& server, const SNetSettings& settings)
+{
+	RaceClient client;
+	if (!client.connect(server, settings.kLoss, RandomService::generateSeed()))
+	{
+		return 1;
+	}
+	cout << "Joining " << server.toString() << endl;
+
+	RNG random(RandomService::generateSeed());
+	uint8_t input = HoverCar::ForwardInput;
+	const chrono::duration<double> step(1.0 / settings.kTickRate);
+	auto next = chrono::steady_clock::now();
+	for (int tick = 0; ; tick++)
+	{
+		input = botInput(random, input);
+		client.update(input);
+
+		// Where the car is, once a second
+		const SNetSnapshot* latest = client.getLatest();
+		if (latest && tick % settings.kTickRate == 0)
+		{
+			const SNetCar& car = latest->car[client.getCar()];
+			const SVector2D position = NetCodec::getPosition(car);
+			cout << "Tick " << latest->tick << ": car " << client.getCar() << " at " << position.x << ", " << position.y
+				<< " lap " << static_cast<int>(car.lap) << " health " << static_cast<int>(car.health) << endl;
+			if (!car.racing)
+			{
+				break;
+			}
+		}
+
+		next += chrono::duration_cast<chrono::steady_clock::duration>(step);
+		this_thread::sleep_until(next);
+	}
+	return 0;
+}
+
+int NetCommand::runTest(const RaceTrackData& track, const SNetSettings& settings, int clientsNumber, float seconds)
+{
+	SNetSettings testSettings = settings;
+	testSettings.kPort = 0;
+	testSettings.kPlayers = clientsNumber;
+
+	RaceServer server(&track, testSettings);
+	if (!server.open())
+	{
+		return 1;
+	}
+
+	SNetAddress address;
+	SNetAddress::parse("127.0.0.1", server.getPort(), address);
+	vector<RaceClient> clients(clientsNumber);
+	vector<RNG> random;
+	vector<uint8_t> inputs(clientsNumber, HoverCar::ForwardInput);
+	for (int i = 0; i < clientsNumber; i++)
+	{
+		if (!clients[i].connect(address, testSettings.kLoss, testSettings.kSeed + i + 1))
+		{
+			return 1;
+		}
+		random.emplace_back(testSettings.kSeed, i);
+	}
+
+	cout << "Loopback: " << clientsNumber << " clients, " << max(testSettings.kCars, clientsNumber) << " cars, "
+		<< testSettings.kSnapshotRate << " Hz snapshots, " << testSettings.kLoss * 100.0f << "% loss each way" << endl;
+
+	// As fast as possible, loopback delivers by the time the other side reads
+	const int ticks = static_cast<int>(seconds * testSettings.kTickRate);
+	long long checked = 0, mismatches = 0;
+	vector<uint32_t> lastChecked(clientsNumber, 0);
+	int tick = 0;
+	bool racing = true;
+	const auto start = chrono::steady_clock::now();
+	while (racing && tick < ticks)
+	{
+		for (int i = 0; i < clientsNumber; i++)
+		{
+			inputs[i] = botInput(random[i], inputs[i]);
+			clients[i].update(inputs[i]);
+
+			// Every snapshot a client decodes must be exactly what the server sent
+			const SNetSnapshot* latest = clients[i].getLatest();
+			if (latest && latest->tick != lastChecked[i])
+			{
+				lastChecked[i] = latest->tick;
+				const SNetSnapshot* sent = server.getHistory().find(latest->tick);
+				bool same = sent && sent->cars == latest->cars;
+				for (int car = 0; same && car < latest->cars; car++)
+				{
+					same = NetCodec::equals(sent->car[car], latest->car[car]);
+				}
+				++checked;
+				mismatches += same ? 0 : 1;
+			}
+		}
+
+		racing = server.tick();
+		if (server.isStarted())
+		{
+			++tick;
+		}
+	}
+	const double wall = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+	const float raced = static_cast<float>(tick) / testSettings.kTickRate;
+
+	vector<RaceServer::SClientStats> stats;
+	server.getClientStats(stats);
+	cout << fixed << setprecision(2);
+	cout << "  client  car    KB/s  bytes/snap  snapshots  full %  received  rejected" << endl;
+	double worst = 0.0;
+	for (const RaceServer::SClientStats& client : stats)
+	{
+		const double rate = client.bytes / max(raced, 1e-3f);
+		worst = max(worst, rate);
+		const RaceClient& end = clients[client.car];
+		cout << setw(8) << client.car << setw(5) << client.car << setw(8) << rate / 1024.0 << setw(12)
+			<< static_cast<double>(client.bytes) / max(client.snapshots, 1) << setw(11) << client.snapshots
+			<< setw(8) << 100.0 * client.fullSnapshots / max(client.snapshots, 1) << setw(10) << end.getSnapshotsReceived()
+			<< setw(10) << end.getSnapshotsRejected() << endl;
+	}
+	cout << raced << "s raced in " << wall << "s; " << checked << " snapshots checked, " << mismatches << " mismatches" << endl;
+	cout << "Worst client " << worst / 1024.0 << " KB/s of a " << kBandwidthBudget / 1024 << " KB/s budget" << endl;
+	cout.unsetf(ios::fixed);
+
+	const bool pass = !mismatches && checked && worst <= kBandwidthBudget;
+	cout << (pass ? "Pass" : "Fail") << endl;
+	return pass ? 0 : 1;
+}
+
+uint8_t NetCommand::botInput(RNG& random, uint8_t previous)
+{
+	// Keeps its input for a while, like a player holding keys
+	if (random.getFloat() > 0.05f)
+	{
+		return previous;
+	}
+
+	uint8_t input = random.getFloat() < 0.9f ? HoverCar::ForwardInput : HoverCar::BackwardInput;
+	const float turn = random.getFloat();
+	input |= turn < 0.3f ? HoverCar::ClockwiseInput : turn < 0.6f ? HoverCar::AntiClockwiseInput : 0;
+	input |= random.getFloat() < 0.1f ? HoverCar::BoostInput : 0;
+	return input;
+}
@@ -0,0 +1,244 @@
+/**
+ * @file netrace.h
+ * Authoritative server races with remote players over UDP, clients get delta compressed snapshots
+ *
+ * @author Jacob Sanchez Perez (G20812080) <jsanchez-perez@uclan.ac.uk>
+ * Games Concepts (CO1301), University of Central Lancashire
+ */
+
+#ifndef DESERT_RACER_NET_RACE_H
+#define DESERT_RACER_NET_RACE_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "vector.h"
+#include "bitstream.h"
+#include "netsocket.h"
+#include "statehash.h"
+#include "simulator.h"
+
+
+namespace desert
+{
+	// A car as sent to clients: quantized, so unchanged values compare equal and deltas stay small
+	struct SNetCar
+	{
+		// 1 / kPositionScale units
+		int32_t x = 0, z = 0;
+		int32_t movementX = 0, movementZ = 0;
+		// 1 / kHeadingSteps of a turn
+		uint16_t heading = 0;
+		uint8_t health = 0, stage = 0, lap = 0;
+		uint8_t racing = 0;
+	};
+
+	// Every car of the race at the end of a server tick
+	struct SNetSnapshot
+	{
+		static const int kMaxCars = 8;
+
+		uint32_t tick = 0;
+		int cars = 0;
+		SNetCar car[kMaxCars];
+	};
+
+	// Quantization and the bit packing of snapshots
+	class NetCodec
+	{
+	public:
+		static const int kPositionScale = 64;
+		static const int kHeadingSteps = 4096;
+
+		static SNetCar quantize(const SHashedCar& car);
+		static SVector2D getPosition(const SNetCar& car);
+		static SVector2D getMovement(const SNetCar& car);
+		// Degrees, 0 faces +Z
+		static float getHeading(const SNetCar& car);
+		static bool equals(const SNetCar& a, const SNetCar& b);
+
+		/**
+		* Only what changed since the baseline: a bit per unchanged car, a bit per unchanged field
+		* Positions, movement and heading are sent as deltas, stage / lap / health / racing packed in 19 bits
+		* @param baseline Snapshot the client acknowledged, null to send everything (against an empty snapshot)
+		*/
+		static void writeSnapshot(BitWriter& writer, const SNetSnapshot& snapshot, const SNetSnapshot* baseline);
+		// Returns false if the data is cut short or does not fit
+		static bool readSnapshot(BitReader& reader, SNetSnapshot& snapshot, const SNetSnapshot* baseline);
+	protected:
+		static const int kHealthBits = 8;
+		static const int kStageBits = 6;
+		static const int kLapBits = 4;
+		static const int kCarsBits = 4;
+	};
+
+	// The last snapshots sent or received, baselines of the deltas
+	class NetSnapshotHistory
+	{
+	public:
+		static const int kSize = 64;
+
+		void add(const SNetSnapshot& snapshot);
+		// Null if that tick is not held (never was or is too old)
+		const SNetSnapshot* find(uint32_t tick) const;
+		void clear();
+	protected:
+		SNetSnapshot mSnapshots[kSize];
+		int mCount = 0;
+		int mNext = 0;
+	};
+
+	struct SNetSettings
+	{
+		uint16_t kPort = 41234;
+		// Server ticks and snapshots sent to every client, per second
+		int kTickRate = 60;
+		int kSnapshotRate = 30;
+		// Cars in the race, players first and AI after them
+		int kCars = 8;
+		// Players the race waits for before it starts
+		int kPlayers = 1;
+		int kLaps = 3;
+		uint64_t kSeed = 1;
+		// Share of the packets sent that are dropped on purpose, both ways (testing)
+		float kLoss = 0.0f;
+	};
+
+	/**
+	* The authority: the race runs here with the headless rules of RaceSimulator,
+	* players' cars are driven by the input their clients send
+	*/
+	class RaceServer
+	{
+	public:
+		struct SClientStats
+		{
+			SNetAddress address;
+			int car;
+			// Every byte sent to the client, with packet headers
+			long long bytes;
+			int snapshots;
+			// Snapshots sent without a baseline (the client had not acknowledged one the server still had)
+			int fullSnapshots;
+		};
+
+		RaceServer(const RaceTrackData* track, const SNetSettings& settings);
+
+		bool open();
+		uint16_t getPort() const;
+		/**
+		* Take the packets waiting, step the race once every player has joined, send snapshots when due
+		* @return False once the race is over
+		*/
+		bool tick();
+		bool isStarted() const;
+		// Snapshots sent, by tick (testing)
+		const NetSnapshotHistory& getHistory() const;
+		void getClientStats(std::vector<SClientStats>& stats) const;
+		// Rank the cars where they are
+		void getResults(std::vector<SCarResult>& results);
+	protected:
+		struct SClient
+		{
+			SNetAddress address;
+			int car = 0;
+			uint8_t input = 0;
+			// Newest input received
+			uint32_t inputSequence = 0;
+			bool acknowledged = false;
+			uint32_t acknowledgedTick = 0;
+			long long bytes = 0;
+			int snapshots = 0;
+			int fullSnapshots = 0;
+		};
+
+		void receive();
+		void sendWelcome(SClient& client);
+		void sendSnapshot(SClient& client, const SNetSnapshot& snapshot);
+		SClient* findClient(const SNetAddress& address);
+
+		const SNetSettings mSettings;
+		SSimulationSettings mRaceSettings;
+		SSimulationConfig mConfig;
+		RaceSimulator mSimulator;
+		RaceSimulator::SSession mSession;
+		std::vector<SRaceAction> mActions;
+		bool mStarted = false;
+		bool mOver = false;
+
+		UdpSocket mSocket;
+		std::vector<SClient> mClients;
+		NetSnapshotHistory mHistory;
+		std::vector<uint8_t> mPacket;
+	};
+
+	// A player's end of a server race: sends input, keeps the newest snapshot
+	class RaceClient
+	{
+	public:
+		/**
+		* @param loss Share of the packets sent that are dropped on purpose (testing)
+		*/
+		bool connect(const SNetAddress& server, float loss = 0.0f, uint64_t lossSeed = 0);
+		/**
+		* Take the packets waiting, then send this tick's input and the newest snapshot received
+		* Input is a state, not an event: a lost packet is made up for by the next one
+		* Until the server answers it asks to join instead
+		* @param input HoverCar::InputBit flags
+		*/
+		void update(uint8_t input);
+
+		bool isJoined() const;
+		// Car this client drives
+		int getCar() const;
+		// Newest snapshot received, null before the first one
+		const SNetSnapshot* getLatest() const;
+		int getSnapshotsReceived() const;
+		// Snapshots dropped because their baseline was not held or they were corrupt
+		int getSnapshotsRejected() const;
+	protected:
+		void receive();
+
+		SNetAddress mServer;
+		UdpSocket mSocket;
+		bool mJoined = false;
+		int mCar = 0;
+		uint32_t mSequence = 0;
+
+		NetSnapshotHistory mHistory;
+		bool mHasLatest = false;
+		SNetSnapshot mLatest;
+		int mReceived = 0;
+		int mRejected = 0;
+		std::vector<uint8_t> mPacket;
+	};
+
+	/**
+	* Command line front end: DesertRacer --net server|client|test|predict [options]
+	* test races bot clients against a server over loopback, checks every snapshot and the bandwidth
+	* predict drives a predicted car against an in-process authority over delayed channels (see PredictionTest)
+	*/
+	class NetCommand
+	{
+	public:
+		static const std::string kFlag;
+		// Most a client may receive (bytes per second)
+		static const int kBandwidthBudget = 16 * 1024;
+
+		/**
+		* @param args Arguments after the flag
+		* @param defaultTrack Track raced if none is given
+		* @return Process exit code
+		*/
+		static int run(const std::vector<std::string>& args, const std::string& defaultTrack);
+		// Input of a bot, a random wander that mostly drives forwards
+		static uint8_t botInput(RNG& random, uint8_t previous);
+	protected:
+		static void printUsage();
+		static int runServer(const RaceTrackData& track, const SNetSettings& settings);
+		static int runClient(const SNetAddress& server, const SNetSettings& settings);
+		static int runTest(const RaceTrackData& track, const SNetSettings& settings, int clients, float seconds);
+	};
+}
+
+#endif
@@ -0,0 +1,240 @@
+/**
+ * @file netsocket.cpp
+ * Non blocking UDP socket, with packet loss that can be simulated for testing
+ *
+ * @author Jacob Sanchez Perez (G20812080) <jsanchez-perez@uclan.ac.uk>
+ * Games Concepts (CO1301), University of Central Lancashire
+ */
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#pragma comment(lib, "Ws2_32.lib")
+#else
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+#include <iostream>
+#include <sstream>
+#include <cstdlib>
+#include <mutex>
+#include "netsocket.h"
+
+using namespace std;
+using namespace desert;
+
+#ifdef _WIN32
+typedef int socklen_t;
+
+// Winsock is started with the first socket and left running
+static bool startNetwork()
+{
+	static once_flag started;
+	static bool ready = false;
+	call_once(started, []()
+	{
+		WSADATA data;
+		ready = WSAStartup(MAKEWORD(2, 2), &data) == 0;
+	});
+	return ready;
+}
+
+static void closeSocket(intptr_t handle)
+{
+	closesocket(static_cast<SOCKET>(handle));
+}
+#else
+typedef int SOCKET;
+
+static bool startNetwork()
+{
+	return true;
+}
+
+static void closeSocket(intptr_t handle)
+{
+	::close(static_cast<SOCKET>(handle));
+}
+#endif
+
+
+string SNetAddress::toString() const
+{
+	ostringstream text;
+	text << (ip >> 24) << "." << ((ip >> 16) & 255) << "." << ((ip >> 8) & 255) << "." << (ip & 255) << ":" << port;
+	return text.str();
+}
+
+bool SNetAddress::parse(const string& text, uint16_t defaultPort, SNetAddress& address)
+{
+	const size_t colon = text.find(':');
+	string host = text.substr(0, colon);
+	address.port = defaultPort;
+	if (colon != string::npos)
+	{
+		const int port = atoi(text.c_str() + colon + 1);
+		if (port <= 0 || port > 65535)
+		{
+			return false;
+		}
+		address.port = static_cast<uint16_t>(port);
+	}
+
+	if (host == "localhost")
+	{
+		host = "127.0.0.1";
+	}
+
+	// Four numbers separated by dots and nothing else
+	istringstream stream(host);
+	address.ip = 0;
+	for (int i = 0; i < 4; i++)
+	{
+		unsigned int part = 256;
+		char dot = '.';
+		if ((i && !(stream >> dot)) || dot != '.' || !(stream >> part) || part > 255)
+		{
+			return false;
+		}
+		address.ip = (address.ip << 8) | part;
+	}
+	return stream.peek() == istringstream::traits_type::eof();
+}
+
+
+UdpSocket::~UdpSocket()
+{
+	close();
+}
+
+bool UdpSocket::open(uint16_t port)
+{
+	close();
+	if (!startNetwork())
+	{
+		cout << "Network could not be started" << endl;
+		return false;
+	}
+
+	const intptr_t handle = static_cast<intptr_t>(socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP));
+	if (handle == -1)
+	{
+		cout << "Socket could not be created" << endl;
+		return false;
+	}
+
+	sockaddr_in local = {};
+	local.sin_family = AF_INET;
+	local.sin_addr.s_addr = htonl(INADDR_ANY);
+	local.sin_port = htons(port);
+
+	// Never block, every tick takes what has arrived and moves on
+#ifdef _WIN32
+	u_long nonBlocking = 1;
+	const bool configured = ioctlsocket(static_cast<SOCKET>(handle), FIONBIO, &nonBlocking) == 0;
+#else
+	const bool configured = fcntl(static_cast<SOCKET>(handle), F_SETFL, O_NONBLOCK) == 0;
+#endif
+
+	if (!configured || ::bind(static_cast<SOCKET>(handle), reinterpret_cast<const sockaddr*>(&local), sizeof(local)) != 0)
+	{
+		cout << "Socket could not be bound to port " << port << endl;
+		closeSocket(handle);
+		return false;
+	}
+
+	socklen_t length = sizeof(local);
+	getsockname(static_cast<SOCKET>(handle), reinterpret_cast<sockaddr*>(&local), &length);
+	mSocket = handle;
+	mPort = ntohs(local.sin_port);
+	return true;
+}
+
+void UdpSocket::close()
+{
+	if (mSocket != -1)
+	{
+		closeSocket(mSocket);
+		mSocket = -1;
+		mPort = 0;
+	}
+}
+
+bool UdpSocket::isOpen() const
+{
+	return mSocket != -1;
+}
+
+uint16_t UdpSocket::getPort() const
+{
+	return mPort;
+}
+
+bool UdpSocket::send(const SNetAddress& to, const void* data, size_t size)
+{
+	if (mSocket == -1)
+	{
+		return false;
+	}
+
+	mBytesSent += size + kHeaderBytes;
+	++mPacketsSent;
+	if (mLoss > 0.0f && mLossRandom.getFloat() < mLoss)
+	{
+		++mPacketsDropped;
+		return true;
+	}
+
+	sockaddr_in remote = {};
+	remote.sin_family = AF_INET;
+	remote.sin_addr.s_addr = htonl(to.ip);
+	remote.sin_port = htons(to.port);
+	const int sent = sendto(static_cast<SOCKET>(mSocket), static_cast<const char*>(data), static_cast<int>(size), 0,
+		reinterpret_cast<const sockaddr*>(&remote), sizeof(remote));
+	return sent == static_cast<int>(size);
+}
+
+int UdpSocket::receive(SNetAddress& from, void* data, size_t capacity)
+{
+	if (mSocket == -1)
+	{
+		return -1;
+	}
+
+	sockaddr_in remote = {};
+	socklen_t length = sizeof(remote);
+	const int received = recvfrom(static_cast<SOCKET>(mSocket), static_cast<char*>(data), static_cast<int>(capacity), 0,
+		reinterpret_cast<sockaddr*>(&remote), &length);
+	if (received < 0)
+	{
+		return -1;
+	}
+
+	from.ip = ntohl(remote.sin_addr.s_addr);
+	from.port = ntohs(remote.sin_port);
+	return received;
+}
+
+void UdpSocket::setLoss(float loss, uint64_t seed)
+{
+	mLoss = loss;
+	mLossRandom = RNG(seed);
+}
+
+long long UdpSocket::getBytesSent() const
+{
+	return mBytesSent;
+}
+
+long long UdpSocket::getPacketsSent() const
+{
+	return mPacketsSent;
+}
+
+long long UdpSocket::getPacketsDropped() const
+{
+	return mPacketsDropped;
+}
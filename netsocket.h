@@ -0,0 +1,91 @@
+/**
+ * @file netsocket.h
+ * Non blocking UDP socket, with packet loss that can be simulated for testing
+ *
+ * @author Jacob Sanchez Perez (G20812080) <jsanchez-perez@uclan.ac.uk>
+ * Games Concepts (CO1301), University of Central Lancashire
+ */
+
+#ifndef DESERT_RACER_NET_SOCKET_H
+#define DESERT_RACER_NET_SOCKET_H
+
+#include <string>
+#include <cstdint>
+#include <cstddef>
+#include "rng.h"
+
+
+namespace desert
+{
+	// IPv4 address and port, both in host order
+	struct SNetAddress
+	{
+		uint32_t ip = 0;
+		uint16_t port = 0;
+
+		bool operator==(const SNetAddress& other) const
+		{
+			return ip == other.ip && port == other.port;
+		}
+
+		std::string toString() const;
+		/**
+		* "a.b.c.d[:port]" or "localhost[:port]"
+		* @return False if it is not an address
+		*/
+		static bool parse(const std::string& text, uint16_t defaultPort, SNetAddress& address);
+	};
+
+	class UdpSocket
+	{
+	public:
+		// Bytes of an IPv4 and UDP header, counted in the bandwidth of every packet
+		static const int kHeaderBytes = 28;
+
+		UdpSocket() = default;
+		~UdpSocket();
+		UdpSocket(const UdpSocket&) = delete;
+		UdpSocket& operator=(const UdpSocket&) = delete;
+
+		/**
+		* Bind to a port on every interface
+		* @param port 0 for any free port
+		*/
+		bool open(uint16_t port = 0);
+		void close();
+		bool isOpen() const;
+		uint16_t getPort() const;
+
+		// Returns false if the packet could not be sent (packets the simulated loss drops count as sent)
+		bool send(const SNetAddress& to, const void* data, size_t size);
+		/**
+		* Next packet waiting, never blocks
+		* @return Its size, -1 if there is none
+		*/
+		int receive(SNetAddress& from, void* data, size_t capacity);
+
+		/**
+		* Drop a share of the packets sent, as a bad connection would
+		* @param loss 0 sends everything, 1 nothing
+		*/
+		void setLoss(float loss, uint64_t seed);
+
+		// Every packet sent, including dropped ones, with their headers
+		long long getBytesSent() const;
+		long long getPacketsSent() const;
+		long long getPacketsDropped() const;
+	protected:
+		// A SOCKET on Windows, a file descriptor elsewhere
+		intptr_t mSocket = -1;
+		uint16_t mPort = 0;
+
+		float mLoss = 0.0f;
+		RNG mLossRandom;
+
+		long long mBytesSent = 0;
+		long long mPacketsSent = 0;
+		long long mPacketsDropped = 0;
+	};
+}
+
+#endif
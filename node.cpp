@@ -21,18 +21,39 @@ SceneNodeContainer::SceneNodeContainer(ISceneNode* sceneNode) :
 {
 }
 
+void SceneNodeContainer::attachToMirror(TransformMirror* mirror)
+{
+	mMirror = mirror;
+	mMirrorSlot = mirror->track(node);
+}
+
 SVector3D SceneNodeContainer::position() const
 {
+	if (mMirror)
+	{
+		return mMirror->position(mMirrorSlot);
+	}
+
 	return { node->GetX(), node->GetY(), node->GetZ() };
 }
 
 SVector2D SceneNodeContainer::position2D() const
 {
+	if (mMirror)
+	{
+		return mMirror->position2D(mMirrorSlot);
+	}
+
 	return { node->GetX(), node->GetZ() };
 }
 
 SVector3D SceneNodeContainer::getFacingVector() const
 {
+	if (mMirror)
+	{
+		return mMirror->facing(mMirrorSlot);
+	}
+
 	float matrix[4][4];
 	node->GetMatrix(&matrix[0][0]);
 	return  { matrix[2][0], matrix[2][1], matrix[2][2] };
@@ -40,6 +61,11 @@ SVector3D SceneNodeContainer::getFacingVector() const
 
 SVector2D SceneNodeContainer::getFacingVector2D() const
 {
+	if (mMirror)
+	{
+		return mMirror->facing2D(mMirrorSlot);
+	}
+
 	float matrix[4][4];
 	node->GetMatrix(&matrix[0][0]);
 	return  { matrix[2][0], matrix[2][2] };
@@ -52,6 +78,16 @@ float SceneNodeContainer::distanceTo(SVector2D point) const
 
 void SceneNodeContainer::resetPosition(bool x, bool y, bool z)
 {
+	if (mMirror)
+	{
+		SVector3D p = position();
+		if (x) { p.x = kInitialPosition.x; }
+		if (y) { p.y = kInitialPosition.y; }
+		if (z) { p.z = kInitialPosition.z; }
+		mMirror->setPosition(mMirrorSlot, p);
+		return;
+	}
+
 	if (x) { node->SetX(kInitialPosition.x); }
 	if (y) { node->SetY(kInitialPosition.y); }
 	if (z) { node->SetZ(kInitialPosition.z); }
@@ -59,6 +95,13 @@ void SceneNodeContainer::resetPosition(bool x, bool y, bool z)
 
 void SceneNodeContainer::resetLocalPosition(bool x, bool y, bool z)
 {
+	// Mirrored nodes have no parent, so local and world positions are the same
+	if (mMirror)
+	{
+		resetPosition(x, y, z);
+		return;
+	}
+
 	if (x) { node->SetLocalX(kInitialLocalPosition.x); }
 	if (y) { node->SetLocalY(kInitialLocalPosition.y); }
 	if (z) { node->SetLocalZ(kInitialLocalPosition.z); }
@@ -66,53 +109,131 @@ void SceneNodeContainer::resetLocalPosition(bool x, bool y, bool z)
 
 void SceneNodeContainer::setPositionByVector(SVector3D vector)
 {
+	if (mMirror) { mMirror->setPosition(mMirrorSlot, vector); return; }
 	node->SetPosition(vector.x, vector.y, vector.z);
 }
 
 void SceneNodeContainer::moveByVector(SVector3D vector)
 {
+	if (mMirror) { mMirror->move(mMirrorSlot, vector); return; }
 	node->Move(vector.x, vector.y, vector.z);
 }
 
 void SceneNodeContainer::moveByVector(SVector2D vector)
 {
-	node->Move(vector.x, 0, vector.y);
+	moveByVector(SVector3D{ vector.x, 0, vector.y });
 }
 
 void SceneNodeContainer::moveLocallyByVector(SVector3D vector)
 {
+	if (mMirror) { mMirror->moveLocal(mMirrorSlot, vector); return; }
 	node->MoveLocal(vector.x, vector.y, vector.z);
 }
 
 void SceneNodeContainer::moveLocallyByVector(SVector2D vector)
 {
-	node->MoveLocal(vector.x, 0, vector.y);
+	moveLocallyByVector(SVector3D{ vector.x, 0, vector.y });
 }
 
 void SceneNodeContainer::rotateByVector(SVector3D vector)
 {
-	node->RotateX(vector.x);
-	node->RotateY(vector.y);
-	node->RotateZ(vector.z);
+	rotate(TransformMirror::XAxis, vector.x, false);
+	rotate(TransformMirror::YAxis, vector.y, false);
+	rotate(TransformMirror::ZAxis, vector.z, false);
 }
 
 void SceneNodeContainer::rotateByVector(SVector2D vector)
 {
-	node->RotateX(vector.x);
-	node->RotateZ(vector.y);
+	rotate(TransformMirror::XAxis, vector.x, false);
+	rotate(TransformMirror::ZAxis, vector.y, false);
 }
 
 void SceneNodeContainer::rotateLocallyByVector(SVector3D vector)
 {
-	node->RotateLocalX(vector.x);
-	node->RotateLocalY(vector.y);
-	node->RotateLocalZ(vector.z);
+	rotate(TransformMirror::XAxis, vector.x, true);
+	rotate(TransformMirror::YAxis, vector.y, true);
+	rotate(TransformMirror::ZAxis, vector.z, true);
 }
 
 void SceneNodeContainer::rotateLocallyByVector(SVector2D vector)
 {
-	node->RotateX(vector.x);
-	node->RotateZ(vector.y);
+	rotate(TransformMirror::XAxis, vector.x, false);
+	rotate(TransformMirror::ZAxis, vector.y, false);
+}
+
+float SceneNodeContainer::getY() const
+{
+	return position().y;
+}
+
+void SceneNodeContainer::setY(float y)
+{
+	if (mMirror) { mMirror->setY(mMirrorSlot, y); return; }
+	node->SetY(y);
+}
+
+void SceneNodeContainer::moveY(float y)
+{
+	moveByVector(SVector3D{ 0, y, 0 });
+}
+
+void SceneNodeContainer::rotateY(float angle)
+{
+	rotate(TransformMirror::YAxis, angle, false);
+}
+
+void SceneNodeContainer::rotateLocalX(float angle)
+{
+	rotate(TransformMirror::XAxis, angle, true);
+}
+
+void SceneNodeContainer::rotateLocalZ(float angle)
+{
+	rotate(TransformMirror::ZAxis, angle, true);
+}
+
+void SceneNodeContainer::resetOrientation()
+{
+	if (mMirror) { mMirror->resetOrientation(mMirrorSlot); return; }
+	node->ResetOrientation();
+}
+
+void SceneNodeContainer::setRotationY(float degrees)
+{
+	if (mMirror) { mMirror->setRotationY(mMirrorSlot, degrees); return; }
+	node->ResetOrientation();
+	node->RotateY(degrees);
+}
+
+void SceneNodeContainer::lookAt(SVector3D target)
+{
+	if (mMirror) { mMirror->lookAt(mMirrorSlot, target); return; }
+	node->LookAt(target.x, target.y, target.z);
+}
+
+void SceneNodeContainer::rotate(TransformMirror::Axis axis, float angle, bool local)
+{
+	if (mMirror)
+	{
+		mMirror->rotate(mMirrorSlot, axis, angle, local);
+		return;
+	}
+
+	switch (axis)
+	{
+	case TransformMirror::XAxis:
+		if (local) { node->RotateLocalX(angle); }
+		else { node->RotateX(angle); }
+		break;
+	case TransformMirror::YAxis:
+		if (local) { node->RotateLocalY(angle); }
+		else { node->RotateY(angle); }
+		break;
+	case TransformMirror::ZAxis:
+		if (local) { node->RotateLocalZ(angle); }
+		else { node->RotateZ(angle); }
+		break;
+	}
 }
 
 const int SceneNodeContainer::kAxisDegrees = 180;
@@ -154,14 +275,38 @@ Collision::CollisionAxis CollisionModel::getNewCollisionAxis()
 	return mNewCollisionAxis;
 }
 
+void CollisionModel::saveState(SnapshotWriter& writer) const
+{
+	writer.write(mVectorModified);
+	writer.write(mLastCollisionAxis);
+	writer.write(mNewCollisionAxis);
+}
+
+void CollisionModel::loadState(SnapshotReader& reader)
+{
+	reader.read(mVectorModified);
+	reader.read(mLastCollisionAxis);
+	reader.read(mNewCollisionAxis);
+}
+
 SphereCollisionModel::SphereCollisionModel(IModel* m) : CollisionModel(m) {}
 
 Collision::CollisionAxis SphereCollisionModel::collision(SVector2D position, const float collisionRadius, bool saveAxis)
 {
 	mVectorModified = false;
+	return test(position, collisionRadius);
+}
+
+Collision::CollisionAxis SphereCollisionModel::test(SVector2D position, const float collisionRadius) const
+{
 	return Collision::circleToCircle(position, position2D(), collisionRadius, mRadius);
 }
 
+void SphereCollisionModel::getShapes(vector<SCollisionShape>& shapes) const
+{
+	shapes.push_back({ SCollisionShape::Circle, mShapeOwner, position2D(), { mRadius, 0 } });
+}
+
 Collision::CollisionAxis SphereCollisionModel::collision(SphereCollisionModel other)
 {
 	mVectorModified = false;
@@ -178,16 +323,7 @@ BoxCollisionModel::BoxCollisionModel(IModel* m, NodeAlignment a) : CollisionMode
 Collision::CollisionAxis BoxCollisionModel::collision(SVector2D position, const float collisionRadius, bool saveAxis)
 {
 	mVectorModified = false;
-	Collision::CollisionAxis axis;
-
-	if (mAlignment == zAligned)
-	{
-		axis = Collision::circleToBox(position, collisionRadius, position2D(), mHalfLength, mHalfWidth);
-	}
-	else
-	{
-		axis = Collision::circleToBox(position, collisionRadius, position2D(), mHalfWidth, mHalfLength);
-	}
+	Collision::CollisionAxis axis = test(position, collisionRadius);
 
 	if (saveAxis)
 	{
@@ -197,6 +333,21 @@ Collision::CollisionAxis BoxCollisionModel::collision(SVector2D position, const
 	return axis;
 }
 
+Collision::CollisionAxis BoxCollisionModel::test(SVector2D position, const float collisionRadius) const
+{
+	if (mAlignment == zAligned)
+	{
+		return Collision::circleToBox(position, collisionRadius, position2D(), mHalfLength, mHalfWidth);
+	}
+	return Collision::circleToBox(position, collisionRadius, position2D(), mHalfWidth, mHalfLength);
+}
+
+void BoxCollisionModel::getShapes(vector<SCollisionShape>& shapes) const
+{
+	const SVector2D halfSize = (mAlignment == zAligned) ? SVector2D{ mHalfLength, mHalfWidth } : SVector2D{ mHalfWidth, mHalfLength };
+	shapes.push_back({ SCollisionShape::Box, mShapeOwner, position2D(), halfSize });
+}
+
 Collision::CollisionAxis BoxCollisionModel::collision(SphereCollisionModel other)
 {
 	mVectorModified = false;
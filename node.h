@@ -10,8 +10,11 @@
 #define DESERT_RACER_NODE_H
 
 #include <TL-Engine.h>
+#include <vector>
 #include "vector.h"
 #include "collision.h"
+#include "transform.h"
+#include "snapshot.h"
 
 
 namespace desert
@@ -36,6 +39,12 @@ namespace desert
 		*/
 		SceneNodeContainer(tle::ISceneNode* sceneNode);
 		/**
+		* Read and write the node's transform through a mirror instead of the engine
+		* Changes reach the engine when the mirror's owner submits it
+		* @param mirror Transform mirror, must outlive the container
+		*/
+		void attachToMirror(TransformMirror* mirror);
+		/**
 		* @return The node's position in the three axis
 		*/
 		SVector3D position() const;
@@ -71,7 +80,22 @@ namespace desert
 		void rotateLocallyByVector(SVector3D vector);
 		void rotateLocallyByVector(SVector2D vector);
 
+		// Single axis operations
+		float getY() const;
+		void setY(float y);
+		void moveY(float y);
+		void rotateY(float angle);
+		void rotateLocalX(float angle);
+		void rotateLocalZ(float angle);
+		void resetOrientation();
+		// Clear all rotations, then rotate around Y
+		void setRotationY(float degrees);
+		void lookAt(SVector3D target);
+
 	protected:
+		// Rotate through the mirror if attached, through the engine otherwise
+		void rotate(TransformMirror::Axis axis, float angle, bool local);
+
 		//
 		static const int kAxisDegrees;
 		// Store initial position and local position as vectors
@@ -79,6 +103,10 @@ namespace desert
 
 		// The pointer to the TL-Engine ISceneNode
 		tle::ISceneNode* node;
+
+		// Optional transform mirror and this node's slot in it
+		TransformMirror* mMirror = nullptr;
+		int mMirrorSlot = -1;
 	};
 
 	/**
@@ -95,14 +123,30 @@ namespace desert
 		* @param collisionRadius Optional parameter for cases in which sphere collision is implemented
 		*/
 		virtual Collision::CollisionAxis collision(SVector2D position, const float collisionRadius = 0.0f, bool saveAxis = false) = 0;
+		/**
+		* Same test as collision() without changing any state, safe to run from several threads
+		* @param position Vector containing position of other node
+		* @param collisionRadius Optional parameter for cases in which sphere collision is implemented
+		*/
+		virtual Collision::CollisionAxis test(SVector2D position, const float collisionRadius = 0.0f) const = 0;
+		/**
+		* Outline of the model on the ground, for queries that do not go through the node (ray casts)
+		* @param shapes The model's shapes are appended here
+		*/
+		virtual void getShapes(std::vector<SCollisionShape>& shapes) const = 0;
 		// Getter for mFixed
 		virtual bool isFixed();
 		virtual void modifyMovementVector(SVector2D change);
 		// Returns true if modifyMovementVector was called before
 		virtual bool vectorWasModified();
 		Collision::CollisionAxis getNewCollisionAxis();
+		// Mutable state for race snapshots (subclasses append theirs), the transform is in the mirror
+		virtual void saveState(SnapshotWriter& writer) const;
+		virtual void loadState(SnapshotReader& reader);
 	protected:
 		void setNewCollisionAxis(Collision::CollisionAxis axis);
+		// Reported by ray casts as what was hit
+		SCollisionShape::Owner mShapeOwner = SCollisionShape::Prop;
 		bool mFixed = true;
 		bool mVectorModified = false;
 		Collision::CollisionAxis mLastCollisionAxis = Collision::None, mNewCollisionAxis = Collision::None;
@@ -113,6 +157,8 @@ namespace desert
 	public:
 		SphereCollisionModel(tle::IModel* m);
 		virtual Collision::CollisionAxis collision(SVector2D position, const float collisionRadius = 0.0f, bool saveAxis = false);
+		virtual Collision::CollisionAxis test(SVector2D position, const float collisionRadius = 0.0f) const;
+		virtual void getShapes(std::vector<SCollisionShape>& shapes) const;
 		virtual Collision::CollisionAxis collision(SphereCollisionModel other);
 		virtual int getCollisionRadius();
 	protected:
@@ -124,6 +170,8 @@ namespace desert
 	public:
 		BoxCollisionModel(tle::IModel* m, NodeAlignment a);
 		virtual Collision::CollisionAxis collision(SVector2D position, const float collisionRadius = 0.0f, bool saveAxis = false);
+		virtual Collision::CollisionAxis test(SVector2D position, const float collisionRadius = 0.0f) const;
+		virtual void getShapes(std::vector<SCollisionShape>& shapes) const;
 		virtual Collision::CollisionAxis collision(SphereCollisionModel other);
 	protected:
 		float mHalfWidth, mHalfLength;
@@ -6,10 +6,8 @@
  * Games Concepts (CO1301), University of Central Lancashire
  */
 #include <TL-Engine.h>
-#include <random>
 #include <iostream>
-#include <cstdlib>
-#include <ctime>
+#include <algorithm>
 #include "vector.h"
 #include "particle.h"
 
@@ -17,32 +15,39 @@ using namespace std;
 using namespace tle;
 using namespace desert;
 
-ParticleSystem::ParticleSystem(IMesh* mesh) : mMesh(mesh) {};
+constexpr float ParticleSystem::kParkedY;
+constexpr float ParticleSystem::kMinImportanceDistance;
+constexpr int ParticleBudget::kMinimumShare;
 
-float ParticleSystem::randMToN(double M, double N)
-{
-	// https://stackoverflow.com/a/17798317
-	return M + (rand() / (RAND_MAX / (N - M)));
-}
+ParticleSystem::ParticleSystem(IMesh* mesh) : mMesh(mesh) {};
 
-void ParticleSystem::setup()
+void ParticleSystem::setup(RNG random, TransformMirror* mirror)
 {
-	// Feed current timestamp as random seed
-	srand(time(nullptr));
+	mRandom = random;
+	mMirror = mirror;
 	createParticles(mInitialParticles);
 }
 
 void ParticleSystem::createParticles(int amount)
 {
+	// Three random components per particle, generated in one go
+	vector<float> randoms(amount * 3);
+	mRandom.fillFloats(randoms.data(), amount * 3, -1.0f, 1.0f);
+
 	for (int i = 0; i < amount; i++)
 	{
 		SVector3D velocity = mInitialVelocity;
-		SVector3D randomVector = { randMToN(-mRangeX, mRangeX), randMToN(-mRangeY, mRangeY), randMToN(-mRangeZ, mRangeZ) };
+		const float* r = &randoms[i * 3];
+		SVector3D randomVector = { r[0] * mRangeX, r[1] * mRangeY, r[2] * mRangeZ };
 
 		IModel* model = mMesh->CreateModel(mInitialPosition.x, mInitialPosition.y, mInitialPosition.z);
 		model->Scale(mModelScale);
 
 		mParticles.push_back({ SceneNodeContainer(model), velocity + randomVector, randomVector, 0.0f });
+		if (mMirror)
+		{
+			mParticles.back().container.attachToMirror(mMirror);
+		}
 	}
 }
 
@@ -60,6 +65,10 @@ void ParticleSystem::updateSystem(const float kDeltaTime, const SVector3D newPos
 {
 	for (Particle& p : mParticles)
 	{
+		if (p.parked)
+		{
+			continue;
+		}
 
 		if (!mActive && p.reset)
 		{
@@ -104,12 +113,116 @@ void ParticleSystem::updateSystem(const float kDeltaTime, const SVector3D newPos
 		}*/
 	}
 
-	if (mParticles.size() < mNumParticles)
+}
+
+void ParticleSystem::spawnParticles()
+{
+	const int target = min(mNumParticles, mAllowance);
+
+	if (static_cast<int>(mParticles.size()) < target)
+	{
+		createParticles(min(mParticleSteps, target - static_cast<int>(mParticles.size())));
+	}
+}
+
+int ParticleSystem::getDemand() const
+{
+	return mNumParticles;
+}
+
+int ParticleSystem::getLiveParticles() const
+{
+	return min(static_cast<int>(mParticles.size()), mAllowance);
+}
+
+void ParticleSystem::setAllowance(const int allowance)
+{
+	if (allowance != mAllowance)
 	{
-		createParticles(mParticleSteps);
+		mAllowance = allowance;
+		applyAllowance();
 	}
 }
 
+void ParticleSystem::applyAllowance()
+{
+	int i = 0;
+	for (Particle& p : mParticles)
+	{
+		const bool overAllowance = i >= mAllowance;
+
+		if (overAllowance && !p.parked)
+		{
+			// Hide it below the ground
+			SVector3D parkedPosition = mInitialPosition;
+			parkedPosition.y = kParkedY;
+			p.container.setPositionByVector(parkedPosition);
+			p.parked = true;
+		}
+		else if (!overAllowance && p.parked)
+		{
+			// Start a fresh life at the emitter
+			p.container.resetPosition();
+			p.velocity = mInitialVelocity + p.randomisation;
+			p.lifespan = 0.0f;
+			p.reset = false;
+			p.parked = false;
+		}
+		i++;
+	}
+}
+
+void ParticleSystem::saveState(SnapshotWriter& writer) const
+{
+	const uint32_t count = static_cast<uint32_t>(mParticles.size());
+	writer.write(mRandom);
+	writer.write(mActive);
+	writer.write(mAllowance);
+	writer.write(count);
+	for (const Particle& particle : mParticles)
+	{
+		writer.write(particle.velocity);
+		writer.write(particle.randomisation);
+		writer.write(particle.lifespan);
+		writer.write(particle.reset);
+		writer.write(particle.parked);
+	}
+}
+
+void ParticleSystem::loadState(SnapshotReader& reader)
+{
+	uint32_t count = 0;
+	reader.read(mRandom);
+	reader.read(mActive);
+	reader.read(mAllowance);
+	reader.read(count);
+
+	// Particles are only ever added
+	if (count > mParticles.size())
+	{
+		reader.fail();
+		return;
+	}
+
+	for (unsigned int i = 0; i < count; i++)
+	{
+		Particle& particle = mParticles[i];
+		reader.read(particle.velocity);
+		reader.read(particle.randomisation);
+		reader.read(particle.lifespan);
+		reader.read(particle.reset);
+		reader.read(particle.parked);
+	}
+}
+
+float ParticleSystem::getImportance(SVector3D viewer) const
+{
+	// Particles spread roughly this far from the emitter during their life
+	const float emitterSize = max(max(mRangeX, mRangeY), mRangeZ) * mLifespan;
+	const float distance = max((mInitialPosition - viewer).length(), kMinImportanceDistance);
+	return emitterSize / distance;
+}
+
 FireParticleSystem::FireParticleSystem(IMesh* fireMesh, SVector3D position) : ParticleSystem(fireMesh), kInitialPosition(position)
 {
 	mNumParticles = kNumParticles;
@@ -123,3 +236,126 @@ FireParticleSystem::FireParticleSystem(IMesh* fireMesh, SVector3D position) : Pa
 	mInitialPosition = kInitialPosition;
 	mInitialVelocity = kInitialVelocity;
 }
+
+ParticleBudget::ParticleBudget(const int particleBudget, const int updateBudget) : kParticleBudget(particleBudget), kUpdateBudget(updateBudget) {}
+
+void ParticleBudget::registerSystem(ParticleSystem* system)
+{
+	mEmitters.push_back({ system, 0.0f, 0, 0.0f, 0 });
+}
+
+void ParticleBudget::clear()
+{
+	mEmitters.clear();
+	mScheduled.clear();
+	mReport = SBudgetReport();
+	mTotals = SBudgetTotals();
+}
+
+void ParticleBudget::update(SVector3D viewer, const float kDeltaTime)
+{
+	plan(viewer, kDeltaTime);
+	simulate(0, getScheduledNumber());
+	spawn();
+}
+
+void ParticleBudget::plan(SVector3D viewer, const float kDeltaTime)
+{
+	mReport = SBudgetReport();
+	mScheduled.clear();
+
+	// Rank emitters, the ones skipped recently get a boost
+	for (SEmitter& e : mEmitters)
+	{
+		e.priority = e.system->getImportance(viewer) * (1 + e.framesSkipped);
+		e.granted = 0;
+		mReport.requestedParticles += e.system->getDemand();
+	}
+
+	stable_sort(mEmitters.begin(), mEmitters.end(), [](const SEmitter& a, const SEmitter& b) { return a.priority > b.priority; });
+
+	// Everyone gets a small share first, so far away fires do not vanish completely
+	int remaining = kParticleBudget;
+	for (SEmitter& e : mEmitters)
+	{
+		e.granted = min(min(e.system->getDemand(), kMinimumShare), remaining);
+		remaining -= e.granted;
+	}
+
+	// Then the rest goes to the most important emitters
+	for (SEmitter& e : mEmitters)
+	{
+		const int extra = min(e.system->getDemand() - e.granted, remaining);
+		e.granted += extra;
+		remaining -= extra;
+
+		e.system->setAllowance(e.granted);
+		mReport.grantedParticles += e.granted;
+	}
+
+	mReport.droppedParticles = mReport.requestedParticles - mReport.grantedParticles;
+
+	// Schedule as many systems as the update budget allows
+	int updatesLeft = kUpdateBudget;
+	for (SEmitter& e : mEmitters)
+	{
+		const int updates = e.system->getLiveParticles();
+		e.pendingTime += kDeltaTime;
+		mReport.requestedUpdates += updates;
+
+		// The most important system is always updated
+		if (updates <= updatesLeft || updatesLeft == kUpdateBudget)
+		{
+			mScheduled.push_back({ e.system, e.pendingTime });
+			e.pendingTime = 0.0f;
+			e.framesSkipped = 0;
+			updatesLeft -= updates;
+			mReport.grantedUpdates += updates;
+		}
+		else
+		{
+			// Catch up later with the accumulated time
+			++e.framesSkipped;
+			++mReport.skippedSystems;
+		}
+	}
+
+	++mTotals.frames;
+	mTotals.skippedSystems += mReport.skippedSystems;
+	if (mReport.droppedParticles)
+	{
+		++mTotals.droppingFrames;
+		mTotals.mostDropped = max(mTotals.mostDropped, mReport.droppedParticles);
+	}
+}
+
+int ParticleBudget::getScheduledNumber() const
+{
+	return static_cast<int>(mScheduled.size());
+}
+
+void ParticleBudget::simulate(int first, int last)
+{
+	for (int i = first; i < last; i++)
+	{
+		mScheduled[i].system->updateSystem(mScheduled[i].time);
+	}
+}
+
+void ParticleBudget::spawn()
+{
+	for (SScheduled& s : mScheduled)
+	{
+		s.system->spawnParticles();
+	}
+}
+
+const ParticleBudget::SBudgetReport& ParticleBudget::getReport() const
+{
+	return mReport;
+}
+
+const ParticleBudget::SBudgetTotals& ParticleBudget::getTotals() const
+{
+	return mTotals;
+}
@@ -12,8 +12,11 @@
 #include <TL-engine.h>
 #include <string>
 #include <vector>
+#include <climits>
 #include "vector.h"
 #include "node.h"
+#include "rng.h"
+#include "snapshot.h"
 
 
 namespace desert
@@ -28,16 +31,52 @@ namespace desert
 			SVector3D randomisation;
 			float lifespan;
 			bool reset = false;
+			// Particle is hidden because the system is over its allowance
+			bool parked = false;
 		};
-		static float randMToN(double M, double N);
 		ParticleSystem(tle::IMesh* mesh);
 		void createParticles(int amount);
-		void setup();
+		/**
+		* Create the initial particles
+		* @param random Random stream owned by this system
+		* @param mirror Transform mirror the particles are moved through
+		*/
+		void setup(RNG random, TransformMirror* mirror);
 		void stop();
 		void resume();
+		// Move the particles (no engine calls, systems can be updated in parallel)
 		void updateSystem(const float kDeltaTime, const SVector3D newPosition = { 0, 0, 0 });
+		// Create the particles still missing, a few steps at a time (engine calls, main thread only)
+		void spawnParticles();
+
+		// Number of particles the system would like to have alive
+		int getDemand() const;
+		// Number of particles currently alive (not parked)
+		int getLiveParticles() const;
+		// Maximum number of live particles, set by the particle budget
+		void setAllowance(const int allowance);
+		/**
+		* Rough projected size of the emitter as seen from a point
+		* @param viewer Position of the viewer (camera / player)
+		*/
+		float getImportance(SVector3D viewer) const;
+		/**
+		* Motion of every particle and the random stream, transforms are in the mirror
+		* Particles created after the snapshot are left as they are when it is restored
+		*/
+		void saveState(SnapshotWriter& writer) const;
+		void loadState(SnapshotReader& reader);
 	protected:
+		// Hide particles over the allowance, bring back the ones under it
+		void applyAllowance();
+
+		// Y position where parked particles are hidden
+		static constexpr float kParkedY = -100.0f;
+		// Avoid dividing by zero when the viewer is inside the emitter
+		static constexpr float kMinImportanceDistance = 1.0f;
+
 		int mNumParticles;
+		int mAllowance = INT_MAX;
 		int mInitialParticles;
 		int mParticleSteps;
 		float mLifespan = 1.0f;
@@ -51,6 +90,8 @@ namespace desert
 		float mRangeX = 1, mRangeY = 1, mRangeZ = 1;
 		const float minY = 9;
 		tle::IMesh* mMesh;
+		RNG mRandom;
+		TransformMirror* mMirror = nullptr;
 		bool mActive = true;
 	};
 
@@ -69,6 +110,89 @@ namespace desert
 		const int kInitialParticles = 10;
 		const int kParticleSteps = 10;
 	};
+
+	/**
+	* Shares a global particle and per-frame update budget between all registered emitters
+	* Emitters closer to (and appearing bigger to) the viewer are served first
+	*/
+	class ParticleBudget
+	{
+	public:
+		// What was requested / granted in the last frame
+		struct SBudgetReport
+		{
+			int requestedParticles = 0;
+			int grantedParticles = 0;
+			int droppedParticles = 0;
+			int requestedUpdates = 0;
+			int grantedUpdates = 0;
+			int skippedSystems = 0;
+		};
+
+		// Every frame planned since the systems were registered
+		struct SBudgetTotals
+		{
+			long long frames = 0;
+			// Frames that dropped particles, and the most dropped in one
+			long long droppingFrames = 0;
+			int mostDropped = 0;
+			long long skippedSystems = 0;
+		};
+
+		/**
+		* @param particleBudget Maximum number of live particles across all emitters
+		* @param updateBudget Maximum number of particle updates per frame
+		*/
+		ParticleBudget(const int particleBudget = kDefaultParticleBudget, const int updateBudget = kDefaultUpdateBudget);
+		void registerSystem(ParticleSystem* system);
+		// Forget all registered systems (does not delete them)
+		void clear();
+		/**
+		* Distribute the budget and update the systems that fit in it
+		* Same as plan(), simulate() for every scheduled system and spawn()
+		* @param viewer Position used to rank emitters
+		* @param kDeltaTime Time elapsed since last frame
+		*/
+		void update(SVector3D viewer, const float kDeltaTime);
+		// Distribute the budget and choose the systems updated this frame
+		void plan(SVector3D viewer, const float kDeltaTime);
+		// Systems chosen by the last plan
+		int getScheduledNumber() const;
+		// Update scheduled systems [first, last), each one is independent
+		void simulate(int first, int last);
+		// Top up the scheduled systems to their allowance
+		void spawn();
+		const SBudgetReport& getReport() const;
+		const SBudgetTotals& getTotals() const;
+	protected:
+		struct SEmitter
+		{
+			ParticleSystem* system;
+			// Time not yet simulated because the update budget ran out
+			float pendingTime;
+			// Consecutive frames skipped, raises priority so nobody starves
+			int framesSkipped;
+			float priority;
+			int granted;
+		};
+
+		struct SScheduled
+		{
+			ParticleSystem* system;
+			float time;
+		};
+
+		static constexpr int kDefaultParticleBudget = 400;
+		static constexpr int kDefaultUpdateBudget = 400;
+		// Every emitter gets at least this many particles before the rest is shared by importance
+		static constexpr int kMinimumShare = 10;
+
+		const int kParticleBudget, kUpdateBudget;
+		std::vector<SEmitter> mEmitters;
+		std::vector<SScheduled> mScheduled;
+		SBudgetReport mReport;
+		SBudgetTotals mTotals;
+	};
 };
 
 #endif
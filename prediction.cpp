@@ -0,0 +1,322 @@
+/**
+ * @file prediction.cpp
+ * The player's car predicted on the client and reconciled with a remote authority
+ *
+ * @author Jacob Sanchez Perez (G20812080) <jsanchez-perez@uclan.ac.uk>
+ * Games Concepts (CO1301), University of Central Lancashire
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <cmath>
+#include "simulator.h"
+#include "netrace.h"
+#include "prediction.h"
+
+using namespace std;
+using namespace desert;
+
+const float PredictedCar::kSmoothingTime = 0.1f;
+const float PredictedCar::kSnapDistance = 10.0f;
+
+
+void SPlayerCarRules::step(SHeadlessCar& car, uint8_t input) const
+{
+	// Same order as a race tick: control, checkpoints, collision, movement
+	const float boostDrag = HeadlessCar::control(car, RaceSimulator::decodeInput(input), *tuning, track->getStartScale(), 1.0f, kDeltaTime);
+	HeadlessCar::passCheckpoints(car, *track, laps);
+	HeadlessCar::collide(car, track->collide(car.previousPosition, car.position, tuning->kCollisionRadius), *tuning);
+	HeadlessCar::move(car, boostDrag, *tuning, kDeltaTime);
+}
+
+
+PredictedCar::PredictedCar(const SPlayerCarRules& rules) : mRules(rules), mHistory(kHistory)
+{
+}
+
+void PredictedCar::reset(const SHeadlessCar& start)
+{
+	mCar = start;
+	mTick = mConfirmed = 0;
+	mHistory.assign(kHistory, SPredictedTick());
+	mHistory[0].car = start;
+	mVisualOffset.zeroOut();
+	mCorrections = 0;
+	mReplayed = 0;
+	mLargestCorrection = 0.0f;
+}
+
+SInputMessage PredictedCar::predict(uint8_t input)
+{
+	++mTick;
+	mRules.step(mCar, input);
+	SPredictedTick& predicted = mHistory[mTick % kHistory];
+	predicted.tick = mTick;
+	predicted.input = input;
+	predicted.car = mCar;
+
+	// What is left of the corrections fades, the same share every tick
+	mVisualOffset *= exp(-mRules.kDeltaTime / kSmoothingTime);
+
+	SInputMessage message;
+	message.tick = mTick;
+	message.count = static_cast<int>(min<uint32_t>(mTick, SInputMessage::kRedundancy));
+	for (int i = 0; i < message.count; i++)
+	{
+		message.inputs[i] = mHistory[(mTick - i) % kHistory].input;
+	}
+	return message;
+}
+
+void PredictedCar::reconcile(const SCarStateMessage& state)
+{
+	// Older than what was already confirmed (reordered), or ahead of the prediction (cannot happen)
+	if (state.tick <= mConfirmed || state.tick > mTick)
+	{
+		return;
+	}
+	mConfirmed = state.tick;
+
+	SPredictedTick& confirmed = mHistory[state.tick % kHistory];
+	if (confirmed.tick == state.tick && sameState(confirmed.car, state.car))
+	{
+		return;
+	}
+
+	// Rewind to the authority's state and run the inputs it has not seen again
+	const SVector2D before = mCar.position;
+	mCar = state.car;
+	confirmed.tick = state.tick;
+	confirmed.car = state.car;
+	if (mTick - state.tick < static_cast<uint32_t>(kHistory))
+	{
+		for (uint32_t tick = state.tick + 1; tick <= mTick; tick++)
+		{
+			SPredictedTick& predicted = mHistory[tick % kHistory];
+			mRules.step(mCar, predicted.input);
+			predicted.car = mCar;
+			++mReplayed;
+		}
+	}
+
+	// The drawn car keeps its place and catches up, unless the jump is too big to hide
+	const SVector2D correction = before - mCar.position;
+	mLargestCorrection = max(mLargestCorrection, correction.length());
+	mVisualOffset += correction;
+	if (mVisualOffset.length() > kSnapDistance)
+	{
+		mVisualOffset.zeroOut();
+	}
+	++mCorrections;
+}
+
+const SHeadlessCar& PredictedCar::getCar() const
+{
+	return mCar;
+}
+
+SVector2D PredictedCar::getRenderPosition() const
+{
+	return mCar.position + mVisualOffset;
+}
+
+uint32_t PredictedCar::getTick() const
+{
+	return mTick;
+}
+
+int PredictedCar::getCorrectionsNumber() const
+{
+	return mCorrections;
+}
+
+long long PredictedCar::getReplayedTicks() const
+{
+	return mReplayed;
+}
+
+float PredictedCar::getLargestCorrection() const
+{
+	return mLargestCorrection;
+}
+
+bool PredictedCar::sameState(const SHeadlessCar& a, const SHeadlessCar& b)
+{
+	return a.position.x == b.position.x && a.position.y == b.position.y && a.movement.x == b.movement.x && a.movement.y == b.movement.y &&
+		a.heading == b.heading && a.state.rotationSpeed == b.state.rotationSpeed && a.state.boostTimer == b.state.boostTimer &&
+		a.state.boostPenaltyTimer == b.state.boostPenaltyTimer && a.state.damageTimer == b.state.damageTimer &&
+		a.state.health == b.state.health &&
+		a.stage == b.stage && a.lap == b.lap && a.collidedLastStep == b.collidedLastStep;
+}
+
+
+CarAuthority::CarAuthority(const SPlayerCarRules& rules) : mRules(rules)
+{
+}
+
+void CarAuthority::reset(const SHeadlessCar& start)
+{
+	mCar = start;
+	mTick = mNewest = 0;
+	mLastInput = 0;
+	fill(begin(mInputTicks), end(mInputTicks), 0);
+	mPushed = false;
+	mPositions.clear();
+	mMissing = 0;
+}
+
+void CarAuthority::receive(const SInputMessage& message)
+{
+	for (int i = 0; i < message.count; i++)
+	{
+		const uint32_t tick = message.tick - i;
+		// Already applied, or too far ahead to hold
+		if (tick <= mTick || tick - mTick > static_cast<uint32_t>(kInputBuffer))
+		{
+			continue;
+		}
+		mInputTicks[tick % kInputBuffer] = tick;
+		mInputs[tick % kInputBuffer] = message.inputs[i];
+	}
+	mNewest = max(mNewest, message.tick);
+}
+
+bool CarAuthority::update()
+{
+	bool ran = false;
+	while (mTick < mNewest)
+	{
+		const uint32_t tick = mTick + 1;
+		const bool received = mInputTicks[tick % kInputBuffer] == tick;
+		// A later input is waiting, so this one is lost for good: keep doing what the player was doing
+		if (!received)
+		{
+			++mMissing;
+		}
+		mLastInput = received ? mInputs[tick % kInputBuffer] : mLastInput;
+
+		if (mPushed)
+		{
+			mCar.movement += mPush;
+			mPushed = false;
+		}
+		mRules.step(mCar, mLastInput);
+		mTick = tick;
+		mPositions.push_back(mCar.position);
+		ran = true;
+	}
+	return ran;
+}
+
+void CarAuthority::push(SVector2D movement)
+{
+	mPush = movement;
+	mPushed = true;
+}
+
+SCarStateMessage CarAuthority::getState() const
+{
+	return { mTick, mCar };
+}
+
+const vector<SVector2D>& CarAuthority::getPositions() const
+{
+	return mPositions;
+}
+
+int CarAuthority::getMissingInputs() const
+{
+	return mMissing;
+}
+
+
+int PredictionTest::run(const RaceTrackData& track, const SPredictionTestSettings& settings)
+{
+	const SPlayerCarRules rules = { &track, &HoverCar::kDefaultTuning, 3, 1.0f / settings.kTickRate };
+	SHeadlessCar start;
+	HeadlessCar::reset(start, track.getGridSlot(0), HoverCar::kDefaultTuning);
+
+	PredictedCar client(rules);
+	CarAuthority authority(rules);
+	client.reset(start);
+	authority.reset(start);
+	DelayedChannel<SInputMessage> up(settings.kLatency, settings.kJitter, settings.kLoss, settings.kSeed);
+	DelayedChannel<SCarStateMessage> down(settings.kLatency, settings.kJitter, settings.kLoss, settings.kSeed + 1);
+	RNG random(settings.kSeed, 2);
+	uint8_t input = HoverCar::ForwardInput;
+
+	// Where the client draws the car each tick: predicted and smoothed, predicted only, and the last state received
+	const int ticks = static_cast<int>(settings.kSeconds * settings.kTickRate);
+	vector<SVector2D> drawn, predicted, unpredicted;
+	SCarStateMessage latest = { 0, start };
+	int bumps = 0;
+
+	for (int tick = 1; tick <= ticks; tick++)
+	{
+		const float now = static_cast<float>(tick) / settings.kTickRate;
+
+		SCarStateMessage state;
+		while (down.receive(now, state))
+		{
+			client.reconcile(state);
+			latest = state.tick > latest.tick ? state : latest;
+		}
+		input = NetCommand::botInput(random, input);
+		up.send(now, client.predict(input));
+		drawn.push_back(client.getRenderPosition());
+		predicted.push_back(client.getCar().position);
+		unpredicted.push_back(latest.car.position);
+
+		SInputMessage message;
+		while (up.receive(now, message))
+		{
+			authority.receive(message);
+		}
+		if (random.getFloat() < settings.kBumpRate / settings.kTickRate)
+		{
+			const float angle = random.getFloat(0.0f, 360.0f);
+			authority.push(HeadlessCar::headingVector(angle) * settings.kBumpSpeed);
+			++bumps;
+		}
+		if (authority.update())
+		{
+			down.send(now, authority.getState());
+		}
+	}
+
+	// Against the authority's car of the same tick
+	const vector<SVector2D>& truth = authority.getPositions();
+	const size_t compared = min(truth.size(), drawn.size());
+	// Largest move between two frames, where corrections show as jumps
+	double errors[3] = {}, largest[3] = {}, steps[3] = {};
+	const vector<SVector2D>* views[3] = { &drawn, &predicted, &unpredicted };
+	for (size_t i = 0; i < compared; i++)
+	{
+		for (int view = 0; view < 3; view++)
+		{
+			const double error = ((*views[view])[i] - truth[i]).length();
+			errors[view] += error;
+			largest[view] = max(largest[view], error);
+			if (i)
+			{
+				steps[view] = max(steps[view], static_cast<double>(((*views[view])[i] - (*views[view])[i - 1]).length()));
+			}
+		}
+	}
+
+	cout << fixed << setprecision(2);
+	cout << "Prediction: " << settings.kLatency * 2000.0f << "ms round trip (+" << settings.kJitter * 1000.0f << "ms jitter), "
+		<< settings.kLoss * 100.0f << "% loss, " << bumps << " bumps in " << settings.kSeconds << "s" << endl;
+	cout << "Corrections " << client.getCorrectionsNumber() << ", " << static_cast<double>(client.getReplayedTicks()) / max(client.getCorrectionsNumber(), 1)
+		<< " ticks replayed each, largest " << client.getLargestCorrection() << "; inputs lost for good " << authority.getMissingInputs() << endl;
+	const char* names[3] = { "predicted + smoothed", "predicted", "last state received" };
+	for (int view = 0; view < 3; view++)
+	{
+		cout << "  " << setw(22) << names[view] << ": error " << errors[view] / max<size_t>(compared, 1) << " average, " << largest[view]
+			<< " largest; largest frame step " << steps[view] << endl;
+	}
+	cout.unsetf(ios::fixed);
+
+	// Without anything the client cannot know about, the prediction must be exact
+	return (!settings.kBumpRate && !settings.kLoss && client.getCorrectionsNumber()) ? 1 : 0;
+}
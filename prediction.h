@@ -0,0 +1,249 @@
+/**
+ * @file prediction.h
+ * The player's car predicted on the client and reconciled with a remote authority
+ *
+ * @author Jacob Sanchez Perez (G20812080) <jsanchez-perez@uclan.ac.uk>
+ * Games Concepts (CO1301), University of Central Lancashire
+ */
+
+#ifndef DESERT_RACER_PREDICTION_H
+#define DESERT_RACER_PREDICTION_H
+
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include "vector.h"
+#include "rng.h"
+#include "racecar.h"
+#include "raceenv.h"
+
+
+namespace desert
+{
+	// What the client sends every tick: its newest inputs, repeated so that a lost message is covered by the next ones
+	struct SInputMessage
+	{
+		static const int kRedundancy = 8;
+
+		// Tick of the newest input
+		uint32_t tick;
+		int count;
+		// HoverCar::InputBit flags, newest first
+		uint8_t inputs[kRedundancy];
+	};
+
+	// The authority's car after the last input it applied
+	struct SCarStateMessage
+	{
+		uint32_t tick;
+		SHeadlessCar car;
+	};
+
+	/**
+	* In-process stand-in for a network link: messages arrive after a delay (and its jitter, which can reorder them)
+	* or not at all
+	*/
+	template <typename T>
+	class DelayedChannel
+	{
+	public:
+		/**
+		* @param latency One way (seconds)
+		* @param jitter Most added on top of the latency (seconds)
+		* @param loss Share of the messages dropped
+		*/
+		DelayedChannel(float latency, float jitter, float loss, uint64_t seed) :
+			mLatency(latency), mJitter(jitter), mLoss(loss), mRandom(seed)
+		{
+		}
+
+		void send(float now, const T& message)
+		{
+			++mSent;
+			if (mLoss > 0.0f && mRandom.getFloat() < mLoss)
+			{
+				++mLost;
+				return;
+			}
+			mInFlight.push_back({ now + mLatency + mRandom.getFloat(0.0f, mJitter), mSent, message });
+		}
+
+		// Earliest message delivered by now, returns false if there is none
+		bool receive(float now, T& message)
+		{
+			auto next = mInFlight.end();
+			for (auto it = mInFlight.begin(); it != mInFlight.end(); ++it)
+			{
+				if (it->delivery <= now && (next == mInFlight.end() || it->delivery < next->delivery ||
+					(it->delivery == next->delivery && it->order < next->order)))
+				{
+					next = it;
+				}
+			}
+
+			if (next == mInFlight.end())
+			{
+				return false;
+			}
+			message = next->message;
+			mInFlight.erase(next);
+			return true;
+		}
+
+		long long getSentNumber() const
+		{
+			return mSent;
+		}
+
+		long long getLostNumber() const
+		{
+			return mLost;
+		}
+	protected:
+		struct SInFlight
+		{
+			float delivery;
+			long long order;
+			T message;
+		};
+
+		float mLatency, mJitter, mLoss;
+		RNG mRandom;
+		std::vector<SInFlight> mInFlight;
+		long long mSent = 0;
+		long long mLost = 0;
+	};
+
+	// Rules of a player's car both ends run, one tick (HoverCar::control then the movement, headless)
+	struct SPlayerCarRules
+	{
+		const RaceTrackData* track;
+		const SHoverCarTuning* tuning;
+		int laps;
+		float kDeltaTime;
+
+		void step(SHeadlessCar& car, uint8_t input) const;
+	};
+
+	/**
+	* The client's car: moved on its own input straight away, corrected when the authority's state for an old tick arrives
+	* A correction replays every input the authority had not applied yet, the jump it makes is hidden over a few frames
+	*/
+	class PredictedCar
+	{
+	public:
+		explicit PredictedCar(const SPlayerCarRules& rules);
+
+		void reset(const SHeadlessCar& start);
+		/**
+		* Run the next tick on an input
+		* @return Message for the authority
+		*/
+		SInputMessage predict(uint8_t input);
+		// Authoritative state arrived: rewind to its tick, replay the inputs after it and smooth the difference
+		void reconcile(const SCarStateMessage& state);
+
+		const SHeadlessCar& getCar() const;
+		// Where the car is drawn: the prediction plus what is left of the last corrections
+		SVector2D getRenderPosition() const;
+		uint32_t getTick() const;
+
+		int getCorrectionsNumber() const;
+		long long getReplayedTicks() const;
+		float getLargestCorrection() const;
+	protected:
+		// Ticks of input and prediction kept, the longest round trip that can be reconciled
+		static const int kHistory = 256;
+		// Seconds for the drawn car to close most of a correction (1 / e of it left)
+		static const float kSmoothingTime;
+		// Corrections larger than this are shown at once
+		static const float kSnapDistance;
+
+		struct SPredictedTick
+		{
+			uint32_t tick = 0;
+			uint8_t input = 0;
+			// State after the tick
+			SHeadlessCar car;
+		};
+
+		static bool sameState(const SHeadlessCar& a, const SHeadlessCar& b);
+
+		const SPlayerCarRules mRules;
+		SHeadlessCar mCar;
+		uint32_t mTick = 0;
+		// Newest tick the authority confirmed
+		uint32_t mConfirmed = 0;
+		std::vector<SPredictedTick> mHistory;
+		SVector2D mVisualOffset;
+
+		int mCorrections = 0;
+		long long mReplayed = 0;
+		float mLargestCorrection = 0.0f;
+	};
+
+	/**
+	* Minimal stand-in for the server: the same car, moved by the client's inputs in tick order
+	* An input that never arrives is replaced by the previous one once later ticks are waiting
+	*/
+	class CarAuthority
+	{
+	public:
+		explicit CarAuthority(const SPlayerCarRules& rules);
+
+		void reset(const SHeadlessCar& start);
+		void receive(const SInputMessage& message);
+		// Apply every input it can, returns true if any tick was run
+		bool update();
+		// Something the client cannot know about (another car hitting it), applied on the next tick
+		void push(SVector2D movement);
+		SCarStateMessage getState() const;
+
+		// Position after every tick run (testing)
+		const std::vector<SVector2D>& getPositions() const;
+		int getMissingInputs() const;
+	protected:
+		static const int kInputBuffer = 64;
+
+		const SPlayerCarRules mRules;
+		SHeadlessCar mCar;
+		uint32_t mTick = 0;
+		// Newest tick an input was received for
+		uint32_t mNewest = 0;
+		uint8_t mLastInput = 0;
+		uint32_t mInputTicks[kInputBuffer] = {};
+		uint8_t mInputs[kInputBuffer] = {};
+		SVector2D mPush;
+		bool mPushed = false;
+
+		std::vector<SVector2D> mPositions;
+		int mMissing = 0;
+	};
+
+	struct SPredictionTestSettings
+	{
+		// One way (seconds)
+		float kLatency = 0.1f;
+		float kJitter = 0.02f;
+		float kLoss = 0.0f;
+		// Pushes from other cars the client does not know about, per second
+		float kBumpRate = 0.5f;
+		float kBumpSpeed = 20.0f;
+		float kSeconds = 60.0f;
+		int kTickRate = 60;
+		uint64_t kSeed = 1;
+	};
+
+	/**
+	* A bot driving a predicted car against the authority over delayed channels
+	* Reports how far the drawn car was from the authority's, with prediction and without
+	*/
+	class PredictionTest
+	{
+	public:
+		// Returns a process exit code
+		static int run(const RaceTrackData& track, const SPredictionTestSettings& settings);
+	};
+}
+
+#endif
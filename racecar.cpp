@@ -18,11 +18,13 @@ using namespace tle;
 using namespace desert;
 
 const string HoverCar::kDefaultModelName = "Racecar";
+const SHoverCarTuning HoverCar::kDefaultTuning = {};
 
-HoverCar::HoverCar(IModel* m, const SControlKeybinding carKeybinding, IMesh* flareMesh) : DesertVehicle(m, DesertVehicle::VehicleType::Player), mKeybind(carKeybinding)
+HoverCar::HoverCar(IModel* m, const SControlKeybinding carKeybinding, IMesh* flareMesh, const SHoverCarTuning* tuning) : DesertVehicle(m, DesertVehicle::VehicleType::Player), mTuning(tuning), mKeybind(carKeybinding)
 {
 	mTag = "Player 1";
-	node->SetY(kModelYOffset);
+	reset(mState, *mTuning);
+	node->SetY(mTuning->kModelYOffset);
 	cout << "HoverCar created" << endl;
 }
 
@@ -42,105 +44,60 @@ void HoverCar::addCamera(DesertCamera cam)
 	cameras.push_back(cam);
 }
 
-float HoverCar::processBoost(tle::I3DEngine* myEngine, const float kDeltaTime)
+uint8_t HoverCar::readInput(I3DEngine* myEngine) const
 {
-	float boostMultiplier = 1;
-
-	// If time penalty is active
-	if (boostPenaltyTimer)
-	{
-		// Reduce remaining penalty time
-		boostPenaltyTimer -= kDeltaTime;
-
-		// Cutoff
-		if (boostPenaltyTimer < kDeltaTime)
-		{
-			boostPenaltyTimer = 0.0f;
-		}
-
-		// Apply double drag
-		boostDragMultiplier = kDrag;
-	}
-	else
-	{
-		// Detect boost key press
-		// Health needs to be above a certain limit for the boost to work
-		if (myEngine->KeyHeld(mKeybind.kBoost) && health > kBoostMinimumHealth)
-		{
-			//
-			boostTimer += kDeltaTime;
-
-			if (boostTimer >= kBoostMaxTimeActive)
-			{
-				boostPenaltyTimer = kBoostTimePenalty;
-				boostTimer = 0.0f;
-				boostState = Penalty;
-			}
-			else
-			{
-				boostState = Active;
-				boostMultiplier = kBoost;
-				if ((boostTimer + kBoostWarningTime) >= kBoostMaxTimeActive)
-				{
-					boostState = Warning;
-				}
-			}
-		}
-		// Boost is not being used and not time penalised
-		else
-		{
-			boostState = Inactive;
-			boostTimer -= kDeltaTime;
-
-			if (boostTimer < kDeltaTime)
-			{
-				boostTimer = 0;
-			}
-		}
-	}
+	uint8_t input = 0;
+	input |= myEngine->KeyHeld(mKeybind.kForwardThrust) ? ForwardInput : 0;
+	input |= myEngine->KeyHeld(mKeybind.kBackwardsThrust) ? BackwardInput : 0;
+	input |= myEngine->KeyHeld(mKeybind.kClockwiseTurn) ? ClockwiseInput : 0;
+	input |= myEngine->KeyHeld(mKeybind.kAntiClockwiseTurn) ? AntiClockwiseInput : 0;
+	input |= myEngine->KeyHeld(mKeybind.kBoost) ? BoostInput : 0;
+	return input;
+}
 
-	return boostMultiplier;
+float HoverCar::processBoost(uint8_t input, const float kDeltaTime)
+{
+	return processBoost(mState, *mTuning, (input & BoostInput) != 0, kDeltaTime);
 }
 
-void HoverCar::processThrust(tle::I3DEngine* myEngine, const float kGameSpeed, const float kDeltaTime, const float boostMultiplier)
+void HoverCar::processThrust(uint8_t input, const float kGameSpeed, const float kDeltaTime, const float boostMultiplier)
 {
 	// Move Forwards / Backwards
-	if (myEngine->KeyHeld(mKeybind.kForwardThrust))
+	if (input & ForwardInput)
 	{
-		movementThisFrame += getFacingVector2D() * (kThrustVector * kGameSpeed * boostMultiplier);
-		carState = Moving;
+		movementThisFrame += processThrust(*mTuning, getFacingVector2D(), 1.0f, kGameSpeed, boostMultiplier);
+		mState.carState = Moving;
 
-		float currentLiftSpeed = (kRearLiftSpeed * kGameSpeed * kDeltaTime);
+		float currentLiftSpeed = (mTuning->kRearLiftSpeed * kGameSpeed * kDeltaTime);
 
-		if (rearLift + currentLiftSpeed < kMaxRearLift)
+		if (mState.rearLift + currentLiftSpeed < mTuning->kMaxRearLift)
 		{
-			rearLift += currentLiftSpeed;
-			node->RotateLocalX(currentLiftSpeed);
+			mState.rearLift += currentLiftSpeed;
+			rotateLocalX(currentLiftSpeed);
 		}
 	}
-	else if (myEngine->KeyHeld(mKeybind.kBackwardsThrust))
+	else if (input & BackwardInput)
 	{
-		movementThisFrame += getFacingVector2D() * (kThrustVector * kGameSpeed * kBackwardThrustMultiplier * boostMultiplier);
-		//node->MoveLocalZ(-kThrust * kBackwardThrustMultiplier * frameGameSpeed);
-		carState = Moving;
+		movementThisFrame += processThrust(*mTuning, getFacingVector2D(), -1.0f, kGameSpeed, boostMultiplier);
+		mState.carState = Moving;
 	}
 }
 
-int HoverCar::processTurn(tle::I3DEngine* myEngine, const float frameSpeed)
+int HoverCar::processTurn(uint8_t input, const float kGameSpeed, const float kDeltaTime)
 {
 	int turnMultiplier = 1;
 
 	// Rotate
-	if (myEngine->KeyHeld(mKeybind.kClockwiseTurn))
+	if (input & ClockwiseInput)
 	{
-		node->RotateY(rotationSpeed * frameSpeed);
-		inclinationState = Turning;
+		rotateY(processTurn(mState, 1.0f, kGameSpeed, kDeltaTime));
+		mState.inclinationState = Turning;
 		turnMultiplier = -1;
 	}
-	else if (myEngine->KeyHeld(mKeybind.kAntiClockwiseTurn))
+	else if (input & AntiClockwiseInput)
 	{
-		node->RotateY(-rotationSpeed * frameSpeed);
-		inclinationState = Turning;
+		rotateY(processTurn(mState, -1.0f, kGameSpeed, kDeltaTime));
+		mState.inclinationState = Turning;
 		turnMultiplier = 1;
 	}
 
@@ -149,35 +106,35 @@ int HoverCar::processTurn(tle::I3DEngine* myEngine, const float frameSpeed)
 
 void HoverCar::processLean(const float frameSpeed, const int turnMultiplier)
 {
-	switch (inclinationState)
+	switch (mState.inclinationState)
 	{
 	case NotTurning:
 		// Slowly reset hover car lean to neutral
-		if (lean)
+		if (mState.lean)
 		{
-			int rotationModifier = (lean > 0) ? -1 : 1;
-			float resetYSpeed = rotationModifier * kResetLeanSpeed * frameSpeed;
+			int rotationModifier = (mState.lean > 0) ? -1 : 1;
+			float resetYSpeed = rotationModifier * mTuning->kResetLeanSpeed * frameSpeed;
 
-			node->RotateLocalZ(resetYSpeed);
-			lean += resetYSpeed;
+			rotateLocalZ(resetYSpeed);
+			mState.lean += resetYSpeed;
 
-			if ((lean * -rotationModifier) < resetYSpeed)
+			if ((mState.lean * -rotationModifier) < resetYSpeed)
 			{
-				node->RotateLocalZ(-lean);
-				lean = 0;
+				rotateLocalZ(-mState.lean);
+				mState.lean = 0;
 			}
 		}
 		break;
 	case Turning:
-		if (carState == Moving)
+		if (mState.carState == Moving)
 		{
 			// Car is turning tightly, start leaning
-			float leanSpeed = turnMultiplier * kLeaningSpeed * frameSpeed;
+			float leanSpeed = turnMultiplier * mTuning->kLeaningSpeed * frameSpeed;
 
-			if ((lean + leanSpeed) < kMaxInclination && (lean + leanSpeed) > -kMaxInclination)
+			if ((mState.lean + leanSpeed) < mTuning->kMaxInclination && (mState.lean + leanSpeed) > -mTuning->kMaxInclination)
 			{
-				lean += (leanSpeed);
-				node->RotateLocalZ(leanSpeed);
+				mState.lean += (leanSpeed);
+				rotateLocalZ(leanSpeed);
 			}
 		}
 		break;
@@ -190,56 +147,55 @@ void HoverCar::processBobble(const float kGameSpeed, const float kDeltaTime)
 	float resetRearLiftSpeed;
 
 	// Sin Wave / Rear Lift
-	switch (carState)
+	switch (mState.carState)
 	{
 	case Stationary:
-		if (node->GetY() != kModelYOffset)
+		if (getY() != mTuning->kModelYOffset)
 		{
-			int heightModifier = (node->GetY() > kModelYOffset) ? -1 : 1;
-			node->MoveY(heightModifier * frameSpeed * kResetYSpeed);
+			int heightModifier = (getY() > mTuning->kModelYOffset) ? -1 : 1;
+			moveY(heightModifier * frameSpeed * mTuning->kResetYSpeed);
 
-			if ((node->GetY() - kModelYOffset) < (frameSpeed * kResetYSpeed))
+			if ((getY() - mTuning->kModelYOffset) < (frameSpeed * mTuning->kResetYSpeed))
 			{
-				node->SetY(kModelYOffset);
+				setY(mTuning->kModelYOffset);
 			}
 
-			timeElapsedMoving = 0;
+			mState.timeElapsedMoving = 0;
 		}
 
-		resetRearLiftSpeed = kResetRearSpeed * frameSpeed;
-		rearLift -= resetRearLiftSpeed;
-		node->RotateLocalX(-resetRearLiftSpeed);
+		resetRearLiftSpeed = mTuning->kResetRearSpeed * frameSpeed;
+		mState.rearLift -= resetRearLiftSpeed;
+		rotateLocalX(-resetRearLiftSpeed);
 
-		if (rearLift <= resetRearLiftSpeed)
+		if (mState.rearLift <= resetRearLiftSpeed)
 		{
-			node->RotateLocalX(-rearLift);
-			rearLift = 0.0f;
+			rotateLocalX(-mState.rearLift);
+			mState.rearLift = 0.0f;
 		}
 		break;
 	case Moving:
-		timeElapsedMoving += kDeltaTime;
-		node->SetY(sin(timeElapsedMoving * kSinFunctionMultiplier) + kModelYOffset);
+		mState.timeElapsedMoving += kDeltaTime;
+		setY(sin(mState.timeElapsedMoving * mTuning->kSinFunctionMultiplier) + mTuning->kModelYOffset);
 		break;
 	}
 }
 
-void HoverCar::control(I3DEngine* myEngine, const float kGameSpeed, const float kDeltaTime)
+void HoverCar::control(I3DEngine* myEngine, uint8_t input, const float kGameSpeed, const float kDeltaTime)
 {
 	const float frameSpeed = kGameSpeed * kDeltaTime;
 	// Reset states
-	inclinationState = NotTurning;
-	carState = Stationary;
-	boostDragMultiplier = 1;
+	mState.inclinationState = NotTurning;
+	mState.carState = Stationary;
 
-	int turnMultiplier = processTurn(myEngine, frameSpeed);
-	float boostMultiplier = processBoost(myEngine, kDeltaTime);
+	int turnMultiplier = processTurn(input, kGameSpeed, kDeltaTime);
+	float boostMultiplier = processBoost(input, kDeltaTime);
 
-	processThrust(myEngine, kGameSpeed, kDeltaTime, boostMultiplier);
+	processThrust(input, kGameSpeed, kDeltaTime, boostMultiplier);
 	processBobble(kGameSpeed, kDeltaTime);
 	processLean(frameSpeed, turnMultiplier);
 	controlCameras(myEngine, kGameSpeed, kDeltaTime);
 
-	damageTimer += kDeltaTime;
+	mState.damageTimer += kDeltaTime;
 }
 
 void HoverCar::controlCameras(I3DEngine* myEngine, const float kGameSpeed, const float kDeltaTime)
@@ -263,26 +219,12 @@ void HoverCar::controlCameras(I3DEngine* myEngine, const float kGameSpeed, const
 
 void HoverCar::reduceHealth(const int reduction)
 {
-	if (damageTimer > kDamageBuffer)
-	{
-		health -= reduction;
-		damageTimer = 0;
-
-		if (health < kHealthSteerNerf)
-		{
-			rotationSpeed = kNerfedRotation;
-		}
-	}
+	reduceHealth(mState, *mTuning, reduction);
 }
 
 void HoverCar::applyMovementVector(const float kDeltaTime)
 {
-	moveByVector(movementThisFrame * kDeltaTime);
-	movementThisFrame *= (kDrag * boostDragMultiplier);
-	if (movementThisFrame.length() < kDragCutoff)
-	{
-		movementThisFrame.zeroOut();
-	}
+	moveByVector(applyMovementVector(movementThisFrame, mState.boostDragMultiplier, *mTuning, kDeltaTime));
 }
 
 SVector2D HoverCar::getMovementVector()
@@ -292,30 +234,16 @@ SVector2D HoverCar::getMovementVector()
 
 void HoverCar::bounce(Collision::CollisionAxis reverse)
 {
-	switch (reverse)
-	{
-	case desert::Collision::xAxis:
-		movementThisFrame.x = -movementThisFrame.x * kBounce;
-		break;
-	case desert::Collision::yAxis:
-		movementThisFrame.y = -movementThisFrame.y * kBounce;
-		break;
-	default:
-		movementThisFrame = -movementThisFrame * kBounce;
-		break;
-	}
+	bounce(movementThisFrame, reverse, *mTuning);
 }
 
 void HoverCar::reset()
 {
 	resetPosition(true, false, true);
-	node->ResetOrientation();
+	resetOrientation();
 	movementThisFrame.zeroOut();
-	health = kInitialHealth;
-
-	lean = 0;
-	rearLift = 0;
-	rotationSpeed = kInitialRotation;
+	// Lean and rear lift go with the orientation
+	reset(mState, *mTuning);
 	resetStage();
 }
 
@@ -326,24 +254,163 @@ ICamera* HoverCar::getCamera()
 
 HoverCar::BoostState HoverCar::getBoostState() const
 {
-	return boostState;
+	return mState.boostState;
 }
 const float HoverCar::getCollisionRadius() const
 {
-	return kCollisionRadius;
+	return mTuning->kCollisionRadius;
 }
 int HoverCar::getHealth() const
 {
-	return health;
+	return mState.health;
 }
 
 float HoverCar::getSpeed() const
 {
-	SVector2D scaledVector = movementThisFrame;
-	return scaledVector.length() * kWorldScale;
+	return movementThisFrame.length() * mTuning->kWorldScale;
+}
+
+void HoverCar::saveState(SnapshotWriter& writer) const
+{
+	DesertVehicle::saveState(writer);
+	writer.write(mState);
+}
+
+void HoverCar::loadState(SnapshotReader& reader)
+{
+	DesertVehicle::loadState(reader);
+	reader.read(mState);
 }
 
 bool HoverCar::speedOverCollisionThreshold() const
 {
-	return getSpeed() > kCollisionSpeedThreshold;
+	return speedOverCollisionThreshold(movementThisFrame, *mTuning);
+}
+
+void HoverCar::reset(SHoverCarState& state, const SHoverCarTuning& tuning)
+{
+	state = SHoverCarState();
+	state.rotationSpeed = tuning.kInitialRotation;
+	state.health = tuning.kInitialHealth;
+}
+
+float HoverCar::processTurn(const SHoverCarState& state, const float turn, const float kGameSpeed, const float kDeltaTime)
+{
+	return turn * state.rotationSpeed * kGameSpeed * kDeltaTime;
+}
+
+float HoverCar::processBoost(SHoverCarState& state, const SHoverCarTuning& tuning, const bool boost, const float kDeltaTime)
+{
+	float boostMultiplier = 1;
+	state.boostDragMultiplier = 1;
+
+	// If time penalty is active
+	if (state.boostPenaltyTimer)
+	{
+		// Reduce remaining penalty time
+		state.boostPenaltyTimer -= kDeltaTime;
+
+		// Cutoff
+		if (state.boostPenaltyTimer < kDeltaTime)
+		{
+			state.boostPenaltyTimer = 0.0f;
+		}
+
+		// Apply double drag
+		state.boostDragMultiplier = tuning.kDrag;
+	}
+	// Health needs to be above a certain limit for the boost to work
+	else if (boost && state.health > tuning.kBoostMinimumHealth)
+	{
+		state.boostTimer += kDeltaTime;
+
+		if (state.boostTimer >= tuning.kBoostMaxTimeActive)
+		{
+			state.boostPenaltyTimer = tuning.kBoostTimePenalty;
+			state.boostTimer = 0.0f;
+			state.boostState = Penalty;
+		}
+		else
+		{
+			state.boostState = Active;
+			boostMultiplier = tuning.kBoost;
+			if ((state.boostTimer + tuning.kBoostWarningTime) >= tuning.kBoostMaxTimeActive)
+			{
+				state.boostState = Warning;
+			}
+		}
+	}
+	// Boost is not being used and not time penalised
+	else
+	{
+		state.boostState = Inactive;
+		state.boostTimer -= kDeltaTime;
+
+		if (state.boostTimer < kDeltaTime)
+		{
+			state.boostTimer = 0;
+		}
+	}
+
+	return boostMultiplier;
+}
+
+SVector2D HoverCar::processThrust(const SHoverCarTuning& tuning, SVector2D facing, const float thrust, const float kGameSpeed,
+	const float boostMultiplier)
+{
+	// Backwards thrust is weaker
+	const float thrustAmount = (thrust >= 0) ? thrust : -thrust * tuning.kBackwardThrustMultiplier;
+	return facing * (tuning.kThrustVector * kGameSpeed * boostMultiplier * thrustAmount);
+}
+
+bool HoverCar::reduceHealth(SHoverCarState& state, const SHoverCarTuning& tuning, const int reduction)
+{
+	if (state.damageTimer <= tuning.kDamageBuffer)
+	{
+		return false;
+	}
+
+	state.health -= reduction;
+	state.damageTimer = 0;
+
+	if (state.health < tuning.kHealthSteerNerf)
+	{
+		state.rotationSpeed = tuning.kNerfedRotation;
+	}
+	return true;
+}
+
+bool HoverCar::speedOverCollisionThreshold(SVector2D movement, const SHoverCarTuning& tuning)
+{
+	return movement.length() * tuning.kWorldScale > tuning.kCollisionSpeedThreshold;
+}
+
+void HoverCar::bounce(SVector2D& movement, Collision::CollisionAxis reverse, const SHoverCarTuning& tuning)
+{
+	switch (reverse)
+	{
+	case Collision::None:
+		break;
+	case Collision::xAxis:
+		movement.x = -movement.x * tuning.kBounce;
+		break;
+	case Collision::yAxis:
+		movement.y = -movement.y * tuning.kBounce;
+		break;
+	default:
+		movement = -movement * tuning.kBounce;
+		break;
+	}
+}
+
+SVector2D HoverCar::applyMovementVector(SVector2D& movement, const float boostDragMultiplier, const SHoverCarTuning& tuning,
+	const float kDeltaTime)
+{
+	const SVector2D displacement = movement * kDeltaTime;
+	movement *= (tuning.kDrag * boostDragMultiplier);
+	if (movement.lengthSquared() < tuning.kDragCutoff * tuning.kDragCutoff)
+	{
+		movement.zeroOut();
+	}
+	return displacement;
 }
\ No newline at end of file
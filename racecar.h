@@ -12,6 +12,7 @@
 #include <TL-Engine.h>
 #include <math.h>
 #include <vector>
+#include <cstdint>
 #include "keybinds.h"
 #include "vector.h"
 #include "node.h"
@@ -22,150 +23,206 @@
 
 namespace desert
 {
-    class HoverCar : public DesertVehicle
+    /**
+    * Hover car tuning constants
+    * One read-only table is shared by every car instead of each car holding its own copy
+    */
+    struct SHoverCarTuning
     {
-    public:
-        enum BoostState
-        {
-            Inactive,
-            Active,
-            Warning,
-            Penalty
-        };
-
-        static const std::string kDefaultModelName;
-
-        HoverCar(tle::IModel* model, const SControlKeybinding carKeybinding, tle::IMesh* flareMesh);
-        ~HoverCar();
-        void addCamera(DesertCamera cam);
-        void control(tle::I3DEngine* myEngine, const float kGameSpeed, const float kDeltaTime);
-        float processBoost(tle::I3DEngine* myEngine, const float kDeltaTime);
-        void processThrust(tle::I3DEngine* myEngine, const float kGameSpeed, const float kDeltaTime, const float boostMultiplier);
-        int processTurn(tle::I3DEngine* myEngine, const float frameSpeed);
-        void processLean(const float frameSpeed, const int turnMultiplier);
-        void processBobble(const float kGameSpeed, const float kDeltaTime);
-        void controlCameras(tle::I3DEngine* myEngine, const float kGameSpeed, const float kDeltaTime);
-        void reduceHealth(const int reduction = 1);
-        void applyMovementVector(const float kDeltaTime);
-        void bounce(Collision::CollisionAxis reverse = Collision::Both);
-        void reset();
-
-        SVector2D getMovementVector();
-
-        tle::ICamera* getCamera();
-        BoostState getBoostState() const;
-        const float getCollisionRadius() const;
-        int getHealth() const;
-        float getSpeed() const;
-        bool speedOverCollisionThreshold() const;
-    protected:
-        // Car forwards / backwards movement state
-        enum HoverCarState
-        {
-            Stationary,
-            Moving
-        };
-
-        // Hover car L/R turning state
-        enum HoverCarInclination
-        {
-            NotTurning,
-            Turning
-        };
-
-        // Control keybinds
-        const SControlKeybinding mKeybind;
-
         // MOVEMENT //
 
         // Thrust speed
-        const SVector2D kThrustVector = { 8.0f, 8.0f };
+        SVector2D kThrustVector = { 8.0f, 8.0f };
         // Multiplier when using backwards thrust
-        const float kBackwardThrustMultiplier = -0.5;
+        float kBackwardThrustMultiplier = -0.5;
         // Rotation speed
-        const float kInitialRotation = 250.0f;
+        float kInitialRotation = 250.0f;
 
         // Movement vector is multiplied by drag every frame
-        const float kDrag = 0.92f;
+        float kDrag = 0.92f;
 
         // Bouncing multiplier
-        const float kBounce = 1.0f;
+        float kBounce = 1.0f;
 
-        const float kWorldScale = 0.5;
+        float kWorldScale = 0.5;
 
-        const float kDragCutoff = 0.05;
+        float kDragCutoff = 0.05;
 
         // BOOST //
 
         // Thrust will be multiplied by this when boost is active
-        const float kBoost = 1.5f;
+        float kBoost = 1.5f;
 
         // Boost maximum continuous use, time penalty and warning period
-        const float kBoostMaxTimeActive = 3.0f, kBoostTimePenalty = 5.0f, kBoostWarningTime = 1.0f;
+        float kBoostMaxTimeActive = 3.0f, kBoostTimePenalty = 5.0f, kBoostWarningTime = 1.0f;
 
         // Minimum health to use boost
-        const float kBoostMinimumHealth = 30.0f;
+        float kBoostMinimumHealth = 30.0f;
 
         // SIN WAVE //
 
         // Initial Y Offset
-        const float kModelYOffset = 3.0f;
+        float kModelYOffset = 3.0f;
         // Speed to reset Y position
-        const float kResetYSpeed = 4.0f;
+        float kResetYSpeed = 4.0f;
         // Modifies sin wave amplitude (aka bumpiness)
-        const float kSinFunctionMultiplier = 12.0f;
+        float kSinFunctionMultiplier = 12.0f;
 
         // LEAN //
 
         // Speed at which car leans into the bends
-        const float kLeaningSpeed = 40.0f;
+        float kLeaningSpeed = 40.0f;
         // Speed at which to reset lean
-        const float kResetLeanSpeed = 30.0f;
+        float kResetLeanSpeed = 30.0f;
         // Max leaning angle
-        const float kMaxInclination = 20.0f;
+        float kMaxInclination = 20.0f;
 
         // REAR LIFT //
 
         // Speed at which rear is lifted
-        const float kRearLiftSpeed = 5.0f;
+        float kRearLiftSpeed = 5.0f;
         // Speed at which rear lift is reset (resetted?)
-        const float kResetRearSpeed = 5.0f;
+        float kResetRearSpeed = 5.0f;
         // Max rear lift angle
-        const float kMaxRearLift = 10.0f;
+        float kMaxRearLift = 10.0f;
 
         // HEALTH //
 
         // Initial health
-        const int kInitialHealth = 100;
+        int kInitialHealth = 100;
         // Rotation speed after a certain damage
-        const float kNerfedRotation = 70.0f;
+        float kNerfedRotation = 70.0f;
         // Health at which rotation nerf will take effect
-        const int kHealthSteerNerf = 40;
-        const float kCollisionSpeedThreshold = 30.0f;
+        int kHealthSteerNerf = 40;
+        float kCollisionSpeedThreshold = 30.0f;
         // Don't take damage if within this time of last damage
-        const float kDamageBuffer = 0.1f;
-
+        float kDamageBuffer = 0.1f;
 
         // Collision radius
-        const float kCollisionRadius = 3.0f;
+        float kCollisionRadius = 3.0f;
+    };
+
+    class HoverCar : public DesertVehicle
+    {
+    public:
+        enum BoostState
+        {
+            Inactive,
+            Active,
+            Warning,
+            Penalty
+        };
+
+        // Controls held during a tick, one bit each (what recordings store)
+        enum InputBit
+        {
+            ForwardInput = 1,
+            BackwardInput = 2,
+            ClockwiseInput = 4,
+            AntiClockwiseInput = 8,
+            BoostInput = 16
+        };
+
+        // Car forwards / backwards movement state
+        enum HoverCarState
+        {
+            Stationary,
+            Moving
+        };
+
+        // Hover car L/R turning state
+        enum HoverCarInclination
+        {
+            NotTurning,
+            Turning
+        };
+
+        // Everything that changes while racing, packed together (fits in a cache line)
+        struct SHoverCarState
+        {
+            float timeElapsedMoving = 0.0f;
+            float rotationSpeed = 0.0f;
+            float boostTimer = 0.0f, boostPenaltyTimer = 0.0f;
+            float damageTimer = 0.0f;
+            float boostDragMultiplier = 1.0f;
+            float rearLift = 0.0f;
+            float lean = 0.0f;
+            int health = 0;
+            HoverCarState carState = Stationary;
+            HoverCarInclination inclinationState = NotTurning;
+            BoostState boostState = Inactive;
+        };
+        static_assert(sizeof(SHoverCarState) <= 64, "Hover car state should fit in a cache line");
+
+        /**
+        * The driving rules on their own, over the state and the movement vector (no car needed)
+        * Headless races, the server, prediction and replays run them too, so every copy of the car behaves the same
+        */
+        static void reset(SHoverCarState& state, const SHoverCarTuning& tuning);
+        // Degrees to turn this tick, turn is -1 (anticlockwise) to 1 (clockwise)
+        static float processTurn(const SHoverCarState& state, const float turn, const float kGameSpeed, const float kDeltaTime);
+        // Returns the thrust multiplier, and sets the state's boost drag for applyMovementVector
+        static float processBoost(SHoverCarState& state, const SHoverCarTuning& tuning, const bool boost, const float kDeltaTime);
+        // Added to the movement vector, thrust is -1 (full reverse) to 1 (full forwards)
+        static SVector2D processThrust(const SHoverCarTuning& tuning, SVector2D facing, const float thrust, const float kGameSpeed,
+            const float boostMultiplier);
+        // Returns true if the car was damaged (not within the damage buffer of the last time)
+        static bool reduceHealth(SHoverCarState& state, const SHoverCarTuning& tuning, const int reduction = 1);
+        static bool speedOverCollisionThreshold(SVector2D movement, const SHoverCarTuning& tuning);
+        static void bounce(SVector2D& movement, Collision::CollisionAxis reverse, const SHoverCarTuning& tuning);
+        // Returns how far the car moves this tick, then drags the movement vector
+        static SVector2D applyMovementVector(SVector2D& movement, const float boostDragMultiplier, const SHoverCarTuning& tuning,
+            const float kDeltaTime);
+
+        static const std::string kDefaultModelName;
+        // Tuning used by every car unless told otherwise
+        static const SHoverCarTuning kDefaultTuning;
+
+        HoverCar(tle::IModel* model, const SControlKeybinding carKeybinding, tle::IMesh* flareMesh, const SHoverCarTuning* tuning = &kDefaultTuning);
+        ~HoverCar();
+        void addCamera(DesertCamera cam);
+        // Control keys held right now, as input bits
+        uint8_t readInput(tle::I3DEngine* myEngine) const;
+        /**
+        * Drive the car for a tick
+        * @param input Input bits, read from the keys or from a recording
+        */
+        void control(tle::I3DEngine* myEngine, uint8_t input, const float kGameSpeed, const float kDeltaTime);
+        float processBoost(uint8_t input, const float kDeltaTime);
+        void processThrust(uint8_t input, const float kGameSpeed, const float kDeltaTime, const float boostMultiplier);
+        int processTurn(uint8_t input, const float kGameSpeed, const float kDeltaTime);
+        void processLean(const float frameSpeed, const int turnMultiplier);
+        void processBobble(const float kGameSpeed, const float kDeltaTime);
+        void controlCameras(tle::I3DEngine* myEngine, const float kGameSpeed, const float kDeltaTime);
+        void reduceHealth(const int reduction = 1);
+        void applyMovementVector(const float kDeltaTime);
+        void bounce(Collision::CollisionAxis reverse = Collision::Both);
+        void reset();
+        void saveState(SnapshotWriter& writer) const;
+        void loadState(SnapshotReader& reader);
+
+        SVector2D getMovementVector();
+
+        tle::ICamera* getCamera();
+        BoostState getBoostState() const;
+        const float getCollisionRadius() const;
+        int getHealth() const;
+        float getSpeed() const;
+        bool speedOverCollisionThreshold() const;
+    protected:
+        // Shared tuning table
+        const SHoverCarTuning* mTuning;
+
+        // Hot per-frame state
+        SHoverCarState mState;
+
+        // Control keybinds
+        const SControlKeybinding mKeybind;
 
         // Cameras that move with the car
         std::vector<DesertCamera> cameras;
         // Pointer to currently active camera
         tle::ICamera* mCurrentCamera;
-
-        HoverCarState carState = Stationary;
-        HoverCarInclination inclinationState = NotTurning;
-        BoostState boostState = Inactive;
-
-        float timeElapsedMoving = 0.0f;
-        float rotationSpeed = kInitialRotation;
-        float boostTimer = 0.0f, boostPenaltyTimer = 0.0f;
-        float damageTimer = 0;
-        float boostDragMultiplier = 1;
-        float rearLift = 0.0f;
-        float lean = 0.0f;
-        int health = kInitialHealth;
     };
 }
 
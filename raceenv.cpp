@@ -0,0 +1,605 @@
+/**
+ * @file raceenv.cpp
+ * Headless races on a loaded track, many of them stepped at once (bot training / balancing)
+ *
+ * @author Jacob Sanchez Perez (G20812080) <jsanchez-perez@uclan.ac.uk>
+ * Games Concepts (CO1301), University of Central Lancashire
+ */
+
+#include <iostream>
+#include <chrono>
+#include <cmath>
+#include <algorithm>
+#include "vector.h"
+#include "files.h"
+#include "node.h"
+#include "checkpoint.h"
+#include "scenery.h"
+#include "racetrack.h"
+#include "raceenv.h"
+
+using namespace std;
+using namespace desert;
+
+
+bool RaceTrackData::load(const string& sceneSetupFilename)
+{
+	mObstacles.clear();
+	mGates.clear();
+	mWaypoints.clear();
+	mGrid.clear();
+
+	vector<SVector2D> checkpoints;
+
+	for (const SSceneModel& model : Files::getSceneModels(sceneSetupFilename))
+	{
+		const SVector2D position = { model.x, model.z };
+		const NodeAlignment alignment = SceneNodeContainer::getAlignmentFromRotation(model.yRotation);
+		// Sizes are given for models along X, models along Z swap them (same as BoxCollisionModel)
+		auto box = [&position, alignment](SCollisionShape::Owner owner, float halfWidth, float halfLength)
+		{
+			const SVector2D halfSize = (alignment == zAligned) ? SVector2D{ halfLength, halfWidth } : SVector2D{ halfWidth, halfLength };
+			return SCollisionShape{ SCollisionShape::Box, owner, position, halfSize };
+		};
+
+		if (model.mesh == HoverCar::kDefaultModelName)
+		{
+			// The first car is the player's, the rest are AI
+			mGrid.push_back({ position, model.yRotation, model.scale });
+		}
+		else if (model.mesh == DesertCheckpoint::kDefaultModelName)
+		{
+			checkpoints.push_back(position);
+			// The gate spans between the struts (across the model), the struts are obstacles
+			mGates.push_back(box(SCollisionShape::Prop, DesertCheckpoint::kHalfLength, DesertCheckpoint::kHalfWidth));
+
+			const SVector2D strutDistance = (alignment == zAligned) ? SVector2D{ 0, DesertCheckpoint::kHalfLength } : SVector2D{ DesertCheckpoint::kHalfLength, 0 };
+			mObstacles.push_back({ SCollisionShape::Circle, SCollisionShape::Strut, position - strutDistance, { DesertCheckpoint::kStrutRadius, 0 } });
+			mObstacles.push_back({ SCollisionShape::Circle, SCollisionShape::Strut, position + strutDistance, { DesertCheckpoint::kStrutRadius, 0 } });
+		}
+		else if (model.mesh == DesertRacetrack::kWaypointModelName)
+		{
+			mWaypoints.push_back(position);
+		}
+		else if (model.mesh == DesertWall::kDefaultModelName)
+		{
+			mObstacles.push_back(box(SCollisionShape::Wall, DesertWall::kHalfWidth, DesertWall::kHalfLength));
+		}
+		else if (model.mesh == DesertTower::kDefaultModelName)
+		{
+			mObstacles.push_back(box(SCollisionShape::Tower, DesertTower::kHalfWidth, DesertTower::kHalfLength));
+		}
+		else if (DesertRacetrack::kCustomCollisionRadius.count(model.mesh))
+		{
+			mObstacles.push_back({ SCollisionShape::Circle, SCollisionShape::Prop, position, { DesertRacetrack::kCustomCollisionRadius.at(model.mesh), 0 } });
+		}
+	}
+
+	if (mGrid.empty() || checkpoints.empty())
+	{
+		cout << "Track " << sceneSetupFilename << " has no start or no checkpoints" << endl;
+		return false;
+	}
+
+	// Same line (and cache) as the game
+	if (!mRacingLine.loadOrBuild(sceneSetupFilename, mWaypoints, checkpoints))
+	{
+		cout << "Track " << sceneSetupFilename << " has no racing line" << endl;
+		return false;
+	}
+
+	mCollisionWorld.build(mObstacles);
+	mFlowField.build(mObstacles, checkpoints);
+
+	cout << "Track data: " << mObstacles.size() << " obstacles, " << mGates.size() << " checkpoints" << endl;
+	return true;
+}
+
+Collision::CollisionAxis RaceTrackData::collide(SVector2D previous, SVector2D position, const float radius) const
+{
+	// The grid holds the same obstacles in the same order
+	const int shape = mCollisionWorld.overlap(position, radius);
+	if (shape < 0)
+	{
+		return Collision::None;
+	}
+
+	// Only overlapping in X before means the car came in along Z, and the other way round
+	switch (Collision::circleToShape(previous, radius, mObstacles[shape]))
+	{
+	case Collision::xAxis:
+		return Collision::yAxis;
+	case Collision::yAxis:
+		return Collision::xAxis;
+	default:
+		return Collision::Both;
+	}
+}
+
+bool RaceTrackData::crossesCheckpoint(int checkpoint, SVector2D position) const
+{
+	const SCollisionShape& gate = mGates[checkpoint];
+	return Collision::pointToBox(position, gate.centre, gate.halfSize.x, gate.halfSize.y) == Collision::Both;
+}
+
+int RaceTrackData::getStagesNumber() const
+{
+	return static_cast<int>(mGates.size());
+}
+
+SVector2D RaceTrackData::getCheckpoint(int checkpoint) const
+{
+	return mGates[checkpoint].centre;
+}
+
+const RacingLine& RaceTrackData::getRacingLine() const
+{
+	return mRacingLine;
+}
+
+const CollisionWorld& RaceTrackData::getCollisionWorld() const
+{
+	return mCollisionWorld;
+}
+
+const FlowField& RaceTrackData::getFlowField() const
+{
+	return mFlowField;
+}
+
+SVector2D RaceTrackData::getStart() const
+{
+	return mGrid.front().position;
+}
+
+float RaceTrackData::getStartHeading() const
+{
+	return mGrid.front().heading;
+}
+
+float RaceTrackData::getStartScale() const
+{
+	return mGrid.front().scale;
+}
+
+int RaceTrackData::getGridSize() const
+{
+	return static_cast<int>(mGrid.size());
+}
+
+const SGridSlot& RaceTrackData::getGridSlot(int slot) const
+{
+	return mGrid[slot];
+}
+
+
+const float HeadlessCar::kDegreesToRadians = 3.14159265358979f / 180.0f;
+
+void HeadlessCar::reset(SHeadlessCar& car, const SGridSlot& slot, const SHoverCarTuning& tuning)
+{
+	car.position = car.previousPosition = slot.position;
+	car.heading = slot.heading;
+	car.movement.zeroOut();
+	HoverCar::reset(car.state, tuning);
+	car.stage = car.lap = 0;
+	car.collidedLastStep = false;
+}
+
+float HeadlessCar::control(SHeadlessCar& car, const SRaceAction& action, const SHoverCarTuning& tuning, const float facingScale,
+	const float kGameSpeed, const float kDeltaTime)
+{
+	const float thrust = max(-1.0f, min(1.0f, action.thrust));
+	const float turn = max(-1.0f, min(1.0f, action.turn));
+
+	// Same order as HoverCar::control
+	car.heading += HoverCar::processTurn(car.state, turn, kGameSpeed, kDeltaTime);
+	const float boostMultiplier = HoverCar::processBoost(car.state, tuning, action.boost, kDeltaTime);
+	car.movement += HoverCar::processThrust(tuning, headingVector(car.heading) * facingScale, thrust, kGameSpeed, boostMultiplier);
+	car.state.damageTimer += kDeltaTime;
+	return car.state.boostDragMultiplier;
+}
+
+bool HeadlessCar::passCheckpoints(SHeadlessCar& car, const RaceTrackData& track, int laps)
+{
+	// Checkpoints, in order
+	const int checkpoint = car.stage % track.getStagesNumber();
+	if (track.crossesCheckpoint(checkpoint, car.position))
+	{
+		++car.stage;
+		// First checkpoint starts a lap
+		return !checkpoint && ++car.lap > laps;
+	}
+	return false;
+}
+
+bool HeadlessCar::collide(SHeadlessCar& car, Collision::CollisionAxis reverseAxis, const SHoverCarTuning& tuning)
+{
+	const bool collided = reverseAxis != Collision::None;
+	const bool newCollision = collided && !car.collidedLastStep;
+
+	// Damage only counts if non contiguous (see DesertRacetrack::resolvePlayerCollisions)
+	if (newCollision && HoverCar::speedOverCollisionThreshold(car.movement, tuning))
+	{
+		HoverCar::reduceHealth(car.state, tuning);
+	}
+	HoverCar::bounce(car.movement, reverseAxis, tuning);
+
+	car.collidedLastStep = collided;
+	return newCollision;
+}
+
+void HeadlessCar::move(SHeadlessCar& car, const float boostDragMultiplier, const SHoverCarTuning& tuning, const float kDeltaTime)
+{
+	car.previousPosition = car.position;
+	car.position += HoverCar::applyMovementVector(car.movement, boostDragMultiplier, tuning, kDeltaTime);
+}
+
+SVector2D HeadlessCar::headingVector(float heading)
+{
+	const float radians = heading * kDegreesToRadians;
+	return { sin(radians), cos(radians) };
+}
+
+
+const SRaceEnvSettings RaceEnvironment::kDefaultSettings = {};
+
+RaceEnvironment::RaceEnvironment(const RaceTrackData* track, int races, const SRaceEnvSettings* settings, const SHoverCarTuning* tuning, int workers) :
+	mTrack(track), mSettings(settings), mTuning(tuning), mRaces(races), mJobs(workers)
+{
+	mStepGraph.addParallelFor("env.step", [this] { return static_cast<int>(mRaces.size()); }, mSettings->kBatchSize,
+		[this](int first, int last) { stepRaces(first, last); });
+}
+
+RaceEnvironment::~RaceEnvironment()
+{
+	cout << "Race environment: " << mRaces.size() << " races, " << mSteps << " steps in " << mStepSeconds << "s ("
+		<< getStepsPerSecond() << " steps/s on " << mJobs.getWorkerCount() + 1 << " threads)" << endl;
+}
+
+void RaceEnvironment::reset(uint64_t seed, vector<SRaceObservation>& observations)
+{
+	const RandomService random(seed);
+	observations.resize(mRaces.size());
+
+	for (unsigned int i = 0; i < mRaces.size(); i++)
+	{
+		mRaces[i].random = random.getStream(RandomService::Race, i);
+		resetRace(mRaces[i]);
+		observations[i] = observe(mRaces[i]);
+	}
+	sense(0, static_cast<int>(mRaces.size()), observations);
+}
+
+void RaceEnvironment::step(const vector<SRaceAction>& actions, vector<SRaceObservation>& observations)
+{
+	if (actions.size() != mRaces.size())
+	{
+		cout << "Race environment: " << actions.size() << " actions for " << mRaces.size() << " races" << endl;
+		return;
+	}
+
+	observations.resize(mRaces.size());
+	mActions = &actions;
+	mObservations = &observations;
+
+	const auto start = chrono::steady_clock::now();
+	mJobs.run(mStepGraph);
+	mStepSeconds += chrono::duration<double>(chrono::steady_clock::now() - start).count();
+	mSteps += mRaces.size();
+
+	mActions = nullptr;
+	mObservations = nullptr;
+}
+
+void RaceEnvironment::stepRaces(int first, int last)
+{
+	for (int i = first; i < last; i++)
+	{
+		float reward = 0.0f;
+		bool collided = false;
+		const bool done = stepRace(mRaces[i], (*mActions)[i], reward, collided);
+
+		// Restart straight away, the bot keeps stepping every race
+		if (done)
+		{
+			resetRace(mRaces[i]);
+		}
+
+		SRaceObservation& observation = (*mObservations)[i];
+		observation = observe(mRaces[i]);
+		observation.reward = reward;
+		observation.collided = collided;
+		observation.done = done;
+	}
+
+	sense(first, last, *mObservations);
+}
+
+void RaceEnvironment::sense(int first, int last, vector<SRaceObservation>& observations) const
+{
+	SRayFan fan = mSettings->kSensors;
+	fan.rays = min(fan.rays, static_cast<int>(SRaceObservation::kMaxSensors));
+	if (fan.rays <= 0 || first >= last)
+	{
+		return;
+	}
+
+	// Every car of the batch in one call
+	const int cars = last - first;
+	vector<SVector2D> origins(cars);
+	vector<float> headings(cars);
+	vector<SRayHit> hits(cars * fan.rays);
+	for (int i = 0; i < cars; i++)
+	{
+		origins[i] = mRaces[first + i].car.position;
+		headings[i] = mRaces[first + i].car.heading;
+	}
+
+	mTrack->getCollisionWorld().rayFans(origins.data(), headings.data(), cars, fan, hits.data());
+
+	for (int i = 0; i < cars; i++)
+	{
+		for (int ray = 0; ray < fan.rays; ray++)
+		{
+			observations[first + i].sensors[ray] = hits[i * fan.rays + ray].distance;
+		}
+	}
+}
+
+bool RaceEnvironment::stepRace(SRaceState& race, const SRaceAction& action, float& reward, bool& collided) const
+{
+	// Same rules as a race tick of the player's car
+	SHeadlessCar& car = race.car;
+	const SHoverCarTuning& tuning = *mTuning;
+	const float kDeltaTime = mSettings->kDeltaTime;
+
+	const float boostDrag = HeadlessCar::control(car, action, tuning, mTrack->getStartScale(), mSettings->kGameSpeed, kDeltaTime);
+	const bool finished = HeadlessCar::passCheckpoints(car, *mTrack, mSettings->kLaps);
+
+	// Collision, one per step
+	const Collision::CollisionAxis reverseAxis = mTrack->collide(car.previousPosition, car.position, tuning.kCollisionRadius);
+	collided = reverseAxis != Collision::None;
+	if (HeadlessCar::collide(car, reverseAxis, tuning))
+	{
+		reward -= mSettings->kCollisionPenalty;
+	}
+
+	HeadlessCar::move(car, boostDrag, tuning, kDeltaTime);
+
+	// Reward progress along the racing line (wrapping around at the finish)
+	const RacingLine& line = mTrack->getRacingLine();
+	const float lineDistance = line.project(car.position, race.lineDistance, mSettings->kLineSearchWindow);
+	float progress = lineDistance - race.lineDistance;
+	if (progress > line.getLength() / 2)
+	{
+		progress -= line.getLength();
+	}
+	else if (progress < -line.getLength() / 2)
+	{
+		progress += line.getLength();
+	}
+	race.lineDistance = lineDistance;
+	reward += progress;
+
+	++race.steps;
+	return finished || car.state.health <= 0 || race.steps >= mSettings->kMaxEpisodeSteps;
+}
+
+void RaceEnvironment::resetRace(SRaceState& race) const
+{
+	const float jitter = mSettings->kStartJitter, headingJitter = mSettings->kHeadingJitter;
+
+	SGridSlot start = mTrack->getGridSlot(0);
+	start.position += SVector2D{ race.random.getFloat(-jitter, jitter), race.random.getFloat(-jitter, jitter) };
+	start.heading += race.random.getFloat(-headingJitter, headingJitter);
+	HeadlessCar::reset(race.car, start, *mTuning);
+
+	race.lineDistance = mTrack->getRacingLine().project(race.car.position);
+	race.steps = 0;
+}
+
+SRaceObservation RaceEnvironment::observe(const SRaceState& race) const
+{
+	const SHeadlessCar& car = race.car;
+	SRaceObservation observation = {};
+	observation.position = car.position;
+	observation.movement = car.movement;
+	observation.heading = car.heading;
+
+	// Into the car's frame
+	const SVector2D facing = HeadlessCar::headingVector(car.heading);
+	const SVector2D right = { facing.y, -facing.x };
+	const SVector2D toCheckpoint = mTrack->getCheckpoint(car.stage % mTrack->getStagesNumber()) - car.position;
+	observation.toCheckpoint = { toCheckpoint.dot(right), toCheckpoint.dot(facing) };
+
+	const RacingLine::SSample sample = mTrack->getRacingLine().sample(race.lineDistance);
+	const SVector2D offset = car.position - sample.position;
+	observation.lineDistance = race.lineDistance;
+	observation.lineOffset = sample.direction.x * offset.y - sample.direction.y * offset.x;
+
+	observation.stage = car.stage;
+	observation.lap = car.lap;
+	observation.health = car.state.health;
+	return observation;
+}
+
+int RaceEnvironment::getRacesNumber() const
+{
+	return static_cast<int>(mRaces.size());
+}
+
+long long RaceEnvironment::getStepsNumber() const
+{
+	return mSteps;
+}
+
+double RaceEnvironment::getStepsPerSecond() const
+{
+	return mStepSeconds > 0 ? mSteps / mStepSeconds : 0.0;
+}
+
+
+const string EnvironmentCommand::kFlag = "--environment";
+
+int EnvironmentCommand::run(const vector<string>& args, const string& defaultTrack)
+{
+	string track = defaultTrack;
+	int races = 512;
+	int steps = 2000;
+	int threads = JobSystem::defaultWorkerCount() + 1;
+	uint64_t seed = 1;
+	string flowImage;
+	int flowGate = 0;
+
+	// Options are "--name value"
+	for (unsigned int i = 0; i < args.size(); i++)
+	{
+		const string& option = args[i];
+		if (i + 1 >= args.size())
+		{
+			cout << "Missing value for " << option << endl;
+			printUsage();
+			return 1;
+		}
+		const string& value = args[++i];
+
+		try
+		{
+			if (option == "--track")
+			{
+				track = value;
+			}
+			else if (option == "--races")
+			{
+				races = max(1, stoi(value));
+			}
+			else if (option == "--steps")
+			{
+				steps = max(1, stoi(value));
+			}
+			else if (option == "--threads")
+			{
+				threads = max(1, min(stoi(value), JobSystem::kMaxThreads));
+			}
+			else if (option == "--seed")
+			{
+				seed = stoull(value);
+			}
+			else if (option == "--flow-image")
+			{
+				// Takes the gate too: "--flow-image file gate"
+				if (i + 1 >= args.size())
+				{
+					cout << "Missing gate for " << option << endl;
+					printUsage();
+					return 1;
+				}
+				flowImage = value;
+				flowGate = stoi(args[++i]);
+			}
+			else
+			{
+				cout << "Unknown option " << option << " " << value << endl;
+				printUsage();
+				return 1;
+			}
+		}
+		catch (const exception&)
+		{
+			cout << "Bad value for " << option << ": " << value << endl;
+			return 1;
+		}
+	}
+
+	RaceTrackData data;
+	if (!data.load(track))
+	{
+		return 1;
+	}
+
+	// Plot the field the AI recovers with, no races
+	if (!flowImage.empty())
+	{
+		const FlowField& field = data.getFlowField();
+		if (flowGate < 0 || flowGate >= field.getGatesNumber())
+		{
+			cout << "No gate " << flowGate << ", the flow field has " << field.getGatesNumber() << endl;
+			return 1;
+		}
+		if (!field.writeImage(flowImage, flowGate))
+		{
+			return 1;
+		}
+		cout << "Flow field of gate " << flowGate << " written to " << flowImage << endl;
+		return 0;
+	}
+
+	cout << "Stepping " << races << " races " << steps << " times" << endl;
+	const int sensors = RaceEnvironment::kDefaultSettings.kSensors.rays;
+	long long episodes = 0;
+	double reward = 0.0;
+	{
+		// Reports its throughput when destroyed
+		RaceEnvironment environment(&data, races, &RaceEnvironment::kDefaultSettings, &HoverCar::kDefaultTuning, threads - 1);
+		vector<SRaceObservation> observations;
+		vector<SRaceAction> actions(races);
+		environment.reset(seed, observations);
+
+		for (int step = 0; step < steps; step++)
+		{
+			for (int i = 0; i < races; i++)
+			{
+				actions[i] = drive(observations[i], sensors);
+			}
+			environment.step(actions, observations);
+
+			for (const SRaceObservation& observation : observations)
+			{
+				reward += observation.reward;
+				episodes += observation.done;
+			}
+		}
+	}
+	cout << episodes << " episodes ended, " << reward / races << " reward per race" << endl;
+	return 0;
+}
+
+void EnvironmentCommand::printUsage()
+{
+	cout << "Usage: DesertRacer " << kFlag << " [--races N] [--steps N] [--threads N] [--seed N] [--track file]" << endl;
+	cout << "       DesertRacer " << kFlag << " --flow-image file gate [--track file]" << endl;
+}
+
+SRaceAction EnvironmentCommand::drive(const SRaceObservation& observation, int sensors)
+{
+	const float kRadiansToTurn = 4.0f / 3.14159265358979f;
+	const float kAvoidDistance = 15.0f;
+	const float kFullThrustAngle = 0.5f;
+
+	SRaceAction action;
+	const float angle = atan2(observation.toCheckpoint.x, observation.toCheckpoint.y);
+	action.turn = angle * kRadiansToTurn;
+	// Eases off while the checkpoint is not ahead
+	action.thrust = fabs(angle) < kFullThrustAngle ? 1.0f : 0.25f;
+
+	// Rays are left to right, the closer half decides which way to swerve
+	float left = observation.sensors[0], right = observation.sensors[0];
+	for (int i = 0; i < sensors; i++)
+	{
+		if (i < sensors / 2)
+		{
+			left = min(left, observation.sensors[i]);
+		}
+		else
+		{
+			right = min(right, observation.sensors[i]);
+		}
+	}
+	if (min(left, right) < kAvoidDistance)
+	{
+		action.turn = left < right ? 1.0f : -1.0f;
+	}
+
+	action.turn = max(-1.0f, min(action.turn, 1.0f));
+	return action;
+}
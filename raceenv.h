@@ -0,0 +1,281 @@
+/**
+ * @file raceenv.h
+ * Headless races on a loaded track, many of them stepped at once (bot training / balancing)
+ *
+ * @author Jacob Sanchez Perez (G20812080) <jsanchez-perez@uclan.ac.uk>
+ * Games Concepts (CO1301), University of Central Lancashire
+ */
+
+#ifndef DESERT_RACER_RACE_ENV_H
+#define DESERT_RACER_RACE_ENV_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "vector.h"
+#include "collision.h"
+#include "collisionworld.h"
+#include "racecar.h"
+#include "racingline.h"
+#include "flowfield.h"
+#include "jobs.h"
+#include "rng.h"
+
+
+namespace desert
+{
+	// Where a hover car starts the race
+	struct SGridSlot
+	{
+		SVector2D position;
+		// Degrees, 0 faces +Z
+		float heading;
+		// The car model's scale, thrust is scaled by it
+		float scale;
+	};
+
+	/**
+	* Everything about a track that does not change during a race, loaded without an engine
+	* Shared read-only by every environment racing on it
+	*/
+	class RaceTrackData
+	{
+	public:
+		/**
+		* Read the obstacles / checkpoints / start of a scene setup file and load (or solve) its racing line
+		* @return False if the track has no player start, checkpoints or racing line
+		*/
+		bool load(const std::string& sceneSetupFilename);
+
+		/**
+		* First obstacle a car overlaps, same rules as the player's collision in a race
+		* @param previous Where the car was last tick (gives the side it came from)
+		* @return Axis to bounce on, None if clear
+		*/
+		Collision::CollisionAxis collide(SVector2D previous, SVector2D position, const float radius) const;
+		// Whether a position is inside a checkpoint's gate
+		bool crossesCheckpoint(int checkpoint, SVector2D position) const;
+
+		int getStagesNumber() const;
+		SVector2D getCheckpoint(int checkpoint) const;
+		const RacingLine& getRacingLine() const;
+		// Obstacles, for ray casts
+		const CollisionWorld& getCollisionWorld() const;
+		// Directions around the obstacles to every checkpoint (AI recovery)
+		const FlowField& getFlowField() const;
+		// The player's start
+		SVector2D getStart() const;
+		// Degrees, 0 faces +Z
+		float getStartHeading() const;
+		// The car model's scale, thrust is scaled by it
+		float getStartScale() const;
+		// Hover cars of the scene, the player's first and the AI after it
+		int getGridSize() const;
+		const SGridSlot& getGridSlot(int slot) const;
+	protected:
+		std::vector<SCollisionShape> mObstacles;
+		CollisionWorld mCollisionWorld;
+		FlowField mFlowField;
+		// Gate of every checkpoint (boxes), in race order
+		std::vector<SCollisionShape> mGates;
+		std::vector<SVector2D> mWaypoints;
+		RacingLine mRacingLine;
+		std::vector<SGridSlot> mGrid;
+	};
+
+	// What a bot does during one step, same controls as the player
+	struct SRaceAction
+	{
+		// -1 full reverse, 1 full forwards
+		float thrust = 0.0f;
+		// -1 anticlockwise, 1 clockwise
+		float turn = 0.0f;
+		bool boost = false;
+	};
+
+	// What a bot sees after a step
+	struct SRaceObservation
+	{
+		static const int kMaxSensors = 16;
+
+		SVector2D position;
+		SVector2D movement;
+		// Degrees, 0 faces +Z
+		float heading;
+		// Next checkpoint relative to the car (x right, y forwards)
+		SVector2D toCheckpoint;
+		// Progress along the racing line, and distance off it (positive on its left)
+		float lineDistance;
+		float lineOffset;
+		int stage;
+		int lap;
+		int health;
+		// Distance to the nearest obstacle along each ray of the sensor fan (left to right)
+		float sensors[kMaxSensors];
+		// Distance gained along the racing line this step, minus penalties
+		float reward;
+		bool collided;
+		/**
+		* The episode ended this step (finished, wrecked or out of time)
+		* The race has already been restarted: the rest of the observation is its first one
+		*/
+		bool done;
+	};
+
+	// The player's hover car without a scene node
+	struct SHeadlessCar
+	{
+		SVector2D position, previousPosition;
+		SVector2D movement;
+		float heading = 0.0f;
+		// Same state as a HoverCar, driven by the same rules
+		HoverCar::SHoverCarState state;
+		int stage = 0, lap = 0;
+		bool collidedLastStep = false;
+	};
+
+	/**
+	* Race tick of the player's car (DesertRacetrack) over a headless car, using HoverCar's own rules
+	* A tick is control -> checkpoints -> collision -> movement
+	*/
+	class HeadlessCar
+	{
+	public:
+		static void reset(SHeadlessCar& car, const SGridSlot& slot, const SHoverCarTuning& tuning);
+		/**
+		* Turning, boost and thrust
+		* @return Drag multiplier of the boost, for the movement
+		*/
+		static float control(SHeadlessCar& car, const SRaceAction& action, const SHoverCarTuning& tuning, const float facingScale,
+			const float kGameSpeed, const float kDeltaTime);
+		// Returns true when the car completes its last lap
+		static bool passCheckpoints(SHeadlessCar& car, const RaceTrackData& track, int laps);
+		/**
+		* Bounce off what the car hit, losing health if it hit hard enough
+		* @param reverseAxis Axis to bounce on, None if the car hit nothing
+		* @return True if the collision is new (the car was not touching anything last tick)
+		*/
+		static bool collide(SHeadlessCar& car, Collision::CollisionAxis reverseAxis, const SHoverCarTuning& tuning);
+		static void move(SHeadlessCar& car, const float boostDragMultiplier, const SHoverCarTuning& tuning, const float kDeltaTime);
+
+		static SVector2D headingVector(float heading);
+	protected:
+		static const float kDegreesToRadians;
+	};
+
+	struct SRaceEnvSettings
+	{
+		// Fixed time step of every race
+		float kDeltaTime = 1.0f / 60.0f;
+		float kGameSpeed = 1.0f;
+		int kLaps = 3;
+		// Races are cut after this many steps
+		int kMaxEpisodeSteps = 60 * 60 * 5;
+		// Random offset of the start position / heading, drawn from each race's own stream
+		float kStartJitter = 2.0f;
+		float kHeadingJitter = 10.0f;
+		// Reward lost for every new collision
+		float kCollisionPenalty = 5.0f;
+		// Distance around the last progress searched for the new one
+		float kLineSearchWindow = 20.0f;
+		// Obstacle sensors around the car (up to SRaceObservation::kMaxSensors rays)
+		SRayFan kSensors = { 8, 180.0f, 100.0f };
+		// Races per job
+		int kBatchSize = 256;
+	};
+
+	/**
+	* N independent headless races on one track, stepped together across a thread pool
+	* Every race owns a compact state; meshes are never loaded and the track is shared
+	*/
+	class RaceEnvironment
+	{
+	public:
+		static const SRaceEnvSettings kDefaultSettings;
+
+		/**
+		* @param track Loaded track, must outlive the environment
+		* @param races Number of races stepped together
+		* @param workers Threads stepping them (besides the calling one)
+		*/
+		RaceEnvironment(const RaceTrackData* track, int races, const SRaceEnvSettings* settings = &kDefaultSettings,
+			const SHoverCarTuning* tuning = &HoverCar::kDefaultTuning, int workers = JobSystem::defaultWorkerCount());
+		// Reports throughput
+		~RaceEnvironment();
+		RaceEnvironment(const RaceEnvironment&) = delete;
+		RaceEnvironment& operator=(const RaceEnvironment&) = delete;
+
+		/**
+		* Restart every race
+		* Race i draws its start from stream i of the seed, so the same seed gives the same races
+		*/
+		void reset(uint64_t seed, std::vector<SRaceObservation>& observations);
+		/**
+		* Advance every race one time step, each with its own action
+		* Finished races restart on their own (see SRaceObservation::done)
+		* @param actions One per race
+		*/
+		void step(const std::vector<SRaceAction>& actions, std::vector<SRaceObservation>& observations);
+
+		int getRacesNumber() const;
+		// Race steps taken so far (every race counts)
+		long long getStepsNumber() const;
+		double getStepsPerSecond() const;
+	protected:
+		// Mutable state of a single race
+		struct SRaceState
+		{
+			SHeadlessCar car;
+			float lineDistance = 0.0f;
+			int steps = 0;
+			RNG random;
+		};
+
+		// Steps races [first, last)
+		void stepRaces(int first, int last);
+		// Returns true if the episode ended
+		bool stepRace(SRaceState& race, const SRaceAction& action, float& reward, bool& collided) const;
+		void resetRace(SRaceState& race) const;
+		SRaceObservation observe(const SRaceState& race) const;
+		// Fill the sensors of races [first, last), one batch of ray casts
+		void sense(int first, int last, std::vector<SRaceObservation>& observations) const;
+
+		const RaceTrackData* mTrack;
+		const SRaceEnvSettings* mSettings;
+		const SHoverCarTuning* mTuning;
+		std::vector<SRaceState> mRaces;
+
+		JobSystem mJobs;
+		JobGraph mStepGraph;
+		// Step being run by the graph
+		const std::vector<SRaceAction>* mActions = nullptr;
+		std::vector<SRaceObservation>* mObservations = nullptr;
+
+		long long mSteps = 0;
+		double mStepSeconds = 0.0;
+	};
+
+	/**
+	* Command line front end: DesertRacer --environment [--races N] [--steps N] [--threads N] [--seed N] [--track file]
+	* Steps a RaceEnvironment with a simple bot in every race and reports the throughput
+	* DesertRacer --environment --flow-image file gate [--track file] plots a gate's flow field instead (PPM image)
+	*/
+	class EnvironmentCommand
+	{
+	public:
+		static const std::string kFlag;
+
+		/**
+		* @param args Arguments after the flag
+		* @param defaultTrack Track raced if none is given
+		* @return Process exit code
+		*/
+		static int run(const std::vector<std::string>& args, const std::string& defaultTrack);
+	protected:
+		static void printUsage();
+		// Heads for the next checkpoint, turning away from obstacles close ahead
+		static SRaceAction drive(const SRaceObservation& observation, int sensors);
+	};
+}
+
+#endif
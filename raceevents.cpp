@@ -0,0 +1,64 @@
+/**
+ * @file raceevents.cpp
+ * What happened in a race tick, queued by the simulation and handed to the presentation after it
+ *
+ * @author Jacob Sanchez Perez (G20812080) <jsanchez-perez@uclan.ac.uk>
+ * Games Concepts (CO1301), University of Central Lancashire
+ */
+
+#include <utility>
+#include "raceevents.h"
+
+using namespace std;
+using namespace desert;
+
+
+void RaceEventQueue::push(const SRaceEvent& event)
+{
+	mEvents.push_back(event);
+}
+
+void RaceEventQueue::push(RaceEventType type, int vehicle, int value)
+{
+	SRaceEvent event;
+	event.type = type;
+	event.vehicle = static_cast<uint8_t>(vehicle);
+	event.value = value;
+	mEvents.push_back(event);
+}
+
+void RaceEventQueue::addConsumer(Consumer consumer)
+{
+	mConsumers.push_back(move(consumer));
+}
+
+void RaceEventQueue::dispatch()
+{
+	if (mEvents.empty())
+	{
+		return;
+	}
+
+	mBatch.swap(mEvents);
+	for (const Consumer& consumer : mConsumers)
+	{
+		consumer(mBatch);
+	}
+	mDispatched += mBatch.size();
+	mBatch.clear();
+}
+
+void RaceEventQueue::clear()
+{
+	mEvents.clear();
+}
+
+const vector<SRaceEvent>& RaceEventQueue::getEvents() const
+{
+	return mEvents;
+}
+
+long long RaceEventQueue::getDispatchedNumber() const
+{
+	return mDispatched;
+}
@@ -0,0 +1,76 @@
+/**
+ * @file raceevents.h
+ * What happened in a race tick, queued by the simulation and handed to the presentation after it
+ *
+ * @author Jacob Sanchez Perez (G20812080) <jsanchez-perez@uclan.ac.uk>
+ * Games Concepts (CO1301), University of Central Lancashire
+ */
+
+#ifndef DESERT_RACER_RACE_EVENTS_H
+#define DESERT_RACER_RACE_EVENTS_H
+
+#include <vector>
+#include <functional>
+#include <cstdint>
+
+
+namespace desert
+{
+	enum RaceEventType : uint8_t
+	{
+		// value: index of the checkpoint, stage: stages completed
+		StageCrossed,
+		// lap: the lap started
+		LapCompleted,
+		// value: health left
+		VehicleDamaged,
+		// The vehicle won, time: race time
+		RaceFinished,
+		// value: new race position (1 is leading)
+		PositionChanged
+	};
+
+	// One event, copied around as is
+	struct SRaceEvent
+	{
+		RaceEventType type = StageCrossed;
+		// 0 for the player, AI i is i + 1 (as in telemetry)
+		uint8_t vehicle = 0;
+		int16_t lap = 0;
+		int32_t stage = 0;
+		int32_t value = 0;
+		float time = 0.0f;
+	};
+
+	/**
+	* Events of one tick, in the order they were pushed
+	* The simulation only pushes, consumers (HUD, telemetry, audio...) get the whole batch once the tick is done
+	* Pushing is not synchronised: the tasks that push must be ordered by the tick graph
+	*/
+	class RaceEventQueue
+	{
+	public:
+		typedef std::function<void(const std::vector<SRaceEvent>& events)> Consumer;
+
+		void push(const SRaceEvent& event);
+		void push(RaceEventType type, int vehicle, int value = 0);
+
+		// Called once per dispatch with the batch, in the order consumers were added
+		void addConsumer(Consumer consumer);
+		// Hand the events to every consumer and empty the queue (consumers may push for the next batch)
+		void dispatch();
+		// Drop the events without handing them out
+		void clear();
+
+		const std::vector<SRaceEvent>& getEvents() const;
+		long long getDispatchedNumber() const;
+	protected:
+		std::vector<SRaceEvent> mEvents;
+		// Batch being handed out, kept to reuse its memory
+		std::vector<SRaceEvent> mBatch;
+		std::vector<Consumer> mConsumers;
+		long long mDispatched = 0;
+	};
+}
+
+#endif
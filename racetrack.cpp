@@ -11,6 +11,7 @@
 #include <vector>
 #include <unordered_map> // Mesh storage
 #include <algorithm>
+#include <chrono>
 
 #include "node.h"
 #include "racetrack.h"
@@ -28,11 +29,26 @@ using namespace tle;
 using namespace desert;
 
 
+const string DesertRacetrack::kBarrelModelName = "Barrel";
+const string DesertRacetrack::kWaypointModelName = "Dummy";
+
+const unordered_map<string, float> DesertRacetrack::kCustomCollisionRadius
+{
+	{ "Snowman", 8.0f },
+	{ "Moon", 173.0f },
+	{ "Barrel", 2.4f },
+	{ "TankSmall1", 1.8f },
+	{ "TankSmall2", 1.8f }
+};
+
 // Set up scene and create objects
-DesertRacetrack::DesertRacetrack(I3DEngine* myEngine, string sceneSetupFilename, SControlKeybinding controlKeybind)
+DesertRacetrack::DesertRacetrack(I3DEngine* myEngine, string sceneSetupFilename, SControlKeybinding controlKeybind, uint64_t raceSeed) : mRandom(raceSeed),
+	mSceneSetupFilename(sceneSetupFilename)
 {
-	// Get setup file lines
-	vector<string> setupLines = Files::getLinesFromFile(sceneSetupFilename);
+	cout << "Race seed: " << mRandom.getMasterSeed() << endl;
+
+	// Get setup file models
+	vector<SSceneModel> sceneModels = Files::getSceneModels(sceneSetupFilename);
 
 	// Create racecar cameras
 	ICamera* followCam = myEngine->CreateCamera();
@@ -46,35 +62,9 @@ DesertRacetrack::DesertRacetrack(I3DEngine* myEngine, string sceneSetupFilename,
 	bool playerLoaded = false;
 
 	// For every model in scene
-	for (string setupLine : setupLines)
+	for (const SSceneModel& sceneModel : sceneModels)
 	{
-		vector<string> setupElements = Files::splitLine(setupLine);
-		const string meshFilename = setupElements.at(0);
-		float initialY = kDefaultY, xRotation = 0, zRotation = 0, scale = 1;
-
-		const float initialX = stof(setupElements.at(XIndex));
-		const float initialZ = stof(setupElements.at(ZIndex));
-		const float yRotation = stof(setupElements.at(YRotIndex));
-
-		if (setupElements.size() > YIndex)
-		{
-			initialY = stof(setupElements.at(YIndex));
-		}
-
-		if (setupElements.size() > XRotIndex)
-		{
-			xRotation = stof(setupElements.at(XRotIndex));
-		}
-
-		if (setupElements.size() > ZRotIndex)
-		{
-			zRotation = stof(setupElements.at(ZRotIndex));
-		}
-
-		if (setupElements.size() > ScaleIndex)
-		{
-			scale = stof(setupElements.at(ScaleIndex));
-		}
+		const string meshFilename = sceneModel.mesh;
 
 		cout << "Loading model of " << meshFilename << endl;
 
@@ -85,17 +75,17 @@ DesertRacetrack::DesertRacetrack(I3DEngine* myEngine, string sceneSetupFilename,
 		}
 
 		// Create model in specified location
-		IModel* model = mMeshes[meshFilename]->CreateModel(initialX, initialY, initialZ);
+		IModel* model = mMeshes[meshFilename]->CreateModel(sceneModel.x, sceneModel.y, sceneModel.z);
 		// Rotate if necessary
-		model->RotateY(yRotation);
-		model->RotateX(xRotation);
-		model->RotateZ(zRotation);
-		model->Scale(scale);
+		model->RotateY(sceneModel.yRotation);
+		model->RotateX(sceneModel.xRotation);
+		model->RotateZ(sceneModel.zRotation);
+		model->Scale(sceneModel.scale);
 
 		// Detect model axis alignment
-		const NodeAlignment alignment = SceneNodeContainer::getAlignmentFromRotation(yRotation);
+		const NodeAlignment alignment = SceneNodeContainer::getAlignmentFromRotation(sceneModel.yRotation);
 
-		if (!playerLoaded && meshFilename == "Racecar")
+		if (!playerLoaded && meshFilename == HoverCar::kDefaultModelName)
 		{
 			followCam->AttachToParent(model);
 			povCam->AttachToParent(model);
@@ -110,6 +100,7 @@ DesertRacetrack::DesertRacetrack(I3DEngine* myEngine, string sceneSetupFilename,
 			povDesertCam.rotateLocallyByVector(kPovCamRotation);
 
 			racecarPtr = new HoverCar(model, controlKeybind, flareMesh);
+			racecarPtr->attachToMirror(&mTransforms);
 			racecarPtr->addCamera(followDesertCam);
 			racecarPtr->addCamera(povDesertCam);
 			mVehicles.push_back(racecarPtr);
@@ -121,22 +112,108 @@ DesertRacetrack::DesertRacetrack(I3DEngine* myEngine, string sceneSetupFilename,
 		}
 	}
 
+	// Ghost of the track's best lap, if one was driven before
+	if (playerLoaded)
+	{
+		IModel* ghostModel = mMeshes[HoverCar::kDefaultModelName]->CreateModel(0, kGhostHiddenY, 0);
+		ghostModel->SetSkin(kGhostSkin);
+		mGhostCar = new SceneNodeContainer(ghostModel);
+		mGhostCar->attachToMirror(&mTransforms);
+	}
+	if (mGhost.load(sceneSetupFilename + GhostPath::kFileExtension))
+	{
+		cout << "Ghost lap of " << mGhost.getDuration() << "s loaded" << endl;
+	}
+
 	// Create UI
-	uiPtr = new GameUI(myEngine);
+	uiPtr = new GameUI(myEngine, &mTimers);
+	mRaceEvents.addConsumer([this](const vector<SRaceEvent>& events) { presentRaceEvents(events); });
 
 	// Initialise UI elements
 	resetDialog();
 	updateUI();
 
+	// Racing line through waypoints and checkpoints, solved once and cached next to the track
+	vector<SVector2D> checkpointPositions;
+	for (DesertCheckpoint* checkpoint : mCheckpoints)
+	{
+		checkpointPositions.push_back(checkpoint->position2D());
+	}
+
+	if (mRacingLine.loadOrBuild(sceneSetupFilename, mWaypoints, checkpointPositions))
+	{
+		for (HoverAI* ai : mAI)
+		{
+			ai->setRacingLine(&mRacingLine);
+		}
+	}
+
+	// Flow field to every checkpoint around the static obstacles, for AI knocked off course
+	vector<const CollisionModel*> obstacles;
+	for (CollisionModel* node : mCollisionNodes)
+	{
+		if (find(mAI.begin(), mAI.end(), node) == mAI.end())
+		{
+			obstacles.push_back(node);
+		}
+	}
+
+	vector<SCollisionShape> obstacleShapes;
+	for (const CollisionModel* obstacle : obstacles)
+	{
+		obstacle->getShapes(obstacleShapes);
+	}
+	mFlowField.build(obstacleShapes, checkpointPositions);
+
+	// Same obstacles for sensor ray casts
+	mCollisionWorld.build(obstacleShapes);
+	for (HoverAI* ai : mAI)
+	{
+		ai->setFlowField(&mFlowField);
+	}
+
+	// Stages of a frame, run by the job system
+	mWaypointReached.assign(mAI.size(), false);
+	mSteering.resize(mAI.size());
+	mAILod.resize(mAI.size());
+	for (vector<SVehicleSnapshot>& states : mVehicleStates)
+	{
+		states.resize(mAI.size() + 1);
+	}
+	captureVehicleStates(0, mAI.size() + 1);
+	swapVehicleStates();
+	buildTickGraphs();
+
 	cout << "Racetrack created" << endl;
 }
 
 DesertRacetrack::~DesertRacetrack()
 {
+	cout << "Transform mirror: " << mTransforms.getCallsRequested() << " engine calls requested, "
+		<< mTransforms.getEngineCalls() << " made, " << mTransforms.getCallsSaved() << " saved" << endl;
+	if (mSnapshotStats.taken)
+	{
+		cout << "Snapshots: " << mSnapshotStats.taken << " taken of " << mSnapshotStats.bytes << " bytes, "
+			<< mSnapshotStats.takeSeconds * 1e6 / mSnapshotStats.taken << "us each; " << mSnapshotStats.restored << " restored, "
+			<< (mSnapshotStats.restored ? mSnapshotStats.restoreSeconds * 1e6 / mSnapshotStats.restored : 0.0) << "us each" << endl;
+	}
+	const ParticleBudget::SBudgetTotals& particleTotals = mParticleBudget.getTotals();
+	if (particleTotals.droppingFrames)
+	{
+		cout << "Particle budget: particles dropped in " << particleTotals.droppingFrames << " of " << particleTotals.frames << " frames, at most "
+			<< particleTotals.mostDropped << "; " << particleTotals.skippedSystems << " system updates deferred" << endl;
+	}
+	const JobSystem::SJobStats jobStats = mJobs.getStats();
+	cout << "Job system: " << mJobs.getWorkerCount() << " workers, " << jobStats.executed << " jobs run, "
+		<< jobStats.stolen << " stolen" << endl;
+
 	// Delete racecar
 	delete racecarPtr;
 	racecarPtr = nullptr;
 
+	delete mGhostCar;
+	mGhostCar = nullptr;
+
 	// Delete UI
 	delete uiPtr;
 	uiPtr = nullptr;
@@ -173,7 +250,9 @@ void DesertRacetrack::handleModel(IModel* model, string type, NodeAlignment alig
 	if (type == HoverCar::kDefaultModelName)
 	{
 		model->SetSkin(racecarSkins.at(mAI.size()));
-		mAI.push_back(new HoverAI(model, "CPU #" + to_string(mAI.size() + 1)));
+		RNG aiRandom = mRandom.getStream(RandomService::AI, mAI.size());
+		mAI.push_back(new HoverAI(model, aiRandom, "CPU #" + to_string(mAI.size() + 1)));
+		mAI.back()->attachToMirror(&mTransforms);
 		mAI.back()->follow(mWaypoints.front());
 		mCollisionNodes.push_back(mAI.back());
 		mVehicles.push_back(mAI.back());
@@ -181,27 +260,31 @@ void DesertRacetrack::handleModel(IModel* model, string type, NodeAlignment alig
 	// Model is a checkpoint
 	else if (type == DesertCheckpoint::kDefaultModelName)
 	{
-		mCheckpoints.push_back(new DesertCheckpoint(model, alignment, crossMesh));
+		mCheckpoints.push_back(new DesertCheckpoint(model, alignment, crossMesh, &mTimers));
+		mCheckpoints.back()->attachToMirror(&mTransforms);
 		// Strut collision detection as collision node
 		mCollisionNodes.push_back(mCheckpoints.back());
 	}
 	// Dummy waypoint for AI
-	else if (type == dummyThiccModel)
+	else if (type == kWaypointModelName)
 	{
-		mWaypoints.push_back(model);
+		mWaypoints.push_back({ model->GetX(), model->GetZ() });
 	}
 	// Model is a wall
 	else if (type == DesertWall::kDefaultModelName)
 	{
 		mCollisionNodes.push_back(new DesertWall(model, alignment));
+		mCollisionNodes.back()->attachToMirror(&mTransforms);
 	}
 	else if (type == DesertTower::kDefaultModelName)
 	{
 		mCollisionNodes.push_back(new DesertTower(model, alignment));
+		mCollisionNodes.back()->attachToMirror(&mTransforms);
 	}
 	else if (kCustomCollisionRadius.count(type))
 	{
-		mCollisionNodes.push_back(new CustomSphereCModel(model, kCustomCollisionRadius[type]));
+		mCollisionNodes.push_back(new CustomSphereCModel(model, kCustomCollisionRadius.at(type)));
+		mCollisionNodes.back()->attachToMirror(&mTransforms);
 	}
 	// Just throw it somewhere
 	else
@@ -209,20 +292,25 @@ void DesertRacetrack::handleModel(IModel* model, string type, NodeAlignment alig
 		mScenery.push_back(model);
 	}
 
-	if (type == barrelModel)
+	if (type == kBarrelModelName)
 	{
 		SVector3D p = mCollisionNodes.back()->position();
 		p += barrelOffset;
 		mParticles.push_back(new FireParticleSystem(flareMesh, p));
-		mParticles.back()->setup();
+		mParticles.back()->setup(mRandom.getStream(RandomService::Particles, mParticles.size() - 1), &mTransforms);
+		mParticleBudget.registerSystem(mParticles.back());
 	}
 }
 
 void DesertRacetrack::updateScene(I3DEngine* myEngine, const float kGameSpeed, const float kDeltaTime)
 {
-	for (ParticleSystem* p : mParticles)
+	mTick = { myEngine, kGameSpeed, kDeltaTime };
+
+	// Particle systems are updated within the global budget
+	// (during the race they are part of the race tick)
+	if (raceState != Transcurring)
 	{
-		p->updateSystem(kDeltaTime);
+		mJobs.run(mIdleTick);
 	}
 
 	// Race has not started
@@ -232,50 +320,56 @@ void DesertRacetrack::updateScene(I3DEngine* myEngine, const float kGameSpeed, c
 		if (myEngine->KeyHit(kDefaultMetaBind.kStartGame))
 		{
 			raceState = Starting;
+			countdown(kSecondsBeforeRace);
 		}
 	}
-	// User pressed start key
-	else if (raceState == Starting)
+	else if (raceState == Transcurring)
 	{
-		// Add a second every time the timer passes one second, reset timer
-		if (timeElapsed > 1)
+		// Back a few seconds, the tick then runs from there
+		if (myEngine->KeyHit(kDefaultMetaBind.kRewind) && rewind())
 		{
-			++secondsElapsed;
-			timeElapsed = 0.0f;
+			// A rewound lap is not a lap the player drove, the ghost waits for the next one
+			mGhostRecorder.discard();
+			hideGhost();
 		}
 
-		// If countdown still on
-		if (secondsElapsed < kSecondsBeforeRace)
+		raceElapsed += kDeltaTime;
+		// Checkpoints reset the race time when the race is over
+		const float time = raceElapsed;
+		const int lap = racecarPtr->getCurrentLap();
+		// Particles, player, AI, checkpoints and collisions
+		mJobs.run(mRaceTick);
+		swapVehicleStates();
+		mRaceEvents.dispatch();
+		updateUI();
+		updateGhost(time, lap);
+		publishTelemetry();
+
+		// Every tick is kept for a while, to rewind to
+		const auto snapshotStart = chrono::steady_clock::now();
+		vector<char>& snapshot = mSnapshots.push(mRaceTicks);
+		saveSnapshot(snapshot);
+		mSnapshotStats.takeSeconds += chrono::duration<double>(chrono::steady_clock::now() - snapshotStart).count();
+		mSnapshotStats.bytes = snapshot.size();
+		++mSnapshotStats.taken;
+
+		// Finished or wrecked, keep the race for replays, with where the player ended to check them against
+		if (raceState == Over)
 		{
-			// If no time has elapsed
-			if (!timeElapsed)
-			{
-				// Display seconds remaining for a second
-				uiPtr->displayText(to_string(kSecondsBeforeRace - secondsElapsed), false, 1);
-			}
+			const SVehicleSnapshot player = racecarPtr->snapshot();
+			SRecordedCar result;
+			result.x = player.position.x;
+			result.z = player.position.y;
+			result.heading = HoverAI::headingOf(player.facing);
+			result.health = racecarPtr->getHealth();
+			result.stage = player.stage;
+			result.lap = player.lap;
+			mRecording.setGameResult(result);
 		}
-		// Countdown ended
-		else
+		if (raceState == Over && mRecording.save(mSceneSetupFilename + InputRecording::kFileExtension))
 		{
-			// Display go indefinitely
-			uiPtr->displayText("Go!", false, 0);
-			uiPtr->togglePosition(true);
-			// Race has started, update state
-			raceState = Transcurring;
-			// Reset seconds elapsed for next cycle
-			secondsElapsed = 0;
-			// Since time is added later, in order for
-			// timeElapsed to be zero this subtraction is needed
-			timeElapsed = -kDeltaTime;
+			cout << "Race recorded to " << mSceneSetupFilename + InputRecording::kFileExtension << endl;
 		}
-
-		// Add time to counter
-		timeElapsed += kDeltaTime;
-	}
-	else if (raceState == Transcurring)
-	{
-		raceElapsed += kDeltaTime;
-		updateOngoingRaceScene(myEngine, kGameSpeed, kDeltaTime);
 	}
 	// Race has ended
 	else if (raceState == Over)
@@ -289,11 +383,20 @@ void DesertRacetrack::updateScene(I3DEngine* myEngine, const float kGameSpeed, c
 		}
 	}
 
+	// Hide crosses and dialogs whose time is up, move the countdown on
+	mTimers.advance(kDeltaTime);
+
 	// Draw UI (text)
-	uiPtr->drawGameUI(kDeltaTime);
+	uiPtr->drawGameUI();
+
+	// New particles are tracked by the transform mirror, which cannot grow while stages run
+	mParticleBudget.spawn();
+
+	// Write the final transform of every node that moved this tick to the engine
+	mTransforms.submit();
 }
 
-void DesertRacetrack::detectCheckpointCrossings(const float kDeltaTime)
+void DesertRacetrack::detectCheckpointCrossings()
 {
 	// We still need the index
 	unsigned int i = 0;
@@ -308,110 +411,243 @@ void DesertRacetrack::detectCheckpointCrossings(const float kDeltaTime)
 				{
 					// Increment stage state
 					vehicle->nextStage();
-
-					if (vehicle->isPlayer())
-					{
-						// Display cross
-						checkpoint->setCrossed();
-					}
+					const int vehicleIndex = getVehicleIndex(vehicle);
 
 					// First checkpoint
 					if (!i)
 					{
 						vehicle->nextLap();
 
-						// Player has completed the race
+						// Vehicle has completed the race
 						if (vehicle->getCurrentLap() > kLaps)
 						{
 							vehicle->resetStage();
 							// Update race state
 							raceState = Over;
-							uiPtr->toggleSummary(true);
-							uiPtr->setSummaryTime(to_string(raceElapsed));
-							uiPtr->setSummaryWinner(vehicle->getTag());
+							SRaceEvent finished;
+							finished.type = RaceFinished;
+							finished.vehicle = static_cast<uint8_t>(vehicleIndex);
+							finished.lap = static_cast<int16_t>(vehicle->getCurrentLap());
+							finished.time = raceElapsed;
+							mRaceEvents.push(finished);
 							raceElapsed = 0.0f;
-
-							if (vehicle->isPlayer())
-							{
-								// Update UI
-								uiPtr->displayText("Race finished", true, 0, "Press R to Restart, Esc to Exit");
-								uiPtr->toggleLapSprite(false);
-							}
 						}
-						// Lap completed
-						else if (vehicle->isPlayer())
+						else
 						{
-							string lapDisplayText = "Final Lap";
-
-							if (vehicle->getCurrentLap() != kLaps)
-							{
-								lapDisplayText = "Lap " + to_string(vehicle->getCurrentLap());
-							}
-
-							// Update UI
-							uiPtr->displayText(lapDisplayText, false, 1.0f);
-							updateLapsInUI();
+							SRaceEvent lap;
+							lap.type = LapCompleted;
+							lap.vehicle = static_cast<uint8_t>(vehicleIndex);
+							lap.lap = static_cast<int16_t>(vehicle->getCurrentLap());
+							lap.time = raceElapsed;
+							mRaceEvents.push(lap);
 						}
 					}
 
-					// Other checkpoint or it's the first lap
-					if (vehicle->isPlayer() && (i || vehicle->getCurrentLap() == 1))
-					{
-						// Show stage completion dialog
-						string dispText = "Stage " + to_string(vehicle->getCurrentStage()) + " complete";
-						uiPtr->displayText(dispText, false, 1.0f);
-					}
+					SRaceEvent stage;
+					stage.type = StageCrossed;
+					stage.vehicle = static_cast<uint8_t>(vehicleIndex);
+					stage.lap = static_cast<int16_t>(vehicle->getCurrentLap());
+					stage.stage = vehicle->getCurrentStage();
+					stage.value = i;
+					stage.time = raceElapsed;
+					mRaceEvents.push(stage);
 				}
 			}
 			SVector2D nextCheckpoint = mCheckpoints[vehicle->getCurrentStage() % getStagesNumber()]->position2D();
 			vehicle->setDistanceToCheckpoint(vehicle->distanceTo(nextCheckpoint));
 		}
 
-		// Update cross position
-		checkpoint->updateScene(kDeltaTime);
 		i++;
 	}
 }
 
-void DesertRacetrack::updateOngoingRaceScene(I3DEngine* myEngine, const float kGameSpeed, const float kDeltaTime)
+int DesertRacetrack::addParticleStages(JobGraph& graph)
 {
-	// To avoid cancelling the car's vector twice, therefore not cancelling it at all,
-	// only count one collision per frame
-	bool carHasCollided = false;
-	Collision::CollisionAxis reverseAxis = Collision::CollisionAxis::None;
+	const int particlePlan = graph.addTask("particles.plan", [this] { mParticleBudget.plan(racecarPtr->position(), mTick.deltaTime); });
+	graph.addParallelFor("particles.simulate", [this] { return mParticleBudget.getScheduledNumber(); }, 1,
+		[this](int first, int last) { mParticleBudget.simulate(first, last); }, { particlePlan });
+	return particlePlan;
+}
 
-	// Handle racecar user input
-	racecarPtr->control(myEngine, kGameSpeed, kDeltaTime);
-	// Update camera
-	currentCamera = racecarPtr->getCamera();
+void DesertRacetrack::buildTickGraphs()
+{
+	// Particles are simulated in every race state
+	addParticleStages(mIdleTick);
+
+	/**
+	* Ongoing race, in the same order as a serial frame:
+	* player input -> AI steering -> waypoints -> checkpoints -> race positions ->
+	* collision queries (player / AI) -> collision resolution
+	* Particles run next to all of it. Nothing here touches the UI: checkpoints, positions and resolution push
+	* race events (in that order, each after the other), presented once the graph is done
+	*/
+	// The particle plan reads the player position, so it goes before the player moves
+	const int particlePlan = addParticleStages(mRaceTick);
+	const int control = mRaceTick.addTask("player.control", [this]
+	{
+		// Handle racecar user input, recorded as it is used
+		const uint8_t input = racecarPtr->readInput(mTick.engine);
+		mRecording.record(mTick.deltaTime, input);
+		racecarPtr->control(mTick.engine, input, mTick.gameSpeed, mTick.deltaTime);
+		// Update camera
+		currentCamera = racecarPtr->getCamera();
+	}, { particlePlan }, JobGraph::MainThread);
+
+	// Steering only reads last tick's snapshots, it does not wait for the player
+	const int lod = mRaceTick.addTask("ai.lod", [this] { updateAILod(); });
+	const int steering = mRaceTick.addParallelFor("ai.steering", [this] { return static_cast<int>(mAI.size()); }, kAIBatchSize,
+		[this](int first, int last) { steerAI(first, last); }, { lod });
+	const int applySteering = mRaceTick.addParallelFor("ai.apply", [this] { return static_cast<int>(mAI.size()); }, kAIBatchSize,
+		[this](int first, int last) { applyAISteering(first, last); }, { steering });
+	const int waypoints = mRaceTick.addTask("ai.waypoints", [this] { advanceWaypoints(); }, { applySteering });
+	const int checkpoints = mRaceTick.addTask("checkpoints", [this] { detectCheckpointCrossings(); }, { control, waypoints });
+	const int positions = mRaceTick.addTask("positions", [this] { updateRacePositions(); }, { checkpoints });
+
+	// Queries only read positions, they run next to each other
+	const int playerQueries = mRaceTick.addTask("player.collision", [this] { detectPlayerCollisions(); }, { positions });
+	const int aiQueries = mRaceTick.addParallelFor("ai.collision", [this] { return static_cast<int>(mAI.size()); }, kAIBatchSize,
+		[this](int first, int last) { detectAICollisions(first, last); }, { positions });
+
+	// Resolution moves things, serial and always in the same order
+	const int playerResolution = mRaceTick.addTask("player.resolution", [this] { resolvePlayerCollisions(); }, { playerQueries, aiQueries }, JobGraph::MainThread);
+	const int aiResolution = mRaceTick.addTask("ai.resolution", [this] { resolveAICollisions(); }, { playerResolution });
+	// Snapshots for the next tick, swapped in once the graph is done
+	mRaceTick.addParallelFor("snapshots", [this] { return static_cast<int>(mAI.size()) + 1; }, kAIBatchSize,
+		[this](int first, int last) { captureVehicleStates(first, last); }, { aiResolution });
+}
+
+void DesertRacetrack::updateAILod()
+{
+	const vector<SVehicleSnapshot>& states = mVehicleStates[mReadStates];
+	const SVector2D player = states[kPlayerState].position;
 
-	// Update AI movement
-	for (HoverAI* hoverAI : mAI)
+	for (unsigned int i = 0; i < mAI.size(); i++)
 	{
-		// Rubberbanding
-		bool ahead = DesertVehicle::compare(hoverAI, racecarPtr);
+		SAILodState& lod = mAILod[i];
+		const float distance = (states[i + 1].position - player).length();
 
-		// If AI has reached its current target
-		if (hoverAI->updateScene(kGameSpeed, kDeltaTime, racecarPtr->distanceTo(hoverAI->position2D()), ahead))
+		// Move one level at a time, only once well past the threshold
+		if (lod.level == NearLod && distance > kNearLodDistance + kLodHysteresis)
 		{
- 			// Calculate next waypoint
-			unsigned int nextWaypointI = hoverAI->getWaypointIndex();
-			if (mWaypoints.size() > nextWaypointI)
-			{
-				// Set AI's next target
-				hoverAI->follow(mWaypoints[nextWaypointI]);
-			}
-			//// AI has reached the last waypoint
-			else
-			{
-				hoverAI->resetWaypoint();
-			}
+			lod.level = MidLod;
+		}
+		else if (lod.level == MidLod && distance < kNearLodDistance - kLodHysteresis)
+		{
+			lod.level = NearLod;
+		}
+		else if (lod.level == MidLod && distance > kFarLodDistance + kLodHysteresis)
+		{
+			lod.level = FarLod;
+		}
+		else if (lod.level == FarLod && distance < kFarLodDistance - kLodHysteresis)
+		{
+			lod.level = MidLod;
 		}
+
+		// Reduced rate cars are spread over the interval, a few of them steer every tick
+		lod.elapsed += mTick.deltaTime;
+		lod.steer = lod.level == NearLod || (lod.level == MidLod && (mRaceTicks + i) % kMidLodInterval == 0);
 	}
 
-	// Checkpoint crossing detection & handling
-	detectCheckpointCrossings(kDeltaTime);
+	++mRaceTicks;
+}
 
+void DesertRacetrack::steerAI(int first, int last)
+{
+	const vector<SVehicleSnapshot>& states = mVehicleStates[mReadStates];
+
+	for (int i = first; i < last; i++)
+	{
+		SAILodState& lod = mAILod[i];
+
+		// Far cars glide on the racing line instead, they are only steered if there is none
+		if (lod.steer || (lod.level == FarLod && !isOnRails(i)))
+		{
+			// Everything since the last steer is caught up at once
+			mSteering[i] = mAI[i]->steer(states[i + 1], states[kPlayerState], mTick.gameSpeed, lod.elapsed);
+			lod.elapsed = 0.0f;
+		}
+		else if (isOnRails(i))
+		{
+			// Gliding keeps the timers going, nothing is left to catch up when the car comes back
+			lod.elapsed = 0.0f;
+		}
+	}
+}
+
+void DesertRacetrack::applyAISteering(int first, int last)
+{
+	for (int i = first; i < last; i++)
+	{
+		const SAILodState& lod = mAILod[i];
+		mWaypointReached[i] = false;
+
+		if (lod.level == FarLod && mAI[i]->advanceOnLine(mTick.deltaTime))
+		{
+			continue;
+		}
+
+		if (lod.steer || lod.level == FarLod)
+		{
+			// Remember if AI has reached its current target, the next one is set serially
+			mWaypointReached[i] = mAI[i]->applySteering(mSteering[i]);
+		}
+		else
+		{
+			// Between steers the car keeps its heading and last thrust, the movement vector does the rest
+			mAI[i]->applyThrust(mSteering[i].thrust);
+		}
+	}
+}
+
+bool DesertRacetrack::isOnRails(int ai) const
+{
+	return mAILod[ai].level == FarLod && !mRacingLine.isEmpty();
+}
+
+void DesertRacetrack::captureVehicleStates(int first, int last)
+{
+	vector<SVehicleSnapshot>& states = mVehicleStates[mReadStates ^ 1];
+
+	for (int i = first; i < last; i++)
+	{
+		const DesertVehicle* vehicle = (i == kPlayerState) ? static_cast<DesertVehicle*>(racecarPtr) : mAI[i - 1];
+		states[i] = vehicle->snapshot();
+	}
+}
+
+void DesertRacetrack::swapVehicleStates()
+{
+	mReadStates ^= 1;
+}
+
+void DesertRacetrack::advanceWaypoints()
+{
+	for (unsigned int i = 0; i < mAI.size(); i++)
+	{
+		if (!mWaypointReached[i])
+		{
+			continue;
+		}
+
+		HoverAI* hoverAI = mAI[i];
+		// Calculate next waypoint
+		unsigned int nextWaypointI = hoverAI->getWaypointIndex();
+		if (mWaypoints.size() > nextWaypointI)
+		{
+			// Set AI's next target
+			hoverAI->follow(mWaypoints[nextWaypointI]);
+		}
+		//// AI has reached the last waypoint
+		else
+		{
+			hoverAI->resetWaypoint();
+		}
+	}
+}
+
+void DesertRacetrack::updateRacePositions()
+{
 	// Sort vehicles by their race position
 	sort(mVehicles.begin(), mVehicles.end(), &DesertVehicle::compare);
 
@@ -419,96 +655,129 @@ void DesertRacetrack::updateOngoingRaceScene(I3DEngine* myEngine, const float kG
 	int i = 1;
 	for (DesertVehicle* vehicle : mVehicles)
 	{
+		if (vehicle->getRacePosition() != i)
+		{
+			mRaceEvents.push(PositionChanged, getVehicleIndex(vehicle), i);
+		}
 		vehicle->setRacePosition(i);
 		i++;
 	}
+}
 
-	/** First, detect collision for
-	* - Player
-	* - AI
-	*
-	* Against
+void DesertRacetrack::detectPlayerCollisions()
+{
+	// To avoid cancelling the car's vector twice, therefore not cancelling it at all,
+	// only count one collision per frame
+	mCarHasCollided = false;
+	mReverseAxis = Collision::CollisionAxis::None;
+
+	/** Detect collision for the player against
 	*
 	* - Walls
 	* - Tanks
 	* - Struts of checkpoints
-	* - AI (yes, AI against AI too)
+	* - AI
 	*/
 	for (CollisionModel* node : mCollisionNodes)
 	{
 		Collision::CollisionAxis axis = node->collision(racecarPtr->position2D(), racecarPtr->getCollisionRadius(), true);
 
 		// Test for collision
-		if (!carHasCollided && axis == Collision::CollisionAxis::Both)
+		if (!mCarHasCollided && axis == Collision::CollisionAxis::Both)
 		{
-			reverseAxis = node->getNewCollisionAxis();
-			carHasCollided = true;
+			mReverseAxis = node->getNewCollisionAxis();
+			mCarHasCollided = true;
 
 			if (!node->isFixed())
 			{
 				node->modifyMovementVector(racecarPtr->getMovementVector());
 			}
 		}
+	}
+}
+
+void DesertRacetrack::detectAICollisions(int first, int last)
+{
+	// Same nodes as the player (AI against AI too), each job only touches its own cars
+	for (int i = first; i < last; i++)
+	{
+		HoverAI* hoverAI = mAI[i];
+
+		// Far cars are moved along the line, collisions would be undone anyway
+		if (isOnRails(i))
+		{
+			continue;
+		}
 
-		for (HoverAI* hoverAI : mAI)
+		for (const CollisionModel* node : mCollisionNodes)
 		{
-			if (node != hoverAI && node->collision(hoverAI->position2D(), hoverAI->getCollisionRadius()) == Collision::CollisionAxis::Both)
+			if (node != hoverAI && node->test(hoverAI->position2D(), hoverAI->getCollisionRadius()) == Collision::CollisionAxis::Both)
 			{
 				hoverAI->setCollided();
+				// Further hits change nothing until the invulnerability ends
+				break;
 			}
 		}
 	}
+}
 
-	/**
-	* Now, handle collision effects
-	*/
+void DesertRacetrack::resolvePlayerCollisions()
+{
 	// Only count damages if non contiguous
-
-	if (carHasCollided)
+	if (mCarHasCollided)
 	{
 		// Threshold
 		if (racecarPtr->speedOverCollisionThreshold() && !carCollidedLastFrame) {
-			// Reduce health, update UI
 			racecarPtr->reduceHealth();
-			updateHealthInUI();
+			mRaceEvents.push(VehicleDamaged, kPlayerState, racecarPtr->getHealth());
 
 			// If car has no more health, stop race
 			if (!racecarPtr->getHealth())
 			{
 				raceState = Over;
-				uiPtr->displayText("Your car is done for :(", false, 0, "Press R to Restart :)");
 			}
 		}
 
 		
 		// Cancel vector out
-		racecarPtr->bounce(reverseAxis);
+		racecarPtr->bounce(mReverseAxis);
 	}
 
 	// After possibly cancelling movement vector out, apply result
-	racecarPtr->applyMovementVector(kDeltaTime);
+	racecarPtr->applyMovementVector(mTick.deltaTime);
+	carCollidedLastFrame = mCarHasCollided;
+}
 
-	// Handle AI collisions
-	for (HoverAI* hoverAI : mAI)
+void DesertRacetrack::resolveAICollisions()
+{
+	for (unsigned int i = 0; i < mAI.size(); i++)
 	{
+		HoverAI* hoverAI = mAI[i];
+
+		// Already moved along the racing line
+		if (isOnRails(i))
+		{
+			continue;
+		}
+
 		if (hoverAI->hasCollided())
 		{
 			// Cancel AI vector
 			hoverAI->bounce();
 			hoverAI->reduceHealth();
+			mRaceEvents.push(VehicleDamaged, i + 1, hoverAI->getHealth());
 		}
 
 		// Apply movement vector result
-		hoverAI->applyMovementVector(kDeltaTime);
+		hoverAI->applyMovementVector(mTick.deltaTime);
 		hoverAI->resetCollided();
 	}
-
-	updateUI();
-	carCollidedLastFrame = carHasCollided;
 }
 
 void DesertRacetrack::reset()
 {
+	mTimers.cancel(mCountdownTimer);
+	mRaceEvents.clear();
 	// Reset car position and movement
 	racecarPtr->reset();
 	// Reset UI
@@ -526,6 +795,277 @@ void DesertRacetrack::reset()
 		ai->reset();
 		ai->follow(mWaypoints.front());
 	}
+
+	// No lap is being recorded, the ghost waits for the first one
+	mGhostRecorder.discard();
+	hideGhost();
+
+	// Every car starts at full detail on the grid
+	mAILod.assign(mAI.size(), SAILodState());
+	mRaceTicks = 0;
+	// Nothing to rewind to
+	mSnapshots.clear();
+
+	// Steering must not see the cars where they were before the reset
+	captureVehicleStates(0, mAI.size() + 1);
+	swapVehicleStates();
+}
+
+const uint32_t DesertRacetrack::kSnapshotMagic = 0x53525244;
+const uint32_t DesertRacetrack::kSnapshotVersion = 1;
+
+void DesertRacetrack::saveSnapshot(vector<char>& buffer) const
+{
+	SnapshotWriter writer(buffer);
+
+	// What the snapshot fits: same version, same number of everything
+	writer.write(kSnapshotMagic);
+	writer.write(kSnapshotVersion);
+	writer.write(static_cast<uint32_t>(mCollisionNodes.size()));
+	writer.write(static_cast<uint32_t>(mAI.size()));
+	writer.write(static_cast<uint32_t>(mParticles.size()));
+
+	// Race
+	writer.write(raceState);
+	writer.write(raceElapsed);
+	writer.write(carCollidedLastFrame);
+	writer.write(mCarHasCollided);
+	writer.write(mReverseAxis);
+	writer.write(mRaceTicks);
+	writer.write(mReadStates);
+	// Ticks recorded so far, what is raced after a rewind replaces the rest
+	writer.write(mRecording.getTicksNumber());
+	writer.writeArray(mAILod);
+	writer.writeArray(mSteering);
+	writer.writeArray(mWaypointReached);
+	writer.writeArray(mVehicleStates[0]);
+	writer.writeArray(mVehicleStates[1]);
+
+	// Race order, as indices (the player is 0, AI i is i + 1)
+	for (const DesertVehicle* vehicle : mVehicles)
+	{
+		const int index = (vehicle == racecarPtr) ? 0 : static_cast<int>(find(mAI.begin(), mAI.end(), vehicle) - mAI.begin()) + 1;
+		writer.write(index);
+	}
+
+	// Scene objects, AI and checkpoints are collision nodes too
+	racecarPtr->saveState(writer);
+	for (const CollisionModel* node : mCollisionNodes)
+	{
+		node->saveState(writer);
+	}
+	for (const ParticleSystem* system : mParticles)
+	{
+		system->saveState(writer);
+	}
+	mTransforms.saveState(writer);
+}
+
+bool DesertRacetrack::restoreSnapshot(const vector<char>& buffer)
+{
+	const auto start = chrono::steady_clock::now();
+	SnapshotReader reader(buffer);
+
+	uint32_t magic = 0, version = 0, nodes = 0, ai = 0, particles = 0;
+	reader.read(magic);
+	reader.read(version);
+	reader.read(nodes);
+	reader.read(ai);
+	reader.read(particles);
+
+	if (!reader.isGood() || magic != kSnapshotMagic || version != kSnapshotVersion ||
+		nodes != mCollisionNodes.size() || ai != mAI.size() || particles != mParticles.size())
+	{
+		cout << "Snapshot does not fit this race" << endl;
+		return false;
+	}
+
+	reader.read(raceState);
+	reader.read(raceElapsed);
+	reader.read(carCollidedLastFrame);
+	reader.read(mCarHasCollided);
+	reader.read(mReverseAxis);
+	reader.read(mRaceTicks);
+	reader.read(mReadStates);
+	int recordedTicks = 0;
+	reader.read(recordedTicks);
+	mRecording.truncate(recordedTicks);
+	reader.readArray(mAILod);
+	reader.readArray(mSteering);
+	reader.readArray(mWaypointReached);
+	reader.readArray(mVehicleStates[0]);
+	reader.readArray(mVehicleStates[1]);
+
+	for (DesertVehicle*& vehicle : mVehicles)
+	{
+		int index = 0;
+		reader.read(index);
+		vehicle = index ? static_cast<DesertVehicle*>(mAI[index - 1]) : racecarPtr;
+	}
+
+	racecarPtr->loadState(reader);
+	for (CollisionModel* node : mCollisionNodes)
+	{
+		node->loadState(reader);
+	}
+	for (ParticleSystem* system : mParticles)
+	{
+		system->loadState(reader);
+	}
+	mTransforms.loadState(reader);
+
+	// Headers matched, so only a bug can get here
+	if (!reader.isGood())
+	{
+		cout << "Snapshot is truncated, the race state is now undefined" << endl;
+	}
+
+	// Text the tick would have updated
+	updateUI();
+	updateLapsInUI();
+	updateHealthInUI();
+	updatePositionInUI();
+
+	mSnapshotStats.restoreSeconds += chrono::duration<double>(chrono::steady_clock::now() - start).count();
+	++mSnapshotStats.restored;
+	return reader.isGood();
+}
+
+bool DesertRacetrack::rewind()
+{
+	if (!mSnapshots.getCount())
+	{
+		return false;
+	}
+
+	unsigned int tick = 0;
+	const vector<char>* snapshot = mSnapshots.find(mSnapshots.getOldestTick(), tick);
+	if (!snapshot || !restoreSnapshot(*snapshot))
+	{
+		return false;
+	}
+
+	// What came after it never happened
+	mSnapshots.discardAfter(tick);
+	return true;
+}
+
+void DesertRacetrack::updateGhost(float time, int previousLap)
+{
+	const float heading = HoverAI::headingOf(racecarPtr->getFacingVector2D());
+	mGhostRecorder.record(time, racecarPtr->position2D(), heading);
+
+	// Crossed the start: the lap driven ends (there is none before the first crossing) and the next one starts
+	const int lap = racecarPtr->getCurrentLap();
+	if (lap != previousLap)
+	{
+		GhostPath lapPath;
+		if (mGhostRecorder.finish(lapPath) && (mGhost.isEmpty() || lapPath.getDuration() < mGhost.getDuration()))
+		{
+			mGhost = lapPath;
+			const string ghostFilename = mSceneSetupFilename + GhostPath::kFileExtension;
+			if (mGhost.save(ghostFilename))
+			{
+				cout << "Best lap (" << mGhost.getDuration() << "s) saved to " << ghostFilename << " as " << mGhost.getKeyframesNumber()
+					<< " keyframes in " << mGhost.getEncodedBytes() << " bytes" << endl;
+			}
+		}
+
+		hideGhost();
+		if (lap <= kLaps && raceState == Transcurring)
+		{
+			mGhostRecorder.begin(time);
+			mGhostRecorder.record(time, racecarPtr->position2D(), heading);
+			mGhostLapStart = time;
+		}
+	}
+
+	// No physics, the pose is interpolated from the best lap's keyframes
+	if (raceState != Transcurring)
+	{
+		hideGhost();
+	}
+	else if (mGhostCar && mGhostLapStart >= 0.0f && !mGhost.isEmpty())
+	{
+		const SGhostPose pose = mGhost.getPose(time - mGhostLapStart);
+		mGhostCar->setPositionByVector({ pose.position.x, HoverCar::kDefaultTuning.kModelYOffset, pose.position.y });
+		mGhostCar->setRotationY(pose.heading);
+	}
+}
+
+void DesertRacetrack::hideGhost()
+{
+	mGhostLapStart = -1.0f;
+	if (mGhostCar)
+	{
+		mGhostCar->setY(kGhostHiddenY);
+	}
+}
+
+void DesertRacetrack::countdown(int secondsLeft)
+{
+	if (secondsLeft)
+	{
+		// Display seconds remaining for a second
+		uiPtr->displayText(to_string(secondsLeft), false, 1);
+		mCountdownTimer = mTimers.schedule(1.0f, [this, secondsLeft] { countdown(secondsLeft - 1); });
+		return;
+	}
+
+	// Display go indefinitely
+	mCountdownTimer = TimerWheel::kNoTimer;
+	uiPtr->displayText("Go!", false, 0);
+	uiPtr->togglePosition(true);
+	// Race has started, update state
+	raceState = Transcurring;
+	mRecording.begin(mSceneSetupFilename, mRandom.getMasterSeed(), kLaps);
+}
+
+bool DesertRacetrack::streamTelemetry(const string& target)
+{
+	return mTelemetry.open(target);
+}
+
+void DesertRacetrack::publishTelemetry()
+{
+	if (!mTelemetry.isOpen())
+	{
+		return;
+	}
+
+	// The snapshots just captured, the player first and then every AI
+	const vector<SVehicleSnapshot>& states = mVehicleStates[mReadStates];
+	for (unsigned int i = 0; i < states.size(); i++)
+	{
+		DesertVehicle* vehicle = getVehicle(i);
+		STelemetrySample sample;
+		sample.tick = mRaceTicks;
+		sample.time = raceElapsed;
+		sample.x = states[i].position.x;
+		sample.z = states[i].position.y;
+		sample.velocityX = states[i].movement.x;
+		sample.velocityZ = states[i].movement.y;
+		sample.health = i ? mAI[i - 1]->getHealth() : racecarPtr->getHealth();
+		sample.stage = states[i].stage;
+		sample.vehicle = static_cast<uint8_t>(i);
+		sample.boostState = static_cast<uint8_t>(i ? HoverCar::Inactive : racecarPtr->getBoostState());
+		sample.racePosition = static_cast<uint8_t>(vehicle->getRacePosition());
+		mTelemetry.publish(sample);
+	}
+}
+
+int DesertRacetrack::getVehicleIndex(const DesertVehicle* vehicle) const
+{
+	if (vehicle == racecarPtr)
+	{
+		return kPlayerState;
+	}
+	return static_cast<int>(find(mAI.begin(), mAI.end(), vehicle) - mAI.begin()) + 1;
+}
+
+DesertVehicle* DesertRacetrack::getVehicle(int index) const
+{
+	return index ? static_cast<DesertVehicle*>(mAI[index - 1]) : racecarPtr;
 }
 
 ICamera* DesertRacetrack::getCamera()
@@ -538,6 +1078,11 @@ int DesertRacetrack::getStagesNumber() const
 	return mCheckpoints.size();
 }
 
+const CollisionWorld& DesertRacetrack::getCollisionWorld() const
+{
+	return mCollisionWorld;
+}
+
 ////////////////////
 // UI
 ////////////////////
@@ -574,7 +1119,6 @@ void DesertRacetrack::updateUI()
 
 	// Update speed
 	uiPtr->setSpeedText(to_string(kmPerH) + "km/h");
-	uiPtr->setRacePosition(racecarPtr->getRacePosition());
 }
 
 void DesertRacetrack::updateLapsInUI()
@@ -587,10 +1131,87 @@ void DesertRacetrack::updateHealthInUI()
 	uiPtr->setHealthText(to_string(racecarPtr->getHealth()));
 }
 
+void DesertRacetrack::updatePositionInUI()
+{
+	uiPtr->setRacePosition(racecarPtr->getRacePosition());
+}
+
+void DesertRacetrack::presentRaceEvents(const vector<SRaceEvent>& events)
+{
+	for (const SRaceEvent& event : events)
+	{
+		const bool player = event.vehicle == kPlayerState;
+
+		switch (event.type)
+		{
+		case StageCrossed:
+			if (player)
+			{
+				// Display cross
+				mCheckpoints[event.value]->setCrossed();
+
+				// Other checkpoint or it's the first lap (a lap has its own dialog)
+				if (event.value || event.lap == 1)
+				{
+					// Show stage completion dialog
+					uiPtr->displayText("Stage " + to_string(event.stage) + " complete", false, 1.0f);
+				}
+			}
+			break;
+		case LapCompleted:
+			if (player)
+			{
+				string lapDisplayText = "Final Lap";
+
+				if (event.lap != kLaps)
+				{
+					lapDisplayText = "Lap " + to_string(event.lap);
+				}
+
+				// Update UI
+				uiPtr->displayText(lapDisplayText, false, 1.0f);
+				updateLapsInUI();
+			}
+			break;
+		case RaceFinished:
+			uiPtr->toggleSummary(true);
+			uiPtr->setSummaryTime(to_string(event.time));
+			uiPtr->setSummaryWinner(getVehicle(event.vehicle)->getTag());
+
+			if (player)
+			{
+				// Update UI
+				uiPtr->displayText("Race finished", true, 0, "Press R to Restart, Esc to Exit");
+				uiPtr->toggleLapSprite(false);
+			}
+			break;
+		case VehicleDamaged:
+			if (player)
+			{
+				updateHealthInUI();
+
+				// The race is over with the car
+				if (!event.value)
+				{
+					uiPtr->displayText("Your car is done for :(", false, 0, "Press R to Restart :)");
+				}
+			}
+			break;
+		case PositionChanged:
+			if (player)
+			{
+				updatePositionInUI();
+			}
+			break;
+		}
+	}
+}
+
 void DesertRacetrack::resetDialog()
 {
 	uiPtr->displayText("Hit Space to Start", false, 0);
 	updateHealthInUI();
+	updatePositionInUI();
 	uiPtr->setLapText("1/" + to_string(kLaps));
 	uiPtr->togglePosition(false);
 	uiPtr->toggleSummary(false);
@@ -11,6 +11,7 @@
 
 #include <TL-Engine.h>
 #include <string>
+#include <unordered_map>
 #include "checkpoint.h"
 #include "scenery.h"
 #include "racecar.h"
@@ -18,6 +19,18 @@
 #include "ai.h"
 #include "vehicle.h"
 #include "particle.h"
+#include "rng.h"
+#include "transform.h"
+#include "jobs.h"
+#include "racingline.h"
+#include "flowfield.h"
+#include "collisionworld.h"
+#include "replay.h"
+#include "snapshot.h"
+#include "ghost.h"
+#include "telemetry.h"
+#include "timerwheel.h"
+#include "raceevents.h"
 
 
 namespace desert
@@ -42,8 +55,9 @@ namespace desert
         * @param myEngine Pointer to TL-Engine running instance
         * @param sceneSetupFilename File containing models / positioning
         * @param controlKeybind Control keybind
+        * @param raceSeed Master seed for all randomness in the race (same seed, same race)
         */
-        DesertRacetrack(tle::I3DEngine* myEngine, string sceneSetupFilename, SControlKeybinding controlKeybind);
+        DesertRacetrack(tle::I3DEngine* myEngine, string sceneSetupFilename, SControlKeybinding controlKeybind, uint64_t raceSeed = RandomService::generateSeed());
         // Destroy racetrack, free memory
         ~DesertRacetrack();
         
@@ -62,10 +76,28 @@ namespace desert
         void updateScene(tle::I3DEngine* myEngine, const float kGameSpeed, const float kDeltaTime);
 
         // Detect and handle checkpoint crossings (collisions)
-        void detectCheckpointCrossings(const float kDeltaTime);
+        void detectCheckpointCrossings();
 
         // Reset scene to initial setup
         void reset();
+
+        /**
+        * Write every piece of mutable race state (cars, AI, checkpoints, particles, transforms, timers)
+        * into a flat buffer, engine pointers excluded
+        */
+        void saveSnapshot(std::vector<char>& buffer) const;
+        /**
+        * Put the race back as it was when a snapshot was taken
+        * @return False if the snapshot is from another version or track (nothing is restored then)
+        */
+        bool restoreSnapshot(const std::vector<char>& buffer);
+        // Go back to the oldest tick kept in the snapshot ring
+        bool rewind();
+        /**
+        * Publish every vehicle's state each race tick
+        * @param target File name or TelemetryStream::kSocketPrefix + socket path
+        */
+        bool streamTelemetry(const std::string& target);
         // Reset UI to initial layout
         void resetDialog();
 
@@ -74,20 +106,78 @@ namespace desert
 
         // Returns number of checkpoints loaded (or stages per lap)
         int getStagesNumber() const;
+        // Static obstacles, for sensor ray casts
+        const CollisionWorld& getCollisionWorld() const;
 
         HoverCar* racecarPtr;
         RaceState raceState = NotStarted;
 
+        // Models with special meaning in setup files
+        static const std::string kBarrelModelName;
+        // Invisible markers the AI drive through
+        static const std::string kWaypointModelName;
+        // Collision Radiuses of sphere-shaped models
+        static const std::unordered_map<std::string, float> kCustomCollisionRadius;
+
     protected:
-        // Detect collisions between objects, handle user input, etc
-        void updateOngoingRaceScene(tle::I3DEngine* myEngine, const float kGameSpeed, const float kDeltaTime);
+        // Build the stages of an idle / race frame (once, after loading)
+        void buildTickGraphs();
+        // Plan / simulate particles, returns the plan stage
+        int addParticleStages(JobGraph& graph);
+
+        // RACE TICK STAGES //
+
+        // Choose the simulation level of every AI from its distance to the player
+        void updateAILod();
+        // Steer AI [first, last) towards their waypoints (reads snapshots only)
+        void steerAI(int first, int last);
+        // Write the steering of AI [first, last) to the cars
+        void applyAISteering(int first, int last);
+        // Give the next waypoint to the AI that reached theirs
+        void advanceWaypoints();
+        // Sort vehicles and store their race position
+        void updateRacePositions();
+        // Find the first node the player collides with (saves collision axes)
+        void detectPlayerCollisions();
+        // Far AI glide along the racing line, no physics / collisions
+        bool isOnRails(int ai) const;
+        // Flag AI [first, last) colliding with any node (read only queries)
+        void detectAICollisions(int first, int last);
+        // Damage / bounce / move the player
+        void resolvePlayerCollisions();
+        // Damage / bounce / move the AI
+        void resolveAICollisions();
+        // Snapshot vehicles [first, last) (player first, then AI) into the write buffer
+        void captureVehicleStates(int first, int last);
+        // Written snapshots become the ones read next tick
+        void swapVehicleStates();
 
+        /**
+        * Record the player's lap, keep it if it is the best of the track and move the ghost along the best lap
+        * @param time Race time at the end of the tick
+        * @param previousLap Player's lap before the tick
+        */
+        void updateGhost(float time, int previousLap);
+        // Ghost out of sight until the player starts a lap
+        void hideGhost();
+        // Show a second of the countdown and wait for the next, the race starts after the last
+        void countdown(int secondsLeft);
+        // Every vehicle's state at the end of the tick, to the telemetry writer
+        void publishTelemetry();
+        // 0 for the player, AI i is i + 1
+        int getVehicleIndex(const DesertVehicle* vehicle) const;
+        DesertVehicle* getVehicle(int index) const;
+
+        // Dialogs, HUD and crosses for the events of a tick
+        void presentRaceEvents(const std::vector<SRaceEvent>& events);
         // Update UI based on current racecar status (boost indicators, speed)
         void updateUI();
         // Update health (only called when car is damaged)
         void updateHealthInUI();
         // Update laps (only called when car completes a lap)
         void updateLapsInUI();
+        // Update place (only called when the player's position changes)
+        void updatePositionInUI();
 
         const SVector3D kFollowCamPosition;
         const SVector3D kFollowCamRotation = { 10, 0, 0 };
@@ -109,6 +199,8 @@ namespace desert
         const float kSkyboxInitialY = -960;
         // Easter egg initial Y
         const float kCubeInitialY = 5;
+        // Where the ghost waits when it is not racing
+        const float kGhostHiddenY = -50;
 
         // Number of seconds to countdown before race starts
         const int kSecondsBeforeRace = 3;
@@ -116,38 +208,50 @@ namespace desert
         // Total number of laps
         const int kLaps = 3;
 
+        // Race ticks kept for rewinding (a few seconds)
+        static const int kSnapshotTicks = 180;
+        static const uint32_t kSnapshotMagic;
+        static const uint32_t kSnapshotVersion;
+
         const int kSecsInAnHour = 60 * 60;
         const int kMetersInKm = 1000;
 
-        const tle::EKeyCode kFollowCamKey = tle::Key_1;
-        const tle::EKeyCode kPovCamKey = tle::Key_2;
+        // AI cars per job in parallel stages
+        const int kAIBatchSize = 8;
 
+        // AI level of detail, by distance to the player
+        enum AILod
+        {
+            // Steering, physics and collision every tick
+            NearLod,
+            // Steering every kMidLodInterval ticks, movement and collision every tick
+            MidLod,
+            // Glides along the racing line, no steering / physics / collision
+            FarLod
+        };
+        const float kNearLodDistance = 150.0f;
+        const float kFarLodDistance = 400.0f;
+        // Cars must get this much past a threshold to change level, so they do not flicker between two
+        const float kLodHysteresis = 25.0f;
+        const int kMidLodInterval = 3;
 
-        enum Setup
+        struct SAILodState
         {
-            XIndex = 1,
-            ZIndex = 2,
-            YRotIndex = 3,
-            YIndex = 4,
-            XRotIndex = 5,
-            ZRotIndex = 6,
-            ScaleIndex = 7
+            AILod level = NearLod;
+            // Time since the car was last steered
+            float elapsed = 0.0f;
+            // Whether it is steered this tick
+            bool steer = true;
         };
 
-        const std::string barrelModel = "Barrel";
-        const std::string dummyThiccModel = "Dummy";
+        const tle::EKeyCode kFollowCamKey = tle::Key_1;
+        const tle::EKeyCode kPovCamKey = tle::Key_2;
+
 
         const SVector3D barrelOffset = { 0, 8, 0 };
 
-        // Collision Radiuses
-        std::unordered_map<std::string, float> kCustomCollisionRadius
-        {
-            { "Snowman", 8.0f },
-            { "Moon", 173.0f },
-            { "Barrel", 2.4f },
-            { "TankSmall1", 1.8f },
-            { "TankSmall2", 1.8f }
-        };
+        // Sets the ghost apart from the player and the AI
+        const std::string kGhostSkin = "Gold.png";
 
         std::vector<std::string> racecarSkins
         {
@@ -167,13 +271,76 @@ namespace desert
         std::vector<tle::IModel*> mScenery;
         // AI & waypoints
         std::vector<HoverAI*> mAI;
-        std::vector<tle::IModel*> mWaypoints;
+        std::vector<SVector2D> mWaypoints;
+        // Line the AI follow, built from the waypoints / checkpoints
+        RacingLine mRacingLine;
+        // Way to each checkpoint around the static obstacles
+        FlowField mFlowField;
+        // Static obstacles bucketed for ray casts
+        CollisionWorld mCollisionWorld;
+        // Filled by AI steering, one flag per AI
+        std::vector<char> mWaypointReached;
+        // Steering decided this tick, one per AI (kept between steers of reduced rate cars)
+        std::vector<HoverAI::SSteering> mSteering;
+        std::vector<SAILodState> mAILod;
+        // Ticks run, staggers the reduced rate cars
+        unsigned int mRaceTicks = 0;
+        // Vehicle snapshots, the player and then every AI, double buffered:
+        // steering reads last tick's while this tick's are written
+        std::vector<SVehicleSnapshot> mVehicleStates[2];
+        int mReadStates = 0;
+        static const int kPlayerState = 0;
         // Numbering
         std::vector<int> mOrdinals;
         std::vector<DesertVehicle*> mVehicles;
 
         // Particle Systems
         std::vector<ParticleSystem*> mParticles;
+        // Caps the particles / updates of all systems above
+        ParticleBudget mParticleBudget;
+
+        // Source of every random stream used in the race
+        RandomService mRandom;
+        // Player input of the race being run, saved next to the track when it is over
+        InputRecording mRecording;
+        // Snapshot of every recent race tick
+        SnapshotRing mSnapshots = SnapshotRing(kSnapshotTicks);
+        // Snapshot / restore cost, reported when the track is destroyed
+        struct SSnapshotStats
+        {
+            long long taken = 0, restored = 0;
+            double takeSeconds = 0.0, restoreSeconds = 0.0;
+            size_t bytes = 0;
+        };
+        SSnapshotStats mSnapshotStats;
+        // Player's lap being driven, and the best lap of the track the ghost replays
+        GhostRecorder mGhostRecorder;
+        GhostPath mGhost;
+        // Ghost model, a racecar without any physics / collisions
+        SceneNodeContainer* mGhostCar = nullptr;
+        // Race time the ghost's lap started at, negative while it is hidden
+        float mGhostLapStart = -1.0f;
+        // Written by a thread of its own, the race never waits for it
+        TelemetryStream mTelemetry;
+        // Pushed by the race tick, presented once it is done
+        RaceEventQueue mRaceEvents;
+        const std::string mSceneSetupFilename;
+
+        // CPU-side transforms of vehicles / collision nodes / particles, submitted once per tick
+        TransformMirror mTransforms;
+
+        // Parameters of the frame being run by the tick graphs
+        struct STick
+        {
+            tle::I3DEngine* engine;
+            float gameSpeed;
+            float deltaTime;
+        };
+        STick mTick = {};
+
+        // Worker threads and the frame stages they run
+        JobSystem mJobs;
+        JobGraph mIdleTick, mRaceTick;
 
         // User interface (sprites / dialog)
         GameUI* uiPtr = nullptr;
@@ -186,10 +353,10 @@ namespace desert
 
         Collision::CollisionAxis mLastCollisionAxis;
 
-        // Start timer
-        float timeElapsed = 0.0f;
-        // Start countdown
-        int secondsElapsed = 0;
+        // Crosses, dialogs and the countdown, advanced once per frame
+        TimerWheel mTimers;
+        // Next second of the countdown
+        TimerWheel::TimerId mCountdownTimer = TimerWheel::kNoTimer;
 
         // Race timer
         float raceElapsed = 0.0f;
@@ -199,6 +366,9 @@ namespace desert
         // The car receives no further damage for any
         // additional frames it is in collision with something
         bool carCollidedLastFrame = false;
+        // Player collision found this frame and the axis to bounce on
+        bool mCarHasCollided = false;
+        Collision::CollisionAxis mReverseAxis = Collision::CollisionAxis::None;
     };
 }
 
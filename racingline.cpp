@@ -0,0 +1,420 @@
+/**
+ * @file racingline.cpp
+ * Smoothed racing line with a target speed profile, solved once per track
+ *
+ * @author Jacob Sanchez Perez (G20812080) <jsanchez-perez@uclan.ac.uk>
+ * Games Concepts (CO1301), University of Central Lancashire
+ */
+
+#include <iostream>
+#include <fstream>
+#include <cmath>
+#include <algorithm>
+#include "vector.h"
+#include "racingline.h"
+
+using namespace std;
+using namespace desert;
+
+const SRacingLineTuning RacingLine::kDefaultTuning = {};
+const string RacingLine::kCacheExtension = ".line";
+// "DRRL"
+const uint32_t RacingLine::kFileMagic = 0x4C525244;
+const uint32_t RacingLine::kFileVersion = 1;
+constexpr float RacingLine::kMergeDistance;
+
+
+bool RacingLine::loadOrBuild(const string& trackFilename, const vector<SVector2D>& waypoints, const vector<SVector2D>& checkpoints,
+	const SRacingLineTuning* tuning)
+{
+	const string cacheFilename = trackFilename + kCacheExtension;
+
+	if (load(cacheFilename, hashInput(waypoints, checkpoints, tuning)))
+	{
+		cout << "Racing line loaded from " << cacheFilename << endl;
+		return !isEmpty();
+	}
+
+	build(waypoints, checkpoints, tuning);
+
+	if (!isEmpty() && save(cacheFilename))
+	{
+		cout << "Racing line solved and saved to " << cacheFilename << endl;
+	}
+
+	return !isEmpty();
+}
+
+void RacingLine::build(const vector<SVector2D>& waypoints, const vector<SVector2D>& checkpoints, const SRacingLineTuning* tuning)
+{
+	mPoints.clear();
+	mSpeeds.clear();
+	mCurvatures.clear();
+	mSpacing = tuning->kSpacing;
+	mInputHash = hashInput(waypoints, checkpoints, tuning);
+
+	vector<char> pinnedControl;
+	const vector<SVector2D> control = controlPoints(waypoints, checkpoints, pinnedControl);
+	const int controlNumber = static_cast<int>(control.size());
+
+	if (controlNumber < kMinControlPoints)
+	{
+		return;
+	}
+
+	// Catmull-Rom spline through every control point
+	vector<SVector2D> spline;
+	vector<char> pinned;
+	for (int i = 0; i < controlNumber; i++)
+	{
+		const SVector2D p0 = control[(i + controlNumber - 1) % controlNumber];
+		const SVector2D p1 = control[i];
+		const SVector2D p2 = control[(i + 1) % controlNumber];
+		const SVector2D p3 = control[(i + 2) % controlNumber];
+
+		for (int step = 0; step < tuning->kSplineSteps; step++)
+		{
+			const float t = static_cast<float>(step) / tuning->kSplineSteps;
+			const float t2 = t * t, t3 = t2 * t;
+
+			spline.push_back((p1 * 2.0f + (p2 - p0) * t + (p0 * 2.0f - p1 * 5.0f + p2 * 4.0f - p3) * t2 + (p1 * 3.0f - p0 - p2 * 3.0f + p3) * t3) * 0.5f);
+			// Checkpoints must be crossed, the line stays on them
+			pinned.push_back(step == 0 && pinnedControl[i]);
+		}
+	}
+
+	// Relax the line: every point moves towards the middle of its neighbours, cutting corners,
+	// but never further than kMaxOffset from the spline
+	vector<SVector2D> line = spline, relaxed = spline;
+	const int splineNumber = static_cast<int>(spline.size());
+	const float maxOffsetSquared = tuning->kMaxOffset * tuning->kMaxOffset;
+
+	for (int pass = 0; pass < tuning->kSmoothingPasses; pass++)
+	{
+		for (int i = 0; i < splineNumber; i++)
+		{
+			if (pinned[i])
+			{
+				relaxed[i] = line[i];
+				continue;
+			}
+
+			const SVector2D middle = (line[(i + splineNumber - 1) % splineNumber] + line[(i + 1) % splineNumber]) * 0.5f;
+			SVector2D moved = line[i] + (middle - line[i]) * tuning->kSmoothingWeight;
+			SVector2D offset = moved - spline[i];
+
+			if (offset.lengthSquared() > maxOffsetSquared)
+			{
+				moved = spline[i] + offset.unit() * tuning->kMaxOffset;
+			}
+			relaxed[i] = moved;
+		}
+		line.swap(relaxed);
+	}
+
+	mPoints = resample(line, mSpacing);
+	buildSpeedProfile(tuning);
+}
+
+vector<SVector2D> RacingLine::controlPoints(const vector<SVector2D>& waypoints, const vector<SVector2D>& checkpoints, vector<char>& pinned)
+{
+	vector<SVector2D> control = waypoints;
+	pinned.assign(control.size(), false);
+
+	if (control.size() < 2)
+	{
+		return control;
+	}
+
+	for (const SVector2D& checkpoint : checkpoints)
+	{
+		// Segment of the loop the checkpoint is closest to
+		int bestSegment = 0;
+		float bestDistance = -1.0f;
+		const int number = static_cast<int>(control.size());
+
+		for (int i = 0; i < number; i++)
+		{
+			const SVector2D a = control[i], b = control[(i + 1) % number];
+			const SVector2D ab = b - a;
+			const float lengthSquared = ab.lengthSquared();
+			const float t = lengthSquared > 0 ? max(0.0f, min(1.0f, (checkpoint - a).dot(ab) / lengthSquared)) : 0.0f;
+			const float distance = (checkpoint - (a + ab * t)).lengthSquared();
+
+			if (bestDistance < 0 || distance < bestDistance)
+			{
+				bestDistance = distance;
+				bestSegment = i;
+			}
+		}
+
+		// Replace a waypoint sitting on the checkpoint, otherwise add one
+		const int next = (bestSegment + 1) % number;
+		if ((control[bestSegment] - checkpoint).lengthSquared() <= kMergeDistance * kMergeDistance)
+		{
+			control[bestSegment] = checkpoint;
+			pinned[bestSegment] = true;
+		}
+		else if ((control[next] - checkpoint).lengthSquared() <= kMergeDistance * kMergeDistance)
+		{
+			control[next] = checkpoint;
+			pinned[next] = true;
+		}
+		else
+		{
+			control.insert(control.begin() + bestSegment + 1, checkpoint);
+			pinned.insert(pinned.begin() + bestSegment + 1, true);
+		}
+	}
+
+	return control;
+}
+
+vector<SVector2D> RacingLine::resample(const vector<SVector2D>& points, const float spacing)
+{
+	vector<SVector2D> samples;
+	const int number = static_cast<int>(points.size());
+
+	if (!number || spacing <= 0)
+	{
+		return samples;
+	}
+
+	samples.push_back(points[0]);
+	// Distance left to walk before the next sample
+	float nextSample = spacing;
+
+	for (int i = 0; i < number; i++)
+	{
+		SVector2D a = points[i];
+		const SVector2D b = points[(i + 1) % number];
+		float segment = (b - a).length();
+
+		while (segment >= nextSample)
+		{
+			a = a + (b - a) * (nextSample / segment);
+			samples.push_back(a);
+			segment -= nextSample;
+			nextSample = spacing;
+		}
+		nextSample -= segment;
+	}
+
+	// The last sample is too close to the first one to be kept (the loop closes there)
+	if (samples.size() > 1 && (samples.back() - samples.front()).length() < spacing * 0.5f)
+	{
+		samples.pop_back();
+	}
+
+	return samples;
+}
+
+float RacingLine::curvature(SVector2D a, SVector2D b, SVector2D c)
+{
+	// k = 1 / R = 4 * area / (|ab| * |bc| * |ca|)
+	const SVector2D ab = b - a, bc = c - b, ca = a - c;
+	const float doubleArea = fabs(ab.x * bc.y - ab.y * bc.x);
+	const float sides = ab.length() * bc.length() * ca.length();
+	return sides > 0 ? 2.0f * doubleArea / sides : 0.0f;
+}
+
+void RacingLine::buildSpeedProfile(const SRacingLineTuning* tuning)
+{
+	const int number = getSamplesNumber();
+	mCurvatures.resize(number);
+	mSpeeds.resize(number);
+
+	// Fastest speed each corner allows
+	for (int i = 0; i < number; i++)
+	{
+		const int span = max(1, min(tuning->kCurvatureSpan, (number - 1) / 2));
+		mCurvatures[i] = curvature(mPoints[wrapIndex(i - span)], mPoints[i], mPoints[wrapIndex(i + span)]);
+		mSpeeds[i] = tuning->kMaxSpeed;
+
+		if (mCurvatures[i] > 0)
+		{
+			mSpeeds[i] = min(mSpeeds[i], sqrt(tuning->kMaxLateralAcceleration / mCurvatures[i]));
+		}
+	}
+
+	// Limited acceleration out of corners (forwards) and braking into them (backwards)
+	// Two laps each way so the limits carry over the start line
+	for (int i = 1; i < number * 2; i++)
+	{
+		const float& previous = mSpeeds[wrapIndex(i - 1)];
+		float& current = mSpeeds[wrapIndex(i)];
+		current = min(current, sqrt(previous * previous + 2 * tuning->kMaxAcceleration * mSpacing));
+	}
+
+	for (int i = number * 2 - 2; i >= 0; i--)
+	{
+		const float& next = mSpeeds[wrapIndex(i + 1)];
+		float& current = mSpeeds[wrapIndex(i)];
+		current = min(current, sqrt(next * next + 2 * tuning->kMaxDeceleration * mSpacing));
+	}
+}
+
+uint64_t RacingLine::hashInput(const vector<SVector2D>& waypoints, const vector<SVector2D>& checkpoints, const SRacingLineTuning* tuning)
+{
+	// FNV-1a over the raw bytes of the input
+	uint64_t hash = 14695981039346656037ull;
+	auto add = [&hash](const void* data, size_t size)
+	{
+		const unsigned char* bytes = static_cast<const unsigned char*>(data);
+		for (size_t i = 0; i < size; i++)
+		{
+			hash = (hash ^ bytes[i]) * 1099511628211ull;
+		}
+	};
+
+	const uint64_t sizes[2] = { waypoints.size(), checkpoints.size() };
+	add(sizes, sizeof(sizes));
+	add(waypoints.data(), waypoints.size() * sizeof(SVector2D));
+	add(checkpoints.data(), checkpoints.size() * sizeof(SVector2D));
+	add(tuning, sizeof(SRacingLineTuning));
+	add(&kFileVersion, sizeof(kFileVersion));
+	return hash;
+}
+
+bool RacingLine::save(const string& filename) const
+{
+	ofstream file(filename, ios::binary);
+
+	if (!file.is_open())
+	{
+		cout << "File IO error when opening " << filename << endl;
+		return false;
+	}
+
+	const uint32_t count = static_cast<uint32_t>(mPoints.size());
+	file.write(reinterpret_cast<const char*>(&kFileMagic), sizeof(kFileMagic));
+	file.write(reinterpret_cast<const char*>(&kFileVersion), sizeof(kFileVersion));
+	file.write(reinterpret_cast<const char*>(&mInputHash), sizeof(mInputHash));
+	file.write(reinterpret_cast<const char*>(&mSpacing), sizeof(mSpacing));
+	file.write(reinterpret_cast<const char*>(&count), sizeof(count));
+	file.write(reinterpret_cast<const char*>(mPoints.data()), count * sizeof(SVector2D));
+	file.write(reinterpret_cast<const char*>(mSpeeds.data()), count * sizeof(float));
+	file.write(reinterpret_cast<const char*>(mCurvatures.data()), count * sizeof(float));
+
+	return file.good();
+}
+
+bool RacingLine::load(const string& filename, uint64_t inputHash)
+{
+	ifstream file(filename, ios::binary);
+
+	if (!file.is_open())
+	{
+		return false;
+	}
+
+	uint32_t magic = 0, version = 0, count = 0;
+	uint64_t hash = 0;
+	float spacing = 0.0f;
+	file.read(reinterpret_cast<char*>(&magic), sizeof(magic));
+	file.read(reinterpret_cast<char*>(&version), sizeof(version));
+	file.read(reinterpret_cast<char*>(&hash), sizeof(hash));
+	file.read(reinterpret_cast<char*>(&spacing), sizeof(spacing));
+	file.read(reinterpret_cast<char*>(&count), sizeof(count));
+
+	// Outdated cache, the track or the solver changed
+	if (!file.good() || magic != kFileMagic || version != kFileVersion || hash != inputHash)
+	{
+		return false;
+	}
+
+	vector<SVector2D> points(count);
+	vector<float> speeds(count), curvatures(count);
+	file.read(reinterpret_cast<char*>(points.data()), count * sizeof(SVector2D));
+	file.read(reinterpret_cast<char*>(speeds.data()), count * sizeof(float));
+	file.read(reinterpret_cast<char*>(curvatures.data()), count * sizeof(float));
+
+	if (!file.good())
+	{
+		return false;
+	}
+
+	mPoints.swap(points);
+	mSpeeds.swap(speeds);
+	mCurvatures.swap(curvatures);
+	mSpacing = spacing;
+	mInputHash = hash;
+	return true;
+}
+
+bool RacingLine::isEmpty() const
+{
+	return mPoints.empty();
+}
+
+float RacingLine::getLength() const
+{
+	return mSpacing * mPoints.size();
+}
+
+int RacingLine::getSamplesNumber() const
+{
+	return static_cast<int>(mPoints.size());
+}
+
+int RacingLine::wrapIndex(int i) const
+{
+	const int number = getSamplesNumber();
+	return ((i % number) + number) % number;
+}
+
+RacingLine::SSample RacingLine::sample(float distance) const
+{
+	// Samples are evenly spaced, the index is a division away
+	const float length = getLength();
+	distance = fmod(distance, length);
+	if (distance < 0)
+	{
+		distance += length;
+	}
+
+	const float position = distance / mSpacing;
+	const int i = wrapIndex(static_cast<int>(position));
+	const int next = wrapIndex(i + 1);
+	const float t = position - floor(position);
+
+	const SVector2D segment = mPoints[next] - mPoints[i];
+	SSample s;
+	s.position = mPoints[i] + segment * t;
+	s.direction = segment.isZero() ? SVector2D{ 0, 1 } : segment.unit();
+	s.targetSpeed = mSpeeds[i] + (mSpeeds[next] - mSpeeds[i]) * t;
+	s.curvature = mCurvatures[i] + (mCurvatures[next] - mCurvatures[i]) * t;
+	return s;
+}
+
+float RacingLine::project(SVector2D position, float guess, float window) const
+{
+	const int number = getSamplesNumber();
+	const int first = static_cast<int>(floor((guess - window) / mSpacing));
+	const int samples = min(number, static_cast<int>(ceil(2 * window / mSpacing)) + 1);
+
+	// Closest segment around the guess
+	float bestDistance = -1.0f, bestAlong = 0.0f;
+	for (int k = 0; k < samples; k++)
+	{
+		const int i = wrapIndex(first + k);
+		const SVector2D a = mPoints[i];
+		const SVector2D ab = mPoints[wrapIndex(i + 1)] - a;
+		const float lengthSquared = ab.lengthSquared();
+		const float t = lengthSquared > 0 ? max(0.0f, min(1.0f, (position - a).dot(ab) / lengthSquared)) : 0.0f;
+		const float distance = (position - (a + ab * t)).lengthSquared();
+
+		if (bestDistance < 0 || distance < bestDistance)
+		{
+			bestDistance = distance;
+			bestAlong = (i + t) * mSpacing;
+		}
+	}
+
+	return bestAlong;
+}
+
+float RacingLine::project(SVector2D position) const
+{
+	return project(position, getLength() * 0.5f, getLength() * 0.5f);
+}
@@ -0,0 +1,130 @@
+/**
+ * @file racingline.h
+ * Smoothed racing line with a target speed profile, solved once per track
+ *
+ * @author Jacob Sanchez Perez (G20812080) <jsanchez-perez@uclan.ac.uk>
+ * Games Concepts (CO1301), University of Central Lancashire
+ */
+
+#ifndef DESERT_RACER_RACING_LINE_H
+#define DESERT_RACER_RACING_LINE_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "vector.h"
+
+
+namespace desert
+{
+	/**
+	* Racing line solver settings
+	* Part of the cache key, changing any of them solves the line again
+	*/
+	struct SRacingLineTuning
+	{
+		// Distance between samples of the solved line
+		float kSpacing = 2.0f;
+		// Samples taken along the spline between two control points
+		int kSplineSteps = 16;
+		// Relaxation passes that straighten the line (cut corners)
+		int kSmoothingPasses = 60;
+		float kSmoothingWeight = 0.5f;
+		// How far the line may drift from the spline through the control points
+		float kMaxOffset = 8.0f;
+		// Samples before / after a point used to measure its curvature (filters out noise)
+		int kCurvatureSpan = 4;
+
+		// Speed profile (units per second)
+		float kMaxSpeed = 100.0f;
+		float kMaxLateralAcceleration = 60.0f;
+		float kMaxAcceleration = 40.0f;
+		float kMaxDeceleration = 60.0f;
+	};
+
+	/**
+	* Closed loop through the waypoints and checkpoints of a track, sampled at a fixed spacing
+	* Every sample stores the target speed derived from the curvature around it,
+	* so following the line is one lookup by distance travelled
+	*/
+	class RacingLine
+	{
+	public:
+		struct SSample
+		{
+			SVector2D position;
+			// Unit direction of travel
+			SVector2D direction;
+			float targetSpeed;
+			float curvature;
+		};
+
+		static const SRacingLineTuning kDefaultTuning;
+		// Cache file name is the track file name plus this
+		static const std::string kCacheExtension;
+
+		/**
+		* Load the line cached next to the track, solve it (and cache it) if missing or outdated
+		* @param trackFilename Scene setup file of the track
+		* @param waypoints AI waypoints, in order
+		* @param checkpoints Checkpoint centres, the line goes through them
+		* @return False if there are not enough waypoints for a line
+		*/
+		bool loadOrBuild(const std::string& trackFilename, const std::vector<SVector2D>& waypoints, const std::vector<SVector2D>& checkpoints,
+			const SRacingLineTuning* tuning = &kDefaultTuning);
+		// Solve the line (no disk access)
+		void build(const std::vector<SVector2D>& waypoints, const std::vector<SVector2D>& checkpoints, const SRacingLineTuning* tuning = &kDefaultTuning);
+
+		bool save(const std::string& filename) const;
+		/**
+		* @param inputHash Hash of the input the line must have been solved from
+		* @return False if the file is missing, damaged or solved from something else
+		*/
+		bool load(const std::string& filename, uint64_t inputHash);
+
+		bool isEmpty() const;
+		// Length of one lap along the line
+		float getLength() const;
+		int getSamplesNumber() const;
+
+		// Interpolated sample at a distance along the line (wraps around laps)
+		SSample sample(float distance) const;
+		/**
+		* Distance along the line of the point closest to a position
+		* @param guess Previous distance, the search starts there
+		* @param window Distance searched before / after the guess
+		*/
+		float project(SVector2D position, float guess, float window) const;
+		// Same, searching the whole line
+		float project(SVector2D position) const;
+	protected:
+		static const uint32_t kFileMagic;
+		static const uint32_t kFileVersion;
+		// Below this many control points there is no loop to follow
+		static const int kMinControlPoints = 3;
+		// Checkpoints closer than this to a waypoint replace it instead of adding a point
+		static constexpr float kMergeDistance = 5.0f;
+
+		// Identifies the input of a solve (control points + tuning)
+		static uint64_t hashInput(const std::vector<SVector2D>& waypoints, const std::vector<SVector2D>& checkpoints, const SRacingLineTuning* tuning);
+
+		// Waypoints with the checkpoints inserted in the segment they belong to
+		static std::vector<SVector2D> controlPoints(const std::vector<SVector2D>& waypoints, const std::vector<SVector2D>& checkpoints, std::vector<char>& pinned);
+		// Resample a closed polyline every spacing units
+		static std::vector<SVector2D> resample(const std::vector<SVector2D>& points, const float spacing);
+		// Curvature of the circle through three points
+		static float curvature(SVector2D a, SVector2D b, SVector2D c);
+
+		// Fill mCurvatures / mSpeeds from mPoints
+		void buildSpeedProfile(const SRacingLineTuning* tuning);
+		int wrapIndex(int i) const;
+
+		std::vector<SVector2D> mPoints;
+		std::vector<float> mSpeeds;
+		std::vector<float> mCurvatures;
+		float mSpacing = 0.0f;
+		uint64_t mInputHash = 0;
+	};
+}
+
+#endif
@@ -0,0 +1,560 @@
+/**
+ * @file replay.cpp
+ * Recorded player input (and the seed it was raced with), replayed headless at full speed
+ *
+ * @author Jacob Sanchez Perez (G20812080) <jsanchez-perez@uclan.ac.uk>
+ * Games Concepts (CO1301), University of Central Lancashire
+ */
+
+#include <iostream>
+#include <fstream>
+#include <chrono>
+#include <algorithm>
+#include <cmath>
+#include "simulator.h"
+#include "ghost.h"
+#include "telemetry.h"
+#include "replay.h"
+
+using namespace std;
+using namespace desert;
+
+const string InputRecording::kFileExtension = ".replay";
+const uint32_t InputRecording::kFileMagic = 0x50525244;
+const uint32_t InputRecording::kFileVersion = 2;
+
+
+void InputRecording::begin(const string& track, uint64_t seed, int laps)
+{
+	mTrack = track;
+	mSeed = seed;
+	mLaps = laps;
+	mDeltaTimes.clear();
+	mRuns.clear();
+	mHasReference = false;
+	mReference = 0;
+	mHasGameResult = false;
+	mGameResult = SRecordedCar();
+}
+
+void InputRecording::record(float deltaTime, uint8_t input)
+{
+	mDeltaTimes.push_back(deltaTime);
+
+	if (!mRuns.empty() && mRuns.back().input == input)
+	{
+		++mRuns.back().ticks;
+	}
+	else
+	{
+		mRuns.push_back({ input, 1 });
+	}
+}
+
+void InputRecording::truncate(int ticks)
+{
+	int drop = getTicksNumber() - max(ticks, 0);
+	if (drop <= 0)
+	{
+		return;
+	}
+
+	mDeltaTimes.resize(mDeltaTimes.size() - drop);
+	while (drop)
+	{
+		SInputRun& run = mRuns.back();
+		const int dropped = min(drop, static_cast<int>(run.ticks));
+		run.ticks -= dropped;
+		drop -= dropped;
+		if (!run.ticks)
+		{
+			mRuns.pop_back();
+		}
+	}
+}
+
+bool InputRecording::save(const string& filename) const
+{
+	ofstream file(filename, ios::binary);
+
+	if (!file.is_open())
+	{
+		cout << "File IO error when opening " << filename << endl;
+		return false;
+	}
+
+	const uint32_t trackLength = static_cast<uint32_t>(mTrack.size());
+	const uint32_t ticks = static_cast<uint32_t>(mDeltaTimes.size());
+	const uint32_t runs = static_cast<uint32_t>(mRuns.size());
+	const int32_t laps = mLaps;
+	const uint8_t hasReference = mHasReference;
+	const uint8_t hasGameResult = mHasGameResult;
+
+	file.write(reinterpret_cast<const char*>(&kFileMagic), sizeof(kFileMagic));
+	file.write(reinterpret_cast<const char*>(&kFileVersion), sizeof(kFileVersion));
+	file.write(reinterpret_cast<const char*>(&trackLength), sizeof(trackLength));
+	file.write(mTrack.data(), trackLength);
+	file.write(reinterpret_cast<const char*>(&mSeed), sizeof(mSeed));
+	file.write(reinterpret_cast<const char*>(&laps), sizeof(laps));
+	file.write(reinterpret_cast<const char*>(&hasReference), sizeof(hasReference));
+	file.write(reinterpret_cast<const char*>(&mReference), sizeof(mReference));
+	file.write(reinterpret_cast<const char*>(&hasGameResult), sizeof(hasGameResult));
+	file.write(reinterpret_cast<const char*>(&mGameResult), sizeof(mGameResult));
+	file.write(reinterpret_cast<const char*>(&ticks), sizeof(ticks));
+	file.write(reinterpret_cast<const char*>(mDeltaTimes.data()), ticks * sizeof(float));
+	file.write(reinterpret_cast<const char*>(&runs), sizeof(runs));
+	for (const SInputRun& run : mRuns)
+	{
+		file.write(reinterpret_cast<const char*>(&run.input), sizeof(run.input));
+		file.write(reinterpret_cast<const char*>(&run.ticks), sizeof(run.ticks));
+	}
+
+	return file.good();
+}
+
+bool InputRecording::load(const string& filename)
+{
+	ifstream file(filename, ios::binary);
+
+	if (!file.is_open())
+	{
+		cout << "File IO error when opening " << filename << endl;
+		return false;
+	}
+
+	uint32_t magic = 0, version = 0, trackLength = 0, ticks = 0, runs = 0;
+	int32_t laps = 0;
+	uint8_t hasReference = 0, hasGameResult = 0;
+	file.read(reinterpret_cast<char*>(&magic), sizeof(magic));
+	file.read(reinterpret_cast<char*>(&version), sizeof(version));
+	file.read(reinterpret_cast<char*>(&trackLength), sizeof(trackLength));
+
+	// Version 1 had no game result
+	if (!file.good() || magic != kFileMagic || version < 1 || version > kFileVersion)
+	{
+		cout << filename << " is not a recording (or is from another version)" << endl;
+		return false;
+	}
+
+	mTrack.resize(trackLength);
+	file.read(&mTrack[0], trackLength);
+	file.read(reinterpret_cast<char*>(&mSeed), sizeof(mSeed));
+	file.read(reinterpret_cast<char*>(&laps), sizeof(laps));
+	file.read(reinterpret_cast<char*>(&hasReference), sizeof(hasReference));
+	file.read(reinterpret_cast<char*>(&mReference), sizeof(mReference));
+	mGameResult = SRecordedCar();
+	if (version >= 2)
+	{
+		file.read(reinterpret_cast<char*>(&hasGameResult), sizeof(hasGameResult));
+		file.read(reinterpret_cast<char*>(&mGameResult), sizeof(mGameResult));
+	}
+	file.read(reinterpret_cast<char*>(&ticks), sizeof(ticks));
+	mDeltaTimes.resize(ticks);
+	file.read(reinterpret_cast<char*>(mDeltaTimes.data()), ticks * sizeof(float));
+	file.read(reinterpret_cast<char*>(&runs), sizeof(runs));
+
+	mRuns.resize(runs);
+	uint64_t runTicks = 0;
+	for (SInputRun& run : mRuns)
+	{
+		file.read(reinterpret_cast<char*>(&run.input), sizeof(run.input));
+		file.read(reinterpret_cast<char*>(&run.ticks), sizeof(run.ticks));
+		runTicks += run.ticks;
+	}
+
+	mLaps = laps;
+	mHasReference = hasReference != 0;
+	mHasGameResult = hasGameResult != 0;
+
+	// Runs must cover every tick exactly
+	if (!file.good() || runTicks != ticks)
+	{
+		cout << filename << " is truncated or corrupt" << endl;
+		mDeltaTimes.clear();
+		mRuns.clear();
+		return false;
+	}
+	return true;
+}
+
+bool InputRecording::isEmpty() const
+{
+	return mDeltaTimes.empty();
+}
+
+int InputRecording::getTicksNumber() const
+{
+	return static_cast<int>(mDeltaTimes.size());
+}
+
+float InputRecording::getDeltaTime(int tick) const
+{
+	return mDeltaTimes[tick];
+}
+
+vector<uint8_t> InputRecording::getInputs() const
+{
+	vector<uint8_t> inputs;
+	inputs.reserve(mDeltaTimes.size());
+	for (const SInputRun& run : mRuns)
+	{
+		inputs.insert(inputs.end(), run.ticks, run.input);
+	}
+	return inputs;
+}
+
+const string& InputRecording::getTrack() const
+{
+	return mTrack;
+}
+
+uint64_t InputRecording::getSeed() const
+{
+	return mSeed;
+}
+
+int InputRecording::getLaps() const
+{
+	return mLaps;
+}
+
+bool InputRecording::hasReference() const
+{
+	return mHasReference;
+}
+
+uint64_t InputRecording::getReference() const
+{
+	return mReference;
+}
+
+void InputRecording::setReference(uint64_t reference)
+{
+	mReference = reference;
+	mHasReference = true;
+}
+
+bool InputRecording::hasGameResult() const
+{
+	return mHasGameResult;
+}
+
+const SRecordedCar& InputRecording::getGameResult() const
+{
+	return mGameResult;
+}
+
+void InputRecording::setGameResult(const SRecordedCar& car)
+{
+	mGameResult = car;
+	mHasGameResult = true;
+}
+
+
+const string ReplayCommand::kFlag = "--replay";
+const float ReplayCommand::kGamePositionTolerance = 1.0f;
+const float ReplayCommand::kGameHeadingTolerance = 5.0f;
+
+int ReplayCommand::run(const vector<string>& args)
+{
+	if (args.empty())
+	{
+		cout << "Usage: DesertRacer " << kFlag << " file" << InputRecording::kFileExtension << " [--repeat N] [--track file] [--hashes file"
+			<< StateHashStream::kFileExtension << "] [--ghost file" << GhostPath::kFileExtension << "] [" << TelemetryStream::kFlag << " file|"
+			<< TelemetryStream::kSocketPrefix << "path] [--bench-snapshots N]" << endl;
+		return 1;
+	}
+
+	const string filename = args.front();
+	int repeat = 1;
+	int snapshotTicks = 0;
+	string track, hashesFilename, ghostFilename, telemetryTarget;
+	for (unsigned int i = 1; i + 1 < args.size(); i += 2)
+	{
+		if (args[i] == "--repeat")
+		{
+			repeat = max(1, atoi(args[i + 1].c_str()));
+		}
+		// Recordings name the track as the game found it, it may live elsewhere
+		else if (args[i] == "--track")
+		{
+			track = args[i + 1];
+		}
+		// Hash of every tick, checked against the file (written if it does not exist yet)
+		else if (args[i] == "--hashes")
+		{
+			hashesFilename = args[i + 1];
+		}
+		// The player's whole race as a ghost
+		else if (args[i] == "--ghost")
+		{
+			ghostFilename = args[i + 1];
+		}
+		// Telemetry of the first run, published as fast as it replays
+		else if (args[i] == TelemetryStream::kFlag)
+		{
+			telemetryTarget = args[i + 1];
+		}
+		// Snapshot every tick and rewind N ticks every N ticks
+		else if (args[i] == "--bench-snapshots")
+		{
+			snapshotTicks = max(1, atoi(args[i + 1].c_str()));
+		}
+	}
+
+	InputRecording recording;
+	if (!recording.load(filename))
+	{
+		return 1;
+	}
+
+	RaceTrackData data;
+	if (!data.load(track.empty() ? recording.getTrack() : track))
+	{
+		return 1;
+	}
+
+	SSimulationSettings settings;
+	settings.kLaps = recording.getLaps();
+	const RaceSimulator simulator(&data, &settings);
+	const SSimulationConfig config;
+	vector<SCarResult> results;
+	TelemetryStream telemetry;
+	if (!telemetryTarget.empty() && !telemetry.open(telemetryTarget))
+	{
+		return 1;
+	}
+
+	cout << "Replaying " << recording.getTicksNumber() << " ticks of seed " << recording.getSeed() << ", " << repeat << " times" << endl;
+
+	// Every run must go through the same states as the first one, tick by tick
+	uint64_t first = 0;
+	bool diverged = false;
+	StateHashStream firstHashes, hashes;
+	StateHashStream::SDivergence divergence;
+	const auto start = chrono::steady_clock::now();
+	for (int i = 0; i < repeat; i++)
+	{
+		const uint64_t hash = simulator.replay(recording, config, results, i ? &hashes : &firstHashes, (i || !telemetry.isOpen()) ? nullptr : &telemetry);
+		if (!i)
+		{
+			first = hash;
+		}
+		else if (hashes.findDivergence(firstHashes, divergence))
+		{
+			cout << "Run " << i + 1 << " diverged: " << hex << hash << " instead of " << first << dec << endl;
+			StateHashStream::printDivergence(cout, divergence);
+			diverged = true;
+		}
+	}
+	const double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+	telemetry.close();
+	const double ticks = static_cast<double>(recording.getTicksNumber()) * repeat;
+	cout << ticks << " ticks in " << seconds << "s (" << ticks / max(seconds, 1e-9) << " ticks/s)" << endl;
+	cout << "Player: position " << results.front().position << (results.front().finished ? ", finished in " : ", out after ")
+		<< results.front().time << "s, " << results.front().collisions << " collisions" << endl;
+	cout << "Final state " << hex << first << dec << endl;
+
+	if (!hashesFilename.empty())
+	{
+		StateHashStream reference;
+		if (!reference.load(hashesFilename))
+		{
+			if (firstHashes.save(hashesFilename))
+			{
+				cout << "Saved the hash of " << firstHashes.getTicksNumber() << " ticks to " << hashesFilename << endl;
+			}
+		}
+		else if (firstHashes.findDivergence(reference, divergence))
+		{
+			cout << "Mismatch with " << hashesFilename << endl;
+			StateHashStream::printDivergence(cout, divergence);
+			diverged = true;
+		}
+		else
+		{
+			cout << "Every tick matches " << hashesFilename << endl;
+		}
+	}
+
+	if (!ghostFilename.empty())
+	{
+		saveGhost(firstHashes, ghostFilename);
+	}
+
+	if (snapshotTicks && !benchmarkSnapshots(simulator, recording, config, data.getGridSize(), snapshotTicks))
+	{
+		diverged = true;
+	}
+
+	// The session that was recorded, raced by the engine
+	if (recording.hasGameResult() && firstHashes.getTicksNumber())
+	{
+		if (!matchesGame(recording.getGameResult(), firstHashes.getCar(firstHashes.getTicksNumber() - 1, 0)))
+		{
+			diverged = true;
+		}
+	}
+	else
+	{
+		cout << "No game result in the recording, only replays are compared" << endl;
+	}
+
+	if (!recording.hasReference())
+	{
+		// The first replay becomes the reference of every later one
+		recording.setReference(first);
+		if (recording.save(filename))
+		{
+			cout << "No reference yet, saved this one to " << filename << endl;
+		}
+	}
+	else if (recording.getReference() != first)
+	{
+		cout << "Mismatch: the recording expects " << hex << recording.getReference() << dec << endl;
+		diverged = true;
+	}
+	else
+	{
+		cout << "Matches the recording's reference" << endl;
+	}
+
+	return diverged ? 1 : 0;
+}
+
+bool ReplayCommand::matchesGame(const SRecordedCar& game, const SHashedCar& replayed)
+{
+	const float positionError = (SVector2D{ replayed.positionX, replayed.positionY } - SVector2D{ game.x, game.z }).length();
+	const float headingError = fabs(HoverAI::wrapDegrees(replayed.heading - game.heading));
+	const bool matches = positionError <= kGamePositionTolerance && headingError <= kGameHeadingTolerance && replayed.health == game.health &&
+		replayed.stage == game.stage && replayed.lap == game.lap;
+
+	cout << (matches ? "Matches the game's session" : "Differs from the game's session") << ": position off by " << positionError
+		<< ", heading by " << headingError << " degrees, health " << replayed.health << " / " << game.health << ", stage " << replayed.stage
+		<< " / " << game.stage << ", lap " << replayed.lap << " / " << game.lap << " (replay / game)" << endl;
+	return matches;
+}
+
+bool ReplayCommand::benchmarkSnapshots(const RaceSimulator& simulator, const InputRecording& recording, const SSimulationConfig& config,
+	int cars, int capacity)
+{
+	const vector<uint8_t> inputs = recording.getInputs();
+	const int ticks = recording.getTicksNumber();
+	vector<SRaceAction> actions(cars);
+	// Same ticks as RaceSimulator::replay, the input of a tick is that of the session's tick before it
+	auto step = [&](RaceSimulator::SSession& session)
+	{
+		RaceSimulator::SSimCar& player = session.cars.front();
+		const int tick = static_cast<int>(session.tick);
+		if (player.racing && !player.usesAI)
+		{
+			actions.front() = RaceSimulator::decodeInput(inputs[tick]);
+		}
+		simulator.step(session, actions.data(), recording.getDeltaTime(tick));
+	};
+
+	// Where the race ends without snapshots
+	RaceSimulator::SSession straight;
+	simulator.start(straight, config, recording.getSeed(), cars, 1);
+	while (straight.racing && static_cast<int>(straight.tick) < ticks)
+	{
+		step(straight);
+	}
+	vector<char> expected;
+	RaceSimulator::saveSession(straight, expected);
+
+	// Every tick: take, restore and take again, which must give the same bytes. Every capacity ticks: rewind to the oldest and race on
+	RaceSimulator::SSession session;
+	simulator.start(session, config, recording.getSeed(), cars, 1);
+	SnapshotRing ring(capacity);
+	vector<char> again;
+	double takeSeconds = 0.0, restoreSeconds = 0.0;
+	long long taken = 0, restored = 0;
+	int mismatches = 0, rewinds = 0;
+	// Each stretch is raced twice, the rewind only happens the first time
+	unsigned int nextRewind = capacity;
+	while (session.racing && static_cast<int>(session.tick) < ticks)
+	{
+		step(session);
+
+		auto start = chrono::steady_clock::now();
+		vector<char>& snapshot = ring.push(session.tick);
+		RaceSimulator::saveSession(session, snapshot);
+		takeSeconds += chrono::duration<double>(chrono::steady_clock::now() - start).count();
+		++taken;
+
+		start = chrono::steady_clock::now();
+		const bool good = RaceSimulator::restoreSession(session, snapshot);
+		restoreSeconds += chrono::duration<double>(chrono::steady_clock::now() - start).count();
+		++restored;
+
+		RaceSimulator::saveSession(session, again);
+		mismatches += (!good || again != snapshot);
+
+		if (capacity > 1 && session.tick == nextRewind)
+		{
+			nextRewind += capacity;
+			unsigned int found = 0;
+			const vector<char>* oldest = ring.find(ring.getOldestTick(), found);
+			start = chrono::steady_clock::now();
+			mismatches += !RaceSimulator::restoreSession(session, *oldest);
+			restoreSeconds += chrono::duration<double>(chrono::steady_clock::now() - start).count();
+			++restored;
+			// What is raced again replaces the snapshots after it
+			ring.discardAfter(found);
+			++rewinds;
+		}
+	}
+	vector<char> end;
+	RaceSimulator::saveSession(session, end);
+
+	cout << "Snapshots: " << again.size() << " bytes, " << takeSeconds * 1e6 / max(taken, 1LL) << "us per take, "
+		<< restoreSeconds * 1e6 / max(restored, 1LL) << "us per restore (" << taken << " taken, " << restored << " restored, " << rewinds
+		<< " rewinds of " << capacity << " ticks)" << endl;
+	if (mismatches)
+	{
+		cout << mismatches << " snapshots did not round trip" << endl;
+	}
+	const bool sameEnd = end == expected;
+	if (!sameEnd)
+	{
+		cout << "Rewinding changed how the race ends" << endl;
+	}
+	return !mismatches && sameEnd;
+}
+
+void ReplayCommand::saveGhost(const StateHashStream& hashes, const string& filename)
+{
+	// The player's car is the first, up to the tick it stopped racing
+	vector<SGhostPose> poses;
+	GhostRecorder recorder;
+	recorder.begin(0.0f);
+	for (int tick = 0; tick < hashes.getTicksNumber() && hashes.getCar(tick, 0).racing; tick++)
+	{
+		const SHashedCar& car = hashes.getCar(tick, 0);
+		recorder.record(hashes.getTime(tick), { car.positionX, car.positionY }, car.heading);
+	}
+
+	GhostPath ghost;
+	if (!recorder.finish(ghost))
+	{
+		return;
+	}
+
+	// How far playback strays from the car at every tick
+	float largestError = 0.0f;
+	int ticks = 0;
+	for (; ticks < hashes.getTicksNumber() && hashes.getCar(ticks, 0).racing; ticks++)
+	{
+		const SHashedCar& car = hashes.getCar(ticks, 0);
+		const SGhostPose pose = ghost.getPose(hashes.getTime(ticks));
+		largestError = max(largestError, (pose.position - SVector2D{ car.positionX, car.positionY }).length());
+	}
+
+	cout << "Ghost: " << ticks << " ticks (" << ticks * sizeof(SGhostPose) << " bytes) kept as " << ghost.getKeyframesNumber() << " keyframes in "
+		<< ghost.getEncodedBytes() << " bytes, largest error " << largestError << endl;
+	if (ghost.save(filename))
+	{
+		cout << "Saved the ghost to " << filename << endl;
+	}
+}
@@ -0,0 +1,134 @@
+/**
+ * @file replay.h
+ * Recorded player input (and the seed it was raced with), replayed headless at full speed
+ *
+ * @author Jacob Sanchez Perez (G20812080) <jsanchez-perez@uclan.ac.uk>
+ * Games Concepts (CO1301), University of Central Lancashire
+ */
+
+#ifndef DESERT_RACER_REPLAY_H
+#define DESERT_RACER_REPLAY_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "statehash.h"
+
+
+namespace desert
+{
+	// simulator.h includes this file
+	class RaceSimulator;
+	struct SSimulationConfig;
+
+	// The player's car as the game left it at the end of the recorded race
+	struct SRecordedCar
+	{
+		float x = 0.0f, z = 0.0f;
+		// Degrees, 0 faces +Z
+		float heading = 0.0f;
+		int32_t health = 0;
+		int32_t stage = 0, lap = 0;
+	};
+
+	/**
+	* Everything needed to race a session again: track, seed, laps and, for every tick,
+	* its time step and the player's input bits (see HoverCar::InputBit)
+	* Inputs are stored as runs, a held key costs nothing until it changes
+	*/
+	class InputRecording
+	{
+	public:
+		static const std::string kFileExtension;
+
+		// Start a new recording, dropping the previous one
+		void begin(const std::string& track, uint64_t seed, int laps);
+		void record(float deltaTime, uint8_t input);
+		// Drop every tick after the first ones (the race was rewound)
+		void truncate(int ticks);
+
+		bool save(const std::string& filename) const;
+		bool load(const std::string& filename);
+
+		bool isEmpty() const;
+		int getTicksNumber() const;
+		float getDeltaTime(int tick) const;
+		// Input bits of every tick, expanded from the runs
+		std::vector<uint8_t> getInputs() const;
+		const std::string& getTrack() const;
+		uint64_t getSeed() const;
+		int getLaps() const;
+
+		/**
+		* Hash of the final state of a headless replay, replays must match it bit for bit
+		* Set by the first replay, recordings from the game have none
+		*/
+		bool hasReference() const;
+		uint64_t getReference() const;
+		void setReference(uint64_t reference);
+
+		/**
+		* Where the game's own session left the player, a headless replay must end close to it
+		* Set by the game when the race is over, headless recordings have none
+		*/
+		bool hasGameResult() const;
+		const SRecordedCar& getGameResult() const;
+		void setGameResult(const SRecordedCar& car);
+	protected:
+		static const uint32_t kFileMagic;
+		static const uint32_t kFileVersion;
+
+		// Same input over consecutive ticks
+		struct SInputRun
+		{
+			uint8_t input;
+			uint32_t ticks;
+		};
+
+		std::string mTrack;
+		uint64_t mSeed = 0;
+		int mLaps = 0;
+		std::vector<float> mDeltaTimes;
+		std::vector<SInputRun> mRuns;
+		bool mHasReference = false;
+		uint64_t mReference = 0;
+		bool mHasGameResult = false;
+		SRecordedCar mGameResult;
+	};
+
+	/**
+	* Command line front end: DesertRacer --replay file [--repeat N] [--hashes file] [--ghost file] [--telemetry target] [--bench-snapshots N]
+	* Replays a recording headless as fast as possible, checks the player against where the recorded game session left it,
+	* the final state against the recording's reference and, given a hash stream, every tick against it
+	* The player's race can be saved as a ghost, with its size and how closely it follows the car
+	*/
+	class ReplayCommand
+	{
+	public:
+		// First argument that switches the game to replaying
+		static const std::string kFlag;
+
+		/**
+		* @param args Arguments after the flag
+		* @return Process exit code, non zero if a replay diverged
+		*/
+		static int run(const std::vector<std::string>& args);
+	protected:
+		// How far the replayed player may end from the game's (the engine moves and turns the car with its own float maths)
+		static const float kGamePositionTolerance;
+		static const float kGameHeadingTolerance;
+
+		// Prints what differs, returns true if the replay ended where the game did
+		static bool matchesGame(const SRecordedCar& game, const SHashedCar& replayed);
+		static void saveGhost(const StateHashStream& hashes, const std::string& filename);
+		/**
+		* Replay with a snapshot of every tick taken, restored and taken again (same bytes), rewinding to the oldest every capacity ticks
+		* Prints the size and the time per take / restore
+		* @return True if every snapshot round tripped and the rewound race ends as the straight one
+		*/
+		static bool benchmarkSnapshots(const RaceSimulator& simulator, const InputRecording& recording, const SSimulationConfig& config,
+			int cars, int capacity);
+	};
+}
+
+#endif
@@ -6,21 +6,110 @@
  * Games Concepts (CO1301), University of Central Lancashire
  */
 
-
+#include <random>
+#include <cstring>
 #include "rng.h"
 
 using namespace desert;
 
-RNG::RNG(int min, int max) : mGenerator(mRandomDevice()), mDistribution(std::uniform_int_distribution<>(min, max))
+constexpr uint64_t RNG::kDefaultSeed;
+
+RNG::RNG(uint64_t seed, uint64_t sequence) : mIncrement((sequence << 1u) | 1u)
+{
+	// Standard PCG seeding procedure
+	next();
+	mState += seed;
+	next();
+}
+
+uint32_t RNG::next()
+{
+	const uint64_t old = mState;
+	mState = old * kMultiplier + mIncrement;
+
+	const uint32_t xorShifted = static_cast<uint32_t>(((old >> 18u) ^ old) >> 27u);
+	const uint32_t rotation = static_cast<uint32_t>(old >> 59u);
+	return (xorShifted >> rotation) | (xorShifted << ((32 - rotation) & 31));
+}
+
+int RNG::getNumber(int min, int max)
 {
+	// In unsigned arithmetic, the full int range does not fit an int
+	const uint32_t bound = static_cast<uint32_t>(max) - static_cast<uint32_t>(min) + 1;
+	if (bound == 0)
+	{
+		// Every 32-bit number is in range
+		return static_cast<int>(next());
+	}
+
+	// Reject the few numbers that would bias the modulo
+	const uint32_t threshold = (0u - bound) % bound;
+	uint32_t r = next();
+	while (r < threshold)
+	{
+		r = next();
+	}
+
+	return static_cast<int>(static_cast<uint32_t>(min) + r % bound);
+}
+
+float RNG::getDecimalPoint(int min, int max)
+{
+	return getNumber(min, max) / kHundred;
 }
 
-int RNG::getNumber()
+float RNG::getFloat()
 {
-	return mDistribution(mGenerator);
+	// Put 23 random bits in the mantissa of a float in [1, 2)
+	const uint32_t bits = (next() >> 9) | 0x3F800000u;
+	float f;
+	std::memcpy(&f, &bits, sizeof(f));
+	return f - 1.0f;
 }
 
-float RNG::getDecimalPoint()
+float RNG::getFloat(float min, float max)
 {
-	return mDistribution(mGenerator) / kHundred;
-}
\ No newline at end of file
+	return min + getFloat() * (max - min);
+}
+
+void RNG::fillFloats(float* out, int count, float min, float max)
+{
+	const float range = max - min;
+
+	for (int i = 0; i < count; i++)
+	{
+		out[i] = min + getFloat() * range;
+	}
+}
+
+uint64_t RandomService::generateSeed()
+{
+	std::random_device device;
+	return (static_cast<uint64_t>(device()) << 32) | device();
+}
+
+RandomService::RandomService(uint64_t masterSeed) : mMasterSeed(masterSeed) {}
+
+void RandomService::setMasterSeed(uint64_t masterSeed)
+{
+	mMasterSeed = masterSeed;
+}
+
+uint64_t RandomService::getMasterSeed() const
+{
+	return mMasterSeed;
+}
+
+RNG RandomService::getStream(Subsystem subsystem, uint32_t entity) const
+{
+	const uint64_t id = (static_cast<uint64_t>(subsystem) << 32) | entity;
+	return RNG(splitMix64(mMasterSeed ^ splitMix64(id)), id);
+}
+
+uint64_t RandomService::splitMix64(uint64_t value)
+{
+	value += 0x9E3779B97F4A7C15ULL;
+	value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	value = (value ^ (value >> 27)) * 0x94D049BB133111EBULL;
+	return value ^ (value >> 31);
+}
@@ -1,22 +1,86 @@
+/**
+ * @file rng.h
+ * Random Number Generation
+ *
+ * @author Jacob Sanchez Perez (G20812080) <jsanchez-perez@uclan.ac.uk>
+ * Games Concepts (CO1301), University of Central Lancashire
+ */
+
 #ifndef DESERT_RACER_RNG
 #define DESERT_RACER_RNG
 
-#include <random>
+#include <cstdint>
 
 
 namespace desert {
+	/**
+	* PCG32 random number stream
+	* Only 16 bytes, so every subsystem / entity can own its own copy
+	*/
 	class RNG
 	{
 	public:
-		RNG(int min, int max);
-		int getNumber();
-		float getDecimalPoint();
+		/**
+		* @param seed Starting point of the stream
+		* @param sequence Selects one of 2^63 independent sequences
+		*/
+		RNG(uint64_t seed = kDefaultSeed, uint64_t sequence = 0);
+		// Next raw 32 bit number
+		uint32_t next();
+		// Integer in [min, max]
+		int getNumber(int min, int max);
+		// Integer in [min, max] divided by a hundred
+		float getDecimalPoint(int min, int max);
+		// Float in [0, 1)
+		float getFloat();
+		// Float in [min, max)
+		float getFloat(float min, float max);
+		/**
+		* Fill a buffer with floats in [min, max)
+		* @param out Buffer with space for at least count floats
+		*/
+		void fillFloats(float* out, int count, float min, float max);
 	protected:
+		static constexpr uint64_t kDefaultSeed = 0x853c49e6748fea9bULL;
+		static constexpr uint64_t kMultiplier = 6364136223846793005ULL;
 		static constexpr float kHundred = 100.0f;
-		std::random_device mRandomDevice;
-		std::mt19937 mGenerator;
-		std::uniform_int_distribution<int> mDistribution;
+
+		uint64_t mState = 0;
+		uint64_t mIncrement = 1;
+	};
+
+	/**
+	* Hands out independent random streams derived from a single master seed
+	* Same master seed, same race
+	*/
+	class RandomService
+	{
+	public:
+		// Who the stream is for, so subsystems never share a sequence
+		enum Subsystem
+		{
+			Race,
+			AI,
+			Particles
+		};
+
+		// Non deterministic seed, for when no seed was requested
+		static uint64_t generateSeed();
+
+		RandomService(uint64_t masterSeed = generateSeed());
+		void setMasterSeed(uint64_t masterSeed);
+		uint64_t getMasterSeed() const;
+		/**
+		* @param subsystem Subsystem requesting the stream
+		* @param entity Index of the entity inside that subsystem
+		*/
+		RNG getStream(Subsystem subsystem, uint32_t entity = 0) const;
+	protected:
+		// Scrambles seeds so that neighbouring ids end up far apart
+		static uint64_t splitMix64(uint64_t value);
+
+		uint64_t mMasterSeed;
 	};
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -15,6 +15,7 @@ DesertWall::DesertWall(IModel* m, NodeAlignment alignment) : BoxCollisionModel(m
 {
 	mHalfWidth = kHalfWidth;
 	mHalfLength = kHalfLength;
+	mShapeOwner = SCollisionShape::Wall;
 	cout << "DesertWall created" << endl;
 }
 
@@ -30,6 +31,7 @@ DesertTower::DesertTower(IModel* m, NodeAlignment alignment) : BoxCollisionModel
 {
 	mHalfWidth = kHalfWidth;
 	mHalfLength = kHalfLength;
+	mShapeOwner = SCollisionShape::Tower;
 	cout << "DesertTower created" << endl;
 }
 
@@ -22,8 +22,7 @@ namespace desert {
 		DesertWall(tle::IModel* m, NodeAlignment alignment);
 		~DesertWall();
 		static const std::string kDefaultModelName;
-	protected:
-		const float kHalfWidth = 2.0f, kHalfLength = 8.5f;
+		static constexpr float kHalfWidth = 2.0f, kHalfLength = 8.5f;
 	};
 
 	class DesertTower : public BoxCollisionModel
@@ -32,8 +31,7 @@ namespace desert {
 		DesertTower(tle::IModel* m, NodeAlignment alignment);
 		~DesertTower();
 		static const std::string kDefaultModelName;
-	protected:
-		const float kHalfWidth = 8.0f, kHalfLength = 8.0f;
+		static constexpr float kHalfWidth = 8.0f, kHalfLength = 8.0f;
 	};
 
 	class CustomSphereCModel : public SphereCollisionModel
@@ -0,0 +1,760 @@
+/**
+ * @file simulator.cpp
+ * Thousands of headless races with the game's rules, for balancing the tuning tables
+ *
+ * @author Jacob Sanchez Perez (G20812080) <jsanchez-perez@uclan.ac.uk>
+ * Games Concepts (CO1301), University of Central Lancashire
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <chrono>
+#include <cmath>
+#include <algorithm>
+#include <limits>
+#include "vector.h"
+#include "collision.h"
+#include "jobs.h"
+#include "rng.h"
+#include "simulator.h"
+
+using namespace std;
+using namespace desert;
+
+
+const SSimulationSettings RaceSimulator::kDefaultSettings = {};
+
+RaceSimulator::RaceSimulator(const RaceTrackData* track, const SSimulationSettings* settings) : mTrack(track), mSettings(settings)
+{
+}
+
+void RaceSimulator::run(const SSimulationConfig& config, uint64_t seed, vector<SCarResult>& results) const
+{
+	race(config, seed, nullptr, results);
+}
+
+uint64_t RaceSimulator::replay(const InputRecording& recording, const SSimulationConfig& config, vector<SCarResult>& results,
+	StateHashStream* hashes, TelemetryStream* telemetry) const
+{
+	return race(config, recording.getSeed(), &recording, results, hashes, telemetry);
+}
+
+SRaceAction RaceSimulator::decodeInput(uint8_t input)
+{
+	// Same priorities as HoverCar: forwards over backwards, clockwise over anticlockwise
+	SRaceAction action;
+	action.thrust = (input & HoverCar::ForwardInput) ? 1.0f : (input & HoverCar::BackwardInput) ? -1.0f : 0.0f;
+	action.turn = (input & HoverCar::ClockwiseInput) ? 1.0f : (input & HoverCar::AntiClockwiseInput) ? -1.0f : 0.0f;
+	action.boost = (input & HoverCar::BoostInput) != 0;
+	return action;
+}
+
+uint64_t RaceSimulator::race(const SSimulationConfig& config, uint64_t seed, const InputRecording* recording, vector<SCarResult>& results,
+	StateHashStream* hashes, TelemetryStream* telemetry) const
+{
+	SSession session;
+	start(session, config, seed, mTrack->getGridSize(), 1);
+	vector<SSimCar>& cars = session.cars;
+	SSimCar& player = cars.front();
+	vector<SRaceAction> actions(cars.size());
+
+	// Recordings set the length of the race and every time step, the time limit does not apply
+	const vector<uint8_t> inputs = recording ? recording->getInputs() : vector<uint8_t>();
+	const int ticks = recording ? recording->getTicksNumber() : numeric_limits<int>::max();
+
+	vector<SHashedCar> hashed;
+	if (hashes)
+	{
+		hashes->begin(static_cast<int>(cars.size()));
+		hashed.resize(cars.size());
+	}
+
+	for (int tick = 0; session.racing && tick < ticks && (recording || session.time < mSettings->kTimeLimit); tick++)
+	{
+		if (player.racing && !player.usesAI)
+		{
+			actions.front() = recording ? decodeInput(inputs[tick]) : script(player, player.lineDistance);
+		}
+		step(session, actions.data(), recording ? recording->getDeltaTime(tick) : mSettings->kDeltaTime);
+
+		if (hashes)
+		{
+			for (unsigned int i = 0; i < cars.size(); i++)
+			{
+				hashed[i] = hashedCar(cars[i]);
+			}
+			hashes->record(session.time, hashed.data());
+		}
+
+		if (telemetry)
+		{
+			for (unsigned int i = 0; i < cars.size(); i++)
+			{
+				telemetry->publish(telemetrySample(cars[i], i, session));
+			}
+		}
+	}
+
+	finish(session, results);
+	return hashState(cars);
+}
+
+void RaceSimulator::start(SSession& session, const SSimulationConfig& config, uint64_t seed, int cars, int humans) const
+{
+	const RandomService random(seed);
+	session.config = &config;
+	session.cars.resize(cars);
+	for (int i = 0; i < cars; i++)
+	{
+		resetCar(session.cars[i], i, i < humans, config, random);
+	}
+	session.time = 0.0f;
+	session.racing = cars;
+	session.tick = 0;
+}
+
+bool RaceSimulator::step(SSession& session, const SRaceAction* actions, float kDeltaTime) const
+{
+	vector<SSimCar>& cars = session.cars;
+	const float kGameSpeed = mSettings->kGameSpeed;
+	const SHoverCarTuning& playerTuning = session.config->player;
+	const SHoverAITuning& aiTuning = session.config->ai;
+	session.time += kDeltaTime;
+	++session.tick;
+	const float time = session.time;
+
+	// Control: every car decides from where the others were at the start of the tick
+	for (unsigned int i = 0; i < cars.size(); i++)
+	{
+		SSimCar& car = cars[i];
+		if (!car.racing)
+		{
+			continue;
+		}
+
+		if (car.usesAI)
+		{
+			steer(car);
+		}
+		else
+		{
+			car.boostDrag = HeadlessCar::control(car.car, actions[i], playerTuning, mTrack->getGridSlot(0).scale, kGameSpeed, kDeltaTime);
+		}
+	}
+
+	// Checkpoints, before anything moves
+	for (SSimCar& car : cars)
+	{
+		if (car.racing && passCheckpoints(car, time))
+		{
+			car.racing = false;
+			car.result.finished = true;
+			car.result.time = time;
+			--session.racing;
+		}
+	}
+
+	// Collisions: players against obstacles then the other cars, AI against obstacles and each other (not players)
+	for (unsigned int i = 0; i < cars.size(); i++)
+	{
+		SSimCar& car = cars[i];
+		car.axis = Collision::None;
+		if (!car.racing || car.usesAI)
+		{
+			continue;
+		}
+
+		car.axis = mTrack->collide(car.car.previousPosition, car.car.position, playerTuning.kCollisionRadius);
+		for (unsigned int j = 0; j < cars.size() && car.axis == Collision::None; j++)
+		{
+			SSimCar& other = cars[j];
+			const float otherRadius = other.usesAI ? aiTuning.kCollisionRadius : playerTuning.kCollisionRadius;
+			if (j != i && other.racing && Collision::circleToCircle(car.car.position, other.car.position,
+				playerTuning.kCollisionRadius, otherRadius) == Collision::Both)
+			{
+				car.axis = Collision::Both;
+				// Other players bounce off on their own turn
+				if (other.usesAI)
+				{
+					other.pushed = true;
+					other.push = car.car.movement * aiTuning.kBounce;
+				}
+			}
+		}
+	}
+
+	for (unsigned int i = 0; i < cars.size(); i++)
+	{
+		SSimCar& car = cars[i];
+		if (!car.racing || !car.usesAI)
+		{
+			continue;
+		}
+
+		bool hit = mTrack->getCollisionWorld().overlap(car.car.position, aiTuning.kCollisionRadius) >= 0;
+		for (unsigned int j = 0; j < cars.size() && !hit; j++)
+		{
+			hit = j != i && cars[j].racing && cars[j].usesAI && Collision::circleToCircle(car.car.position, cars[j].car.position,
+				aiTuning.kCollisionRadius, aiTuning.kCollisionRadius) == Collision::Both;
+		}
+
+		// Further hits change nothing until the invulnerability ends
+		if (hit && !car.ai.invTimer)
+		{
+			car.ai.collided = true;
+			car.ai.invTimer = aiTuning.kInvTime;
+		}
+	}
+
+	// Resolution and movement
+	for (SSimCar& car : cars)
+	{
+		if (!car.racing)
+		{
+			continue;
+		}
+
+		if (car.usesAI)
+		{
+			if (car.pushed)
+			{
+				car.car.movement = car.push;
+				car.pushed = false;
+			}
+
+			if (car.ai.collided)
+			{
+				car.car.movement = -car.car.movement * aiTuning.kBounce;
+				--car.ai.health;
+				++car.result.collisions;
+				car.ai.collided = false;
+			}
+
+			car.car.previousPosition = car.car.position;
+			car.car.position += car.car.movement * kDeltaTime;
+			car.car.movement *= aiTuning.kDrag;
+		}
+		else
+		{
+			if (HeadlessCar::collide(car.car, car.axis, playerTuning))
+			{
+				++car.result.collisions;
+			}
+			HeadlessCar::move(car.car, car.boostDrag, playerTuning, kDeltaTime);
+
+			// A wrecked player is out of the race
+			if (car.car.state.health <= 0)
+			{
+				car.racing = false;
+				car.result.time = time;
+				--session.racing;
+			}
+		}
+	}
+
+	return session.racing > 0;
+}
+
+void RaceSimulator::finish(SSession& session, vector<SCarResult>& results) const
+{
+	vector<SSimCar>& cars = session.cars;
+
+	// Finishers by time, then the rest by how far they got
+	vector<int> order(cars.size());
+	vector<SVehicleSnapshot> snapshots(cars.size());
+	for (unsigned int i = 0; i < cars.size(); i++)
+	{
+		order[i] = i;
+		snapshots[i] = snapshot(cars[i]);
+		if (!cars[i].result.finished && cars[i].racing)
+		{
+			cars[i].result.time = session.time;
+		}
+	}
+	stable_sort(order.begin(), order.end(), [&cars, &snapshots](int a, int b)
+	{
+		const SCarResult& resultA = cars[a].result;
+		const SCarResult& resultB = cars[b].result;
+		if (resultA.finished != resultB.finished)
+		{
+			return resultA.finished;
+		}
+		if (resultA.finished)
+		{
+			return resultA.time < resultB.time;
+		}
+		return DesertVehicle::compareSnapshots(snapshots[a], snapshots[b]);
+	});
+
+	results.resize(cars.size());
+	for (unsigned int i = 0; i < order.size(); i++)
+	{
+		cars[order[i]].result.position = i + 1;
+	}
+	for (unsigned int i = 0; i < cars.size(); i++)
+	{
+		results[i] = cars[i].result;
+	}
+}
+
+void RaceSimulator::resetCar(SSimCar& car, int slot, bool human, const SSimulationConfig& config, const RandomService& random) const
+{
+	// The game hands the AI streams out in grid order, a player using the AI rules takes the next one
+	const bool usesAI = !human || (!slot && config.aiPlayer);
+	const int aiIndex = slot ? slot - 1 : mTrack->getGridSize() - 1;
+	RNG raceRandom = random.getStream(RandomService::Race, slot);
+	const float jitter = mSettings->kStartJitter;
+
+	SGridSlot start = gridSlot(slot);
+	start.position += SVector2D{ raceRandom.getFloat(-jitter, jitter), raceRandom.getFloat(-jitter, jitter) };
+
+	car = SSimCar();
+	car.usesAI = usesAI;
+	car.result = { 0, false, 0.0f, 0.0f, 0.0f, 0, 0 };
+	HeadlessCar::reset(car.car, start, config.player);
+	car.lineDistance = mTrack->getRacingLine().project(car.car.position);
+
+	if (usesAI)
+	{
+		const FlowField& field = mTrack->getFlowField();
+		RNG aiRandom = random.getStream(RandomService::AI, aiIndex);
+		car.driver = { &config.ai, aiRandom.getDecimalPoint(config.ai.kMinSpeedRng, config.ai.kMaxSpeedRng), start.scale,
+			&mTrack->getRacingLine(), field.isEmpty() ? nullptr : &field };
+
+		car.ai.heading = start.heading;
+		car.ai.lineDistance = mTrack->getRacingLine().project(start.position);
+		car.ai.health = config.ai.kInitialHealth;
+		car.ai.thrust = config.ai.kInitialThrust;
+	}
+}
+
+SGridSlot RaceSimulator::gridSlot(int slot) const
+{
+	const int gridSize = mTrack->getGridSize();
+	SGridSlot start = mTrack->getGridSlot(slot % gridSize);
+
+	// More cars than the track has places for: further rows behind the grid
+	if (slot >= gridSize)
+	{
+		start.position -= HeadlessCar::headingVector(start.heading) * (mSettings->kGridSpacing * (slot / gridSize));
+	}
+	return start;
+}
+
+SRaceAction RaceSimulator::script(const SSimCar& car, float& lineDistance) const
+{
+	const RacingLine& line = mTrack->getRacingLine();
+	lineDistance = line.project(car.car.position, lineDistance, mSettings->kLineSearchWindow);
+	const RacingLine::SSample ahead = line.sample(lineDistance + mSettings->kScriptLookahead);
+
+	SRaceAction action;
+	const float error = HoverAI::wrapDegrees(HoverAI::headingOf(ahead.position - car.car.position) - car.car.heading);
+	action.turn = max(-1.0f, min(error / mSettings->kScriptFullTurn, 1.0f));
+	action.thrust = max(0.0f, min((ahead.targetSpeed - car.car.movement.length()) / mSettings->kScriptThrottleBand, 1.0f));
+	return action;
+}
+
+void RaceSimulator::steer(SSimCar& car) const
+{
+	const HoverAI::SSteering steering = HoverAI::steer(car.driver, car.ai, snapshot(car), mSettings->kGameSpeed, mSettings->kDeltaTime);
+
+	// Same as HoverAI::applySteering
+	car.ai.invTimer = steering.invTimer;
+	car.ai.lineDistance = steering.lineDistance;
+	car.ai.heading = steering.heading;
+	car.car.movement += steering.thrust;
+}
+
+bool RaceSimulator::passCheckpoints(SSimCar& car, float time) const
+{
+	const int lap = car.car.lap;
+	const bool finished = HeadlessCar::passCheckpoints(car.car, *mTrack, mSettings->kLaps);
+
+	// The first crossing starts lap one, every other one ends a lap
+	if (car.car.lap != lap)
+	{
+		if (lap)
+		{
+			const float lapTime = time - car.lapStart;
+			car.result.bestLap = car.result.laps ? min(car.result.bestLap, lapTime) : lapTime;
+			car.result.lapTotal += lapTime;
+			++car.result.laps;
+		}
+		car.lapStart = time;
+	}
+	return finished;
+}
+
+SVehicleSnapshot RaceSimulator::snapshot(const SSimCar& car) const
+{
+	SVehicleSnapshot s;
+	s.position = car.car.position;
+	s.facing = HeadlessCar::headingVector(car.usesAI ? car.ai.heading : car.car.heading);
+	s.movement = car.car.movement;
+	s.distanceToCheckpoint = (mTrack->getCheckpoint(car.car.stage % mTrack->getStagesNumber()) - car.car.position).length();
+	s.stage = car.car.stage;
+	s.lap = car.car.lap;
+	return s;
+}
+
+void RaceSimulator::saveSession(const SSession& session, vector<char>& buffer)
+{
+	SnapshotWriter writer(buffer);
+	writer.write(session.time);
+	writer.write(session.racing);
+	writer.write(session.tick);
+	writer.writeArray(session.cars);
+}
+
+bool RaceSimulator::restoreSession(SSession& session, const vector<char>& buffer)
+{
+	SnapshotReader reader(buffer);
+	float time = 0.0f;
+	int racing = 0;
+	unsigned int tick = 0;
+	reader.read(time);
+	reader.read(racing);
+	reader.read(tick);
+	// Straight into the cars, a snapshot of a different grid is refused before anything is read
+	reader.readArray(session.cars);
+	if (!reader.isGood())
+	{
+		return false;
+	}
+	session.time = time;
+	session.racing = racing;
+	session.tick = tick;
+	return true;
+}
+
+SHashedCar RaceSimulator::hashedCar(const SSimCar& car)
+{
+	const SHeadlessCar& c = car.car;
+	SHashedCar h;
+	h.positionX = c.position.x;
+	h.positionY = c.position.y;
+	h.movementX = c.movement.x;
+	h.movementY = c.movement.y;
+	h.heading = car.usesAI ? car.ai.heading : c.heading;
+	h.boostTimer = c.state.boostTimer;
+	h.boostPenaltyTimer = c.state.boostPenaltyTimer;
+	h.damageTimer = c.state.damageTimer;
+	h.invTimer = car.ai.invTimer;
+	h.lineDistance = car.ai.lineDistance;
+	h.health = car.usesAI ? car.ai.health : c.state.health;
+	h.stage = c.stage;
+	h.lap = c.lap;
+	h.racing = car.racing;
+	return h;
+}
+
+STelemetrySample RaceSimulator::telemetrySample(const SSimCar& car, int index, const SSession& session)
+{
+	const SHeadlessCar& c = car.car;
+	STelemetrySample sample;
+	sample.tick = session.tick;
+	sample.time = session.time;
+	sample.x = c.position.x;
+	sample.z = c.position.y;
+	sample.velocityX = c.movement.x;
+	sample.velocityZ = c.movement.y;
+	sample.health = car.usesAI ? car.ai.health : c.state.health;
+	sample.stage = c.stage;
+	sample.vehicle = static_cast<uint8_t>(index);
+
+	// Kept by the same rules as HoverCar's
+	if (!car.usesAI)
+	{
+		sample.boostState = c.state.boostState;
+	}
+	return sample;
+}
+
+uint64_t RaceSimulator::hashState(const vector<SSimCar>& cars)
+{
+	// FNV-1a over the raw bytes, floats hash their exact bits
+	uint64_t hash = 14695981039346656037ull;
+	auto add = [&hash](const void* data, size_t size)
+	{
+		const unsigned char* bytes = static_cast<const unsigned char*>(data);
+		for (size_t i = 0; i < size; i++)
+		{
+			hash = (hash ^ bytes[i]) * 1099511628211ull;
+		}
+	};
+
+	for (const SSimCar& car : cars)
+	{
+		const SHeadlessCar& c = car.car;
+		const float floats[] = { c.position.x, c.position.y, c.movement.x, c.movement.y, c.heading, c.state.boostTimer, c.state.boostPenaltyTimer,
+			c.state.damageTimer, car.ai.heading, car.ai.lineDistance, car.ai.invTimer };
+		const int ints[] = { c.state.health, c.stage, c.lap, car.ai.health, car.racing };
+		add(floats, sizeof(floats));
+		add(ints, sizeof(ints));
+	}
+	return hash;
+}
+
+
+const string SimulatorCommand::kFlag = "--simulate";
+
+const unordered_map<string, SimulatorCommand::Setter> SimulatorCommand::kSetters =
+{
+	{ "ai.minSpeed", [](SSimulationConfig& c, float v) { c.ai.kMinSpeedRng = static_cast<int>(v); } },
+	{ "ai.maxSpeed", [](SSimulationConfig& c, float v) { c.ai.kMaxSpeedRng = static_cast<int>(v); } },
+	{ "ai.turnRate", [](SSimulationConfig& c, float v) { c.ai.kTurnRate = v; } },
+	{ "ai.thrust", [](SSimulationConfig& c, float v) { c.ai.kThrustVector = { v, v }; } },
+	{ "ai.drag", [](SSimulationConfig& c, float v) { c.ai.kDrag = v; } },
+	{ "ai.bounce", [](SSimulationConfig& c, float v) { c.ai.kBounce = v; } },
+	{ "ai.invTime", [](SSimulationConfig& c, float v) { c.ai.kInvTime = v; } },
+	{ "ai.lookahead", [](SSimulationConfig& c, float v) { c.ai.kLineLookahead = v; } },
+	{ "ai.throttleBand", [](SSimulationConfig& c, float v) { c.ai.kThrottleBand = v; } },
+	{ "ai.recoveryDistance", [](SSimulationConfig& c, float v) { c.ai.kRecoveryDistance = v; } },
+	{ "ai.recoveryThrottle", [](SSimulationConfig& c, float v) { c.ai.kRecoveryThrottle = v; } },
+	{ "player.thrust", [](SSimulationConfig& c, float v) { c.player.kThrustVector = { v, v }; } },
+	{ "player.rotation", [](SSimulationConfig& c, float v) { c.player.kInitialRotation = v; } },
+	{ "player.drag", [](SSimulationConfig& c, float v) { c.player.kDrag = v; } },
+	{ "player.bounce", [](SSimulationConfig& c, float v) { c.player.kBounce = v; } },
+	{ "player.health", [](SSimulationConfig& c, float v) { c.player.kInitialHealth = static_cast<int>(v); } },
+	{ "player.collisionThreshold", [](SSimulationConfig& c, float v) { c.player.kCollisionSpeedThreshold = v; } }
+};
+
+int SimulatorCommand::run(const vector<string>& args, const string& defaultTrack)
+{
+	string track = defaultTrack;
+	int races = 1000;
+	uint64_t seed = 1;
+	int workers = JobSystem::defaultWorkerCount();
+	bool aiPlayer = false;
+	SSimulationSettings settings;
+	vector<string> sweep;
+
+	// Options are "--name value"
+	for (unsigned int i = 0; i < args.size(); i++)
+	{
+		const string& option = args[i];
+		if (i + 1 >= args.size())
+		{
+			cout << "Missing value for " << option << endl;
+			printUsage();
+			return 1;
+		}
+		const string& value = args[++i];
+
+		try
+		{
+			if (option == "--track")
+			{
+				track = value;
+			}
+			else if (option == "--races")
+			{
+				races = max(1, stoi(value));
+			}
+			else if (option == "--seed")
+			{
+				seed = stoull(value);
+			}
+			else if (option == "--threads")
+			{
+				workers = max(0, stoi(value) - 1);
+			}
+			else if (option == "--laps")
+			{
+				settings.kLaps = max(1, stoi(value));
+			}
+			else if (option == "--time-limit")
+			{
+				settings.kTimeLimit = stof(value);
+			}
+			else if (option == "--player" && (value == "script" || value == "ai"))
+			{
+				aiPlayer = value == "ai";
+			}
+			else if (option == "--set")
+			{
+				sweep.push_back(value);
+			}
+			else
+			{
+				cout << "Unknown option " << option << " " << value << endl;
+				printUsage();
+				return 1;
+			}
+		}
+		catch (const exception&)
+		{
+			cout << "Bad value for " << option << ": " << value << endl;
+			return 1;
+		}
+	}
+
+	vector<SSimulationConfig> configs;
+	if (!expandSweep(sweep, aiPlayer, configs))
+	{
+		printUsage();
+		return 1;
+	}
+
+	RaceTrackData data;
+	if (!data.load(track))
+	{
+		return 1;
+	}
+
+	// Race i of every configuration uses seed + i, so configurations are compared on the same races
+	const RaceSimulator simulator(&data, &settings);
+	const int total = static_cast<int>(configs.size()) * races;
+	vector<vector<SCarResult>> results(total);
+
+	JobSystem jobs(workers);
+	JobGraph graph;
+	graph.addParallelFor("sim.races", [total] { return total; }, 4, [&](int first, int last)
+	{
+		for (int i = first; i < last; i++)
+		{
+			simulator.run(configs[i / races], seed + i % races, results[i]);
+		}
+	});
+
+	cout << "Simulating " << total << " races (" << configs.size() << " configurations) on " << jobs.getWorkerCount() + 1 << " threads" << endl;
+	const auto start = chrono::steady_clock::now();
+	jobs.run(graph);
+	const double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+	cout << total << " races in " << seconds << "s (" << total / max(seconds, 1e-6) << " races/s)" << endl;
+
+	for (unsigned int i = 0; i < configs.size(); i++)
+	{
+		report(configs[i], results, i * races, (i + 1) * races);
+	}
+	return 0;
+}
+
+void SimulatorCommand::printUsage()
+{
+	cout << "Usage: DesertRacer " << kFlag << " [--track file] [--races N] [--seed S] [--threads N] [--laps N]" << endl
+		<< "       [--time-limit seconds] [--player script|ai] [--set key=v1,v2,...]..." << endl
+		<< "Every combination of the --set values is raced. Keys:";
+	vector<string> keys;
+	for (const auto& setter : kSetters)
+	{
+		keys.push_back(setter.first);
+	}
+	sort(keys.begin(), keys.end());
+	for (const string& key : keys)
+	{
+		cout << " " << key;
+	}
+	cout << endl;
+}
+
+bool SimulatorCommand::expandSweep(const vector<string>& sweep, bool aiPlayer, vector<SSimulationConfig>& configs)
+{
+	configs.assign(1, SSimulationConfig());
+	configs.front().aiPlayer = aiPlayer;
+
+	for (const string& entry : sweep)
+	{
+		const size_t equals = entry.find('=');
+		const string key = entry.substr(0, equals);
+		if (equals == string::npos || !kSetters.count(key))
+		{
+			cout << "Unknown setting " << entry << endl;
+			return false;
+		}
+
+		// Every configuration so far, once per value
+		vector<SSimulationConfig> expanded;
+		stringstream values(entry.substr(equals + 1));
+		string value;
+		while (getline(values, value, ','))
+		{
+			float number;
+			try
+			{
+				number = stof(value);
+			}
+			catch (const exception&)
+			{
+				cout << "Bad value for " << key << ": " << value << endl;
+				return false;
+			}
+
+			for (SSimulationConfig config : configs)
+			{
+				kSetters.at(key)(config, number);
+				config.name += (config.name.empty() ? "" : " ") + key + "=" + value;
+				expanded.push_back(config);
+			}
+		}
+
+		if (expanded.empty())
+		{
+			cout << "No values for " << key << endl;
+			return false;
+		}
+		configs.swap(expanded);
+	}
+	return true;
+}
+
+void SimulatorCommand::report(const SSimulationConfig& config, const vector<vector<SCarResult>>& races, int first, int last)
+{
+	const int cars = static_cast<int>(races[first].size());
+	const int raceCount = last - first;
+	vector<SCarTotals> totals(cars);
+
+	for (int race = first; race < last; race++)
+	{
+		for (int car = 0; car < cars; car++)
+		{
+			const SCarResult& result = races[race][car];
+			SCarTotals& total = totals[car];
+			total.positions.resize(cars, 0);
+			++total.positions[result.position - 1];
+			total.collisions += result.collisions;
+			if (result.finished)
+			{
+				++total.finished;
+				total.finishTime += result.time;
+			}
+			if (result.laps)
+			{
+				total.bestLap = total.laps ? min(total.bestLap, result.bestLap) : result.bestLap;
+				total.lapTime += result.lapTotal;
+				total.laps += result.laps;
+			}
+		}
+	}
+
+	cout << endl << "[" << (config.name.empty() ? "defaults" : config.name) << "] " << raceCount << " races, "
+		<< (config.aiPlayer ? "AI" : "scripted") << " player" << endl;
+	cout << "  car      avg pos  finish s  avg lap s  best lap s  collisions  DNF %  position % (1st..)" << endl;
+	cout << fixed;
+
+	for (int car = 0; car < cars; car++)
+	{
+		const SCarTotals& total = totals[car];
+		double positionSum = 0.0;
+		for (int position = 0; position < cars; position++)
+		{
+			positionSum += (position + 1.0) * total.positions[position];
+		}
+
+		const string name = car ? "CPU #" + to_string(car) : "Player";
+		cout << "  " << left << setw(8) << name << right << setprecision(2)
+			<< setw(8) << positionSum / raceCount
+			<< setw(10) << (total.finished ? total.finishTime / total.finished : 0.0)
+			<< setw(11) << (total.laps ? total.lapTime / total.laps : 0.0)
+			<< setw(12) << total.bestLap
+			<< setw(12) << static_cast<double>(total.collisions) / raceCount
+			<< setprecision(1) << setw(7) << 100.0 * (raceCount - total.finished) / raceCount << " ";
+		for (int position = 0; position < cars; position++)
+		{
+			cout << setw(6) << 100.0 * total.positions[position] / raceCount;
+		}
+		cout << endl;
+	}
+	cout << defaultfloat;
+}
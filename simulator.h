@@ -0,0 +1,236 @@
+/**
+ * @file simulator.h
+ * Thousands of headless races with the game's rules, for balancing the tuning tables
+ *
+ * @author Jacob Sanchez Perez (G20812080) <jsanchez-perez@uclan.ac.uk>
+ * Games Concepts (CO1301), University of Central Lancashire
+ */
+
+#ifndef DESERT_RACER_SIMULATOR_H
+#define DESERT_RACER_SIMULATOR_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include "vector.h"
+#include "ai.h"
+#include "racecar.h"
+#include "raceenv.h"
+#include "replay.h"
+#include "snapshot.h"
+#include "statehash.h"
+#include "telemetry.h"
+
+
+namespace desert
+{
+	// One combination of tuning values, raced many times
+	struct SSimulationConfig
+	{
+		// Values changed from the defaults, "key=value ..." (empty for none)
+		std::string name;
+		SHoverAITuning ai = HoverAI::kDefaultTuning;
+		SHoverCarTuning player = HoverCar::kDefaultTuning;
+		// The player's car is driven by the AI rules instead of the script
+		bool aiPlayer = false;
+	};
+
+	struct SSimulationSettings
+	{
+		// Fixed time step of every race
+		float kDeltaTime = 1.0f / 60.0f;
+		float kGameSpeed = 1.0f;
+		int kLaps = 3;
+		// Cars still racing after this long do not finish (seconds)
+		float kTimeLimit = 300.0f;
+		// Random offset of every car's start position, so races differ beyond the AI speeds
+		float kStartJitter = 1.0f;
+
+		// Scripted player, drives the racing line
+		// Distance ahead of the car's progress it steers towards
+		float kScriptLookahead = 15.0f;
+		// Heading error that gets full lock (degrees)
+		float kScriptFullTurn = 10.0f;
+		// Speed below the target at which it stops using full thrust
+		float kScriptThrottleBand = 10.0f;
+		// Distance around the last progress searched for the new one
+		float kLineSearchWindow = 20.0f;
+		// Between rows of cars added behind the track's grid, when a race has more cars than it
+		float kGridSpacing = 15.0f;
+	};
+
+	// How one car did in one race
+	struct SCarResult
+	{
+		// 1 is the winner, cars that did not finish are ranked by how far they got
+		int position;
+		bool finished;
+		// Seconds to finish, or until the car was wrecked / ran out of time
+		float time;
+		// Seconds, zero if no lap was completed
+		float bestLap;
+		float lapTotal;
+		int laps;
+		int collisions;
+	};
+
+	/**
+	* A whole race (the player and every AI of the grid) without an engine
+	* Same rules and tick order as DesertRacetrack, except that the race goes on until every car is done:
+	* finished cars leave the track, wrecked ones too
+	*/
+	class RaceSimulator
+	{
+	public:
+		static const SSimulationSettings kDefaultSettings;
+
+		/**
+		* @param track Loaded track, must outlive the simulator
+		*/
+		RaceSimulator(const RaceTrackData* track, const SSimulationSettings* settings = &kDefaultSettings);
+
+		/**
+		* Race once, same seed same race
+		* AI unique speeds come from the seed's AI streams like in the game, start offsets from its race streams
+		* @param results One per car, the player's first
+		*/
+		void run(const SSimulationConfig& config, uint64_t seed, std::vector<SCarResult>& results) const;
+		/**
+		* Race the recording's seed with the player driven by its input, one recorded tick per tick
+		* Laps are the simulator's, set them to the recording's
+		* @param hashes Filled with the state hash of every tick, if not null
+		* @param telemetry Every car of every tick is published to it, if not null
+		* @return Hash of the final state of every car (same recording, same hash)
+		*/
+		uint64_t replay(const InputRecording& recording, const SSimulationConfig& config, std::vector<SCarResult>& results,
+			StateHashStream* hashes = nullptr, TelemetryStream* telemetry = nullptr) const;
+
+		// Player controls of a set of input bits (see HoverCar::InputBit)
+		static SRaceAction decodeInput(uint8_t input);
+
+		// Mutable state of one car
+		struct SSimCar
+		{
+			// Position, movement, stage and lap (every car), the rest only for players
+			SHeadlessCar car;
+			// Heading, progress, invulnerability and health of cars using the AI rules
+			HoverAI::SHoverAIState ai;
+			HoverAI::SHoverAIDriver driver;
+			bool usesAI = false;
+			bool racing = true;
+			// AI push from a player this tick (see HoverAI::modifyMovementVector)
+			bool pushed = false;
+			SVector2D push;
+			// Players: progress of the script along the racing line, boost drag and what the car hit this tick
+			float lineDistance = 0.0f;
+			float boostDrag = 1.0f;
+			Collision::CollisionAxis axis = Collision::None;
+			// Seconds the current lap started at
+			float lapStart = 0.0f;
+			SCarResult result;
+		};
+
+		// A race stepped one tick at a time by its owner
+		struct SSession
+		{
+			const SSimulationConfig* config = nullptr;
+			std::vector<SSimCar> cars;
+			float time = 0.0f;
+			int racing = 0;
+			unsigned int tick = 0;
+		};
+
+		/**
+		* Put the cars on the grid (rows are added behind it if there are more cars than places)
+		* @param config Must outlive the session
+		* @param humans Cars [0, humans) are driven by the actions given to every step, the rest by the AI rules
+		*/
+		void start(SSession& session, const SSimulationConfig& config, uint64_t seed, int cars, int humans) const;
+		/**
+		* One tick of the race, same order as DesertRacetrack
+		* @param actions One per car, only those of racing players are read
+		* @return False once every car is done
+		*/
+		bool step(SSession& session, const SRaceAction* actions, float kDeltaTime) const;
+		// Rank the cars where they are
+		void finish(SSession& session, std::vector<SCarResult>& results) const;
+		// Everything a session changes (not its config), as DesertRacetrack snapshots a race
+		static void saveSession(const SSession& session, std::vector<char>& buffer);
+		// Returns false if the snapshot is of a session with a different number of cars
+		static bool restoreSession(SSession& session, const std::vector<char>& buffer);
+		// Gameplay state of a car, as hashed and sent over the network
+		static SHashedCar hashedCar(const SSimCar& car);
+		// Telemetry of a car (no race position, the simulator ranks cars when the race is over)
+		static STelemetrySample telemetrySample(const SSimCar& car, int index, const SSession& session);
+	protected:
+		/**
+		* @param recording Player input and time steps, null to script the player and use fixed steps
+		* @param hashes Hash stream of every tick, null for none
+		* @param telemetry Telemetry of every tick, null for none
+		* @return Hash of the final state
+		*/
+		uint64_t race(const SSimulationConfig& config, uint64_t seed, const InputRecording* recording, std::vector<SCarResult>& results,
+			StateHashStream* hashes = nullptr, TelemetryStream* telemetry = nullptr) const;
+		void resetCar(SSimCar& car, int slot, bool human, const SSimulationConfig& config, const RandomService& random) const;
+		SGridSlot gridSlot(int slot) const;
+		// Drive the racing line with the player's controls
+		SRaceAction script(const SSimCar& car, float& lineDistance) const;
+		// Heading / thrust of a car using the AI rules, from the state at the start of the tick
+		void steer(SSimCar& car) const;
+		// Returns true when the car completes its last lap
+		bool passCheckpoints(SSimCar& car, float time) const;
+		// Snapshot read by the AI rules and by the race order
+		SVehicleSnapshot snapshot(const SSimCar& car) const;
+		// FNV-1a over the simulated state of every car
+		static uint64_t hashState(const std::vector<SSimCar>& cars);
+
+		const RaceTrackData* mTrack;
+		const SSimulationSettings* mSettings;
+	};
+
+	/**
+	* Command line front end: DesertRacer --simulate [options]
+	* Races every configuration of a sweep across all cores and prints a compact report for each
+	*/
+	class SimulatorCommand
+	{
+	public:
+		// First argument that switches the game to simulation
+		static const std::string kFlag;
+
+		/**
+		* @param args Arguments after the flag
+		* @param defaultTrack Track raced if none is given
+		* @return Process exit code
+		*/
+		static int run(const std::vector<std::string>& args, const std::string& defaultTrack);
+	protected:
+		// Sets one tuning value of a configuration
+		typedef std::function<void(SSimulationConfig&, float)> Setter;
+		static const std::unordered_map<std::string, Setter> kSetters;
+
+		// Totals of one car slot over every race of a configuration
+		struct SCarTotals
+		{
+			std::vector<int> positions;
+			int finished = 0;
+			double finishTime = 0.0;
+			double lapTime = 0.0;
+			int laps = 0;
+			float bestLap = 0.0f;
+			long long collisions = 0;
+		};
+
+		static void printUsage();
+		/**
+		* Every combination of the values of a sweep ("key=v1,v2,..." each)
+		* @return False if a key or value is not understood
+		*/
+		static bool expandSweep(const std::vector<std::string>& sweep, bool aiPlayer, std::vector<SSimulationConfig>& configs);
+		static void report(const SSimulationConfig& config, const std::vector<std::vector<SCarResult>>& races, int first, int last);
+	};
+}
+
+#endif
@@ -0,0 +1,125 @@
+/**
+ * @file snapshot.cpp
+ * Flat buffers of simulation state, written and restored with plain copies
+ *
+ * @author Jacob Sanchez Perez (G20812080) <jsanchez-perez@uclan.ac.uk>
+ * Games Concepts (CO1301), University of Central Lancashire
+ */
+
+#include <algorithm>
+#include "snapshot.h"
+
+using namespace std;
+using namespace desert;
+
+
+SnapshotWriter::SnapshotWriter(vector<char>& buffer) : mBuffer(buffer)
+{
+	mBuffer.clear();
+}
+
+void SnapshotWriter::write(const void* data, size_t size)
+{
+	const size_t offset = mBuffer.size();
+	mBuffer.resize(offset + size);
+	if (size)
+	{
+		memcpy(&mBuffer[offset], data, size);
+	}
+}
+
+
+SnapshotReader::SnapshotReader(const vector<char>& buffer) : mBuffer(buffer)
+{
+}
+
+bool SnapshotReader::isGood() const
+{
+	return mGood;
+}
+
+void SnapshotReader::fail()
+{
+	mGood = false;
+}
+
+void SnapshotReader::read(void* data, size_t size)
+{
+	if (!mGood || mOffset + size > mBuffer.size())
+	{
+		mGood = false;
+		memset(data, 0, size);
+		return;
+	}
+
+	if (size)
+	{
+		memcpy(data, &mBuffer[mOffset], size);
+	}
+	mOffset += size;
+}
+
+
+SnapshotRing::SnapshotRing(int capacity) : mSlots(max(capacity, 1))
+{
+}
+
+vector<char>& SnapshotRing::push(unsigned int tick)
+{
+	discardAfter(tick);
+	// A snapshot of the same tick replaces the old one
+	if (mCount && mSlots[mNewest].tick == tick)
+	{
+		return mSlots[mNewest].buffer;
+	}
+
+	mNewest = (mNewest + 1) % getCapacity();
+	mCount = min(mCount + 1, getCapacity());
+	mSlots[mNewest].tick = tick;
+	return mSlots[mNewest].buffer;
+}
+
+const vector<char>* SnapshotRing::find(unsigned int tick, unsigned int& found) const
+{
+	// Newest first, ticks only grow towards the newest
+	for (int i = 0; i < mCount; i++)
+	{
+		const SSlot& slot = mSlots[(mNewest - i + getCapacity()) % getCapacity()];
+		if (slot.tick <= tick)
+		{
+			found = slot.tick;
+			return &slot.buffer;
+		}
+	}
+	return nullptr;
+}
+
+void SnapshotRing::discardAfter(unsigned int tick)
+{
+	while (mCount && mSlots[mNewest].tick > tick)
+	{
+		mNewest = (mNewest - 1 + getCapacity()) % getCapacity();
+		--mCount;
+	}
+}
+
+void SnapshotRing::clear()
+{
+	mCount = 0;
+	mNewest = -1;
+}
+
+int SnapshotRing::getCount() const
+{
+	return mCount;
+}
+
+int SnapshotRing::getCapacity() const
+{
+	return static_cast<int>(mSlots.size());
+}
+
+unsigned int SnapshotRing::getOldestTick() const
+{
+	return mSlots[(mNewest - mCount + 1 + getCapacity()) % getCapacity()].tick;
+}
@@ -0,0 +1,133 @@
+/**
+ * @file snapshot.h
+ * Flat buffers of simulation state, written and restored with plain copies
+ *
+ * @author Jacob Sanchez Perez (G20812080) <jsanchez-perez@uclan.ac.uk>
+ * Games Concepts (CO1301), University of Central Lancashire
+ */
+
+#ifndef DESERT_RACER_SNAPSHOT_H
+#define DESERT_RACER_SNAPSHOT_H
+
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+
+namespace desert
+{
+	/**
+	* Appends blocks of trivially copyable state to a buffer
+	* The buffer keeps its capacity between snapshots, so a warm writer never allocates
+	*/
+	class SnapshotWriter
+	{
+	public:
+		// The buffer is emptied
+		explicit SnapshotWriter(std::vector<char>& buffer);
+
+		void write(const void* data, size_t size);
+
+		template <typename T>
+		void write(const T& value)
+		{
+			static_assert(std::is_trivially_copyable<T>::value, "Snapshots only hold plain data");
+			write(&value, sizeof(T));
+		}
+
+		// An array, its length first
+		template <typename T>
+		void writeArray(const std::vector<T>& values)
+		{
+			static_assert(std::is_trivially_copyable<T>::value, "Snapshots only hold plain data");
+			const uint32_t count = static_cast<uint32_t>(values.size());
+			write(count);
+			write(values.data(), count * sizeof(T));
+		}
+	protected:
+		std::vector<char>& mBuffer;
+	};
+
+	/**
+	* Reads blocks back in the order they were written
+	* Reading past the end fails the reader instead of the program
+	*/
+	class SnapshotReader
+	{
+	public:
+		explicit SnapshotReader(const std::vector<char>& buffer);
+
+		// False once a read went past the end (what was read is then zeroes) or the data did not fit
+		bool isGood() const;
+		// The snapshot does not fit what is being restored
+		void fail();
+		void read(void* data, size_t size);
+
+		template <typename T>
+		void read(T& value)
+		{
+			static_assert(std::is_trivially_copyable<T>::value, "Snapshots only hold plain data");
+			read(&value, sizeof(T));
+		}
+
+		// An array written by writeArray, it must have the same length as the one being restored
+		template <typename T>
+		void readArray(std::vector<T>& values)
+		{
+			static_assert(std::is_trivially_copyable<T>::value, "Snapshots only hold plain data");
+			uint32_t count = 0;
+			read(count);
+			if (count != values.size())
+			{
+				fail();
+				return;
+			}
+			read(values.data(), count * sizeof(T));
+		}
+	protected:
+		const std::vector<char>& mBuffer;
+		size_t mOffset = 0;
+		bool mGood = true;
+	};
+
+	/**
+	* The snapshots of the last N ticks, oldest overwritten first
+	* Buffers are reused, once every slot has been written snapshots cost no allocations
+	*/
+	class SnapshotRing
+	{
+	public:
+		explicit SnapshotRing(int capacity);
+
+		// Buffer to write the snapshot of a tick into (any snapshot of a later tick is dropped)
+		std::vector<char>& push(unsigned int tick);
+		/**
+		* Latest snapshot at or before a tick
+		* @param found Tick of the snapshot returned
+		* @return Null if the ring holds nothing that old
+		*/
+		const std::vector<char>* find(unsigned int tick, unsigned int& found) const;
+		// Drop every snapshot after a tick (the race was rewound to it)
+		void discardAfter(unsigned int tick);
+		void clear();
+
+		int getCount() const;
+		int getCapacity() const;
+		// Tick of the oldest snapshot held, only valid if the ring is not empty
+		unsigned int getOldestTick() const;
+	protected:
+		struct SSlot
+		{
+			unsigned int tick;
+			std::vector<char> buffer;
+		};
+
+		std::vector<SSlot> mSlots;
+		// Slot of the newest snapshot
+		int mNewest = -1;
+		int mCount = 0;
+	};
+}
+
+#endif
@@ -0,0 +1,253 @@
+/**
+ * @file statehash.cpp
+ * Running hash of the gameplay state of every tick, to find where two runs of a race part ways
+ *
+ * @author Jacob Sanchez Perez (G20812080) <jsanchez-perez@uclan.ac.uk>
+ * Games Concepts (CO1301), University of Central Lancashire
+ */
+
+#include <iostream>
+#include <fstream>
+#include <cstring>
+#include <algorithm>
+#include "statehash.h"
+
+using namespace std;
+using namespace desert;
+
+const string StateHashStream::kFileExtension = ".hashes";
+const uint32_t StateHashStream::kFileMagic = 0x48535244;
+const uint32_t StateHashStream::kFileVersion = 1;
+const uint64_t StateHashStream::kOffsetBasis = 14695981039346656037ull;
+const uint64_t StateHashStream::kPrime = 1099511628211ull;
+
+const char* const StateHashStream::kFieldNames[kFieldsNumber] =
+{
+	"position.x", "position.z", "movement.x", "movement.z", "heading", "boostTimer", "boostPenaltyTimer", "damageTimer",
+	"invTimer", "lineDistance", "health", "stage", "lap", "racing"
+};
+
+static_assert(sizeof(SHashedCar) % sizeof(uint32_t) == 0, "Hashed fields are 4 bytes each");
+
+
+void StateHashStream::begin(int cars)
+{
+	mCars = cars;
+	mHashes.clear();
+	mTimes.clear();
+	mValues.clear();
+}
+
+uint64_t StateHashStream::record(float time, const SHashedCar* cars)
+{
+	// FNV-style (FNV-1a constants, a 32-bit word at a time rather than a byte): each tick carries on from the last one's hash
+	uint64_t hash = mHashes.empty() ? kOffsetBasis : mHashes.back();
+	auto add = [&hash](const void* data, size_t size)
+	{
+		const unsigned char* bytes = static_cast<const unsigned char*>(data);
+		for (size_t i = 0; i < size; i += sizeof(uint32_t))
+		{
+			uint32_t word;
+			memcpy(&word, bytes + i, sizeof(word));
+			hash = (hash ^ word) * kPrime;
+		}
+	};
+
+	add(&time, sizeof(time));
+	add(cars, mCars * sizeof(SHashedCar));
+
+	mHashes.push_back(hash);
+	mTimes.push_back(time);
+	mValues.insert(mValues.end(), cars, cars + mCars);
+	return hash;
+}
+
+bool StateHashStream::save(const string& filename) const
+{
+	ofstream file(filename, ios::binary);
+
+	if (!file.is_open())
+	{
+		cout << "File IO error when opening " << filename << endl;
+		return false;
+	}
+
+	const int32_t cars = mCars;
+	const uint32_t ticks = static_cast<uint32_t>(mHashes.size());
+	file.write(reinterpret_cast<const char*>(&kFileMagic), sizeof(kFileMagic));
+	file.write(reinterpret_cast<const char*>(&kFileVersion), sizeof(kFileVersion));
+	file.write(reinterpret_cast<const char*>(&cars), sizeof(cars));
+	file.write(reinterpret_cast<const char*>(&ticks), sizeof(ticks));
+	file.write(reinterpret_cast<const char*>(mHashes.data()), ticks * sizeof(uint64_t));
+	file.write(reinterpret_cast<const char*>(mTimes.data()), ticks * sizeof(float));
+	file.write(reinterpret_cast<const char*>(mValues.data()), mValues.size() * sizeof(SHashedCar));
+
+	return file.good();
+}
+
+bool StateHashStream::load(const string& filename)
+{
+	ifstream file(filename, ios::binary);
+
+	if (!file.is_open())
+	{
+		return false;
+	}
+
+	uint32_t magic = 0, version = 0, ticks = 0;
+	int32_t cars = 0;
+	file.read(reinterpret_cast<char*>(&magic), sizeof(magic));
+	file.read(reinterpret_cast<char*>(&version), sizeof(version));
+	file.read(reinterpret_cast<char*>(&cars), sizeof(cars));
+	file.read(reinterpret_cast<char*>(&ticks), sizeof(ticks));
+
+	if (!file.good() || magic != kFileMagic || version != kFileVersion || cars < 0)
+	{
+		cout << filename << " is not a hash stream (or is from another version)" << endl;
+		return false;
+	}
+
+	mCars = cars;
+	mHashes.resize(ticks);
+	mTimes.resize(ticks);
+	mValues.resize(static_cast<size_t>(ticks) * cars);
+	file.read(reinterpret_cast<char*>(mHashes.data()), ticks * sizeof(uint64_t));
+	file.read(reinterpret_cast<char*>(mTimes.data()), ticks * sizeof(float));
+	file.read(reinterpret_cast<char*>(mValues.data()), mValues.size() * sizeof(SHashedCar));
+
+	if (!file.good())
+	{
+		cout << filename << " is truncated" << endl;
+		begin(0);
+		return false;
+	}
+	return true;
+}
+
+int StateHashStream::getTicksNumber() const
+{
+	return static_cast<int>(mHashes.size());
+}
+
+int StateHashStream::getCarsNumber() const
+{
+	return mCars;
+}
+
+uint64_t StateHashStream::getHash(int tick) const
+{
+	return mHashes[tick];
+}
+
+float StateHashStream::getTime(int tick) const
+{
+	return mTimes[tick];
+}
+
+const SHashedCar& StateHashStream::getCar(int tick, int car) const
+{
+	return mValues[static_cast<size_t>(tick) * mCars + car];
+}
+
+uint64_t StateHashStream::getFinalHash() const
+{
+	return mHashes.empty() ? kOffsetBasis : mHashes.back();
+}
+
+bool StateHashStream::findDivergence(const StateHashStream& reference, SDivergence& divergence) const
+{
+	if (mCars != reference.mCars)
+	{
+		divergence = { 0, -1, CarsField, static_cast<uint32_t>(reference.mCars), static_cast<uint32_t>(mCars) };
+		return true;
+	}
+
+	const int ticks = min(getTicksNumber(), reference.getTicksNumber());
+
+	// Hashes are chained, the first tick that differs is the first tick whose state did
+	int tick = 0;
+	while (tick < ticks && mHashes[tick] == reference.mHashes[tick])
+	{
+		++tick;
+	}
+
+	if (tick == ticks)
+	{
+		if (getTicksNumber() == reference.getTicksNumber())
+		{
+			return false;
+		}
+		divergence = { tick, -1, TicksField, static_cast<uint32_t>(reference.getTicksNumber()), static_cast<uint32_t>(getTicksNumber()) };
+		return true;
+	}
+
+	divergence = { tick, -1, 0, 0, 0 };
+	if (memcmp(&mTimes[tick], &reference.mTimes[tick], sizeof(float)))
+	{
+		memcpy(&divergence.expected, &reference.mTimes[tick], sizeof(float));
+		memcpy(&divergence.actual, &mTimes[tick], sizeof(float));
+		return true;
+	}
+
+	for (int car = 0; car < mCars; car++)
+	{
+		uint32_t expected[kFieldsNumber], actual[kFieldsNumber];
+		memcpy(expected, &reference.mValues[static_cast<size_t>(tick) * mCars + car], sizeof(SHashedCar));
+		memcpy(actual, &mValues[static_cast<size_t>(tick) * mCars + car], sizeof(SHashedCar));
+
+		for (int field = 0; field < kFieldsNumber; field++)
+		{
+			if (expected[field] != actual[field])
+			{
+				divergence = { tick, car, field, expected[field], actual[field] };
+				return true;
+			}
+		}
+	}
+
+	divergence = { tick, -1, HashField, 0, 0 };
+	return true;
+}
+
+void StateHashStream::printDivergence(ostream& out, const SDivergence& divergence)
+{
+	out << "Diverged at tick " << divergence.tick << ": ";
+
+	switch (divergence.field)
+	{
+	case TicksField:
+		out << divergence.actual << " ticks instead of " << divergence.expected << endl;
+		return;
+	case CarsField:
+		out << divergence.actual << " cars instead of " << divergence.expected << endl;
+		return;
+	case HashField:
+		out << "the hash differs but every value matches" << endl;
+		return;
+	}
+
+	const bool isFloat = divergence.car < 0 || divergence.field < kFloatFields;
+	if (divergence.car < 0)
+	{
+		out << "race time";
+	}
+	else
+	{
+		out << "car " << divergence.car << " " << kFieldNames[divergence.field];
+	}
+
+	if (isFloat)
+	{
+		float expected, actual;
+		memcpy(&expected, &divergence.expected, sizeof(float));
+		memcpy(&actual, &divergence.actual, sizeof(float));
+		const streamsize precision = out.precision(9);
+		out << " is " << actual << " instead of " << expected;
+		out.precision(precision);
+	}
+	else
+	{
+		out << " is " << static_cast<int32_t>(divergence.actual) << " instead of " << static_cast<int32_t>(divergence.expected);
+	}
+	out << hex << " (bits " << divergence.actual << " / " << divergence.expected << ")" << dec << endl;
+}
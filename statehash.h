@@ -0,0 +1,112 @@
+/**
+ * @file statehash.h
+ * Running hash of the gameplay state of every tick, to find where two runs of a race part ways
+ *
+ * @author Jacob Sanchez Perez (G20812080) <jsanchez-perez@uclan.ac.uk>
+ * Games Concepts (CO1301), University of Central Lancashire
+ */
+
+#ifndef DESERT_RACER_STATE_HASH_H
+#define DESERT_RACER_STATE_HASH_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <ostream>
+
+
+namespace desert
+{
+	/**
+	* Gameplay relevant state of one car at the end of a tick
+	* Every field is 4 bytes and hashed by its exact bits, fields a car does not use stay zero
+	*/
+	struct SHashedCar
+	{
+		float positionX = 0.0f, positionY = 0.0f;
+		float movementX = 0.0f, movementY = 0.0f;
+		float heading = 0.0f;
+		float boostTimer = 0.0f, boostPenaltyTimer = 0.0f, damageTimer = 0.0f;
+		// AI only
+		float invTimer = 0.0f, lineDistance = 0.0f;
+		int32_t health = 0;
+		int32_t stage = 0, lap = 0;
+		int32_t racing = 0;
+	};
+
+	/**
+	* Hashes of every tick of a race, each chained to the one before, and the values they were taken from
+	* Comparing two streams costs one compare per tick until they differ, the values then tell which field did
+	*/
+	class StateHashStream
+	{
+	public:
+		static const std::string kFileExtension;
+
+		// Divergences that are not about a field of a car
+		enum StreamField
+		{
+			// The number of ticks (every tick both have matches)
+			TicksField = -1,
+			CarsField = -2,
+			// The tick hash, its values all match (the stream is corrupt)
+			HashField = -3
+		};
+
+		// Where two streams first differ
+		struct SDivergence
+		{
+			int tick;
+			// -1 for the race time or a StreamField
+			int car;
+			// Field of the car in declaration order, or a StreamField
+			int field;
+			uint32_t expected, actual;
+		};
+
+		// Start a new stream, dropping the previous one
+		void begin(int cars);
+		/**
+		* Hash the state at the end of a tick
+		* @param cars One per car, as many as the stream began with
+		* @return Hash of this tick, covering every tick before it
+		*/
+		uint64_t record(float time, const SHashedCar* cars);
+
+		bool save(const std::string& filename) const;
+		bool load(const std::string& filename);
+
+		int getTicksNumber() const;
+		int getCarsNumber() const;
+		uint64_t getHash(int tick) const;
+		// Race time and a car's values at the end of a tick
+		float getTime(int tick) const;
+		const SHashedCar& getCar(int tick, int car) const;
+		// Hash of the last tick, the offset basis if nothing was recorded
+		uint64_t getFinalHash() const;
+
+		/**
+		* First tick, car and field that differ from a reference
+		* @return False if both streams are the same
+		*/
+		bool findDivergence(const StateHashStream& reference, SDivergence& divergence) const;
+		static void printDivergence(std::ostream& out, const SDivergence& divergence);
+	protected:
+		static const uint32_t kFileMagic;
+		static const uint32_t kFileVersion;
+		static const int kFieldsNumber = sizeof(SHashedCar) / sizeof(uint32_t);
+		// Field names in declaration order, and which of them are floats
+		static const char* const kFieldNames[kFieldsNumber];
+		static const int kFloatFields = 10;
+
+		static const uint64_t kOffsetBasis;
+		static const uint64_t kPrime;
+
+		int mCars = 0;
+		std::vector<uint64_t> mHashes;
+		std::vector<float> mTimes;
+		std::vector<SHashedCar> mValues;
+	};
+}
+
+#endif
@@ -0,0 +1,243 @@
+/**
+ * @file telemetry.cpp
+ * Live vehicle telemetry, handed from the race to a writer thread without locks
+ *
+ * @author Jacob Sanchez Perez (G20812080) <jsanchez-perez@uclan.ac.uk>
+ * Games Concepts (CO1301), University of Central Lancashire
+ */
+
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+#include <iostream>
+#include <chrono>
+#include <cstring>
+#include "telemetry.h"
+
+using namespace std;
+using namespace desert;
+
+const string TelemetryStream::kFlag = "--telemetry";
+const string TelemetryStream::kSocketPrefix = "unix:";
+const uint32_t TelemetryStream::kMagic = 0x54525244;
+const uint32_t TelemetryStream::kVersion = 1;
+
+#ifdef MSG_NOSIGNAL
+// A reader that went away must not kill the game
+static const int kSendFlags = MSG_NOSIGNAL;
+#else
+static const int kSendFlags = 0;
+#endif
+
+
+TelemetryStream::~TelemetryStream()
+{
+	close();
+}
+
+bool TelemetryStream::open(const string& target)
+{
+	close();
+	if (!openSink(target))
+	{
+		return false;
+	}
+
+	const uint32_t header[3] = { kMagic, kVersion, static_cast<uint32_t>(sizeof(STelemetrySample)) };
+	if (!write(header, sizeof(header)))
+	{
+		cout << "Telemetry could not be written to " << target << endl;
+		closeSink();
+		return false;
+	}
+
+	mTarget = target;
+	mStopping = false;
+	mFailed = false;
+	mRing.reset(kRingCapacity);
+	mWriter = thread(&TelemetryStream::writerLoop, this);
+	cout << "Streaming telemetry to " << target << endl;
+	return true;
+}
+
+void TelemetryStream::close()
+{
+	if (!mWriter.joinable())
+	{
+		return;
+	}
+
+	mStopping = true;
+	mWriter.join();
+	closeSink();
+	mRing.reset(0);
+	printStats();
+}
+
+bool TelemetryStream::isOpen() const
+{
+	return mWriter.joinable();
+}
+
+void TelemetryStream::publish(const STelemetrySample& sample)
+{
+	if (!mWriter.joinable())
+	{
+		return;
+	}
+
+	++mPublished;
+	// Full: the writer is behind, the sample is lost rather than waited for
+	if (!mRing.tryPush(sample))
+	{
+		++mDropped;
+	}
+}
+
+long long TelemetryStream::getPublished() const
+{
+	return mPublished;
+}
+
+long long TelemetryStream::getDropped() const
+{
+	return mDropped;
+}
+
+long long TelemetryStream::getWritten() const
+{
+	return mWritten;
+}
+
+void TelemetryStream::printStats() const
+{
+	cout << "Telemetry: " << mPublished << " samples published, " << mWritten << " written to " << mTarget << ", " << mDropped << " dropped" << endl;
+}
+
+bool TelemetryStream::openSink(const string& target)
+{
+	if (target.compare(0, kSocketPrefix.size(), kSocketPrefix))
+	{
+		mFile = fopen(target.c_str(), "wb");
+		if (!mFile)
+		{
+			cout << "File IO error when opening " << target << endl;
+			return false;
+		}
+		return true;
+	}
+
+#ifdef _WIN32
+	cout << "Unix sockets are not supported on this platform, stream to a file instead" << endl;
+	return false;
+#else
+	const string path = target.substr(kSocketPrefix.size());
+	sockaddr_un address = {};
+	address.sun_family = AF_UNIX;
+	if (path.empty() || path.size() >= sizeof(address.sun_path))
+	{
+		cout << "Socket path " << path << " is empty or too long" << endl;
+		return false;
+	}
+	memcpy(address.sun_path, path.c_str(), path.size());
+
+	const int handle = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (handle == -1 || connect(handle, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0)
+	{
+		cout << "Nothing is listening on " << path << endl;
+		if (handle != -1)
+		{
+			::close(handle);
+		}
+		return false;
+	}
+	mSocket = handle;
+	return true;
+#endif
+}
+
+bool TelemetryStream::write(const void* data, size_t size)
+{
+	if (mFile)
+	{
+		return fwrite(data, 1, size, mFile) == size;
+	}
+
+#ifndef _WIN32
+	// Blocking is fine here, only the writer waits for the socket
+	const char* bytes = static_cast<const char*>(data);
+	while (size)
+	{
+		const ssize_t sent = send(static_cast<int>(mSocket), bytes, size, kSendFlags);
+		if (sent <= 0)
+		{
+			return false;
+		}
+		bytes += sent;
+		size -= static_cast<size_t>(sent);
+	}
+	return true;
+#else
+	return false;
+#endif
+}
+
+void TelemetryStream::closeSink()
+{
+	if (mFile)
+	{
+		fclose(mFile);
+		mFile = nullptr;
+	}
+#ifndef _WIN32
+	if (mSocket != -1)
+	{
+		::close(static_cast<int>(mSocket));
+		mSocket = -1;
+	}
+#endif
+}
+
+void TelemetryStream::writerLoop()
+{
+	vector<STelemetrySample> batch(kWriteBatch);
+	for (;;)
+	{
+		// Read before taking the samples, so that everything published before close() is written
+		const bool stopping = mStopping;
+		const size_t count = mRing.popBatch(batch.data(), kWriteBatch);
+
+		if (count)
+		{
+			if (!mFailed && write(batch.data(), count * sizeof(STelemetrySample)))
+			{
+				mWritten += count;
+			}
+			else
+			{
+				// The reader is gone (or the disk full), the race goes on without it
+				if (!mFailed)
+				{
+					cout << "Telemetry target " << mTarget << " failed, samples are dropped from now on" << endl;
+				}
+				mFailed = true;
+				mDropped += count;
+			}
+		}
+		else if (stopping)
+		{
+			break;
+		}
+		else
+		{
+			this_thread::sleep_for(chrono::milliseconds(1));
+		}
+	}
+
+	if (mFile)
+	{
+		fflush(mFile);
+	}
+}
@@ -0,0 +1,179 @@
+/**
+ * @file telemetry.h
+ * Live vehicle telemetry, handed from the race to a writer thread without locks
+ *
+ * @author Jacob Sanchez Perez (G20812080) <jsanchez-perez@uclan.ac.uk>
+ * Games Concepts (CO1301), University of Central Lancashire
+ */
+
+#ifndef DESERT_RACER_TELEMETRY_H
+#define DESERT_RACER_TELEMETRY_H
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+
+
+namespace desert
+{
+	/**
+	* Fixed size queue between exactly one producer thread and one consumer thread, no locks
+	* Each side owns one index and only reads the other's, a full queue refuses instead of waiting
+	*/
+	template <typename T>
+	class SpscRing
+	{
+	public:
+		/**
+		* Allocate the items (rounded up to a power of two, 0 frees them) and empty the queue
+		* Only while neither side is using it
+		*/
+		void reset(size_t capacity)
+		{
+			size_t size = capacity ? 2 : 0;
+			while (size && size < capacity)
+			{
+				size <<= 1;
+			}
+			std::vector<T>(size).swap(mItems);
+			mMask = size ? size - 1 : 0;
+			mHead.store(0, std::memory_order_relaxed);
+			mTail.store(0, std::memory_order_relaxed);
+		}
+
+		// Producer only, returns false (and keeps nothing) if the consumer has not made room
+		bool tryPush(const T& item)
+		{
+			const size_t head = mHead.load(std::memory_order_relaxed);
+			if (head - mTail.load(std::memory_order_acquire) > mMask)
+			{
+				return false;
+			}
+			mItems[head & mMask] = item;
+			// Publishes the item before the index that makes it visible
+			mHead.store(head + 1, std::memory_order_release);
+			return true;
+		}
+
+		/**
+		* Consumer only, takes what is waiting (up to the maximum)
+		* @return Items taken
+		*/
+		size_t popBatch(T* items, size_t maximum)
+		{
+			const size_t tail = mTail.load(std::memory_order_relaxed);
+			const size_t count = std::min(mHead.load(std::memory_order_acquire) - tail, maximum);
+			for (size_t i = 0; i < count; i++)
+			{
+				items[i] = mItems[(tail + i) & mMask];
+			}
+			// Frees the slots once they were copied out
+			mTail.store(tail + count, std::memory_order_release);
+			return count;
+		}
+
+		size_t getCapacity() const
+		{
+			return mItems.size();
+		}
+	protected:
+		// Padding rather than alignas, the ring lives in heap objects and new does not over-align before C++17
+		static const size_t kCacheLine = 64;
+
+		// A cache line apart, each side writes one of them all the time
+		std::atomic<size_t> mHead{ 0 };
+		char mHeadPadding[kCacheLine - sizeof(std::atomic<size_t>)];
+		std::atomic<size_t> mTail{ 0 };
+		char mTailPadding[kCacheLine - sizeof(std::atomic<size_t>)];
+		size_t mMask = 0;
+		std::vector<T> mItems;
+	};
+
+	// One vehicle at the end of one tick, written as is (little endian, 40 bytes)
+	struct STelemetrySample
+	{
+		uint32_t tick = 0;
+		// Race time (seconds)
+		float time = 0.0f;
+		float x = 0.0f, z = 0.0f;
+		// Units per second
+		float velocityX = 0.0f, velocityZ = 0.0f;
+		int32_t health = 0;
+		int32_t stage = 0;
+		// 0 for the player, AI i is i + 1
+		uint8_t vehicle = 0;
+		// HoverCar::BoostState, Inactive for AI
+		uint8_t boostState = 0;
+		// 1 is leading, 0 if not ranked
+		uint8_t racePosition = 0;
+		uint8_t padding = 0;
+		uint32_t reserved = 0;
+	};
+
+	/**
+	* Samples published by the race thread, written by a background thread to a file or a local socket
+	* Publishing never blocks: if the writer falls behind, samples are dropped and counted
+	* The stream starts with a header (magic, version, sample size) followed by the samples
+	*/
+	class TelemetryStream
+	{
+	public:
+		// Argument of the game that streams a race's telemetry
+		static const std::string kFlag;
+		// Targets starting with this are Unix domain sockets, anything else is a file
+		static const std::string kSocketPrefix;
+		static const size_t kRingCapacity = 16384;
+
+		~TelemetryStream();
+
+		/**
+		* Start the writer, the ring is only allocated while streaming
+		* @param target "unix:/path/to/socket" (a listening stream socket) or a file name
+		*/
+		bool open(const std::string& target);
+		// Stop the writer once it wrote what is waiting, and free the ring
+		void close();
+		bool isOpen() const;
+
+		// Race thread only
+		void publish(const STelemetrySample& sample);
+
+		long long getPublished() const;
+		long long getDropped() const;
+		long long getWritten() const;
+		// Published / dropped / written, one line
+		void printStats() const;
+	protected:
+		static const uint32_t kMagic;
+		static const uint32_t kVersion;
+		// Samples the writer takes from the ring at once
+		static const size_t kWriteBatch = 1024;
+
+		bool openSink(const std::string& target);
+		bool write(const void* data, size_t size);
+		void closeSink();
+		void writerLoop();
+
+		SpscRing<STelemetrySample> mRing;
+		std::thread mWriter;
+		std::atomic<bool> mStopping{ false };
+		// One of them is open while streaming
+		std::FILE* mFile = nullptr;
+		intptr_t mSocket = -1;
+		std::string mTarget;
+
+		// Counted by the race thread (dropped by the writer too), read by anyone
+		std::atomic<long long> mPublished{ 0 };
+		std::atomic<long long> mDropped{ 0 };
+		// Counted by the writer, which drops what it cannot write once the target fails
+		std::atomic<long long> mWritten{ 0 };
+		bool mFailed = false;
+	};
+}
+
+#endif
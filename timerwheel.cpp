@@ -0,0 +1,218 @@
+/**
+ * @file timerwheel.cpp
+ * Timers of the whole scene in one hierarchical wheel, advanced once per frame
+ *
+ * @author Jacob Sanchez Perez (G20812080) <jsanchez-perez@uclan.ac.uk>
+ * Games Concepts (CO1301), University of Central Lancashire
+ */
+
+#include <cmath>
+#include <utility>
+#include "timerwheel.h"
+
+using namespace std;
+using namespace desert;
+
+const float TimerWheel::kDefaultResolution = 0.01f;
+
+
+TimerWheel::TimerWheel(float resolution) : mResolution(resolution)
+{
+}
+
+TimerWheel::TimerId TimerWheel::schedule(float delay, function<void()> callback)
+{
+	uint32_t index;
+	if (!mFree.empty())
+	{
+		index = mFree.back();
+		mFree.pop_back();
+	}
+	else
+	{
+		index = static_cast<uint32_t>(mTimers.size());
+		mTimers.emplace_back();
+	}
+
+	// Whole steps, counted from the next one (the time already elapsed towards it included)
+	const double steps = ceil((max(delay, 0.0f) + mElapsed) / mResolution);
+	STimer& timer = mTimers[index];
+	timer.deadline = mNow + max(static_cast<uint64_t>(steps), static_cast<uint64_t>(1));
+	timer.pending = true;
+	timer.callback = move(callback);
+	++mPending;
+	place(index);
+
+	return (static_cast<TimerId>(timer.generation) << 32) | (index + 1);
+}
+
+bool TimerWheel::cancel(TimerId& id)
+{
+	STimer* timer = find(id);
+	id = kNoTimer;
+	if (!timer)
+	{
+		return false;
+	}
+
+	// Its slot entry stays, and is dropped when the slot comes round
+	release(static_cast<uint32_t>(timer - mTimers.data()));
+	return true;
+}
+
+bool TimerWheel::isPending(TimerId id) const
+{
+	return find(id) != nullptr;
+}
+
+float TimerWheel::getRemaining(TimerId id) const
+{
+	const STimer* timer = find(id);
+	if (!timer)
+	{
+		return 0.0f;
+	}
+	return static_cast<float>(timer->deadline - mNow) * mResolution - mElapsed;
+}
+
+void TimerWheel::advance(float deltaTime)
+{
+	mElapsed += deltaTime;
+	const uint64_t steps = static_cast<uint64_t>(mElapsed / mResolution);
+	mElapsed -= steps * mResolution;
+
+	if (!mPending)
+	{
+		// Nothing waits, so no slot needs looking at
+		mNow += steps;
+		return;
+	}
+
+	for (uint64_t i = 0; i < steps; i++)
+	{
+		step();
+	}
+}
+
+void TimerWheel::clear()
+{
+	for (auto& level : mSlots)
+	{
+		for (auto& slot : level)
+		{
+			slot.clear();
+		}
+	}
+	for (uint32_t i = 0; i < mTimers.size(); i++)
+	{
+		if (mTimers[i].pending)
+		{
+			release(i);
+		}
+	}
+}
+
+int TimerWheel::getPendingNumber() const
+{
+	return mPending;
+}
+
+long long TimerWheel::getFiredNumber() const
+{
+	return mFired;
+}
+
+void TimerWheel::place(uint32_t index)
+{
+	const STimer& timer = mTimers[index];
+	const SEntry entry = { index, timer.generation };
+	const uint64_t remaining = timer.deadline - mNow;
+
+	for (int level = 0; level < kLevels; level++)
+	{
+		const int shift = kSlotBits * level;
+		if (remaining < (static_cast<uint64_t>(kSlots) << shift) || level == kLevels - 1)
+		{
+			// Beyond the top level it waits a turn there and is placed again
+			const uint64_t deadline = min(timer.deadline, mNow + (static_cast<uint64_t>(kSlots) << shift) - 1);
+			mSlots[level][(deadline >> shift) & (kSlots - 1)].push_back(entry);
+			return;
+		}
+	}
+}
+
+void TimerWheel::step()
+{
+	++mNow;
+
+	// A level's slot comes round each time the levels below complete a turn
+	for (int level = 1; level < kLevels; level++)
+	{
+		const int shift = kSlotBits * level;
+		if (mNow & ((static_cast<uint64_t>(1) << shift) - 1))
+		{
+			break;
+		}
+
+		vector<SEntry>& slot = mSlots[level][(mNow >> shift) & (kSlots - 1)];
+		mDue.swap(slot);
+		for (const SEntry& entry : mDue)
+		{
+			if (mTimers[entry.index].pending && mTimers[entry.index].generation == entry.generation)
+			{
+				place(entry.index);
+			}
+		}
+		mDue.clear();
+	}
+
+	vector<SEntry>& slot = mSlots[0][mNow & (kSlots - 1)];
+	if (slot.empty())
+	{
+		return;
+	}
+
+	// Taken out first, callbacks scheduling new timers never land in it (they are at least a step away)
+	mDue.swap(slot);
+	for (const SEntry& entry : mDue)
+	{
+		STimer& timer = mTimers[entry.index];
+		if (!timer.pending || timer.generation != entry.generation)
+		{
+			continue;
+		}
+
+		function<void()> callback = move(timer.callback);
+		release(entry.index);
+		++mFired;
+		callback();
+	}
+	mDue.clear();
+}
+
+TimerWheel::STimer* TimerWheel::find(TimerId id)
+{
+	const uint64_t index = (id & 0xFFFFFFFF) - 1;
+	if (id == kNoTimer || index >= mTimers.size())
+	{
+		return nullptr;
+	}
+
+	STimer& timer = mTimers[index];
+	return timer.pending && timer.generation == (id >> 32) ? &timer : nullptr;
+}
+
+const TimerWheel::STimer* TimerWheel::find(TimerId id) const
+{
+	return const_cast<TimerWheel*>(this)->find(id);
+}
+
+void TimerWheel::release(uint32_t index)
+{
+	STimer& timer = mTimers[index];
+	timer.pending = false;
+	timer.callback = nullptr;
+	++timer.generation;
+	mFree.push_back(index);
+	--mPending;
+}
@@ -0,0 +1,98 @@
+/**
+ * @file timerwheel.h
+ * Timers of the whole scene in one hierarchical wheel, advanced once per frame
+ *
+ * @author Jacob Sanchez Perez (G20812080) <jsanchez-perez@uclan.ac.uk>
+ * Games Concepts (CO1301), University of Central Lancashire
+ */
+
+#ifndef DESERT_RACER_TIMER_WHEEL_H
+#define DESERT_RACER_TIMER_WHEEL_H
+
+#include <vector>
+#include <cstdint>
+#include <functional>
+
+
+namespace desert
+{
+	/**
+	* Callbacks run once their delay has passed, nothing is polled while it waits
+	* Time moves in steps of a fixed resolution. Level 0 has a slot per step, each level above a slot per
+	* whole turn of the one below, timers move down a level when their slot comes round
+	* A step costs the timers due in it (and, once per turn of a level, those moving down), no timers cost nothing
+	*/
+	class TimerWheel
+	{
+	public:
+		// 0 is never a timer
+		typedef uint64_t TimerId;
+		static const TimerId kNoTimer = 0;
+		// Seconds per step
+		static const float kDefaultResolution;
+
+		explicit TimerWheel(float resolution = kDefaultResolution);
+
+		/**
+		* Run a callback after a delay (rounded up to whole steps, at least one)
+		* The callback may schedule and cancel timers
+		*/
+		TimerId schedule(float delay, std::function<void()> callback);
+		// Stop a timer that has not run yet, the id is set to kNoTimer
+		bool cancel(TimerId& id);
+		bool isPending(TimerId id) const;
+		// Seconds until a timer runs, zero if it is not pending
+		float getRemaining(TimerId id) const;
+
+		// Move time on, running every callback due in deadline order
+		void advance(float deltaTime);
+		// Drop every timer without running it
+		void clear();
+
+		int getPendingNumber() const;
+		long long getFiredNumber() const;
+	protected:
+		static const int kLevels = 4;
+		static const int kSlotBits = 6;
+		static const int kSlots = 1 << kSlotBits;
+
+		struct STimer
+		{
+			uint64_t deadline = 0;
+			// Bumped when the timer is done, so old ids and slot entries no longer match
+			uint32_t generation = 1;
+			bool pending = false;
+			std::function<void()> callback;
+		};
+
+		// A timer in a slot, dropped when it comes round if the timer was cancelled since
+		struct SEntry
+		{
+			uint32_t index;
+			uint32_t generation;
+		};
+
+		// Put a timer in the slot of its deadline, the lowest level that reaches it
+		void place(uint32_t index);
+		// One step: move the slots that came round down, then run the timers due
+		void step();
+		STimer* find(TimerId id);
+		const STimer* find(TimerId id) const;
+		void release(uint32_t index);
+
+		const float mResolution;
+		// Steps taken, and time left over towards the next one
+		uint64_t mNow = 0;
+		float mElapsed = 0.0f;
+
+		std::vector<STimer> mTimers;
+		std::vector<uint32_t> mFree;
+		std::vector<SEntry> mSlots[kLevels][kSlots];
+		// Slot being run, kept to reuse its memory
+		std::vector<SEntry> mDue;
+		int mPending = 0;
+		long long mFired = 0;
+	};
+}
+
+#endif
@@ -0,0 +1,303 @@
+/**
+ * @file transform.cpp
+ * CPU-side mirror of scene node transforms
+ *
+ * @author Jacob Sanchez Perez (G20812080) <jsanchez-perez@uclan.ac.uk>
+ * Games Concepts (CO1301), University of Central Lancashire
+ */
+
+#include <TL-Engine.h>
+#include <cmath>
+#include <algorithm>
+#include "vector.h"
+#include "transform.h"
+
+using namespace tle;
+using namespace desert;
+
+const float TransformMirror::kDegreesToRadians = 3.14159265358979f / 180.0f;
+
+
+int TransformMirror::track(ISceneNode* node)
+{
+	mNodes.push_back(node);
+	mTransforms.push_back(STransform());
+	mPending.push_back(false);
+
+	// Only engine read this node will ever need
+	node->GetMatrix(&mTransforms.back().matrix[0][0]);
+	++mEngineCalls;
+
+	return static_cast<int>(mNodes.size()) - 1;
+}
+
+void TransformMirror::clear()
+{
+	mNodes.clear();
+	mTransforms.clear();
+	mPending.clear();
+}
+
+void TransformMirror::submit()
+{
+	mLastSubmitted = 0;
+
+	for (unsigned int i = 0; i < mNodes.size(); i++)
+	{
+		if (mPending[i])
+		{
+			mNodes[i]->SetMatrix(&mTransforms[i].matrix[0][0]);
+			mPending[i] = false;
+			++mLastSubmitted;
+		}
+	}
+
+	mEngineCalls += mLastSubmitted;
+}
+
+void TransformMirror::saveState(SnapshotWriter& writer) const
+{
+	const uint32_t count = static_cast<uint32_t>(mTransforms.size());
+	writer.write(count);
+	writer.write(mTransforms.data(), count * sizeof(STransform));
+}
+
+void TransformMirror::loadState(SnapshotReader& reader)
+{
+	uint32_t count = 0;
+	reader.read(count);
+
+	// Nodes are only ever added, a snapshot never has more than the mirror
+	if (count > mTransforms.size())
+	{
+		reader.fail();
+		return;
+	}
+
+	reader.read(mTransforms.data(), count * sizeof(STransform));
+	fill(mPending.begin(), mPending.begin() + count, true);
+}
+
+void TransformMirror::queue(int slot)
+{
+	// Without the mirror every command would have been an engine call
+	countCalls(1);
+	mPending[slot] = true;
+}
+
+void TransformMirror::countCalls(int calls)
+{
+	mCallsRequested[JobSystem::getThreadIndex()].calls += calls;
+}
+
+float TransformMirror::axisScale(const float* axis)
+{
+	return sqrt(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+}
+
+void TransformMirror::setPosition(int slot, SVector3D position)
+{
+	float* translation = mTransforms[slot].matrix[3];
+	translation[0] = position.x;
+	translation[1] = position.y;
+	translation[2] = position.z;
+	queue(slot);
+}
+
+void TransformMirror::setY(int slot, float y)
+{
+	mTransforms[slot].matrix[3][1] = y;
+	queue(slot);
+}
+
+void TransformMirror::move(int slot, SVector3D offset)
+{
+	float* translation = mTransforms[slot].matrix[3];
+	translation[0] += offset.x;
+	translation[1] += offset.y;
+	translation[2] += offset.z;
+	queue(slot);
+}
+
+void TransformMirror::moveLocal(int slot, SVector3D offset)
+{
+	float (&m)[4][4] = mTransforms[slot].matrix;
+
+	for (int i = 0; i < 3; i++)
+	{
+		m[3][i] += offset.x * m[0][i] + offset.y * m[1][i] + offset.z * m[2][i];
+	}
+	queue(slot);
+}
+
+void TransformMirror::rotate(int slot, Axis axis, float degrees, bool local)
+{
+	const float c = cos(degrees * kDegreesToRadians);
+	const float s = sin(degrees * kDegreesToRadians);
+
+	// Rotation matrices as used by DirectX (row vectors, left handed)
+	float r[3][3] = { { 1, 0, 0 }, { 0, 1, 0 }, { 0, 0, 1 } };
+	switch (axis)
+	{
+	case XAxis:
+		r[1][1] = c; r[1][2] = s;
+		r[2][1] = -s; r[2][2] = c;
+		break;
+	case YAxis:
+		r[0][0] = c; r[0][2] = -s;
+		r[2][0] = s; r[2][2] = c;
+		break;
+	case ZAxis:
+		r[0][0] = c; r[0][1] = s;
+		r[1][0] = -s; r[1][1] = c;
+		break;
+	}
+
+	float (&m)[4][4] = mTransforms[slot].matrix;
+	float result[3][3];
+
+	for (int i = 0; i < 3; i++)
+	{
+		for (int j = 0; j < 3; j++)
+		{
+			// Local rotations apply before the current orientation, world ones after it
+			result[i][j] = local ?
+				r[i][0] * m[0][j] + r[i][1] * m[1][j] + r[i][2] * m[2][j] :
+				m[i][0] * r[0][j] + m[i][1] * r[1][j] + m[i][2] * r[2][j];
+		}
+	}
+
+	for (int i = 0; i < 3; i++)
+	{
+		for (int j = 0; j < 3; j++)
+		{
+			m[i][j] = result[i][j];
+		}
+	}
+	queue(slot);
+}
+
+void TransformMirror::lookAt(int slot, SVector3D target)
+{
+	float (&m)[4][4] = mTransforms[slot].matrix;
+	const SVector3D worldUp = { 0, 1, 0 };
+	SVector3D zAxis = target - SVector3D{ m[3][0], m[3][1], m[3][2] };
+
+	// Already there, nothing to look at
+	if (zAxis.isZero())
+	{
+		return;
+	}
+
+	zAxis = zAxis.unit();
+	SVector3D xAxis = worldUp.cross(zAxis);
+	xAxis = xAxis.isZero() ? SVector3D{ 1, 0, 0 } : xAxis.unit();
+	const SVector3D yAxis = zAxis.cross(xAxis);
+
+	const SVector3D axes[3] = { xAxis, yAxis, zAxis };
+	for (int i = 0; i < 3; i++)
+	{
+		const float scale = axisScale(m[i]);
+		m[i][0] = axes[i].x * scale;
+		m[i][1] = axes[i].y * scale;
+		m[i][2] = axes[i].z * scale;
+	}
+	queue(slot);
+}
+
+void TransformMirror::resetOrientation(int slot)
+{
+	float (&m)[4][4] = mTransforms[slot].matrix;
+
+	for (int i = 0; i < 3; i++)
+	{
+		const float scale = axisScale(m[i]);
+		for (int j = 0; j < 3; j++)
+		{
+			m[i][j] = (i == j) ? scale : 0.0f;
+		}
+	}
+	queue(slot);
+}
+
+void TransformMirror::setRotationY(int slot, float degrees)
+{
+	float (&m)[4][4] = mTransforms[slot].matrix;
+	const float c = cos(degrees * kDegreesToRadians);
+	const float s = sin(degrees * kDegreesToRadians);
+	const float rows[3][3] = { { c, 0, -s }, { 0, 1, 0 }, { s, 0, c } };
+
+	for (int i = 0; i < 3; i++)
+	{
+		const float scale = axisScale(m[i]);
+		for (int j = 0; j < 3; j++)
+		{
+			m[i][j] = rows[i][j] * scale;
+		}
+	}
+	queue(slot);
+}
+
+SVector3D TransformMirror::position(int slot)
+{
+	countCalls(kPositionCalls);
+	const float* translation = mTransforms[slot].matrix[3];
+	return { translation[0], translation[1], translation[2] };
+}
+
+SVector2D TransformMirror::position2D(int slot)
+{
+	countCalls(kPosition2DCalls);
+	const float* translation = mTransforms[slot].matrix[3];
+	return { translation[0], translation[2] };
+}
+
+SVector3D TransformMirror::facing(int slot)
+{
+	countCalls(kFacingCalls);
+	const float* zAxis = mTransforms[slot].matrix[2];
+	return { zAxis[0], zAxis[1], zAxis[2] };
+}
+
+SVector2D TransformMirror::facing2D(int slot)
+{
+	countCalls(kFacingCalls);
+	const float* zAxis = mTransforms[slot].matrix[2];
+	return { zAxis[0], zAxis[2] };
+}
+
+void TransformMirror::getMatrix(int slot, float* matrix)
+{
+	countCalls(kFacingCalls);
+	const STransform& transform = mTransforms[slot];
+
+	for (int i = 0; i < 16; i++)
+	{
+		matrix[i] = transform.matrix[i / 4][i % 4];
+	}
+}
+
+long long TransformMirror::getCallsRequested() const
+{
+	long long total = 0;
+	for (const SCallCounter& counter : mCallsRequested)
+	{
+		total += counter.calls;
+	}
+	return total;
+}
+
+long long TransformMirror::getEngineCalls() const
+{
+	return mEngineCalls;
+}
+
+long long TransformMirror::getCallsSaved() const
+{
+	return getCallsRequested() - mEngineCalls;
+}
+
+int TransformMirror::getLastSubmitted() const
+{
+	return mLastSubmitted;
+}
@@ -0,0 +1,127 @@
+/**
+ * @file transform.h
+ * CPU-side mirror of scene node transforms
+ *
+ * @author Jacob Sanchez Perez (G20812080) <jsanchez-perez@uclan.ac.uk>
+ * Games Concepts (CO1301), University of Central Lancashire
+ */
+
+#ifndef DESERT_RACER_TRANSFORM_H
+#define DESERT_RACER_TRANSFORM_H
+
+#include <TL-Engine.h>
+#include <vector>
+#include "vector.h"
+#include "jobs.h"
+#include "snapshot.h"
+
+
+namespace desert
+{
+	/**
+	* Keeps the world matrix of every tracked node in one contiguous array
+	* The simulation reads and writes these copies only; changed nodes are queued
+	* (once per node, however many times they change) and written to the engine in
+	* a single pass by submit()
+	*/
+	class TransformMirror
+	{
+	public:
+		enum Axis
+		{
+			XAxis,
+			YAxis,
+			ZAxis
+		};
+
+		/**
+		* Start mirroring a node (its current transform is read once)
+		* Not while other threads use the mirror, slots may move in memory
+		* @param node TL-Engine scene node, must not have a parent
+		* @return Slot of the node in the mirror
+		*/
+		int track(tle::ISceneNode* node);
+		// Stop mirroring every node
+		void clear();
+		// Write every changed transform to the engine, one call per node
+		void submit();
+		/**
+		* Every mirrored matrix, as one block
+		* Nodes tracked after the snapshot (new particles) keep their transform when it is restored
+		*/
+		void saveState(SnapshotWriter& writer) const;
+		// Restored nodes are all written by the next submit
+		void loadState(SnapshotReader& reader);
+
+		// TRANSFORM COMMANDS //
+
+		void setPosition(int slot, SVector3D position);
+		void setY(int slot, float y);
+		// Move in world space
+		void move(int slot, SVector3D offset);
+		// Move along the node's own axes
+		void moveLocal(int slot, SVector3D offset);
+		/**
+		* Rotate around an axis passing through the node's position
+		* @param degrees Angle in degrees (TL-Engine convention)
+		* @param local Use the node's axis instead of the world one
+		*/
+		void rotate(int slot, Axis axis, float degrees, bool local);
+		// Point the node's Z axis at a position, keeping the world up direction
+		void lookAt(int slot, SVector3D target);
+		// Clear all rotations (scale is kept)
+		void resetOrientation(int slot);
+		// Replace the orientation with a rotation around Y (scale is kept)
+		void setRotationY(int slot, float degrees);
+
+		// QUERIES //
+
+		SVector3D position(int slot);
+		SVector2D position2D(int slot);
+		SVector3D facing(int slot);
+		SVector2D facing2D(int slot);
+		// Copy the mirrored 4x4 world matrix
+		void getMatrix(int slot, float* matrix);
+
+		// Engine calls the queries / commands would have needed without the mirror
+		long long getCallsRequested() const;
+		// Engine calls the mirror actually made (reads + writes)
+		long long getEngineCalls() const;
+		long long getCallsSaved() const;
+		// Nodes written by the last submit
+		int getLastSubmitted() const;
+	protected:
+		struct STransform
+		{
+			float matrix[4][4];
+		};
+
+		// Engine calls that each kind of query needs without a mirror
+		static const int kPositionCalls = 3, kPosition2DCalls = 2, kFacingCalls = 1;
+		static const float kDegreesToRadians;
+
+		// Flag a node for the next submit
+		void queue(int slot);
+		// Add to the calling thread's request counter
+		void countCalls(int calls);
+		// Length of one of the matrix axes (the node's scale on that axis)
+		static float axisScale(const float* axis);
+
+		std::vector<STransform> mTransforms;
+		std::vector<tle::ISceneNode*> mNodes;
+		// Coalesced command buffer: one flag per node, set when it changes
+		std::vector<char> mPending;
+
+		// One counter per thread (a cache line apart), queries run in parallel stages
+		struct SCallCounter
+		{
+			long long calls = 0;
+			char padding[JobSystem::kCacheLine - sizeof(long long)];
+		};
+		SCallCounter mCallsRequested[JobSystem::kMaxThreads];
+		long long mEngineCalls = 0;
+		int mLastSubmitted = 0;
+	};
+}
+
+#endif
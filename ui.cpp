@@ -106,7 +106,7 @@ ISprite* DesertSprite::getISPrite()
 	return mSprite;
 }
 
-GameUI::GameUI(I3DEngine* myEngine) : kWindowH(myEngine->GetHeight()), kWindowW(myEngine->GetWidth())
+GameUI::GameUI(I3DEngine* myEngine, TimerWheel* timers) : kWindowH(myEngine->GetHeight()), kWindowW(myEngine->GetWidth()), mTimers(timers)
 {
 	const int smallUnit = 10,  doubleUnit = 20, reallyBigUnit = 60;
 	const unsigned int placeColour = 4279060385;
@@ -162,6 +162,8 @@ GameUI::GameUI(I3DEngine* myEngine) : kWindowH(myEngine->GetHeight()), kWindowW(
 
 GameUI::~GameUI()
 {
+	mTimers->cancel(mHideTimer);
+
 	// Free memory up
 	delete mTuxSprite;
 	delete mGoalSprite;
@@ -218,9 +220,12 @@ string GameUI::racePlaceAsString(int place)
 
 void GameUI::displayText(string text, bool goal, const float time, string subText)
 {
-	mShowForTime = time;
-
-	mTimeElapsed = 0.0f;
+	// A new text replaces the old one and its time (0 shows it until the next)
+	mTimers->cancel(mHideTimer);
+	if (time)
+	{
+		mHideTimer = mTimers->schedule(time, [this] { hideText(); });
+	}
 	mState = DesertSprite::ESpriteState::Shown;
 
 	if (goal)
@@ -264,23 +269,11 @@ void GameUI::setSummaryTime(string text)
 	mSummarySprite->setText(text, 1);
 }
 
-void GameUI::drawGameUI(const float kDeltaTime)
+void GameUI::drawGameUI()
 {
 	if (mState == DesertSprite::ESpriteState::Shown) {
-		mTimeElapsed += kDeltaTime;
-
-		if (mShowForTime && mTimeElapsed > mShowForTime)
-		{
-			mTimeElapsed = 0.0f;
-			mTuxSprite->setText("", 0);
-			mTuxSprite->setText("", 1);
-			mState = DesertSprite::ESpriteState::Hidden;
-		}
-		else
-		{
-			mTuxSprite->drawText();
-			mGoalSprite->drawText();
-		}
+		mTuxSprite->drawText();
+		mGoalSprite->drawText();
 	}
 
 	mLapSprite->drawText();
@@ -289,6 +282,14 @@ void GameUI::drawGameUI(const float kDeltaTime)
 	mSummarySprite->drawText();
 }
 
+void GameUI::hideText()
+{
+	mHideTimer = TimerWheel::kNoTimer;
+	mTuxSprite->setText("", 0);
+	mTuxSprite->setText("", 1);
+	mState = DesertSprite::ESpriteState::Hidden;
+}
+
 void GameUI::toggleLapSprite(bool on)
 {
 	mLapSprite->toggle(on);
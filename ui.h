@@ -13,6 +13,7 @@
 #include <string>
 #include <vector>
 #include "vector.h"
+#include "timerwheel.h"
 
 
 namespace desert
@@ -126,8 +127,9 @@ namespace desert
     public:
         /**
         * @param myEngine Pointer to TL-Engine running instance
+        * @param timers Wheel of the scene, hides the text shown for a time
         */
-        GameUI(tle::I3DEngine* myEngine);
+        GameUI(tle::I3DEngine* myEngine, TimerWheel* timers);
         // UI destructor
         GameUI::~GameUI();
         void remove(tle::I3DEngine* myEngine);
@@ -139,10 +141,8 @@ namespace desert
         * @param subText Subtitle to appear in the main dialog
         */
         void displayText(std::string text, bool goal, const float time, std::string subText = "");
-        /**
-        * @param kDeltaTime Time elapsed since last frame
-        */
-        void drawGameUI(const float kDeltaTime);
+        // Draws the texts of the frame
+        void drawGameUI();
         // Sets car health text
         void setHealthText(std::string text);
         // Sets car speed text
@@ -202,10 +202,13 @@ namespace desert
         DesertSprite *mBoostSprite, *mWarnSprite, *mOverheatSprite;
         DesertSprite *mSummarySprite;
 
+        // Clears the main dialog once its time is up
+        void hideText();
+
         DesertSprite::ESpriteState mState;
 
-        float mShowForTime;
-        float mTimeElapsed = 0.0f;
+        TimerWheel* mTimers;
+        TimerWheel::TimerId mHideTimer = TimerWheel::kNoTimer;
     };
 }
 
@@ -0,0 +1,177 @@
+/**
+ * @file vecbench.cpp
+ * Size and speed of the vector structs against their old virtual layout
+ *
+ * @author Jacob Sanchez Perez (G20812080) <jsanchez-perez@uclan.ac.uk>
+ * Games Concepts (CO1301), University of Central Lancashire
+ */
+
+#include <iostream>
+#include <chrono>
+#include <algorithm>
+#include "vecbench.h"
+
+using namespace std;
+using namespace desert;
+
+const string VectorBenchmarkCommand::kFlag = "--bench-vectors";
+
+
+int VectorBenchmarkCommand::run(const vector<string>& args)
+{
+	int count = 4096;
+	int passes = 2000;
+
+	// Options are "--name value"
+	for (unsigned int i = 0; i < args.size(); i++)
+	{
+		const string& option = args[i];
+		if (i + 1 >= args.size())
+		{
+			cout << "Missing value for " << option << endl;
+			printUsage();
+			return 1;
+		}
+		const string& value = args[++i];
+
+		try
+		{
+			if (option == "--count")
+			{
+				count = max(1, stoi(value));
+			}
+			else if (option == "--passes")
+			{
+				passes = max(1, stoi(value));
+			}
+			else
+			{
+				cout << "Unknown option " << option << " " << value << endl;
+				printUsage();
+				return 1;
+			}
+		}
+		catch (const exception&)
+		{
+			cout << "Bad value for " << option << ": " << value << endl;
+			return 1;
+		}
+	}
+
+	cout << "Sizes: 2D " << sizeof(SLegacyVector2D) << " -> " << sizeof(SVector2D) << " bytes, 3D " << sizeof(SLegacyVector3D) << " -> "
+		<< sizeof(SVector3D) << " bytes" << endl;
+	cout << "Times per vector over " << count << " vectors, " << passes << " passes (old / per vector / batch):" << endl;
+
+	// Same values in both layouts, nothing zero
+	vector<SLegacyVector3D> legacyPositions(count), legacyVelocities(count);
+	vector<SLegacyVector2D> legacyPoints(count);
+	vector<SVector3D> positions(count), velocities(count);
+	vector<SVector2D> points(count), directions(count);
+	vector<float> distances(count);
+	for (int i = 0; i < count; i++)
+	{
+		const float f = static_cast<float>(i % 97) + 1.0f;
+		legacyPositions[i] = { f, -f, 0.5f * f };
+		legacyVelocities[i] = { 0.1f, 0.2f * f, -0.3f };
+		legacyPoints[i] = { f, 2.0f - f };
+		positions[i] = { f, -f, 0.5f * f };
+		velocities[i] = { 0.1f, 0.2f * f, -0.3f };
+		points[i] = { f, 2.0f - f };
+	}
+	const float kDeltaTime = 1.0f / 60.0f;
+	const SLegacyVector2D legacyTarget = { 10.0f, 20.0f };
+	const SVector2D target = { 10.0f, 20.0f };
+	float sink = 0.0f;
+
+	// position += velocity * dt, as particles and cars move
+	const double legacyMove = time([&]
+	{
+		for (int i = 0; i < count; i++)
+		{
+			legacyPositions[i] += legacyVelocities[i] * kDeltaTime;
+		}
+	}, count, passes);
+	const double currentMove = time([&]
+	{
+		for (int i = 0; i < count; i++)
+		{
+			positions[i] += velocities[i] * kDeltaTime;
+		}
+	}, count, passes);
+	const double batchMove = time([&] { vectors::multiplyAdd(positions.data(), velocities.data(), kDeltaTime, count); }, count, passes);
+	report("move", legacyMove, currentMove, batchMove);
+
+	// Directions towards a target, as the AI steers
+	const double legacyUnit = time([&]
+	{
+		for (int i = 0; i < count; i++)
+		{
+			const SLegacyVector2D direction = (legacyPoints[i] - legacyTarget).unit();
+			sink += direction.x;
+		}
+	}, count, passes);
+	const double currentUnit = time([&]
+	{
+		for (int i = 0; i < count; i++)
+		{
+			directions[i] = (points[i] - target).unit();
+		}
+	}, count, passes);
+	const double batchUnit = time([&]
+	{
+		for (int i = 0; i < count; i++)
+		{
+			directions[i] = points[i] - target;
+		}
+		vectors::fastUnit(directions.data(), count);
+	}, count, passes);
+	report("normalise", legacyUnit, currentUnit, batchUnit);
+
+	// Distance to a target from every point, the old vectors have no squared length
+	const double legacyDistance = time([&]
+	{
+		for (int i = 0; i < count; i++)
+		{
+			distances[i] = (legacyPoints[i] - legacyTarget).length();
+		}
+	}, count, passes);
+	const double currentDistance = time([&]
+	{
+		for (int i = 0; i < count; i++)
+		{
+			distances[i] = (points[i] - target).lengthSquared();
+		}
+	}, count, passes);
+	const double batchDistance = time([&] { vectors::distancesSquared(points.data(), target, distances.data(), count); }, count, passes);
+	report("distances", legacyDistance, currentDistance, batchDistance);
+
+	// Keeps every loop's results alive
+	for (int i = 0; i < count; i++)
+	{
+		sink += legacyPositions[i].x + positions[i].x + directions[i].y + distances[i];
+	}
+	cout << "(checksum " << sink << ")" << endl;
+	return 0;
+}
+
+void VectorBenchmarkCommand::printUsage()
+{
+	cout << "Usage: DesertRacer " << kFlag << " [--count N] [--passes N]" << endl;
+}
+
+double VectorBenchmarkCommand::time(const function<void()>& pass, int count, int passes)
+{
+	// One pass untimed, so every layout starts with its arrays in cache
+	pass();
+	const auto start = chrono::steady_clock::now();
+	for (int i = 0; i < passes; i++)
+	{
+		pass();
+	}
+	return chrono::duration<double>(chrono::steady_clock::now() - start).count() / (static_cast<double>(count) * passes);
+}
+
+void VectorBenchmarkCommand::report(const string& name, double legacy, double current, double batch)
+{
+	cout << "  " << name << ": " << legacy * 1e9 << " / " << current * 1e9 << " / " << batch * 1e9 << " ns (" << legacy / batch << "x)" << endl;
+}
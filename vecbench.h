@@ -0,0 +1,116 @@
+/**
+ * @file vecbench.h
+ * Size and speed of the vector structs against their old virtual layout
+ *
+ * @author Jacob Sanchez Perez (G20812080) <jsanchez-perez@uclan.ac.uk>
+ * Games Concepts (CO1301), University of Central Lancashire
+ */
+
+#ifndef DESERT_RACER_VEC_BENCH_H
+#define DESERT_RACER_VEC_BENCH_H
+
+#include <string>
+#include <vector>
+#include <cmath>
+#include <functional>
+#include "vector.h"
+
+
+namespace desert
+{
+	/**
+	* Command line front end: DesertRacer --bench-vectors [--count N] [--passes N]
+	* Runs the same loops over arrays of the old vectors (virtual SVector base) and the current ones, per vector and in batches
+	* Prints the size of each layout and the time per vector of each loop
+	*/
+	class VectorBenchmarkCommand
+	{
+	public:
+		static const std::string kFlag;
+
+		/**
+		* @param args Arguments after the flag
+		* @return Process exit code
+		*/
+		static int run(const std::vector<std::string>& args);
+	protected:
+		// The vectors as they were, a vptr in front of the components
+		struct SLegacyVector
+		{
+			virtual float length() const = 0;
+			virtual bool isZero() const = 0;
+			virtual void zeroOut() = 0;
+		};
+
+		struct SLegacyVector3D : SLegacyVector
+		{
+			float x = 0, y = 0, z = 0;
+
+			SLegacyVector3D() {};
+			SLegacyVector3D(float xComp, float yComp, float zComp) : x(xComp), y(yComp), z(zComp) {};
+
+			SLegacyVector3D operator*(const float scalar) const
+			{
+				return { x * scalar, y * scalar, z * scalar };
+			}
+			void operator+=(const SLegacyVector3D& other)
+			{
+				x += other.x;
+				y += other.y;
+				z += other.z;
+			}
+			float length() const override
+			{
+				return sqrt(x * x + y * y + z * z);
+			}
+			bool isZero() const override
+			{
+				return x == 0 && y == 0 && z == 0;
+			}
+			void zeroOut() override
+			{
+				x = y = z = 0;
+			}
+		};
+
+		struct SLegacyVector2D : SLegacyVector
+		{
+			float x = 0, y = 0;
+
+			SLegacyVector2D() {};
+			SLegacyVector2D(float xComp, float yComp) : x(xComp), y(yComp) {};
+
+			SLegacyVector2D operator-(const SLegacyVector2D& other) const
+			{
+				return { x - other.x, y - other.y };
+			}
+			SLegacyVector2D operator/(const float scalar) const
+			{
+				return { x / scalar, y / scalar };
+			}
+			SLegacyVector2D unit() const
+			{
+				return (*this) / length();
+			}
+			float length() const override
+			{
+				return sqrt(x * x + y * y);
+			}
+			bool isZero() const override
+			{
+				return x == 0 && y == 0;
+			}
+			void zeroOut() override
+			{
+				x = y = 0;
+			}
+		};
+
+		static void printUsage();
+		// Seconds per vector of a pass over count vectors, repeated passes times
+		static double time(const std::function<void()>& pass, int count, int passes);
+		static void report(const std::string& name, double legacy, double current, double batch);
+	};
+}
+
+#endif
@@ -9,94 +9,103 @@
 #ifndef DESERT_RACER_VECTOR_H
 #define DESERT_RACER_VECTOR_H
 
-#include <cmath> // sqrt
+#include <cmath> // sqrt, fma
+#include <cstdint> // Float bits
+#include <cstring> // memcpy
 #include <string> // Output vector as string (mainly for debugging)
+#include <type_traits> // Layout checks
 
 #include <iostream>
 
 
 namespace desert
 {
-	// SVector interface
-	struct SVector
+	// Approximate 1 / sqrt(value) from the float's bits, refined twice (relative error under 5e-6), no intrinsics
+	inline float fastInverseSqrt(const float value)
 	{
-		virtual float length() const = 0;
-		virtual bool isZero() const = 0;
-		virtual void zeroOut() = 0;
-	};
+		uint32_t bits;
+		std::memcpy(&bits, &value, sizeof(bits));
+		bits = 0x5F375A86u - (bits >> 1);
+		float estimate;
+		std::memcpy(&estimate, &bits, sizeof(estimate));
+
+		estimate *= 1.5f - 0.5f * value * estimate * estimate;
+		return estimate * (1.5f - 0.5f * value * estimate * estimate);
+	}
 
 	/**
 	* 3D Vector struct
 	* Holds the data for a tridimensional vector
 	* Offers several operator overloads for convenience
+	* No virtual functions, so it is trivially copyable and can live in plain arrays
 	*/
-	struct SVector3D : SVector
+	struct SVector3D
 	{
 		float x = 0;
 		float y = 0;
 		float z = 0;
 
-		SVector3D() {};
-		SVector3D(float xComp, float yComp, float zComp) : x(xComp), y(yComp), z(zComp) {};
+		constexpr SVector3D() {};
+		constexpr SVector3D(float xComp, float yComp, float zComp) : x(xComp), y(yComp), z(zComp) {};
 
 		// Vector negation
-		SVector3D operator-() const
+		constexpr SVector3D operator-() const
 		{
 			return { -x, -y, -z };
 		}
 
 		// Vector addition
-		SVector3D operator+(const SVector3D& other) const
+		constexpr SVector3D operator+(const SVector3D& other) const
 		{
 			return { x + other.x, y + other.y, z + other.z };
 		}
 
 		// Vector substraction
-		SVector3D operator-(const SVector3D& other) const
+		constexpr SVector3D operator-(const SVector3D& other) const
 		{
 			return { x - other.x, y - other.y, z - other.z };
 		}
 
 		// Vector multiplication
-		SVector3D operator*(const SVector3D& other) const
+		constexpr SVector3D operator*(const SVector3D& other) const
 		{
 			return { x * other.x, y * other.y, z * other.z };
 		}
 
 		// Scalar addition
-		SVector3D operator+(const float scalar) const
+		constexpr SVector3D operator+(const float scalar) const
 		{
 			return { x + scalar, y + scalar, z + scalar };
 		}
 
 		// Scalar subtraction
-		SVector3D operator-(const float scalar) const
+		constexpr SVector3D operator-(const float scalar) const
 		{
 			return { x - scalar, y - scalar, z - scalar };
 		}
 
 		// Scalar multiplication
-		SVector3D operator*(const float scalar) const
+		constexpr SVector3D operator*(const float scalar) const
 		{
 			return { x * scalar, y * scalar, z * scalar };
 		}
 
 		// Scalar division
-		SVector3D operator/(const float scalar) const
+		constexpr SVector3D operator/(const float scalar) const
 		{
 			return { x / scalar, y / scalar, z / scalar };
 		}
 
 		// Vector addition assignment
-		void operator+=(const SVector3D& other)
+		constexpr void operator+=(const SVector3D& other)
 		{
 			x += other.x;
 			y += other.y;
-			z -= other.z;
+			z += other.z;
 		}
 
 		// Vector subtraction assignment
-		void operator-=(const SVector3D& other)
+		constexpr void operator-=(const SVector3D& other)
 		{
 			x -= other.x;
 			y -= other.y;
@@ -104,7 +113,7 @@ namespace desert
 		}
 
 		// Vector multiplication assignment
-		void operator*=(const SVector3D& other)
+		constexpr void operator*=(const SVector3D& other)
 		{
 			x *= other.x;
 			y *= other.y;
@@ -112,7 +121,7 @@ namespace desert
 		}
 
 		// Scalar multiplication assignment
-		void operator*=(const float scalar)
+		constexpr void operator*=(const float scalar)
 		{
 			x *= scalar;
 			y *= scalar;
@@ -120,16 +129,21 @@ namespace desert
 		}
 
 		// Return vector of each component squared
-		SVector3D squared() const
+		constexpr SVector3D squared() const
 		{
 			return (*this) * (*this);
 		}
 
+		// Squared vector length (no square root, good enough for comparisons)
+		constexpr float lengthSquared() const
+		{
+			return x * x + y * y + z * z;
+		}
+
 		// Vector length
 		float length() const
 		{
-			SVector3D s = squared();
-			return sqrt(s.x + s.y + s.z);
+			return sqrt(lengthSquared());
 		}
 
 		// Returns unit vector
@@ -138,14 +152,26 @@ namespace desert
 			return (*this) / length();
 		}
 
+		// Unit vector using an approximate reciprocal square root (vector must not be zero)
+		SVector3D fastUnit() const
+		{
+			return (*this) * fastInverseSqrt(lengthSquared());
+		}
+
+		// Returns this + (other * scalar), each component rounded once
+		SVector3D multiplyAdd(const SVector3D& other, const float scalar) const
+		{
+			return { std::fma(other.x, scalar, x), std::fma(other.y, scalar, y), std::fma(other.z, scalar, z) };
+		}
+
 		// Vector dot multiplication
-		float dot(const SVector3D& other) const
+		constexpr float dot(const SVector3D& other) const
 		{
 			return x * other.x + y * other.y + z * other.z;
 		}
 
 		// Vector cross multiplication
-		SVector3D cross(const SVector3D& other) const
+		constexpr SVector3D cross(const SVector3D& other) const
 		{
 			return { y * other.z - z * other.y, z * other.x - x * other.z, x * other.y - y * other.x };
 		}
@@ -157,13 +183,13 @@ namespace desert
 			return output;
 		}
 
-		bool isZero() const
+		constexpr bool isZero() const
 		{
 			return x == 0 && y == 0 && z == 0;
 		}
 
 		// Reset all components to zero
-		void zeroOut()
+		constexpr void zeroOut()
 		{
 			x = 0;
 			y = 0;
@@ -171,106 +197,116 @@ namespace desert
 		}
 	};
 
+	static_assert(sizeof(SVector3D) == 3 * sizeof(float), "SVector3D must be tightly packed");
+	static_assert(std::is_trivially_copyable<SVector3D>::value, "SVector3D must be trivially copyable");
+	static_assert(std::is_standard_layout<SVector3D>::value, "SVector3D must have standard layout");
+
 	/**
 	* 2D Vector struct
 	* Holds the data for a 2-dimensional vector
 	* Offers several operator overloads for convenience
+	* No virtual functions, so it is trivially copyable and can live in plain arrays
 	*/
-	struct SVector2D : SVector
+	struct SVector2D
 	{
 		float x = 0;
 		float y = 0;
 
-		SVector2D() {};
-		SVector2D(float xComp, float yComp) : x(xComp), y(yComp) {};
+		constexpr SVector2D() {};
+		constexpr SVector2D(float xComp, float yComp) : x(xComp), y(yComp) {};
 
 		// Vector negation
-		SVector2D operator-() const
+		constexpr SVector2D operator-() const
 		{
 			return { -x, -y };
 		}
 
 		// Vector addition
-		SVector2D operator+(const SVector2D& other) const
+		constexpr SVector2D operator+(const SVector2D& other) const
 		{
 			return { x + other.x, y + other.y };
 		}
 
 		// Vector subtraction
-		SVector2D operator-(const SVector2D& other) const
+		constexpr SVector2D operator-(const SVector2D& other) const
 		{
 			return { x - other.x, y - other.y };
 		}
 
 		// Vector multiplication
-		SVector2D operator*(const SVector2D& other) const
+		constexpr SVector2D operator*(const SVector2D& other) const
 		{
 			return { x * other.x, y * other.y };
 		}
 
 		// Scalar addition
-		SVector2D operator+(const float scalar) const
+		constexpr SVector2D operator+(const float scalar) const
 		{
 			return { x + scalar, y + scalar };
 		}
 
 		// Scalar subtraction
-		SVector2D operator-(const float scalar) const
+		constexpr SVector2D operator-(const float scalar) const
 		{
 			return { x - scalar, y - scalar };
 		}
 
 		// Scalar multiplication
-		SVector2D operator*(const float scalar) const
+		constexpr SVector2D operator*(const float scalar) const
 		{
 			return { x * scalar, y * scalar };
 		}
 
 		// Scalar division
-		SVector2D operator/(const float scalar) const
+		constexpr SVector2D operator/(const float scalar) const
 		{
 			return { x / scalar, y / scalar };
 		}
 
 		// Vector addition assignment
-		void operator+=(const SVector2D& other)
+		constexpr void operator+=(const SVector2D& other)
 		{
 			x += other.x;
 			y += other.y;
 		}
 
 		// Vector subtraction assignment
-		void operator-=(const SVector2D& other)
+		constexpr void operator-=(const SVector2D& other)
 		{
 			x -= other.x;
 			y -= other.y;
 		}
 
 		// Vector multiplication assignment
-		void operator*=(const SVector2D& other)
+		constexpr void operator*=(const SVector2D& other)
 		{
 			x *= other.x;
 			y *= other.y;
 		}
 
 		// Scalar multiplication assignment
-		void operator*=(const float scalar)
+		constexpr void operator*=(const float scalar)
 		{
 			x *= scalar;
 			y *= scalar;
 		}
 
 		// Returns vector with all components squared
-		SVector2D squared() const
+		constexpr SVector2D squared() const
 		{
 			return (*this) * (*this);
 		}
 
+		// Squared vector length (no square root, good enough for comparisons)
+		constexpr float lengthSquared() const
+		{
+			return x * x + y * y;
+		}
+
 		// Vector length
 		float length() const
 		{
-			SVector2D s = squared();
-			return sqrt(s.x + s.y);
+			return sqrt(lengthSquared());
 		}
 
 		// Unit vector
@@ -279,8 +315,20 @@ namespace desert
 			return (*this) / length();
 		}
 
+		// Unit vector using an approximate reciprocal square root (vector must not be zero)
+		SVector2D fastUnit() const
+		{
+			return (*this) * fastInverseSqrt(lengthSquared());
+		}
+
+		// Returns this + (other * scalar), each component rounded once
+		SVector2D multiplyAdd(const SVector2D& other, const float scalar) const
+		{
+			return { std::fma(other.x, scalar, x), std::fma(other.y, scalar, y) };
+		}
+
 		// Dot product
-		float dot(const SVector2D& other) const
+		constexpr float dot(const SVector2D& other) const
 		{
 			return x * other.x + y * other.y;
 		}
@@ -292,18 +340,100 @@ namespace desert
 			return output;
 		}
 
-		bool isZero() const
+		constexpr bool isZero() const
 		{
 			return x == 0 && y == 0;
 		}
 
 		// Reset components to zero
-		void zeroOut()
+		constexpr void zeroOut()
 		{
 			x = 0;
 			y = 0;
 		}
 	};
+
+	static_assert(sizeof(SVector2D) == 2 * sizeof(float), "SVector2D must be tightly packed");
+	static_assert(std::is_trivially_copyable<SVector2D>::value, "SVector2D must be trivially copyable");
+	static_assert(std::is_standard_layout<SVector2D>::value, "SVector2D must have standard layout");
+
+	/**
+	* Batch operations over contiguous vector arrays
+	* Plain loops over the array with no calls or aliasing between iterations, so the compiler vectorises them
+	*/
+	namespace vectors
+	{
+		// vectors[i] += others[i] * scalar, fused where the target has FMA (elsewhere std::fma is a slow library call)
+		inline void multiplyAdd(SVector2D* vectors, const SVector2D* others, const float scalar, const int count)
+		{
+			for (int i = 0; i < count; i++)
+			{
+#ifdef FP_FAST_FMAF
+				vectors[i].x = std::fma(others[i].x, scalar, vectors[i].x);
+				vectors[i].y = std::fma(others[i].y, scalar, vectors[i].y);
+#else
+				vectors[i].x += others[i].x * scalar;
+				vectors[i].y += others[i].y * scalar;
+#endif
+			}
+		}
+
+		// vectors[i] += others[i] * scalar, fused where the target has FMA
+		inline void multiplyAdd(SVector3D* vectors, const SVector3D* others, const float scalar, const int count)
+		{
+			for (int i = 0; i < count; i++)
+			{
+#ifdef FP_FAST_FMAF
+				vectors[i].x = std::fma(others[i].x, scalar, vectors[i].x);
+				vectors[i].y = std::fma(others[i].y, scalar, vectors[i].y);
+				vectors[i].z = std::fma(others[i].z, scalar, vectors[i].z);
+#else
+				vectors[i].x += others[i].x * scalar;
+				vectors[i].y += others[i].y * scalar;
+				vectors[i].z += others[i].z * scalar;
+#endif
+			}
+		}
+
+		// vectors[i] *= scalar
+		inline void scale(SVector2D* vectors, const float scalar, const int count)
+		{
+			for (int i = 0; i < count; i++)
+			{
+				vectors[i].x *= scalar;
+				vectors[i].y *= scalar;
+			}
+		}
+
+		// vectors[i] *= scalar
+		inline void scale(SVector3D* vectors, const float scalar, const int count)
+		{
+			for (int i = 0; i < count; i++)
+			{
+				vectors[i].x *= scalar;
+				vectors[i].y *= scalar;
+				vectors[i].z *= scalar;
+			}
+		}
+
+		// out[i] = squared distance between points[i] and target
+		inline void distancesSquared(const SVector2D* points, const SVector2D target, float* out, const int count)
+		{
+			for (int i = 0; i < count; i++)
+			{
+				out[i] = (points[i] - target).lengthSquared();
+			}
+		}
+
+		// vectors[i] = vectors[i].fastUnit() (none may be zero)
+		inline void fastUnit(SVector2D* vectors, const int count)
+		{
+			for (int i = 0; i < count; i++)
+			{
+				vectors[i] *= fastInverseSqrt(vectors[i].lengthSquared());
+			}
+		}
+	}
 }
 
 #endif
@@ -15,7 +15,7 @@ using namespace desert;
 
 DesertVehicle::DesertVehicle(IModel* m, VehicleType t) : SphereCollisionModel(m),  type(t)
 {
-
+	mShapeOwner = SCollisionShape::Vehicle;
 }
 
 void DesertVehicle::nextStage()
@@ -84,19 +84,24 @@ int DesertVehicle::getRacePosition()
 	return mRacePosition;
 }
 
-bool DesertVehicle::operator<(const DesertVehicle& other) const
+bool DesertVehicle::isAhead(int lapA, int stageA, float distanceA, int lapB, int stageB, float distanceB)
 {
-	if (mLap == other.mLap)
+	if (lapA == lapB)
 	{
-		if (mStage == other.mStage)
+		if (stageA == stageB)
 		{
-			return mDistanceToCheckpoint < other.mDistanceToCheckpoint;
+			return distanceA < distanceB;
 		}
 
-		return mStage > other.mStage;
+		return stageA > stageB;
 	}
 
-	return mLap > other.mLap;
+	return lapA > lapB;
+}
+
+bool DesertVehicle::operator<(const DesertVehicle& other) const
+{
+	return isAhead(mLap, mStage, mDistanceToCheckpoint, other.mLap, other.mStage, other.mDistanceToCheckpoint);
 }
 
 bool DesertVehicle::compare(DesertVehicle* a, DesertVehicle* b)
@@ -104,4 +109,41 @@ bool DesertVehicle::compare(DesertVehicle* a, DesertVehicle* b)
 	return *a < *b;
 }
 
-void DesertVehicle::resetWaypoint() {}
\ No newline at end of file
+bool DesertVehicle::compareSnapshots(const SVehicleSnapshot& a, const SVehicleSnapshot& b)
+{
+	return isAhead(a.lap, a.stage, a.distanceToCheckpoint, b.lap, b.stage, b.distanceToCheckpoint);
+}
+
+SVehicleSnapshot DesertVehicle::snapshot() const
+{
+	SVehicleSnapshot s;
+	s.position = position2D();
+	s.facing = getFacingVector2D();
+	s.movement = movementThisFrame;
+	s.distanceToCheckpoint = mDistanceToCheckpoint;
+	s.stage = mStage;
+	s.lap = mLap;
+	return s;
+}
+
+void DesertVehicle::resetWaypoint() {}
+
+void DesertVehicle::saveState(SnapshotWriter& writer) const
+{
+	CollisionModel::saveState(writer);
+	writer.write(movementThisFrame);
+	writer.write(mDistanceToCheckpoint);
+	writer.write(mStage);
+	writer.write(mLap);
+	writer.write(mRacePosition);
+}
+
+void DesertVehicle::loadState(SnapshotReader& reader)
+{
+	CollisionModel::loadState(reader);
+	reader.read(movementThisFrame);
+	reader.read(mDistanceToCheckpoint);
+	reader.read(mStage);
+	reader.read(mLap);
+	reader.read(mRacePosition);
+}
\ No newline at end of file
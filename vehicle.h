@@ -17,6 +17,20 @@
 
 namespace desert
 {
+	/**
+	* What other cars may know about a vehicle, captured once per tick
+	* Steering only reads these, never the live vehicles
+	*/
+	struct SVehicleSnapshot
+	{
+		SVector2D position;
+		SVector2D facing;
+		SVector2D movement;
+		float distanceToCheckpoint = 0.0f;
+		int stage = 0;
+		int lap = 0;
+	};
+
 	class DesertVehicle : public SphereCollisionModel, public VectorBasedMovement
 	{
 	public:
@@ -41,9 +55,18 @@ namespace desert
 		int getRacePosition();
 		bool operator<(const DesertVehicle& other) const;
 		static bool compare(DesertVehicle* a, DesertVehicle* b);
+		// Same order as compare, on snapshots
+		static bool compareSnapshots(const SVehicleSnapshot& a, const SVehicleSnapshot& b);
+		// Capture the state other cars read
+		SVehicleSnapshot snapshot() const;
 		virtual void reduceHealth(const int reduction = 1) = 0;
 		virtual void resetWaypoint();
+		void saveState(SnapshotWriter& writer) const;
+		void loadState(SnapshotReader& reader);
 	protected:
+		// True if the first vehicle goes ahead of the second one
+		static bool isAhead(int lapA, int stageA, float distanceA, int lapB, int stageB, float distanceB);
+
 		const VehicleType type;
 		float mDistanceToCheckpoint = 0;
 		std::string mTag;